@@ -0,0 +1,59 @@
+#ifndef AHOCORASICK_H
+#define AHOCORASICK_H
+
+#include <cstdint>
+
+#include "patternmatcher.h"
+
+namespace {
+    constexpr size_t AC_MAX_DENSE_TRANSITIONS = 4194304;  // 16 MB transition table
+}
+
+// Aho-Corasick automaton matching any number of patterns in a single pass
+// Bytes that do not occur in any pattern share one equivalence class, which keeps the
+// transition table small; automatons small enough get a dense DFA table (one lookup per byte),
+// larger ones are run as a trie with failure links
+// Ignoring case, both cases of a letter share their equivalence class: the automaton is the same size
+// and runs at the same speed
+class AhoCorasickMatcher : public PatternMatcher
+{
+public:
+    explicit AhoCorasickMatcher(const std::vector<std::string>& Patterns, bool IgnoreCase = false);
+
+    void FindAll(std::string_view Contents, std::vector<Match>& Matches) const override;
+
+    const char* name() const override;
+
+private:
+    // Builds the trie, the failure links and the output links
+    void Build();
+
+    // Fills the dense transition table from the trie and failure links
+    void BuildDenseTable();
+
+    // Follows the trie and failure links from State on Class
+    uint32_t NextState(uint32_t State, uint16_t Class) const;
+
+    // Reports every pattern ending at Position, starting from the output state Output
+    void ReportMatches(uint32_t Output, size_t Position, std::vector<Match>& Matches) const;
+
+    static constexpr uint32_t NO_STATE = UINT32_MAX;
+
+    uint16_t              _byteClass[256];
+    uint16_t              _numClasses;
+    // trie edges of state s: [_edgeStart[s], _edgeStart[s + 1]) in _edgeClass / _edgeTarget
+    std::vector<uint32_t> _edgeStart;
+    std::vector<uint16_t> _edgeClass;
+    std::vector<uint32_t> _edgeTarget;
+    std::vector<uint32_t> _fail;
+    // pattern ending exactly in a state, or NO_STATE
+    std::vector<uint32_t> _terminal;
+    // nearest state (itself or through failure links) where a pattern ends, or NO_STATE
+    std::vector<uint32_t> _output;
+    // next state with a pattern ending, following failure links from a terminal state
+    std::vector<uint32_t> _outputLink;
+    // dense DFA: _dense[state * _numClasses + class]; empty when too large
+    std::vector<uint32_t> _dense;
+};
+
+#endif // AHOCORASICK_H
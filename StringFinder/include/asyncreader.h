@@ -0,0 +1,103 @@
+#ifndef ASYNCREADER_H
+#define ASYNCREADER_H
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <filesystem>
+
+#include "concurrentqueue.h"
+#include "statistics.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr int    DEFAULT_IO_DEPTH = 64;
+    constexpr int    MAX_IO_DEPTH = 4096;
+    constexpr size_t ASYNC_READ_MAX_SIZE = 1048576;  // in bytes; 1 MB
+    constexpr int    MAX_READER_THREADS = 8;         // fallback backend
+}
+
+// Read stage placed between the file enumeration and the search workers: keeps up to QueueDepth files
+// being opened and read at once, so the device always has work queued while the workers search the
+// files already read (the output queue holds up to QueueDepth more files: reading and searching
+// overlap, like a double buffer)
+// Small regular files (up to ASYNC_READ_MAX_SIZE) are read whole; larger files and inputs that are not
+// regular files are handed over unread, to be memory mapped or streamed by the workers; so are files
+// that cannot be open or read, the workers then report the error
+// Two backends:
+//  - io_uring (Linux 5.6 and later): a single thread submits the open and stat of every new file
+//    together, then its read once both are done, and reaps completions in batches; no thread blocks
+//    per file, and it only waits for the source when no operation is in flight: completions are never
+//    held behind a slow enumeration
+//  - fallback, when io_uring is not available: a small pool of threads (QueueDepth, at most
+//    MAX_READER_THREADS) each open, stat and pread one file at a time; QueueDepth still bounds the
+//    output queue
+class AsyncReader
+{
+public:
+    // Next file to read and its sequence number; returns false once there are no more files
+    // With Wait false the source must not block: it returns true with an empty File if no file is ready yet
+    using SourceFunction = std::function<bool(fs::path& File, uint64_t& Sequence, bool Wait)>;
+
+    struct ReadFile
+    {
+        fs::path    path;
+        uint64_t    sequence;
+        bool        isRead;    // false: to be open by the consumer
+        std::string contents;
+    };
+
+    AsyncReader(SourceFunction Source, int QueueDepth = DEFAULT_IO_DEPTH, bool UseRing = true);
+
+    AsyncReader(const AsyncReader& r) = delete;
+
+    AsyncReader& operator=(const AsyncReader& r) = delete;
+
+    ~AsyncReader();
+
+    // Counts the files read whole and their bytes, and times the reads; must be called before Start()
+    void UseStatistics(Statistics& Stats);
+
+    // Starts the read stage; returns immediately
+    void Start();
+
+    // Next file, in completion order; returns false once every file was handed over
+    bool Pop(ReadFile& File);
+
+    // Blocks until every file was handed over
+    void Wait();
+
+    // Name of the backend in use, valid once started
+    const char* backend() const;
+
+private:
+    // Submission and completion rings of io_uring, driven through raw system calls
+    class IoRing;
+
+    // io_uring backend, run by a single thread
+    void RunRing();
+
+    // Fallback backend, run by every thread
+    void RunThread();
+
+    // Adds a file read whole to the statistics, if any
+    void CountRead(const ReadFile& File);
+
+    SourceFunction            _source;
+    int                       _queueDepth;
+    bool                      _useRing;
+    std::unique_ptr<IoRing>   _ring;  // null with the fallback backend
+    Statistics*               _statistics;
+    ConcurrentQueue<ReadFile> _output;
+    std::mutex                _sourceMutex;
+    std::atomic<int>          _runningThreads;
+    std::vector<std::thread>  _threads;
+};
+
+#endif // ASYNCREADER_H
@@ -0,0 +1,53 @@
+#ifndef CASEFOLDING_H
+#define CASEFOLDING_H
+
+#include <string>
+#include <cstddef>
+#include <string_view>
+
+// ASCII case folding used by the case insensitive search (-i)
+// Only A-Z and a-z are folded; every other byte, UTF-8 sequences included, only matches itself
+// Contents are never folded: the matchers fold the bytes they compare, so prefixes and suffixes are
+// still taken from the original bytes
+namespace {
+    inline bool IsAsciiLetter(char Byte)
+    {
+        const unsigned char lower = static_cast<unsigned char>(Byte) | 0x20;
+
+        return (lower >= 'a') && (lower <= 'z');
+    }
+
+    // Lowercase letter, or Byte itself
+    inline char FoldCase(char Byte)
+    {
+        return IsAsciiLetter(Byte) ? static_cast<char>(Byte | 0x20) : Byte;
+    }
+
+    inline std::string FoldCase(std::string_view String)
+    {
+        std::string folded(String);
+
+        for (auto&& byte : folded)
+        {
+            byte = FoldCase(byte);
+        }
+
+        return folded;
+    }
+
+    // Compares Size bytes of Data with Folded (already folded)
+    inline bool EqualsFolded(const char* Data, const char* Folded, size_t Size)
+    {
+        for (size_t i = 0; i < Size; ++i)
+        {
+            if (FoldCase(Data[i]) != Folded[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+#endif // CASEFOLDING_H
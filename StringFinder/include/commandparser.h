@@ -2,24 +2,33 @@
 #define COMMANDVALIDATOR_H
 
 #include <string>
+#include <vector>
+
+#include "searchoptions.h"
 
 namespace {
-constexpr int ARGUMENTS_NUMBER = 3;
+constexpr int MIN_ARGUMENTS_NUMBER = 3;
 constexpr int PATH_MIN_LENGTH = 0;
 constexpr int PATH_MAX_LENGTH = 128;
 constexpr int STRING_MIN_LENGTH = 0;
 constexpr int STRING_MAX_LENGTH = 128;
+constexpr int MAX_THREADS_NUMBER = 1024;
+constexpr int MAX_CACHE_SIZE = 1048576;  // in MB; 1 TB
 }
 
 // Class used to validate command line arguments and transform them in a
 // suitable format for processing
-// Provides getters for location and search string
+// Provides getters for location and search strings
+// Accepted forms:
+//    <path> <search_string>
+//    <path> -e <search_string> [-e <search_string> ...] [-f <patterns_file>]
+// followed or preceded by options (see PrintHelp())
 class CommandParser
 {
 public:
     CommandParser();
 
-    // Validate location and search string
+    // Validate location and search strings
     bool ValidateArguments(const int Argc, const char * const Argv[]);
 
     // Used for debugging
@@ -27,7 +36,10 @@ public:
 
     std::string location() const;
 
-    std::string searchString() const;
+    // Unique search strings, in command line order
+    std::vector<std::string> searchStrings() const;
+
+    SearchOptions options() const;
 
 private:
     // Validates that a string has the length between min and max limits
@@ -36,17 +48,42 @@ private:
     // Validates that the provided path is a file or a directory
     bool IsPathValid(const char * const Path) const;
 
-    // Validates the string length and content
+    // Validates the string length (any byte is searched for)
     bool IsSearchStringValid(const char * const SearchString) const;
 
-    // TODO: implement as per requirements
-    bool ContainsOnlyValidChars(const char * const SearchString) const;
+    // Validates a search string and adds it to the list (duplicates are ignored)
+    bool AddSearchString(const char * const SearchString);
+
+    // Adds every non empty line of a file as a search string
+    bool ReadPatternsFile(const char * const FileName);
+
+    // Sets the number of worker threads from its command line value
+    bool ParseThreadCount(const char * const ThreadCount);
+
+    // Sets the number of files read ahead of the search
+    bool ParseIoDepth(const char * const IoDepth);
+
+    // Reads the maximum size of the result cache, in MB
+    bool ParseCacheSize(const char * const CacheSize);
+
+    // Sets the output format from its command line name
+    bool ParseFormat(const char * const Format);
+
+    // Sets how binary files are handled from its command line name
+    bool ParseBinaryFiles(const char * const BinaryFiles);
+
+    // Adds a comma separated list of extensions to exclude
+    bool ParseExtensions(const char * const Extensions);
+
+    // Adds a glob to exclude or to include, once checked
+    bool AddGlob(const char * const Glob, std::vector<std::string>& Globs);
 
     // Show application usage
     void PrintHelp() const;
 
-    std::string _location;
-    std::string _searchString;
+    std::string              _location;
+    std::vector<std::string> _searchStrings;
+    SearchOptions            _options;
 };
 
 #endif // COMMANDVALIDATOR_H
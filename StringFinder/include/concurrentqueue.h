@@ -0,0 +1,127 @@
+#ifndef CONCURRENTQUEUE_H
+#define CONCURRENTQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <cstdint>
+#include <condition_variable>
+
+// Multi-producer / multi-consumer FIFO queue used to hand work between pipeline stages
+// Producers call Close() once no more items will be pushed; consumers drain the remaining
+// items and then Pop() returns false
+// A non-zero capacity bounds the queue: Push() blocks while the queue is full
+template <typename T>
+class ConcurrentQueue
+{
+public:
+    explicit ConcurrentQueue(size_t Capacity = 0) : _capacity{ Capacity }, _closed{ false }, _popCount{ 0 }
+    {
+    }
+
+    ConcurrentQueue(const ConcurrentQueue& q) = delete;
+
+    ConcurrentQueue& operator=(const ConcurrentQueue& q) = delete;
+
+    // Appends an item; returns false if the queue was already closed
+    bool Push(T Item)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _notFull.wait(lock, [this] { return _closed || (0 == _capacity) || (_items.size() < _capacity); });
+
+        if (_closed)
+        {
+            return false;
+        }
+
+        _items.push_back(std::move(Item));
+        lock.unlock();
+        _notEmpty.notify_one();
+
+        return true;
+    }
+
+    // Waits for an item; returns false once the queue is closed and empty
+    bool Pop(T& Item)
+    {
+        uint64_t sequence = 0;
+
+        return Pop(Item, sequence);
+    }
+
+    // Same as Pop(Item); Sequence receives the rank of the item in pop order (0 for the first
+    // item ever popped), which gives consumers a total order over the items
+    bool Pop(T& Item, uint64_t& Sequence)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _notEmpty.wait(lock, [this] { return _closed || !_items.empty(); });
+
+        if (_items.empty())
+        {
+            return false;
+        }
+
+        Item = std::move(_items.front());
+        _items.pop_front();
+        Sequence = _popCount++;
+        lock.unlock();
+        _notFull.notify_one();
+
+        return true;
+    }
+
+    // Same as Pop(Item), without waiting: returns false if the queue is currently empty
+    bool TryPop(T& Item)
+    {
+        uint64_t sequence = 0;
+        bool     isClosed = false;
+
+        return TryPop(Item, sequence, isClosed);
+    }
+
+    // Same as Pop(Item, Sequence), without waiting: returns false if the queue is currently empty;
+    // IsClosed then tells whether no item will ever come
+    bool TryPop(T& Item, uint64_t& Sequence, bool& IsClosed)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        IsClosed = _closed;
+
+        if (_items.empty())
+        {
+            return false;
+        }
+
+        Item = std::move(_items.front());
+        _items.pop_front();
+        Sequence = _popCount++;
+        lock.unlock();
+        _notFull.notify_one();
+
+        return true;
+    }
+
+    // Wakes up all waiting consumers; no more items are accepted afterwards
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+
+        _notEmpty.notify_all();
+        _notFull.notify_all();
+    }
+
+private:
+    const size_t            _capacity;
+    bool                    _closed;
+    uint64_t                _popCount;
+    std::deque<T>           _items;
+    std::mutex              _mutex;
+    std::condition_variable _notEmpty;
+    std::condition_variable _notFull;
+};
+
+#endif // CONCURRENTQUEUE_H
@@ -0,0 +1,106 @@
+#ifndef CONTENTSNIFFER_H
+#define CONTENTSNIFFER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+// Binary file detection used by --binary: a file is classified from its first SNIFF_SIZE bytes only,
+// so a large binary file is skipped before the rest of it is read
+//  - a NUL byte makes a file binary (text never holds one; UTF-16 text is not searchable byte by byte)
+//  - so do more than MAX_INVALID_UTF8_PERCENT of bytes outside valid UTF-8 sequences: compressed or
+//    encoded data has about half of them, text in a single byte encoding (Latin-1) only a few
+// Files whose extension is in BINARY_EXTENSIONS are binary whatever their contents; skipping them
+// needs no read at all (see PathFilter)
+namespace {
+    constexpr size_t SNIFF_SIZE = 8192;               // in bytes
+    constexpr size_t MAX_INVALID_UTF8_PERCENT = 30;
+
+    constexpr std::string_view BINARY_EXTENSIONS[] = {
+        "7z", "a", "avi", "bin", "bmp", "bz2", "class", "dll", "dylib", "exe", "gif", "gz", "ico",
+        "jar", "jpeg", "jpg", "lib", "mkv", "mov", "mp3", "mp4", "o", "obj", "pdb", "pdf", "png", "pyc",
+        "so", "tgz", "wasm", "webp", "xz", "zip", "zst"
+    };
+
+    // Number of bytes of the valid UTF-8 sequence starting at Data (at most Size bytes long), 0 if there
+    // is none; overlong forms, surrogates and code points past U+10FFFF are not valid
+    inline size_t Utf8SequenceSize(const uint8_t* Data, size_t Size)
+    {
+        const uint8_t lead = Data[0];
+        size_t        size = 0;
+        uint8_t       low = 0x80;
+        uint8_t       high = 0xBF;
+
+        if (lead < 0x80)
+        {
+            return 1;
+        }
+
+        if ( (lead >= 0xC2) && (lead <= 0xDF) )
+        {
+            size = 2;
+        }
+        else if ( (lead >= 0xE0) && (lead <= 0xEF) )
+        {
+            size = 3;
+            low = (0xE0 == lead) ? 0xA0 : 0x80;
+            high = (0xED == lead) ? 0x9F : 0xBF;
+        }
+        else if ( (lead >= 0xF0) && (lead <= 0xF4) )
+        {
+            size = 4;
+            low = (0xF0 == lead) ? 0x90 : 0x80;
+            high = (0xF4 == lead) ? 0x8F : 0xBF;
+        }
+        else
+        {
+            return 0;
+        }
+
+        if (Size < size)
+        {
+            return 0;
+        }
+
+        // only the second byte has narrower bounds
+        for (size_t i = 1; i < size; ++i)
+        {
+            if ( (Data[i] < low) || (Data[i] > high) )
+            {
+                return 0;
+            }
+
+            low = 0x80;
+            high = 0xBF;
+        }
+
+        return size;
+    }
+
+    // Returns true if the first SNIFF_SIZE bytes of Contents (a whole file, or its first bytes) look binary
+    inline bool IsBinaryContents(std::string_view Contents)
+    {
+        const std::string_view start = Contents.substr(0, SNIFF_SIZE);
+        const uint8_t*         data = reinterpret_cast<const uint8_t*>( start.data() );
+        // a sequence cut by the end of the sniffed bytes is not counted as invalid
+        const size_t           end = (start.size() < Contents.size()) ? start.size() - 3 : start.size();
+        size_t                 invalidBytes = 0;
+
+        if (std::string_view::npos != start.find('\0'))
+        {
+            return true;
+        }
+
+        for (size_t i = 0; i < end; )
+        {
+            const size_t size = Utf8SequenceSize( data + i, start.size() - i );
+
+            invalidBytes += (0 == size) ? 1 : 0;
+            i += (0 == size) ? 1 : size;
+        }
+
+        return (invalidBytes * 100 > start.size() * MAX_INVALID_UTF8_PERCENT);
+    }
+}
+
+#endif // CONTENTSNIFFER_H
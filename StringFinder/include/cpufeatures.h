@@ -0,0 +1,63 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Instruction set extensions supported by the running CPU and enabled by the OS;
+// detected once, on first use, and used to select the vectorized kernels at run time
+struct CpuFeatures
+{
+    bool sse2;
+    bool ssse3;
+    bool avx2;
+    bool avx512bw;
+
+    static const CpuFeatures& Detect();
+};
+
+// Kernels are compiled for their own instruction set, whatever the baseline of the build;
+// they must only be called after checking CpuFeatures
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2   __attribute__((target("sse2")))
+#define TARGET_SSSE3  __attribute__((target("ssse3")))
+#define TARGET_AVX2   __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define TARGET_SSE2
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_X86
+#endif
+
+// Index of the lowest set bit; Mask must not be 0
+inline unsigned TrailingZeros(uint32_t Mask)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward(&index, Mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>( __builtin_ctz(Mask) );
+#endif
+}
+
+// Index of the lowest set bit; Mask must not be 0
+inline unsigned TrailingZeros64(uint64_t Mask)
+{
+#ifdef _MSC_VER
+    const uint32_t low = static_cast<uint32_t>(Mask);
+    return (0 != low) ? TrailingZeros(low) : 32 + TrailingZeros( static_cast<uint32_t>(Mask >> 32) );
+#else
+    return static_cast<unsigned>( __builtin_ctzll(Mask) );
+#endif
+}
+
+#endif // CPUFEATURES_H
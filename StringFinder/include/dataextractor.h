@@ -1,26 +1,61 @@
 #ifndef DATAEXTRACTOR_H
 #define DATAEXTRACTOR_H
 
-#include <map>
+#include <mutex>
+#include <atomic>
 #include <vector>
+#include <memory>
 #include <string>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <string_view>
 #include <filesystem>
-#include <fstream>
-#include <streambuf>
 
-namespace fs = std::experimental::filesystem;
+#include "patternmatcher.h"
+#include "stringdata.h"
+#include "searchoptions.h"
+#include "outputbuffer.h"
+#include "resultformatter.h"
+#include "mappedfile.h"
+#include "threadpool.h"
+#include "resultcache.h"
+#include "asyncreader.h"
+#include "statistics.h"
+#include "filewatcher.h"
+#include "pathfilter.h"
+#include "directorymanifest.h"
+
+namespace fs = std::filesystem;
 
 namespace {
-    constexpr int       AFFIX_SIZE = 3;
-    constexpr uintmax_t MAX_FILE_SIZE = 104857600;  // in bytes; 100 MB
-    constexpr unsigned  BLOCK_SIZE = sizeof(char) * 5242880;
-    constexpr unsigned  BUFFER_SIZE = 100;
-    constexpr int       NUM_THREADS = 4;
+    constexpr size_t FILE_CHUNK_SIZE = 8388608;  // in bytes; 8 MB
+    constexpr size_t CHUNK_RESUME_WINDOW = 65536;  // bytes searched again at once where a match runs into a chunk
 }
-// Class used to extract positions, prefixes and suffixes for all occurrences  of a 
-// search string from file/files located at specified location; 
+
+// Class used to extract positions, prefixes and suffixes for all occurrences  of one or 
+// several search strings from file/files located at specified location; 
+// All search strings are compiled into a single matcher, so every file is scanned only once; 
 // If the location represent a directory, all files located inside it (including subdirectories)
 // will be taken into account
+// Files are searched by a work stealing thread pool; files larger than FILE_CHUNK_SIZE are split into
+// chunks (overlapping by the longest match size) that any idle worker can steal, so a single huge file
+// keeps all workers busy
+// With --regex, the search strings are regular expressions (see RegexMatcher); as their matches do not
+// overlap, the chunks are joined where a match runs from one chunk into the next
+// With a trigram index (see TrigramIndex), only the files the index reports as candidates are searched
+// Small files are open and read ahead of the workers by an asynchronous read stage (see AsyncReader),
+// so the device is kept busy while the workers search
+// With a result cache (see ResultCache), unchanged files are not read at all: their cached data is used
+// Files excluded by their path (extension, globs, ignore files) are dropped as they are listed, and
+// excluded directories are never walked (see PathFilter); with --binary, files
+// whose first bytes look binary (see contentsniffer.h) are skipped, or searched without affixes, before
+// the rest of them is read (the read stage reads small files whole, they are only spared the search)
+// With --stats or --progress, every stage is counted and timed (see Statistics)
+// In watch mode, the location keeps being watched once searched (see FileWatcher): files that grew are
+// only searched from where the previous search stopped, so only new matches are reported
+// Every instance is a single search, run on a thread pool it may share with other searches running
+// at the same time (see SearchEngine); a search can be cancelled from any thread
 class DataExtractor
 {
 public:
@@ -31,18 +66,6 @@ public:
         SUFFIX
     };  // Used by GetAvailableAffixChars()
 
-    // Holds the prefix and the suffix for a position
-    struct AffixData
-    {
-        void Clear();
-        
-        std::string prefix;
-        std::string suffix;
-    };
-
-    // Holds affixes data for all positions of a search string  found inside a file
-    typedef std::map< size_t, AffixData > StringData;
-
     // Holds the path of a file and the search string data found inside it
     struct FileData
     {
@@ -54,7 +77,10 @@ public:
         StringData stringData;
     };
     
-    static DataExtractor& instance(std::string SearchString, std::string Location);
+    // Receives the data of a file where the search strings were found
+    using ResultFunction = std::function<void(const fs::path& File, const StringData& Data)>;
+
+    DataExtractor(std::vector<std::string> SearchStrings, std::string Location, SearchOptions Options = SearchOptions());
 
     DataExtractor operator=(DataExtractor& d) = delete;
 
@@ -62,47 +88,159 @@ public:
 
     ~DataExtractor();
 
-    // Populates the vector containing all files data
-    void ExtractData();
+    // Populates the vector containing all files data, searching on the workers of Pool
+    // When streaming, the data of every file is displayed as soon as the file is done instead
+    // With OnResult, the data of every file is handed to it as soon as the file is done (one file at a
+    // time, in path order with orderedOutput) instead of being kept or displayed
+    // Returns early, with the results found so far, once cancelled
+    void ExtractData(ThreadPool& Pool, ResultFunction OnResult = nullptr);
+
+    // Writes the results to an open descriptor (e.g. a client socket) instead of the standard output
+    // or the output file; must be called before ExtractData()
+    void SetOutput(int Descriptor, bool IsColorized);
+
+    // Reuses and updates Manifest, shared with other searches of the location, instead of opening the
+    // manifest file of the options; must be called before ExtractData()
+    void UseManifest(DirectoryManifest& Manifest);
+
+    // Watch mode: searches the changes of the location (see FileWatcher) and displays their new matches,
+    // until cancelled; must follow ExtractData() and DisplayData()
+    void WatchChanges(ThreadPool& Pool);
+
+    // Stops the search as soon as possible: files not started yet are skipped; may be called from any
+    // thread, before or during ExtractData()
+    void Cancel();
+
+    bool cancelled() const;
+
+    // Data of all files where the search strings were found, in path order (not when streaming)
+    const std::vector< std::shared_ptr<FileData> >& results() const;
+
+    // Counters and timers of the search; null unless the statistics or the progress are displayed
+    const Statistics* statistics() const;
 
     // Iterates through the  vector containing all files data and displays on the standard output,
-    // for each file, the positions where the search string was found and the prefix and suffix 
+    // for each file, the positions where the search strings were found and the prefix and suffix 
     // associated with each position
+    // When streaming, only displays the number of files where the search strings were found
+    // Results are written in the selected output format, to the output file if any, followed by
+    // the statistics of the search with --stats
     void DisplayData();
 
 private:
-    DataExtractor(std::string SearchString, std::string Location);
+    // Hands the data of a searched file over to the results (Data is null if the file cannot be read);
+    // called once per file, by the worker that finished it
+    using DeliverFunction = std::function<void(int WorkerId, uint64_t Sequence, std::shared_ptr<FileData> Data)>;
 
-    // Finds search string positions inside a single file and their associated affixes
-    void ExtractFileData(const fs::path& File, std::shared_ptr<FileData>& FileData);
+    // Watch mode: bytes of a file searched so far, and end of the last match found in them
+    struct SearchedSize
+    {
+        uint64_t size;
+        uint64_t matchEnd;
+    };
+
+    // A large file, searched chunk by chunk by several workers
+    struct ChunkedFile
+    {
+        fs::path                                        path;
+        uint64_t                                        sequence;
+        MappedFile                                      file;
+        std::vector< std::vector<PatternMatcher::Match> > chunkMatches;
+        std::atomic<size_t>                             remainingChunks;
+        std::string                                     cacheKey;
+        bool                                            withAffixes;
+    };
+
+    // Displays the search strings and the number of files where they were found (text format)
+    void DisplaySummary(const size_t NumberOfFiles);
+
+    // Finds search strings positions inside a single file and their associated affixes
+    // The file is memory mapped and scanned without being copied, whatever its size; large files
+    // are split into chunks pushed to the pool, and delivered by the worker finishing the last one
+    // Inputs that cannot be mapped are streamed instead
+    // Files found unchanged in the result cache are delivered without being opened
+    void SearchFile(ThreadPool& Pool, int WorkerId, const fs::path& File, uint64_t Sequence,
+                    const DeliverFunction& Deliver);
 
-    // Finds search string positions inside a single file and their associated affixes for files over 100 MB
-    // Decreases memory usage but increases processing time
-    void ExtractBigFileData(const fs::path& FileName, std::shared_ptr<FileData>& Data);
+    // Searches one chunk of a large file; the worker finishing the last chunk delivers the file data
+    void SearchChunk(ChunkedFile& File, size_t Chunk, int WorkerId, const DeliverFunction& Deliver);
 
-    // Obtains a list of files located at the specified location (recursively iterates through directories)
-    std::vector<fs::path> GetFileList(const fs::path& Path);
+    // Searches a small file already read by the read stage (see AsyncReader)
+    void SearchContents(int WorkerId, const AsyncReader::ReadFile& File, const DeliverFunction& Deliver);
 
-    // Reads contents of a file in memory
-    std::string ReadFile(fs::path) const;
+    // Searches an input that cannot be memory mapped, block by block (see StreamScanner); returns null
+    // if it cannot be read
+    std::shared_ptr<FileData> SearchStream(const fs::path& File);
+
+    // Watch mode: searches the bytes of a changed file that were not searched yet (the whole file if it
+    // was replaced or truncated); returns null if there is nothing new to search
+    std::shared_ptr<FileData> SearchChanges(const FileWatcher::Change& Change);
+
+    // Watch mode: remembers how many bytes of a file were searched, and where the last match found in
+    // them ended
+    void RecordSearchedSize(const fs::path& File, uint64_t Size, uint64_t MatchEnd = 0);
+
+    // Finds all search strings inside Contents (a file or a chunk) starting at Start or after it, counted
+    // and timed with statistics
+    void Search(const std::string_view& Contents, size_t Start, std::vector<PatternMatcher::Match>& Matches);
+
+    // Regular expressions: appends the matches of the chunk ending at ChunkEnd to those of the chunks
+    // before it; a chunk is searched as if no match ran into it, so where one does, the chunk is searched
+    // again from the end of that match until both searches agree
+    void AppendChunkMatches(const std::string_view& Contents, size_t ChunkEnd,
+                            const std::vector<PatternMatcher::Match>& ChunkMatches,
+                            std::vector<PatternMatcher::Match>& FileMatches);
+
+    // Binary files: returns false if the file starting with Contents is skipped; WithAffixes tells whether
+    // the affixes of its matches are extracted
+    bool InspectContents(const std::string_view& Contents, bool& WithAffixes);
+
+    // Collects the affixes of all matches found in a file (only their positions without affixes)
+    std::shared_ptr<FileData> BuildFileData(const fs::path& File, const std::string_view& Contents,
+                                            const std::vector<PatternMatcher::Match>& Matches,
+                                            bool WithAffixes = true);
 
     // Depending on type, prefix of suffix, computes the available length to be extracted
-    size_t GetAvailableAffixChars(const AffixType Type, const size_t Pos, 
+    size_t GetAvailableAffixChars(const AffixType Type, const size_t Pos, const size_t MatchSize,
                                                          const size_t ContentsSize);
 
-    // Extracts the prefix and the suffix associated to a specified position
-    AffixData GetAffixData(const std::string& Contents, const size_t Pos);
+    // Extracts the prefix and the suffix associated to a match; the returned views point inside Contents
+    StringData::AffixView GetAffixData(const std::string_view& Contents, const PatternMatcher::Match& Match);
 
-    // Verifies if the search string was found in a file
+    // Verifies if any search string was found in a file
     bool IsEmpty(const std::shared_ptr<FileData>& Data);
 
-    // Properly displays a string containing special characters on standard output; 
-    // (e.g. tabs will be displayed as '\t', newlines as '\n' etc.)
-    void DisplayString(std::ostream& OutStream, const std::string& CppString);
-
-    std::string           _searchString;
-    std::string           _location;
-    size_t                _searchStringSize;
+    // Displays a highlighted value on standard output
+    void DisplayValue(const std::string_view& Value);
+
+    void DisplayValue(const uint64_t Value);
+
+    std::vector<std::string>        _searchStrings;
+    std::string                     _location;
+    std::unique_ptr<PatternMatcher> _matcher;
+    // bytes shared by consecutive chunks (longest match size): matches starting in a chunk may end in
+    // the next one
+    size_t                          _chunkOverlap;
+    SearchOptions                   _options;
+    // files excluded by their name, from the options
+    PathFilter                      _pathFilter;
+    size_t                          _streamedFiles;
+    // all results are displayed through this buffer (standard output or output file)
+    OutputBuffer                    _output;
+    std::unique_ptr<ResultFormatter> _formatter;
+    // null without --cache
+    std::unique_ptr<ResultCache>    _cache;
+    // null without --stats and --progress
+    std::unique_ptr<Statistics>     _statistics;
+    // null unless given to ExtractData()
+    ResultFunction                  _onResult;
+    // null unless given to UseManifest()
+    DirectoryManifest*              _sharedManifest;
+    std::atomic<bool>               _cancelled;
+    // watch mode only: set up before the first search, so no change is missed
+    std::unique_ptr<FileWatcher>    _watcher;
+    std::mutex                      _searchedSizesMutex;
+    std::unordered_map<std::string, SearchedSize> _searchedSizes;
     std::vector< std::shared_ptr<FileData> > _extractedData;
 };
 
@@ -0,0 +1,104 @@
+#ifndef DIRECTORYMANIFEST_H
+#define DIRECTORYMANIFEST_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <filesystem>
+
+#include "mappedfile.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr std::string_view MANIFEST_FILE_MAGIC = "SFMANIF1";
+    constexpr std::string_view MANIFEST_FILE_END_MAGIC = "SFMANEND";
+    constexpr uint32_t         MANIFEST_FILE_VERSION = 1;
+    constexpr size_t           MANIFEST_FILE_HEADER_SIZE = 8 + 4 + 4;
+    constexpr size_t           MANIFEST_FILE_FOOTER_SIZE = 8 + 8 + 8;
+    constexpr uint64_t         RACY_WRITE_TIME = 2000000000;  // in nanoseconds; 2 s
+}
+
+// Cache of the listings of all directories of a location, kept on disk between runs
+// A directory is stamped with its identity (device, inode) and its last write time, which changes
+// whenever an entry is added, removed or renamed inside it: while the stamp is unchanged, the cached
+// listing (names and types of the entries) is used instead of reading the directory and checking the
+// type of every entry, so walking an unchanged tree costs a single stat per directory
+// Directories modified less than RACY_WRITE_TIME before being listed are never reused, as they may
+// still change within the same write time
+// Listings found in the manifest file, or read again, are kept in memory: a manifest may outlive a
+// single walk and be shared by concurrent ones (see SearchServer), each saving it when done
+// Layout of the manifest file (fixed size integers are little endian, varints LEB128, see encoding.h):
+//
+//  header            MANIFEST_FILE_MAGIC | u32 version | u32 reserved
+//                    varint root size | canonical root of the location
+//  directory records varint path size | path relative to the root | u64 device | u64 inode |
+//                    u64 write time | varint entry count
+//                    per entry: u8 is directory | varint name size | name
+//  directory table   per directory, sorted by path: u64 offset of the record
+//  footer            u64 directory count | u64 directory table offset | MANIFEST_FILE_END_MAGIC
+class DirectoryManifest
+{
+public:
+    struct Entry
+    {
+        std::string name;
+        bool        isDirectory;
+    };
+
+    // Identity and last write time of a directory
+    struct Stamp
+    {
+        uint64_t device;
+        uint64_t inode;
+        uint64_t writeTime;  // in nanoseconds
+    };
+
+    DirectoryManifest();
+
+    DirectoryManifest(const DirectoryManifest& m) = delete;
+
+    DirectoryManifest& operator=(const DirectoryManifest& m) = delete;
+
+    // Loads the manifest of Root from ManifestFile; a missing, invalid or foreign manifest
+    // just starts empty
+    void Open(const fs::path& ManifestFile, const fs::path& Root);
+
+    // Stamp of Directory; returns false if it cannot be read
+    static bool GetStamp(const fs::path& Directory, Stamp& DirectoryStamp);
+
+    // Cached listing of the directory at RelativePath, if its stamp did not change; thread safe
+    bool Lookup(const std::string& RelativePath, const Stamp& DirectoryStamp, std::vector<Entry>& Entries);
+
+    // Records the listing of a directory read again; thread safe
+    void Record(std::string RelativePath, const Stamp& DirectoryStamp, const std::vector<Entry>& Entries);
+
+    // Writes every directory looked up or recorded to ManifestFile (replaced atomically), unless
+    // nothing changed since the last save; thread safe, saves are serialised
+    bool Save(const fs::path& ManifestFile);
+
+private:
+    struct DirectoryRecord
+    {
+        Stamp              stamp;
+        std::vector<Entry> entries;
+    };
+
+    // Listing of the directory at RelativePath in the manifest file, if its stamp did not change
+    bool LookupFile(std::string_view RelativePath, const Stamp& DirectoryStamp, std::vector<Entry>& Entries) const;
+
+    MappedFile                             _file;
+    std::string_view                       _contents;
+    std::string                            _root;
+    size_t                                 _directoryCount;
+    const char*                            _directoryTable;
+    std::mutex                             _mutex;
+    std::map<std::string, DirectoryRecord> _records;
+    bool                                   _isModified;
+    std::mutex                             _saveMutex;
+};
+
+#endif // DIRECTORYMANIFEST_H
@@ -0,0 +1,130 @@
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <condition_variable>
+
+#include "concurrentqueue.h"
+#include "directorymanifest.h"
+#include "statistics.h"
+#include "pathfilter.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr int    NUM_WALKER_THREADS = 2;
+    constexpr size_t FILE_QUEUE_CAPACITY = 65536;
+}
+
+// Class used to enumerate, exactly once, all regular files located at a specified location
+// Directories are shared between several walker threads (each thread lists one directory at a time,
+// non recursively) and every file found is pushed into a queue as soon as it is known, so consumers
+// can start processing before the traversal is over
+// The file queue is closed when the whole tree has been walked
+// In ordered mode a single thread walks the tree depth first, listing every directory in sorted order,
+// so files are pushed in path order
+// With a manifest, directories that did not change since the previous run are not read again:
+// their cached listing is used instead
+// With a path filter, excluded files are dropped as they are listed, before being queued, and excluded
+// directories are pruned: neither they nor anything under them is ever listed (the listing itself,
+// and the manifest, keep them); the ignore files of every directory listed are read along the way
+class DirectoryWalker
+{
+public:
+    DirectoryWalker(const fs::path& Root, ConcurrentQueue<fs::path>& FileQueue, bool Ordered = false,
+                    int NumThreads = NUM_WALKER_THREADS);
+
+    DirectoryWalker(const DirectoryWalker& w) = delete;
+
+    DirectoryWalker& operator=(const DirectoryWalker& w) = delete;
+
+    ~DirectoryWalker();
+
+    // Reuses and updates the listings of Manifest; must be called before Start()
+    void UseManifest(DirectoryManifest& Manifest);
+
+    // Counts the directories listed and the files found, and times the listings; must be called before Start()
+    void UseStatistics(Statistics& Stats);
+
+    // Only queues the files, and only walks the directories, Filter accepts (a root that is a file is
+    // always queued); must be called before Start()
+    void UsePathFilter(const PathFilter& Filter);
+
+    // Starts the walker threads; returns immediately
+    void Start();
+
+    // Blocks until the traversal is over
+    void Wait();
+
+    // Ends the traversal early (e.g. the search was cancelled): no more directories are listed and
+    // the file queue is closed; may be called from any thread
+    void Stop();
+
+    // Directories whose listing came from the manifest, and directories read again while a manifest
+    // is used, by this walk
+    size_t reusedDirectories() const;
+
+    size_t readDirectories() const;
+
+private:
+    // A directory to list; its path from the root and its ignore rules are only known with a path filter
+    struct PendingDirectory
+    {
+        fs::path                           path;
+        std::string                        relativePath;
+        std::shared_ptr<const IgnoreRules> rules;
+    };
+
+    // Lists pending directories until there is nothing left to walk
+    void WalkerThread();
+
+    // Pushes the files of a single directory into the file queue and its subdirectories
+    // into the pending directories list
+    void ListDirectory(const PendingDirectory& Directory);
+
+    // Ordered mode: pushes all files located under Directory, in path order
+    void WalkOrdered(const PendingDirectory& Directory);
+
+    // Names and types of the entries of Directory (symbolic links to directories are not followed),
+    // from the manifest when the directory did not change; returns false if it cannot be read
+    bool ReadDirectory(const fs::path& Directory, std::vector<DirectoryManifest::Entry>& Entries);
+
+    // Adds a listed directory and its files to the statistics, if any
+    void CountEntries(const std::vector<DirectoryManifest::Entry>& Entries);
+
+    // Rules applying to the entries of a listed directory: those of its ignore files, if the path
+    // filter uses them and Entries has some, on top of the rules of its parent
+    std::shared_ptr<const IgnoreRules> DirectoryRules(const PendingDirectory& Directory,
+                                                      const std::vector<DirectoryManifest::Entry>& Entries) const;
+
+    // Returns true if the path filter excludes an entry of Directory, and counts it; RelativePath is
+    // set to the path of the entry from the root when there is a path filter
+    bool IsExcluded(const PendingDirectory& Directory, const DirectoryManifest::Entry& Entry,
+                    const IgnoreRules* Rules, std::string& RelativePath);
+
+    fs::path                     _root;
+    DirectoryManifest*           _manifest;
+    Statistics*                  _statistics;
+    const PathFilter*            _pathFilter;
+    ConcurrentQueue<fs::path>&   _fileQueue;
+    bool                         _ordered;
+    int                          _numThreads;
+    std::deque<PendingDirectory> _pendingDirectories;
+    int                          _busyWalkers;
+    bool                         _finished;
+    std::atomic<bool>            _stopped;
+    std::atomic<size_t>          _reusedDirectories;
+    std::atomic<size_t>          _readDirectories;
+    std::mutex                   _mutex;
+    std::condition_variable      _workAvailable;
+    std::vector<std::thread>     _threads;
+};
+
+#endif // DIRECTORYWALKER_H
@@ -0,0 +1,70 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Integer encodings used by the binary files written by the application (result files, index files)
+// Fixed size integers are little endian; varints are LEB128 (7 bits per byte, low bits first)
+namespace {
+    constexpr size_t MAX_VARINT_SIZE = 10;
+
+    // Writes Value at Buffer (at least MAX_VARINT_SIZE bytes); returns the number of bytes written
+    inline size_t EncodeVarint(uint64_t Value, char* Buffer)
+    {
+        size_t size = 0;
+
+        while (Value >= 0x80)
+        {
+            Buffer[size++] = static_cast<char>( (Value & 0x7F) | 0x80 );
+            Value >>= 7;
+        }
+
+        Buffer[size++] = static_cast<char>(Value);
+
+        return size;
+    }
+
+    // Reads a varint starting at Data and moves Data past it; returns false if the varint is
+    // truncated or too long
+    inline bool DecodeVarint(const char*& Data, const char* End, uint64_t& Value)
+    {
+        Value = 0;
+
+        for (unsigned shift = 0; (Data < End) && (shift < 64); shift += 7)
+        {
+            const uint8_t byte = static_cast<uint8_t>(*Data++);
+
+            Value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+            if ( !(byte & 0x80) )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    inline void EncodeFixed(uint64_t Value, char* Buffer, size_t Size)
+    {
+        for (size_t i = 0; i < Size; ++i)
+        {
+            Buffer[i] = static_cast<char>( (Value >> (8 * i)) & 0xFF );
+        }
+    }
+
+    inline uint64_t DecodeFixed(const char* Data, size_t Size)
+    {
+        uint64_t value = 0;
+
+        for (size_t i = 0; i < Size; ++i)
+        {
+            value |= static_cast<uint64_t>( static_cast<uint8_t>(Data[i]) ) << (8 * i);
+        }
+
+        return value;
+    }
+}
+
+#endif // ENCODING_H
@@ -0,0 +1,66 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <map>
+#include <vector>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr int    WATCH_POLL_INTERVAL = 250;  // in milliseconds
+    constexpr size_t WATCH_EVENT_BUFFER_SIZE = 65536;
+}
+
+// Class used to be notified of the files created, written or moved inside a location (inotify)
+// Every directory of the location is watched (new directories as soon as they show up); a single
+// file location is watched on its own
+// When the kernel event queue overflows, changes were lost: the caller must look at every file
+// again (overflow is reported, and watches are added again for the whole location)
+// Only supported on Linux
+class FileWatcher
+{
+public:
+    // A file that changed since the last call to Wait()
+    struct Change
+    {
+        fs::path path;
+        bool     isReplaced;  // created or moved in: not the file seen before
+    };
+
+    FileWatcher();
+
+    FileWatcher(const FileWatcher& w) = delete;
+
+    FileWatcher& operator=(const FileWatcher& w) = delete;
+
+    ~FileWatcher();
+
+    // Starts watching Location and everything below it; returns false (with a message) if it cannot
+    // be watched
+    bool Open(const fs::path& Location);
+
+    // Waits up to Timeout milliseconds for changes, appended to Changes (a file may appear several
+    // times); Overflow is set if changes were lost; returns false on error
+    bool Wait(int Timeout, std::vector<Change>& Changes, bool& Overflow);
+
+    // Watches Directory and its subdirectories (again), appending all their files to Changes
+    // (not as replaced)
+    void AddTree(const fs::path& Directory, std::vector<Change>& Changes);
+
+private:
+    // Watches a single directory or file; returns false if it cannot be watched
+    bool AddWatch(const fs::path& Path, bool IsDirectory);
+
+    struct Watch
+    {
+        fs::path path;
+        bool     isDirectory;
+    };
+
+    int                  _descriptor;
+    bool                 _isLimitReported;  // out of watches (fs.inotify.max_user_watches)
+    std::map<int, Watch> _watches;          // by watch descriptor
+};
+
+#endif // FILEWATCHER_H
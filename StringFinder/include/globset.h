@@ -0,0 +1,98 @@
+#ifndef GLOBSET_H
+#define GLOBSET_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "regexmatcher.h"
+
+namespace {
+    constexpr size_t NO_GLOB = SIZE_MAX;
+    constexpr size_t GLOBS_PER_AUTOMATON = 256;  // general globs compiled into a single RegexMatcher
+}
+
+// Set of globs, in gitignore syntax, matched at once against the paths of files and directories
+// relative to a base directory ('/' separated, "src/main.cpp"):
+//  - * matches any bytes but '/', ? a single one, [abc] [a-z] [!...] a byte of a set; \ escapes
+//  - a glob without '/' matches a name at any depth ("*.log"); one with a '/' (other than a trailing
+//    one) matches from the base directory ("/build", "src/*.cpp")
+//  - a trailing '/' only matches directories ("node_modules/")
+//  - "**/" matches any number of directories, a trailing "/**" everything inside a directory
+// Most globs need no automaton: a plain name ("node_modules") is a hash lookup, a '*' followed by a
+// plain suffix ("*.log") a lookup of the tails of the name; the others are translated into regular
+// expressions over "/<path>" and compiled together into lazy DFAs (see RegexMatcher): a path is
+// run once through them, whatever their number
+class GlobSet
+{
+public:
+    struct Glob
+    {
+        std::string pattern;
+        bool        isNegated;        // a '!' rule of an ignore file (see IgnoreRules)
+        bool        isDirectoryOnly;  // trailing '/'
+    };
+
+    GlobSet();
+
+    GlobSet(const GlobSet& g) = delete;
+
+    GlobSet& operator=(const GlobSet& g) = delete;
+
+    // Adds a glob; returns false, with the reason in Error, if it is invalid; Compile() must be
+    // called again once globs are added
+    bool Add(std::string_view Pattern, bool IsNegated, std::string& Error);
+
+    // Builds the automata
+    void Compile();
+
+    // Checks a single glob; returns false, with the reason in Error, if it is invalid
+    static bool Validate(std::string_view Pattern, std::string& Error);
+
+    bool empty() const;
+
+    const Glob& glob(size_t Index) const;
+
+    // Index of the last glob matching the entry at Path (relative to the base directory), or NO_GLOB
+    size_t Match(std::string_view Path, bool IsDirectory) const;
+
+private:
+    // General globs compiled into a single automaton: its patterns are the globs in reverse order,
+    // so the lowest pattern matching (the one RegexMatcher reports) is the last glob
+    struct Automaton
+    {
+        std::unique_ptr<RegexMatcher> matcher;
+        std::vector<size_t>           globs;
+    };
+
+    // Regular expression matching "/<path>" for the paths Pattern (without its leading and trailing
+    // '/') matches
+    static bool Translate(std::string_view Pattern, bool IsAnchored, std::string& Regex, std::string& Error);
+
+    // Last glob of Indices matching an entry of the type IsDirectory tells, or NO_GLOB
+    size_t Last(const std::vector<size_t>& Indices, bool IsDirectory) const;
+
+    // Automata of Globs, GLOBS_PER_AUTOMATON at a time
+    static std::vector<Automaton> Build(const std::vector<size_t>& Globs, const std::vector<std::string>& Regexes);
+
+    // Last glob of Automata matching the whole of Path, or NO_GLOB
+    static size_t MatchAutomata(const std::vector<Automaton>& Automata, std::string_view Path);
+
+    std::vector<Glob>                                      _globs;
+    // fast paths: globs by name, by suffix, and the ones matching everything ("*")
+    std::unordered_map< std::string, std::vector<size_t> > _names;
+    std::unordered_map< std::string, std::vector<size_t> > _suffixes;
+    std::vector<size_t>                                    _suffixSizes;
+    std::vector<size_t>                                    _everything;
+    // general globs, and their regular expressions
+    std::vector<size_t>                                    _generalGlobs;
+    std::vector<std::string>                               _regexes;
+    std::vector<Automaton>                                 _automata;      // every general glob
+    std::vector<Automaton>                                 _fileAutomata;  // without the directory only ones
+};
+
+#endif // GLOBSET_H
@@ -0,0 +1,54 @@
+#ifndef IGNORERULES_H
+#define IGNORERULES_H
+
+#include <memory>
+#include <string>
+#include <filesystem>
+#include <string_view>
+
+#include "globset.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    // read in this order: rules of .ignore (meant for searches only) win over those of .gitignore
+    constexpr std::string_view IGNORE_FILE_NAMES[] = { ".gitignore", ".ignore" };
+}
+
+// Rules of the ignore files of a directory, on top of those of the directories above it, up to the
+// location: the deepest directory with a rule matching a path decides, and within a directory its
+// last matching rule; a negated rule ("!keep.log") keeps what an earlier rule, or a directory above,
+// ignores
+// Ignore files follow the gitignore format: one glob per line (see GlobSet), relative to their
+// directory; blank lines and lines starting with '#' are skipped, "\#" and "\!" start a glob with
+// '#' or '!', unescaped trailing spaces are dropped, invalid globs never match
+// As with git, nothing inside an ignored directory can be kept: the directory is never listed
+class IgnoreRules
+{
+public:
+    // Use Load()
+    IgnoreRules(std::string_view RelativePath, std::shared_ptr<const IgnoreRules> Parent);
+
+    IgnoreRules(const IgnoreRules& r) = delete;
+
+    IgnoreRules& operator=(const IgnoreRules& r) = delete;
+
+    // Rules of Directory, at RelativePath from the location ('/' separated, empty for the location
+    // itself): those of its ignore files on top of Parent (null at the location); Parent itself when
+    // Directory has no ignore file
+    static std::shared_ptr<const IgnoreRules> Load(const fs::path& Directory, std::string_view RelativePath,
+                                                  std::shared_ptr<const IgnoreRules> Parent);
+
+    // Returns true if the entry at RelativePath (from the location) is ignored
+    bool IsIgnored(std::string_view RelativePath, bool IsDirectory) const;
+
+private:
+    // Adds the rules of an ignore file; returns false if there is none
+    bool Read(const fs::path& File);
+
+    std::shared_ptr<const IgnoreRules> _parent;
+    std::string                        _base;   // path of the directory from the location, '/' terminated
+    GlobSet                            _rules;
+};
+
+#endif // IGNORERULES_H
@@ -0,0 +1,60 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t READ_CHUNK_SIZE = 1048576;  // in bytes; 1 MB
+}
+
+// Class used to expose the contents of a file without copying it: regular files are mapped
+// read only in memory and scanned directly from the page cache
+// Inputs that cannot be mapped (pipes, character devices, pseudo files reporting a size of 0)
+// are read instead, chunk by chunk, into an internal buffer, unless opened with MAP_ONLY
+class MappedFile
+{
+public:
+    MappedFile();
+
+    MappedFile(const MappedFile& m) = delete;
+
+    MappedFile& operator=(const MappedFile& m) = delete;
+
+    enum OpenMode
+    {
+        READ_UNMAPPABLE,
+        MAP_ONLY
+    };  // Used by Open()
+
+    ~MappedFile();
+
+    // Maps (or reads) the file; returns false if the file cannot be open
+    // With MAP_ONLY, inputs that cannot be mapped are not read either: Open() silently returns false,
+    // and the caller streams them instead (see StreamScanner)
+    bool Open(const fs::path& FileName, OpenMode Mode = READ_UNMAPPABLE);
+
+    // Releases the mapping / buffer
+    void Close();
+
+    // Contents of the file; valid until Close() is called
+    std::string_view contents() const;
+
+    // True if the contents are served from a memory mapping
+    bool isMapped() const;
+
+private:
+    const char* _data;
+    size_t      _size;
+    bool        _mapped;
+    std::string _buffer;
+#ifdef _WIN32
+    void*       _fileHandle;
+    void*       _mappingHandle;
+#endif
+};
+
+#endif // MAPPEDFILE_H
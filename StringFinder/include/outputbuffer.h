@@ -0,0 +1,100 @@
+#ifndef OUTPUTBUFFER_H
+#define OUTPUTBUFFER_H
+
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t OUTPUT_BUFFER_SIZE = 1048576;  // in bytes; 1 MB
+}
+
+// Class used to write results with as few system calls as possible
+// Everything is appended to a large user space buffer which is written with a single write call
+// once full (or on Flush()); colour codes are only emitted when the output is a terminal
+// Not thread safe: a single thread is expected to write results
+class OutputBuffer
+{
+public:
+    enum Color
+    {
+        DEFAULT,
+        GREEN,
+        RED,
+        YELLOW
+    };
+
+    // Writes to the standard output by default
+    explicit OutputBuffer(int Descriptor = 1);
+
+    OutputBuffer(const OutputBuffer& o) = delete;
+
+    OutputBuffer& operator=(const OutputBuffer& o) = delete;
+
+    ~OutputBuffer();
+
+    // Writes to a file instead (created or truncated, written as is, without colours);
+    // returns false if the file cannot be created
+    bool Open(const fs::path& FileName);
+
+    // Writes to an already open descriptor instead (e.g. a socket), without colours; the descriptor
+    // is not closed by the buffer
+    void Attach(int Descriptor);
+
+    void Write(std::string_view Text);
+
+    void Write(char Character);
+
+    void WriteNumber(uint64_t Number);
+
+    // Writes a string containing special characters in a readable way
+    // (e.g. tabs are written as '\t', newlines as '\n' etc.); runs of bytes that need no escaping
+    // are copied in bulk
+    void WriteEscaped(std::string_view Text);
+
+    // Writes the JSON member "Name":"Text" when Text is valid UTF-8; otherwise "Name_base64":"..."
+    // holding its bytes base64 encoded (an escape such as \u00e9 would stand for a character, not
+    // for the byte), so every consumer gets the exact bytes back
+    void WriteJsonField(std::string_view Name, std::string_view Text);
+
+    // Starts writing in Color (no-op when the output is not a terminal)
+    void SetColor(Color NewColor);
+
+    // Back to the default colour
+    void ResetColor();
+
+    // Writes the buffered bytes
+    void Flush();
+
+    // Colour codes are emitted only when true; defaults to "the output is a terminal"
+    void SetColorized(bool IsColorized);
+
+    // True once a write failed (e.g. the reading end of a pipe or socket went away): everything
+    // written afterwards is dropped
+    bool closed() const;
+
+private:
+    // Makes room for at least Size bytes
+    void Reserve(size_t Size);
+
+    // Writes valid UTF-8 Text as a quoted JSON string; control characters are written as \u00XX
+    void WriteJsonString(std::string_view Text);
+
+    // Writes Bytes as a quoted base64 string (RFC 4648, padded)
+    void WriteBase64(std::string_view Bytes);
+
+    // Writes Size bytes to the descriptor, with as many write calls as the system needs
+    void WriteDirect(const char* Data, size_t Size);
+
+    int               _descriptor;
+    bool              _ownsDescriptor;
+    bool              _isColorized;
+    bool              _isClosed;
+    std::vector<char> _buffer;
+    size_t            _used;
+};
+
+#endif // OUTPUTBUFFER_H
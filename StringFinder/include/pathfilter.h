@@ -0,0 +1,86 @@
+#ifndef PATHFILTER_H
+#define PATHFILTER_H
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <unordered_set>
+#include <unordered_map>
+
+#include "globset.h"
+#include "ignorerules.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t MAX_EXTENSION_SIZE = 16;  // in bytes; longer extensions are never excluded
+}
+
+// Class used to tell, from its path alone, whether a file or a directory found under the location is
+// searched: entries are excluded as soon as they are listed, so excluded files are never open or read,
+// and excluded directories never listed (nor anything under them)
+//  - extensions: everything after a dot of the name ("tar.gz" and "gz" both exclude "logs.tar.gz"),
+//    compared whatever the case of its ASCII letters; names starting with a dot (".gitignore") are
+//    not extensions
+//  - excluded globs (see GlobSet) skip files and whole directories ("node_modules/", "*.min.js")
+//  - with included globs, only the files matching one of them are searched ("*.log"); directories
+//    are walked whatever their name
+//  - with ignore files, the rules of the .gitignore and .ignore files found under the location
+//    (see IgnoreRules), and the .git directories, skip files and directories too
+// Paths are relative to the location, '/' separated ("src/main.cpp")
+class PathFilter
+{
+public:
+    PathFilter();
+
+    PathFilter(const PathFilter& f) = delete;
+
+    PathFilter& operator=(const PathFilter& f) = delete;
+
+    // Adds extensions to exclude, with or without their leading dot ("o", ".o")
+    void ExcludeExtensions(const std::vector<std::string>& Extensions);
+
+    // Adds globs to exclude, or to include; invalid ones are skipped (see GlobSet::Validate)
+    void ExcludeGlobs(const std::vector<std::string>& Globs);
+
+    void IncludeGlobs(const std::vector<std::string>& Globs);
+
+    // Also skips what the ignore files found under the location ignore
+    void UseIgnoreFiles();
+
+    bool usesIgnoreFiles() const;
+
+    // Returns true if nothing is excluded
+    bool empty() const;
+
+    // Returns true if the entry at RelativePath is kept; Rules are the ignore rules of its directory,
+    // if any
+    bool Accepts(std::string_view RelativePath, bool IsDirectory, const IgnoreRules* Rules = nullptr) const;
+
+    // Returns true if File, found under Root without walking it (from an index, or a change), is kept,
+    // and so are all the directories between them; ignore files along the way are read once, then
+    // cached
+    bool AcceptsPath(const fs::path& Root, const fs::path& File) const;
+
+private:
+    // Returns true if a file named FileName has no excluded extension
+    bool AcceptsExtension(std::string_view FileName) const;
+
+    // Rules of the directory at RelativePath from Root, from the cache when already read
+    std::shared_ptr<const IgnoreRules> DirectoryRules(const fs::path& Root, const std::string& RelativePath,
+                                                      std::shared_ptr<const IgnoreRules> Parent) const;
+
+    std::unordered_set<std::string>                                               _excludedExtensions;
+    size_t                                                                        _maxExtensionSize;
+    GlobSet                                                                       _excludedGlobs;
+    GlobSet                                                                       _includedGlobs;
+    bool                                                                          _useIgnoreFiles;
+    mutable std::mutex                                                            _rulesMutex;
+    mutable std::unordered_map< std::string, std::shared_ptr<const IgnoreRules> > _rulesCache;
+};
+
+#endif // PATHFILTER_H
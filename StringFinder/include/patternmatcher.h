@@ -0,0 +1,92 @@
+#ifndef PATTERNMATCHER_H
+#define PATTERNMATCHER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <string_view>
+
+#include "searcher.h"
+
+namespace {
+    constexpr size_t TEDDY_MAX_PATTERNS = 32;
+}
+
+// Base class of the engines used to find all occurrences of a set of literal patterns in a
+// single pass over a buffer
+// Create() compiles the pattern list into the most suitable engine:
+//  - one pattern:            vectorized literal search (Searcher)
+//  - a few patterns:         SIMD Teddy matcher (nibble fingerprints over 16/32 byte lanes)
+//  - many patterns:          Aho-Corasick automaton
+// With IsRegex, the patterns are regular expressions instead (see RegexMatcher)
+// Every engine can ignore case (ASCII letters only, see casefolding.h) without copying the contents:
+// matches are reported at the positions of the original bytes
+class PatternMatcher
+{
+public:
+    // One occurrence of a pattern; pattern is the index of the pattern in patterns()
+    struct Match
+    {
+        size_t position;
+        size_t pattern;
+        size_t length;
+    };
+
+    virtual ~PatternMatcher();
+
+    // Appends every occurrence (overlapping ones included) of every pattern found in Contents
+    // to Matches, ordered by position and then by pattern index
+    virtual void FindAll(std::string_view Contents, std::vector<Match>& Matches) const = 0;
+
+    // Same as FindAll(), for the matches starting at Start or after it; the bytes before Start are
+    // only looked at by regular expressions (the byte before a match decides anchors and word boundaries)
+    // Positions are relative to Contents
+    virtual void FindFrom(std::string_view Contents, size_t Start, std::vector<Match>& Matches) const;
+
+    // Name of the engine, used for diagnostics
+    virtual const char* name() const = 0;
+
+    // Size of the longest match; a match found in a buffer only depends on the byte before it and on
+    // the maxMatchSize() bytes from its start (one byte past its end, for regular expressions)
+    virtual size_t maxMatchSize() const;
+
+    // True when every occurrence is reported, overlapping ones included; false when the search
+    // resumes at the end of every match (regular expressions)
+    virtual bool overlappingMatches() const;
+
+    // Every match contains at least one of these literals (folded when ignoring case); an empty
+    // literal when some pattern has none
+    virtual std::vector<std::string> requiredLiterals() const;
+
+    // As given (not folded)
+    const std::vector<std::string>& patterns() const;
+
+    bool ignoreCase() const;
+
+    // Patterns must be unique (once folded, when ignoring case) and not empty; regular expressions
+    // must be valid (see RegexProgram::Validate())
+    static std::unique_ptr<PatternMatcher> Create(const std::vector<std::string>& Patterns, bool IgnoreCase = false,
+                                                  bool IsRegex = false);
+
+protected:
+    PatternMatcher(const std::vector<std::string>& Patterns, bool IgnoreCase);
+
+    std::vector<std::string> _patterns;
+    bool                     _ignoreCase;
+};
+
+// Single pattern engine
+class LiteralMatcher : public PatternMatcher
+{
+public:
+    explicit LiteralMatcher(const std::string& Pattern, bool IgnoreCase = false);
+
+    void FindAll(std::string_view Contents, std::vector<Match>& Matches) const override;
+
+    const char* name() const override;
+
+private:
+    Searcher _searcher;
+};
+
+#endif // PATTERNMATCHER_H
@@ -0,0 +1,111 @@
+#ifndef REGEXMATCHER_H
+#define REGEXMATCHER_H
+
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+#include "regexprogram.h"
+#include "patternmatcher.h"
+
+namespace {
+    constexpr size_t REGEX_CACHE_ENTRIES = 262144;     // 1 MB of lazy DFA transitions per search thread
+    constexpr size_t REGEX_PREFILTER_BLOCK = 262144;   // bytes searched for literals at once
+    constexpr size_t REGEX_MIN_HIT_DISTANCE = 32;      // closer literals (on average): the prefilter is dropped
+}
+
+// Regular expression engine (syntax in regexprogram.h), linear in the size of the contents
+// Matches are the leftmost longest ones and do not overlap: the search resumes at the end of every
+// match; a match longer than maxMatchSize() is cut to its longest prefix that fits
+// The patterns run as a lazy DFA, built while searching: a state is the set of NFA instructions
+// alive (plus what the previous byte tells the assertions), and transitions are computed the first
+// time they are taken, per byte class. The cache is cleared when full, so a pattern whose DFA would
+// blow up costs what an NFA simulation costs
+// A match is found in two steps:
+//  - an unanchored scan finds where the first match ends, and the last position before it where no
+//    thread was alive (no match spans it)
+//  - anchored scans from there find the leftmost start, and the longest match from it
+// When every match contains one of a few literals, these are searched first with the literal
+// engines (Searcher, Teddy): only the bytes around them are run through the DFA, until the literals
+// turn out too common, or the scans around them cost more than scanning everything (e.g. "x.*y")
+// Each search thread takes its own DFA cache from a pool: FindAll() may run concurrently
+class RegexMatcher : public PatternMatcher
+{
+public:
+    explicit RegexMatcher(const std::vector<std::string>& Patterns, bool IgnoreCase = false);
+
+    ~RegexMatcher();
+
+    RegexMatcher(const RegexMatcher&) = delete;
+
+    RegexMatcher& operator=(const RegexMatcher&) = delete;
+
+    void FindAll(std::string_view Contents, std::vector<Match>& Matches) const override;
+
+    void FindFrom(std::string_view Contents, size_t Start, std::vector<Match>& Matches) const override;
+
+    const char* name() const override;
+
+    size_t maxMatchSize() const override;
+
+    bool overlappingMatches() const override;
+
+    std::vector<std::string> requiredLiterals() const override;
+
+private:
+    // Lazy DFA of a search thread (see regexmatcher.cpp)
+    struct DfaCache;
+
+    // Finds the leftmost longest match starting in [From, StartLimit)
+    bool FindNext(std::string_view Contents, size_t From, size_t StartLimit, DfaCache& Cache, Match& Result) const;
+
+    // Unanchored scan from From: End of the first match starting before StartLimit, and Idle, the last
+    // position before it no thread spans
+    bool FindFirstEnd(std::string_view Contents, size_t From, size_t StartLimit, DfaCache& Cache, size_t& End,
+                      size_t& Idle) const;
+
+    // Anchored scan: longest match starting at Start
+    bool FindLongest(std::string_view Contents, size_t Start, DfaCache& Cache, Match& Result) const;
+
+    // Start state for the previous byte of Contents at Position
+    uint32_t StartState(std::string_view Contents, size_t Position, bool IsAnchored, DfaCache& Cache) const;
+
+    // Same instructions, no new thread started
+    uint32_t AnchoredState(uint32_t State, DfaCache& Cache) const;
+
+    // Computes the transition of State on Class; State is renumbered if the cache had to be cleared
+    uint32_t Step(uint32_t& State, uint8_t Class, DfaCache& Cache) const;
+
+    // Pattern matching at the end of the contents from State, or NO_PATTERN
+    uint32_t EndPattern(uint32_t State, DfaCache& Cache) const;
+
+    // Follows splits and assertions from the instructions of Key; collects the byte instructions reached
+    // in Cache and returns the lowest pattern matching, or NO_PATTERN
+    uint32_t Closure(const std::string& Key, bool IsLineEnd, bool IsNextWord, DfaCache& Cache) const;
+
+    // State key: flags, then sorted instructions
+    std::string Key(uint8_t Flags, const std::vector<uint32_t>& Instructions) const;
+
+    uint32_t Intern(const std::string& Key, DfaCache& Cache) const;
+
+    void Reset(DfaCache& Cache) const;
+
+    std::unique_ptr<DfaCache> AcquireCache() const;
+
+    void ReleaseCache(std::unique_ptr<DfaCache> Cache) const;
+
+    static constexpr uint32_t NO_PATTERN = UINT32_MAX - 1;
+
+    RegexProgram                                _program;
+    bool                                        _isValid;
+    uint8_t                                     _byteClasses[256];
+    uint8_t                                     _flagMask;
+    size_t                                      _maxMatchSize;
+    // literal engine finding the candidates, and how far before them matches may start
+    std::unique_ptr<PatternMatcher>             _prefilter;
+    size_t                                      _literalOffset;
+    mutable std::mutex                          _cachesMutex;
+    mutable std::vector< std::unique_ptr<DfaCache> > _caches;
+};
+
+#endif // REGEXMATCHER_H
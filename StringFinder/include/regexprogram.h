@@ -0,0 +1,129 @@
+#ifndef REGEXPROGRAM_H
+#define REGEXPROGRAM_H
+
+#include <bitset>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace {
+    constexpr size_t   REGEX_MAX_MATCH_SIZE = 4096;     // in bytes; longer matches are cut to their longest prefix that fits
+    constexpr uint32_t REGEX_MAX_REPEAT = 1000;         // largest {n,m} bound
+    constexpr size_t   REGEX_MAX_INSTRUCTIONS = 65536;  // once repetitions are expanded
+    constexpr int      REGEX_MAX_DEPTH = 64;            // nested groups
+    constexpr size_t   REGEX_MAX_LITERALS = 32;         // alternatives of a required literal set
+}
+
+// Regular expressions compiled into a Thompson NFA (one instruction per byte set, split, jump,
+// assertion or match), run by RegexMatcher
+// Syntax, over bytes (a UTF-8 character is a sequence of bytes):
+//  - literal bytes; \ escapes any punctuation; \t \n \r \f \v and \xHH
+//  - .  any byte but \n; [abc] [a-z] [^...] byte sets; \d \w \s and their complements \D \W \S
+//  - ( ) and (?: ) groups, | alternation
+//  - * + ? {n} {n,} {n,m} repetitions
+//  - ^ and $ match at the start and at the end of a line, \b and \B at word boundaries (or not)
+// Matches are the leftmost longest ones (POSIX), so repetitions have no lazy form; a pattern must
+// not match the empty string
+// Several patterns are compiled into a single program: every pattern ends with its own match
+// instruction
+// Compiling also analyses the patterns:
+//  - the size of their longest match (bounded by REGEX_MAX_MATCH_SIZE)
+//  - the literals one of which every match contains, and how far from the start of the match they
+//    can be (e.g. "error" in "(fatal )?error [0-9]+"): RegexMatcher looks for them first
+//  - the byte classes: bytes no instruction tells apart share a class, which keeps the lazy DFA
+//    transition tables small
+class RegexProgram
+{
+public:
+    enum Opcode
+    {
+        BYTES,   // consumes a byte of set argument, then continues at next
+        SPLIT,   // continues at both next and alternative
+        ASSERT,  // continues at next if the Assertion argument holds
+        MATCH    // pattern argument ends here
+    };  // Used by Instruction
+
+    enum Assertion
+    {
+        LINE_START,
+        LINE_END,
+        WORD_BOUNDARY,
+        NOT_WORD_BOUNDARY
+    };  // Used by ASSERT instructions
+
+    struct Instruction
+    {
+        Opcode   opcode;
+        uint32_t next;
+        uint32_t alternative;
+        uint32_t argument;
+    };
+
+    // A literal every match of some pattern may contain, starting at most offset bytes after the
+    // start of the match
+    struct Literal
+    {
+        std::string bytes;
+        size_t      offset;
+    };
+
+    RegexProgram();
+
+    // Compiles Patterns; returns false, with the reason in Error, if one of them is invalid
+    bool Compile(const std::vector<std::string>& Patterns, bool IgnoreCase, std::string& Error);
+
+    // Checks a single pattern; returns false, with the reason in Error, if it is invalid
+    static bool Validate(const std::string& Pattern, std::string& Error);
+
+    // Word bytes, as \w and \b see them: ASCII letters, digits and '_'
+    static bool IsWordByte(uint8_t Byte);
+
+    const std::vector<Instruction>& instructions() const;
+
+    // First instruction of the program (tries every pattern)
+    uint32_t start() const;
+
+    bool Contains(uint32_t Set, uint8_t Byte) const;
+
+    uint16_t byteClass(uint8_t Byte) const;
+
+    uint16_t numClasses() const;
+
+    // A byte of every class
+    uint8_t classByte(uint16_t Class) const;
+
+    bool hasLineAssertions() const;
+
+    bool hasWordAssertions() const;
+
+    size_t maxMatchSize() const;
+
+    // Every match of every pattern contains one of them (folded when ignoring case); empty if some
+    // pattern has no usable literal
+    const std::vector<Literal>& literals() const;
+
+private:
+    // Parses patterns into syntax trees, analyses and emits them
+    class Compiler;
+
+    // Returns the index of the new set
+    uint32_t AddSet(const std::bitset<256>& Set);
+
+    uint32_t AddInstruction(Opcode Code, uint32_t Next, uint32_t Alternative, uint32_t Argument);
+
+    // Splits the bytes into classes no instruction tells apart
+    void BuildByteClasses();
+
+    std::vector<Instruction>      _instructions;
+    std::vector< std::bitset<256> > _sets;
+    uint32_t                      _start;
+    uint16_t                      _byteClass[256];
+    uint16_t                      _numClasses;
+    std::vector<uint8_t>          _classBytes;
+    bool                          _hasLineAssertions;
+    bool                          _hasWordAssertions;
+    size_t                        _maxMatchSize;
+    std::vector<Literal>          _literals;
+};
+
+#endif // REGEXPROGRAM_H
@@ -0,0 +1,77 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <filesystem>
+
+#include "stringdata.h"
+#include "searchoptions.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr std::string_view CACHE_ENTRY_MAGIC = "SFCACHE1";
+    constexpr std::string_view CACHE_STATE_FILE = "cache.size";
+    constexpr double           CACHE_EVICTION_TARGET = 0.9;      // of the maximum size, after an eviction
+}
+
+// Persistent cache of the matches found in files, kept in a directory between runs
+// An entry is keyed by the fingerprint of a file (path, size, write time, device and inode: no need to
+// read the file to know it did not change), the search strings (whether case is ignored, they are
+// regular expressions, and how binary files are handled) and AFFIX_SIZE; it holds the StringData of the
+// file in a compact form (varint delta encoded positions, packed affix sizes, affix bytes)
+// Entries are files named after the hash of their key (the full key is stored and compared, so hash
+// collisions are harmless), written to a temporary file then renamed, so concurrent runs are safe
+// Size is bounded with an LRU policy: hits refresh the write time of their entry and, when the total
+// size goes past the maximum, the least recently used entries are removed
+class ResultCache
+{
+public:
+    ResultCache(const fs::path& Directory, uint64_t MaxSize, const std::vector<std::string>& SearchStrings,
+                bool IgnoreCase = false, bool IsRegex = false,
+                SearchOptions::BinaryFiles BinaryFiles = SearchOptions::SEARCH_BINARY);
+
+    ResultCache(const ResultCache& c) = delete;
+
+    ResultCache& operator=(const ResultCache& c) = delete;
+
+    // Creates the cache directory if needed; returns false if it cannot be used
+    bool Open();
+
+    // Key of the current version of File; empty if File cannot be stat'ed, or was modified less than
+    // RACY_WRITE_TIME ago (it may still change within the same write time: never cached)
+    std::string Key(const fs::path& File) const;
+
+    // Matches stored for Key; thread safe
+    bool Lookup(const std::string& Key, StringData& Data);
+
+    // Stores the matches found for Key; thread safe
+    void Store(const std::string& Key, const StringData& Data);
+
+    // Evicts entries if the cache grew past its maximum size; call once all lookups and stores are done
+    void Finish();
+
+    uint64_t hits() const;
+
+    uint64_t misses() const;
+
+private:
+    // Path of the entry file of Key
+    fs::path EntryPath(const std::string& Key) const;
+
+    // Removes the least recently used entries until the cache fits; returns the remaining size
+    uint64_t Evict();
+
+    fs::path                 _directory;
+    uint64_t                 _maxSize;
+    std::string              _searchStringsKey;  // key part shared by all entries
+    std::atomic<uint64_t>    _hits;
+    std::atomic<uint64_t>    _misses;
+    std::atomic<uint64_t>    _writtenBytes;
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,68 @@
+#ifndef RESULTCOLLECTOR_H
+#define RESULTCOLLECTOR_H
+
+#include <vector>
+#include <algorithm>
+
+namespace {
+    constexpr size_t CACHE_LINE_SIZE = 64;
+}
+
+// Collects results produced concurrently by a fixed number of worker threads
+// Every thread appends to its own buffer (no locking, no shared writes), and the buffers
+// are merged once, after all workers are done, into a single deterministically ordered vector
+template <typename T>
+class ResultCollector
+{
+public:
+    explicit ResultCollector(int NumThreads) : _slots( (NumThreads > 0) ? NumThreads : 1 )
+    {
+    }
+
+    ResultCollector(const ResultCollector& c) = delete;
+
+    ResultCollector& operator=(const ResultCollector& c) = delete;
+
+    // Must only be called by the thread owning ThreadId
+    void Add(int ThreadId, T Item)
+    {
+        _slots[ThreadId].items.push_back(std::move(Item));
+    }
+
+    // Concatenates all per thread buffers and sorts the result; must only be called
+    // once all workers finished
+    template <typename Compare>
+    std::vector<T> Merge(Compare Less)
+    {
+        size_t         totalSize = 0;
+        std::vector<T> merged{};
+
+        for (auto&& slot : _slots)
+        {
+            totalSize += slot.items.size();
+        }
+
+        merged.reserve(totalSize);
+
+        for (auto&& slot : _slots)
+        {
+            std::move(slot.items.begin(), slot.items.end(), std::back_inserter(merged));
+            slot.items.clear();
+        }
+
+        std::sort(merged.begin(), merged.end(), Less);
+
+        return merged;
+    }
+
+private:
+    // Each buffer lives on its own cache line so that threads do not false share
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        std::vector<T> items;
+    };
+
+    std::vector<Slot> _slots;
+};
+
+#endif // RESULTCOLLECTOR_H
@@ -0,0 +1,31 @@
+#ifndef RESULTFILE_H
+#define RESULTFILE_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "encoding.h"
+
+// Layout of the binary result file (--format binary), shared by BinaryFormatter and ResultReader
+// All fixed size integers are little endian; varints are LEB128 (7 bits per byte, low bits first)
+//
+//  header      RESULT_FILE_MAGIC | u32 version | u32 search string count
+//              per search string: varint size | bytes
+//  file record varint path size | path bytes | varint match count
+//              per match: varint position delta (from the previous match of the file, or from 0)
+//                         [varint search string index, only when there are several search strings]
+//                         u8 (prefix size << 4) | suffix size | prefix bytes | suffix bytes
+//  path table  per file record: u64 offset of the record
+//  footer      u64 file count | u64 match count | u64 path table offset | RESULT_FILE_END_MAGIC
+//
+// Records are written as soon as files are done, so the file can be produced in streaming mode;
+// the path table and the footer give random access to the records once the file is complete
+namespace {
+    constexpr std::string_view RESULT_FILE_MAGIC = "SFRESULT";
+    constexpr std::string_view RESULT_FILE_END_MAGIC = "SFRESEND";
+    constexpr uint32_t         RESULT_FILE_VERSION = 1;
+    constexpr size_t           RESULT_FILE_HEADER_SIZE = 8 + 4 + 4;
+    constexpr size_t           RESULT_FILE_FOOTER_SIZE = 8 + 8 + 8 + 8;
+}
+
+#endif // RESULTFILE_H
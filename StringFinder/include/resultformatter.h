@@ -0,0 +1,93 @@
+#ifndef RESULTFORMATTER_H
+#define RESULTFORMATTER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+#include "stringdata.h"
+#include "outputbuffer.h"
+#include "searchoptions.h"
+
+namespace fs = std::filesystem;
+
+// Base class of the result formats: writes the matches of every file, straight from their
+// StringData, into an OutputBuffer
+// WriteFile() is called once per file with results (in display order) and Finish() once at the end
+class ResultFormatter
+{
+public:
+    ResultFormatter(OutputBuffer& Output, const std::vector<std::string>& SearchStrings);
+
+    ResultFormatter(const ResultFormatter& f) = delete;
+
+    ResultFormatter& operator=(const ResultFormatter& f) = delete;
+
+    virtual ~ResultFormatter();
+
+    virtual void WriteFile(const fs::path& Path, const StringData& Data) = 0;
+
+    virtual void Finish();
+
+    // Formatter writing results in Format
+    static std::unique_ptr<ResultFormatter> Create(SearchOptions::Format Format, OutputBuffer& Output,
+                                                   const std::vector<std::string>& SearchStrings);
+
+protected:
+    OutputBuffer&                   _output;
+    const std::vector<std::string>& _searchStrings;
+};
+
+// Human readable, coloured text (the default):
+//   Displaying data found inside <"path">:
+//   Position: N		Prefix: ...	Suffix: ...	[Search string: ...]
+class TextFormatter : public ResultFormatter
+{
+public:
+    TextFormatter(OutputBuffer& Output, const std::vector<std::string>& SearchStrings);
+
+    void WriteFile(const fs::path& Path, const StringData& Data) override;
+
+private:
+    // Writes a highlighted string, special characters escaped
+    void WriteString(std::string_view String);
+};
+
+// JSON Lines: one object per file
+//   {"path":"...","matches":[{"position":N,"prefix":"...","suffix":"..."[,"search_string":"..."]},...]}
+// A path, affix or search string that is not valid UTF-8 (e.g. an affix cutting a character in two,
+// a Latin-1 file) is written base64 encoded instead, its member name suffixed: "prefix_base64":"..."
+class JsonLinesFormatter : public ResultFormatter
+{
+public:
+    JsonLinesFormatter(OutputBuffer& Output, const std::vector<std::string>& SearchStrings);
+
+    void WriteFile(const fs::path& Path, const StringData& Data) override;
+};
+
+// Compact binary file, see resultfile.h for the layout and resultreader.h to read it back
+class BinaryFormatter : public ResultFormatter
+{
+public:
+    BinaryFormatter(OutputBuffer& Output, const std::vector<std::string>& SearchStrings);
+
+    void WriteFile(const fs::path& Path, const StringData& Data) override;
+
+    // Writes the path table and the footer
+    void Finish() override;
+
+private:
+    void WriteBytes(std::string_view Bytes);
+
+    void WriteVarint(uint64_t Value);
+
+    void WriteFixed(uint64_t Value, size_t Size);
+
+    uint64_t              _offset;       // bytes written so far
+    uint64_t              _matchCount;
+    std::vector<uint64_t> _recordOffsets;
+};
+
+#endif // RESULTFORMATTER_H
@@ -0,0 +1,135 @@
+#ifndef RESULTREADER_H
+#define RESULTREADER_H
+
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <filesystem>
+
+#include "mappedfile.h"
+
+namespace fs = std::filesystem;
+
+// Class used to read back a binary result file (--format binary) without parsing it up front:
+// the file is memory mapped, the footer and the path table give access to every file record and
+// the matches of a record are decoded one by one while iterating
+// All views returned point inside the mapping and are valid until Close() is called
+//
+//    ResultReader reader{};
+//
+//    if ( reader.Open("results.bin") )
+//    {
+//        for (size_t i = 0; i < reader.fileCount(); ++i)
+//        {
+//            ResultReader::FileRecord record = reader.file(i);
+//
+//            for (auto&& match : record) { ... match.position, match.prefix ... }
+//        }
+//    }
+class ResultReader
+{
+public:
+    struct Match
+    {
+        uint64_t         position;
+        size_t           searchString;  // index in searchStrings()
+        std::string_view prefix;
+        std::string_view suffix;
+    };
+
+    // Decodes the matches of a file record
+    class MatchIterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Match;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Match*;
+        using reference = const Match&;
+
+        MatchIterator();
+
+        MatchIterator(const char* Data, const char* End, uint64_t Count, bool HasSearchStrings);
+
+        const Match& operator*() const;
+
+        const Match* operator->() const;
+
+        MatchIterator& operator++();
+
+        bool operator==(const MatchIterator& Other) const;
+
+        bool operator!=(const MatchIterator& Other) const;
+
+    private:
+        // Decodes the match at _data into _match; ends the iteration on malformed data
+        void Decode();
+
+        const char* _data;
+        const char* _end;
+        uint64_t    _remaining;
+        bool        _hasSearchStrings;
+        Match       _match;
+    };
+
+    // A file and its matches
+    class FileRecord
+    {
+    public:
+        FileRecord();
+
+        FileRecord(std::string_view Path, uint64_t MatchCount, const char* Matches, const char* End,
+                   bool HasSearchStrings);
+
+        std::string_view path() const;
+
+        uint64_t matchCount() const;
+
+        MatchIterator begin() const;
+
+        MatchIterator end() const;
+
+    private:
+        std::string_view _path;
+        uint64_t         _matchCount;
+        const char*      _matches;
+        const char*      _end;
+        bool             _hasSearchStrings;
+    };
+
+    ResultReader();
+
+    ResultReader(const ResultReader& r) = delete;
+
+    ResultReader& operator=(const ResultReader& r) = delete;
+
+    // Maps the file and validates its header and footer; returns false if it is not a valid result file
+    bool Open(const fs::path& FileName);
+
+    void Close();
+
+    size_t fileCount() const;
+
+    // Total number of matches, over all files
+    uint64_t matchCount() const;
+
+    const std::vector<std::string_view>& searchStrings() const;
+
+    // Record of the file with index Index (files are stored in display order);
+    // an empty record if the record is malformed
+    FileRecord file(size_t Index) const;
+
+private:
+    // Reports a malformed file and closes it
+    bool Invalid(const fs::path& FileName, const char* Reason);
+
+    MappedFile                    _file;
+    std::string_view              _contents;
+    std::vector<std::string_view> _searchStrings;
+    size_t                        _fileCount;
+    uint64_t                      _matchCount;
+    const char*                   _pathTable;
+};
+
+#endif // RESULTREADER_H
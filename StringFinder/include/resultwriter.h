@@ -0,0 +1,165 @@
+#ifndef RESULTWRITER_H
+#define RESULTWRITER_H
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+#include "concurrentqueue.h"
+
+namespace {
+    constexpr size_t RESULT_QUEUE_CAPACITY = 256;
+    constexpr size_t REORDER_WINDOW = 1024;
+}
+
+// Streams results to a single writer thread as soon as they are produced
+// Workers Submit() results through a bounded queue (so a slow consumer throttles the search instead
+// of letting results pile up in memory) and a dedicated thread hands them to the Output function
+// In ordered mode every sequence number must be submitted (with HasResult = false for inputs without
+// result) and results are written in sequence order: a reorder buffer holds the results that arrive
+// early; workers call WaitForTurn() before starting an input, which keeps that buffer within
+// REORDER_WINDOW entries
+// The optional Idle function is called whenever the writer has nothing left to write (e.g. to flush
+// buffered output), so results are batched under load but still show up in real time otherwise
+template <typename T>
+class ResultWriter
+{
+public:
+    ResultWriter(std::function<void(T&)> Output, bool Ordered, std::function<void()> Idle = nullptr) :
+        _output{ std::move(Output) }, _idle{ std::move(Idle) }, _ordered{ Ordered }, _queue{ RESULT_QUEUE_CAPACITY },
+        _nextSequence{ 0 }
+    {
+    }
+
+    ResultWriter(const ResultWriter& w) = delete;
+
+    ResultWriter& operator=(const ResultWriter& w) = delete;
+
+    ~ResultWriter()
+    {
+        Finish();
+    }
+
+    // Starts the writer thread
+    void Start()
+    {
+        _thread = std::thread(&ResultWriter::WriterThread, this);
+    }
+
+    // Ordered mode: blocks while Sequence is too far ahead of the next result to be written
+    void WaitForTurn(uint64_t Sequence)
+    {
+        if (_ordered)
+        {
+            std::unique_lock<std::mutex> lock(_windowMutex);
+
+            _windowMoved.wait(lock, [this, Sequence] { return Sequence < _nextSequence + REORDER_WINDOW; });
+        }
+    }
+
+    // Hands a result over to the writer thread
+    void Submit(uint64_t Sequence, T Result, bool HasResult)
+    {
+        if (_ordered || HasResult)
+        {
+            _queue.Push( Entry{ Sequence, std::move(Result), HasResult } );
+        }
+    }
+
+    // Writes the remaining results and stops the writer thread
+    void Finish()
+    {
+        _queue.Close();
+
+        if (_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t sequence;
+        T        result;
+        bool     hasResult;
+    };
+
+    void WriterThread()
+    {
+        Entry entry{};
+
+        while ( NextEntry(entry) )
+        {
+            if (!_ordered)
+            {
+                _output(entry.result);
+                continue;
+            }
+
+            _pending.emplace(entry.sequence, std::move(entry));
+
+            // flush everything that is now contiguous
+            auto next = _pending.begin();
+
+            while ( (next != _pending.end()) && (next->first == _nextSequence) )
+            {
+                if (next->second.hasResult)
+                {
+                    _output(next->second.result);
+                }
+
+                next = _pending.erase(next);
+
+                {
+                    std::lock_guard<std::mutex> lock(_windowMutex);
+                    ++_nextSequence;
+                }
+
+                _windowMoved.notify_all();
+            }
+        }
+
+        // ordered mode: inputs that were never submitted (e.g. unreadable files) must not block the rest
+        for (auto&& pending : _pending)
+        {
+            if (pending.second.hasResult)
+            {
+                _output(pending.second.result);
+            }
+        }
+
+        _pending.clear();
+    }
+
+    // Pops the next entry, calling the idle function first if none is ready
+    bool NextEntry(Entry& NewEntry)
+    {
+        if ( _queue.TryPop(NewEntry) )
+        {
+            return true;
+        }
+
+        if (_idle)
+        {
+            _idle();
+        }
+
+        return _queue.Pop(NewEntry);
+    }
+
+    std::function<void(T&)>   _output;
+    std::function<void()>     _idle;
+    const bool                _ordered;
+    ConcurrentQueue<Entry>    _queue;
+    std::map<uint64_t, Entry> _pending;
+    uint64_t                  _nextSequence;
+    std::mutex                _windowMutex;
+    std::condition_variable   _windowMoved;
+    std::thread               _thread;
+};
+
+#endif // RESULTWRITER_H
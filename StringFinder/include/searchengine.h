@@ -0,0 +1,42 @@
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include "dataextractor.h"
+#include "threadpool.h"
+
+// Library entry point: runs searches (see DataExtractor) on a pool of worker threads created once and
+// shared by all of them, so a long running process pays no thread startup cost per search and several
+// searches can run at the same time, from different threads
+// Usage:
+//     SearchEngine  engine{};
+//     DataExtractor search({ "needle" }, "path/to/dir");
+//
+//     engine.Run(search, [](const fs::path& File, const StringData& Data) { ... });
+// and search.Cancel() from any other thread stops it early
+class SearchEngine
+{
+public:
+    // 0 threads means one per hardware thread
+    explicit SearchEngine(int NumThreads = 0);
+
+    SearchEngine(const SearchEngine& e) = delete;
+
+    SearchEngine& operator=(const SearchEngine& e) = delete;
+
+    // Runs a search until it is over or cancelled; the calling thread waits (it must not be a worker
+    // of the engine)
+    // OnResult, if any, receives the data of every file where the search strings were found as soon
+    // as the file is done; otherwise the results are kept by Search (see DataExtractor::results())
+    void Run(DataExtractor& Search, DataExtractor::ResultFunction OnResult = nullptr);
+
+    // Watch mode: searches the changes of the location of a search that already ran and displayed
+    // its results, until the search is cancelled
+    void Watch(DataExtractor& Search);
+
+    int threadCount() const;
+
+private:
+    ThreadPool _pool;
+};
+
+#endif // SEARCHENGINE_H
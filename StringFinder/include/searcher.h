@@ -0,0 +1,51 @@
+#ifndef SEARCHER_H
+#define SEARCHER_H
+
+#include <string>
+#include <string_view>
+
+// Class used to find all occurrences of a literal string inside a buffer
+// The search kernel is vectorized (first and last byte of the needle are compared over
+// 16/32/64 byte lanes and only candidate positions are fully verified); the widest
+// instruction set supported by the running CPU is selected once, at construction
+// Ignoring case, the needle is folded once and the lanes of the first and last byte are folded while
+// compared (a single OR when the byte is a letter), so the haystack is never copied
+class Searcher
+{
+public:
+    enum InstructionSet
+    {
+        SCALAR,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    explicit Searcher(std::string Needle, bool IgnoreCase = false);
+
+    // Forces a specific kernel; falls back on the best supported one if the CPU lacks it
+    Searcher(std::string Needle, InstructionSet Set, bool IgnoreCase = false);
+
+    // Returns the position of the first occurrence of the needle found at or after From,
+    // or std::string_view::npos
+    size_t Find(std::string_view Haystack, size_t From = 0) const;
+
+    // Folded when ignoring case
+    const std::string& needle() const;
+
+    InstructionSet instructionSet() const;
+
+    // Widest instruction set supported by the CPU (and enabled by the OS)
+    static InstructionSet DetectInstructionSet();
+
+    static const char* InstructionSetName(InstructionSet Set);
+
+private:
+    typedef size_t (*FindFunction)(const char* Data, size_t Size, const char* Needle, size_t NeedleSize);
+
+    std::string    _needle;
+    InstructionSet _instructionSet;
+    FindFunction   _find;
+};
+
+#endif // SEARCHER_H
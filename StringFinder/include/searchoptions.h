@@ -0,0 +1,105 @@
+#ifndef SEARCHOPTIONS_H
+#define SEARCHOPTIONS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Options controlling how a search is run and how its results are reported;
+// filled in by CommandParser, defaults match a plain "<path> <search_string>" run
+struct SearchOptions
+{
+    enum Format
+    {
+        TEXT,
+        JSON_LINES,
+        BINARY
+    };  // Used by outputFormat
+
+    enum BinaryFiles
+    {
+        SEARCH_BINARY,
+        SKIP_BINARY,
+        BINARY_WITHOUT_AFFIXES
+    };  // Used by binaryFiles
+
+    // Write the results of every file as soon as the file is done, instead of once the whole
+    // location was searched
+    bool streamOutput = false;
+
+    // Streaming only: keep the results in path order (files are enumerated in path order and
+    // results that finish early wait in a reorder buffer)
+    bool orderedOutput = false;
+
+    // Search strings match whatever the case of their ASCII letters (see casefolding.h)
+    bool ignoreCase = false;
+
+    // Search strings are regular expressions (see RegexProgram); matches do not overlap
+    bool regex = false;
+
+    // What is done with the files whose first bytes look binary (see contentsniffer.h); files are only
+    // inspected when not searched as they are
+    BinaryFiles binaryFiles = SEARCH_BINARY;
+
+    // Files with these extensions are neither open nor searched (see PathFilter)
+    std::vector<std::string> excludedExtensions;
+
+    // Files and directories matching these globs are skipped as they are listed; with included globs,
+    // only the files matching one of them are searched (see PathFilter and GlobSet)
+    std::vector<std::string> excludedGlobs;
+
+    std::vector<std::string> includedGlobs;
+
+    // What the .gitignore and .ignore files found under the location ignore is skipped too
+    // (see IgnoreRules)
+    bool useIgnoreFiles = false;
+
+    // Number of worker threads; 0 means one per hardware thread
+    // Searches run by a SearchEngine use the threads of the engine instead
+    int numThreads = 0;
+
+    // Number of files open and read ahead of the workers at once; 0 disables the read stage
+    int ioDepth = 64;
+
+    // Only the files the trigram index stored in this file reports as candidates are searched
+    // when not empty
+    std::string indexFile;
+
+    // Directory listings are cached in this file between runs when not empty (see DirectoryManifest)
+    std::string manifestFile;
+
+    // Matches found in every file are cached in this directory between runs when not empty
+    // (see ResultCache)
+    std::string cacheDirectory;
+
+    // Maximum size of the result cache, in bytes; 1 GB by default
+    uint64_t cacheSize = 1073741824;
+
+    // The location is indexed into this file (before searching, if search strings are given)
+    // when not empty
+    std::string buildIndexFile;
+
+    // Once searched, keep watching the location and display the matches of every change
+    bool watchChanges = false;
+
+    // The location is served on this Unix domain socket (see SearchServer) when not empty
+    std::string serveSocket;
+
+    // The search is sent to the server listening on this socket when not empty
+    std::string connectSocket;
+
+    // How the results are written (see ResultFormatter)
+    Format outputFormat = TEXT;
+
+    // Results are written to this file instead of the standard output when not empty;
+    // required by the machine readable formats
+    std::string outputFile;
+
+    // Display the counters and timers of every stage once the search is over (see Statistics)
+    bool showStatistics = false;
+
+    // Rewrite a progress line on the standard error while searching
+    bool showProgress = false;
+};
+
+#endif // SEARCHOPTIONS_H
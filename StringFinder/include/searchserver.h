@@ -0,0 +1,85 @@
+#ifndef SEARCHSERVER_H
+#define SEARCHSERVER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <string_view>
+#include <filesystem>
+
+#include "searchengine.h"
+#include "searchoptions.h"
+#include "directorymanifest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr std::string_view SERVER_QUERY_MAGIC = "SFQUERY1";
+    constexpr size_t           MAX_QUERY_SIZE = 16777216;  // in bytes; 16 MB
+    constexpr int              SERVER_BACKLOG = 64;
+}
+
+// Long running search server: keeps a location warm between searches and runs the searches sent by
+// clients over a Unix domain socket
+// Started once, the server keeps its worker threads (one SearchEngine shared by all queries, which run
+// concurrently, one thread per connection) and the listing of the location (a single directory
+// manifest shared by all queries, see DirectoryManifest, checked with a single stat per directory and
+// only saved when it changed);
+// file contents stay in the page cache, and with a result cache (--cache) or an index (--index) given
+// to the server, every query uses them
+// A query is a single request, written by the client before it shuts its side of the connection down
+// (integers are varints, see encoding.h):
+//
+//  SERVER_QUERY_MAGIC | u8 flags (1: ordered, 2: colours, 4: ignore case, 8: regex, 16: skip binary
+//  files, 32: binary files without affixes) | u8 output format | varint search string count |
+//  per search string: varint size | bytes
+//
+// The server answers with the results, streamed as they are found, in the requested format (exactly
+// the bytes the command line would write), then closes the connection; a client going away cancels
+// its query
+// Only supported where Unix domain sockets are (not on Windows)
+class SearchServer
+{
+public:
+    enum QueryFlags
+    {
+        ORDERED_QUERY = 1,
+        COLORIZED_QUERY = 2,
+        IGNORE_CASE_QUERY = 4,
+        REGEX_QUERY = 8,
+        SKIP_BINARY_QUERY = 16,
+        BINARY_WITHOUT_AFFIXES_QUERY = 32
+    };  // Used by the query flags
+
+    // Options apply to every query (manifest, cache, index, threads, I/O depth, statistics, excluded
+    // extensions; binary files unless the query tells how to handle them)
+    SearchServer(std::string Location, SearchOptions Options);
+
+    SearchServer(const SearchServer& s) = delete;
+
+    SearchServer& operator=(const SearchServer& s) = delete;
+
+    // Listens on SocketFile and serves queries until the process is stopped; returns false if the
+    // socket cannot be created (or is used by another server)
+    bool Serve(const fs::path& SocketFile);
+
+    // Client side: sends a query to the server listening on SocketFile and copies the results to the
+    // output file, or to the standard output; returns false if the server cannot be reached
+    static bool Query(const fs::path& SocketFile, const std::vector<std::string>& SearchStrings,
+                      const SearchOptions& Options);
+
+private:
+    // Reads, runs and answers a single query, then closes the connection
+    void HandleConnection(int Connection);
+
+    // Walks the location once, so the first query already finds its listing in the manifest
+    void WarmUp();
+
+    std::string       _location;
+    SearchOptions     _options;
+    SearchEngine      _engine;
+    DirectoryManifest _manifest;
+    std::atomic<int>  _activeQueries;
+};
+
+#endif // SEARCHSERVER_H
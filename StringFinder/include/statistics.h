@@ -0,0 +1,120 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+namespace {
+    constexpr int PROGRESS_INTERVAL = 250;  // in milliseconds
+}
+
+// Counters and timers of every stage of a search (walk, read, search, affix extraction, output)
+// Every thread updates its own block of counters, with plain (relaxed) loads and stores: no lock and
+// no shared cache line on the hot path; blocks are only summed when the values are read, by the
+// progress line or the final summary
+// Times are summed over all threads: a stage run by 8 threads for 1 second counts 8 seconds
+class Statistics
+{
+public:
+    enum Counter
+    {
+        DIRECTORIES_LISTED,
+        DIRECTORIES_EXCLUDED,  // pruned: never listed (see PathFilter)
+        FILES_FOUND,
+        FILES_EXCLUDED,        // by their path (see PathFilter)
+        FILES_READ,            // by the read stage (see AsyncReader)
+        BYTES_READ,
+        FILES_SEARCHED,
+        BINARY_FILES,          // skipped, or searched without affixes (see contentsniffer.h)
+        BYTES_SEARCHED,
+        MATCHES,
+        COUNTER_COUNT
+    };  // Used by Add() and counter()
+
+    enum Timer
+    {
+        WALK_TIME,
+        READ_TIME,       // opening, mapping and reading files
+        WAIT_TIME,       // workers waiting for the next file
+        SEARCH_TIME,
+        AFFIX_TIME,
+        OUTPUT_TIME,
+        TIMER_COUNT
+    };  // Used by ScopedTimer, AddTime() and seconds()
+
+    // Adds the time spent in a scope to a timer; does nothing without statistics
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(Statistics* Stats, Timer Type);
+
+        ScopedTimer(const ScopedTimer& t) = delete;
+
+        ScopedTimer& operator=(const ScopedTimer& t) = delete;
+
+        ~ScopedTimer();
+
+    private:
+        Statistics*                           _statistics;
+        Timer                                 _type;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    Statistics();
+
+    Statistics(const Statistics& s) = delete;
+
+    Statistics& operator=(const Statistics& s) = delete;
+
+    ~Statistics();
+
+    // Adds Value to a counter of the calling thread
+    void Add(Counter Type, uint64_t Value = 1);
+
+    void AddTime(Timer Type, std::chrono::steady_clock::duration Time);
+
+    // Sums of all threads
+    uint64_t counter(Counter Type) const;
+
+    double seconds(Timer Type) const;
+
+    // Starts / stops rewriting a progress line on the standard error every PROGRESS_INTERVAL
+    void StartProgress();
+
+    void StopProgress();
+
+    // Displays all counters and timers on the standard output
+    void Display() const;
+
+private:
+    // on its own cache lines: threads never write to the lines of another block
+    struct alignas(64) ThreadBlock
+    {
+        std::atomic<uint64_t> counters[COUNTER_COUNT];
+        std::atomic<uint64_t> times[TIMER_COUNT];  // in nanoseconds
+    };
+
+    // Block of the calling thread, created on its first update
+    ThreadBlock& Local();
+
+    // Rewrites the progress line
+    void DisplayProgress() const;
+
+    uint64_t                                   _id;  // unique, unlike addresses: keys the thread local cache
+    std::chrono::steady_clock::time_point      _start;
+    mutable std::mutex                         _mutex;
+    std::map<std::thread::id, ThreadBlock*>    _threadBlocks;
+    std::vector< std::unique_ptr<ThreadBlock> > _blocks;
+    bool                                       _stopProgress;
+    std::condition_variable                    _progressStopped;
+    std::thread                                _progressThread;
+};
+
+#endif // STATISTICS_H
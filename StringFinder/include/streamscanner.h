@@ -0,0 +1,70 @@
+#ifndef STREAMSCANNER_H
+#define STREAMSCANNER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <filesystem>
+
+#include "patternmatcher.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t STREAM_BLOCK_SIZE = 1048576;  // in bytes; 1 MB
+}
+
+// Class used to search inputs that cannot be memory mapped (pipes, character devices, pseudo files)
+// with a fixed amount of memory, whatever their size
+// The input is read block by block into a single buffer, allocated once and never cleared; after every
+// block only its tail is moved to the front of the buffer:
+//  - the overlap (longest match size - 1 + AFFIX_SIZE bytes): matches starting there may end in the
+//    next block, or their suffix may; they are reported with the next block
+//  - the history (AFFIX_SIZE bytes before the overlap): prefixes of the matches reported next, and the
+//    byte before the first match for regular expressions
+// Every match is therefore reported exactly once, with its full prefix and suffix inside the window
+// it is reported with, and the history is never searched twice
+// Matches that do not overlap (regular expressions) are searched for from the end of the last match
+// reported, as if the input were searched in one piece
+class StreamScanner
+{
+public:
+    // Reads up to Size bytes into Buffer; BytesRead is 0 at the end of the input
+    using ReadFunction = std::function<bool(char* Buffer, size_t Size, size_t& BytesRead)>;
+
+    // Receives the matches reported with a window: positions are relative to Window, which starts at
+    // offset Offset of the input and holds the affixes of all the matches
+    using MatchFunction = std::function<void(std::string_view Window, uint64_t Offset,
+                                             const std::vector<PatternMatcher::Match>& Matches)>;
+
+    // Receives the first bytes of the input (its first window, or the whole input if shorter) before it
+    // is searched; returns false to stop the scan there
+    using InspectFunction = std::function<bool(std::string_view Start)>;
+
+    explicit StreamScanner(const PatternMatcher& Matcher, size_t BlockSize = STREAM_BLOCK_SIZE);
+
+    StreamScanner(const StreamScanner& s) = delete;
+
+    StreamScanner& operator=(const StreamScanner& s) = delete;
+
+    // Searches a file; returns false (with a message) if it cannot be open or read
+    bool Scan(const fs::path& FileName, const MatchFunction& OnMatches, const InspectFunction& Inspect = nullptr);
+
+    // Searches any input; returns false if Read fails
+    bool Scan(const ReadFunction& Read, const MatchFunction& OnMatches, const InspectFunction& Inspect = nullptr);
+
+    // Number of bytes of the last input scanned whole (or read until Inspect stopped the scan)
+    uint64_t inputSize() const;
+
+private:
+    const PatternMatcher&              _matcher;
+    size_t                             _blockSize;
+    size_t                             _overlap;
+    std::string                        _buffer;
+    std::vector<PatternMatcher::Match> _matches;
+    uint64_t                           _inputSize;
+};
+
+#endif // STREAMSCANNER_H
@@ -0,0 +1,64 @@
+#ifndef STRINGDATA_H
+#define STRINGDATA_H
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <string_view>
+
+namespace {
+    constexpr int AFFIX_SIZE = 3;
+}
+
+// Holds the positions of the search strings found inside a file, with their prefixes and suffixes
+// Storage is columnar and append only:
+//  - a sorted vector of positions
+//  - the index of the search string of every match (only stored when several search strings are used)
+//  - a single byte arena holding AFFIX_SIZE prefix bytes followed by AFFIX_SIZE suffix bytes per match
+//    (only stored once a match with a prefix or a suffix was added: files searched without affixes
+//    cost 8 bytes per match)
+// Affixes are only shorter than AFFIX_SIZE next to the edges of a file; their sizes are then kept
+// in a small side list, so a match costs 8 + 2 * AFFIX_SIZE bytes
+class StringData
+{
+public:
+    static_assert(AFFIX_SIZE < 16, "affix sizes are packed on 4 bits");
+
+    // Prefix and suffix of a match; views inside the arena, valid while the StringData is not modified
+    struct AffixView
+    {
+        std::string_view prefix;
+        std::string_view suffix;
+    };
+
+    StringData();
+
+    // Appends a match; positions must be added in increasing order
+    void Add(uint64_t Position, size_t SearchString, std::string_view Prefix, std::string_view Suffix);
+
+    // Pre-allocates room for Count matches
+    void Reserve(size_t Count);
+
+    // Releases the capacity left unused once a file is done
+    void ShrinkToFit();
+
+    size_t size() const;
+
+    bool empty() const;
+
+    uint64_t position(size_t Index) const;
+
+    // Index of the search string found at position(Index)
+    size_t searchString(size_t Index) const;
+
+    AffixView affixes(size_t Index) const;
+
+private:
+    std::vector<uint64_t>                      _positions;
+    std::vector<uint32_t>                      _searchStrings;
+    std::vector<char>                          _affixes;
+    // match index, (prefix size << 4) | suffix size; sorted by match index
+    std::vector< std::pair<uint64_t, uint8_t> > _shortAffixes;
+};
+
+#endif // STRINGDATA_H
@@ -0,0 +1,48 @@
+#ifndef TEDDYMATCHER_H
+#define TEDDYMATCHER_H
+
+#include <cstdint>
+
+#include "patternmatcher.h"
+
+namespace {
+    constexpr size_t TEDDY_NUM_BUCKETS = 8;
+    constexpr size_t TEDDY_MAX_FINGERPRINT = 3;
+}
+
+// SIMD matcher for small pattern sets (Teddy algorithm)
+// Patterns are spread over 8 buckets; the first 1 to 3 bytes of every pattern are encoded into
+// per byte nibble tables, so that two shuffles per fingerprint byte tell, for 16 (SSSE3) or
+// 32 (AVX2) positions at once, which buckets may match; only those candidates are verified
+// Ignoring case, both cases of every letter of a fingerprint are set in the nibble tables and the
+// candidates are verified against the folded patterns
+// Must only be created when the CPU supports SSSE3
+class TeddyMatcher : public PatternMatcher
+{
+public:
+    explicit TeddyMatcher(const std::vector<std::string>& Patterns, bool IgnoreCase = false);
+
+    void FindAll(std::string_view Contents, std::vector<Match>& Matches) const override;
+
+    const char* name() const override;
+
+    // Teddy needs at least SSSE3 (byte shuffles)
+    static bool IsSupported();
+
+private:
+    // Bucket bits that may match at Position (scalar version of the vector filter)
+    uint8_t Candidates(const char* Data, size_t Position) const;
+
+    // Verifies the patterns of the buckets set in Buckets at Position
+    void Verify(std::string_view Contents, size_t Position, uint8_t Buckets, std::vector<Match>& Matches) const;
+
+    size_t                             _fingerprintSize;
+    bool                               _useAvx2;
+    alignas(16) uint8_t                _lowNibbles[TEDDY_MAX_FINGERPRINT][16];
+    alignas(16) uint8_t                _highNibbles[TEDDY_MAX_FINGERPRINT][16];
+    std::vector< std::vector<size_t> > _buckets;
+    // patterns as compared: folded when ignoring case
+    std::vector<std::string>           _foldedPatterns;
+};
+
+#endif // TEDDYMATCHER_H
@@ -0,0 +1,102 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <list>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+// Pool of worker threads with work stealing
+// Every worker owns a task deque: tasks pushed by a worker go to its own deque, which it takes
+// from the front (most recent first, still hot in cache), while idle workers steal from the back
+// of the other deques (oldest, i.e. largest remaining work first)
+// When no task is queued anywhere, idle workers ask the Source function given to Run() for new
+// work (e.g. the next file to search); a source call may push tasks for the other workers
+// The workers live as long as the pool and several threads may call Run() at once (e.g. concurrent
+// searches sharing one pool): each call is a job with its own source, and idle workers turn to the
+// job with the fewest workers busy on it
+class ThreadPool
+{
+public:
+    // Tasks and sources get the index of the worker running them, in [0, size())
+    using Task = std::function<void(int WorkerId)>;
+    using Source = std::function<bool(int WorkerId)>;
+
+    explicit ThreadPool(int NumThreads);
+
+    ThreadPool(const ThreadPool& p) = delete;
+
+    ThreadPool& operator=(const ThreadPool& p) = delete;
+
+    ~ThreadPool();
+
+    // Runs the workers until Source returned false (nothing left to produce) and every task it led to
+    // is done; the calling thread waits, so it must not be a worker of this pool
+    void Run(Source WorkSource);
+
+    // Queues a task of the job being run by worker WorkerId on its deque; must be called from that worker
+    void Push(int WorkerId, Task NewTask);
+
+    int size() const;
+
+    // Number of hardware threads (at least 1)
+    static int DefaultThreadCount();
+
+private:
+    // A call to Run()
+    struct Job
+    {
+        Source source;
+        size_t queuedTasks;      // tasks waiting in a deque
+        size_t runningTasks;     // tasks and source calls being run
+        bool   sourceExhausted;
+        bool   isDone;
+    };
+
+    struct QueuedTask
+    {
+        Job* job;
+        Task task;
+    };
+
+    // A deque per worker, each on its own cache lines
+    struct alignas(64) WorkerQueue
+    {
+        std::mutex             mutex;
+        std::deque<QueuedTask> tasks;
+        Job*                   currentJob;  // only used by the worker itself
+    };
+
+    void WorkerThread(int WorkerId);
+
+    // Takes a task from the worker's own deque, or steals one from another worker
+    bool TakeTask(int WorkerId, QueuedTask& NextTask);
+
+    // Returns true if a task is in any deque
+    bool HasQueuedTask();
+
+    // Job whose source should be called next, null if every source is exhausted; _mutex must be held
+    Job* NextSource();
+
+    // Accounts for the end of a task or source call; wakes everyone waiting when a job is done
+    void Finished(Job& FinishedJob);
+
+    const int                                  _numThreads;
+    std::vector< std::unique_ptr<WorkerQueue> > _queues;
+    std::list<Job>                             _jobs;
+    std::mutex                                 _mutex;
+    std::condition_variable                    _stateChanged;
+    size_t                                     _queuedTasks;  // all jobs
+    std::atomic<uint64_t>                      _taskEvents;      // tasks pushed into, or taken from, a deque
+    std::atomic<int>                           _waitingWorkers;  // for a task being pushed or taken
+    bool                                       _stopping;
+    std::vector<std::thread>                   _threads;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,103 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <filesystem>
+
+#include "mappedfile.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr std::string_view INDEX_FILE_MAGIC = "SFINDEX1";
+    constexpr std::string_view INDEX_FILE_END_MAGIC = "SFINDEND";
+    constexpr uint32_t         INDEX_FILE_VERSION = 2;
+    constexpr size_t           INDEX_FILE_HEADER_SIZE = 8 + 4 + 4;
+    constexpr size_t           INDEX_FILE_FOOTER_SIZE = 8 + 8 + 8 + 8 + 8 + 8 + 8;
+    constexpr size_t           TRIGRAM_ENTRY_SIZE = 4 + 4 + 8;
+    constexpr size_t           TRIGRAM_COUNT = 1 << 24;
+}
+
+// Persistent index of the trigrams (3 consecutive bytes) contained in every file of a location
+// A search string can only be found in a file containing all of its trigrams, so intersecting the
+// posting lists of the trigrams of the search strings gives the (few) files worth searching
+// Layout of the index file (fixed size integers are little endian, varints LEB128, see encoding.h):
+//
+//  header         INDEX_FILE_MAGIC | u32 version | u32 reserved
+//                 varint root size | canonical root of the indexed location
+//  file records   per file: varint path size | path relative to the root | u64 size | u64 write time
+//  posting lists  per trigram: varint delta encoded file ids, in increasing order
+//  directories    per directory: varint path size | path relative to the root | u64 write time
+//  file table     per file: u64 offset of the record; file ids are indexes in this table (path order)
+//  trigram table  per trigram, sorted: u32 trigram | u32 file count | u64 offset of the posting list
+//  footer         u64 file count | u64 trigram count | u64 file table offset | u64 trigram table offset |
+//                 u64 directory count | u64 directories offset | INDEX_FILE_END_MAGIC
+//
+// The index is memory mapped at query time; only the posting lists of the searched trigrams are read
+// Trigrams are indexed as they are: ignoring case, a file is a candidate for a trigram if it contains
+// any of its case variants (up to 8)
+// It reflects the location when it was built; files modified since (their size or write time changed)
+// are still candidates, and so are the files added since, found by listing the directories whose write
+// time changed: results stay complete, but the index must be rebuilt to stay fast
+// Write times less than RACY_WRITE_TIME old when the index is built are stored as 0: the file or
+// directory may still change within the same write time, so it always looks modified
+class TrigramIndex
+{
+public:
+    TrigramIndex();
+
+    TrigramIndex(const TrigramIndex& i) = delete;
+
+    TrigramIndex& operator=(const TrigramIndex& i) = delete;
+
+    // Indexes all files located at Location into IndexFile, using NumThreads workers
+    static bool Build(const fs::path& Location, const fs::path& IndexFile, int NumThreads);
+
+    // Maps an index file and validates it; returns false if it is not a valid index
+    bool Open(const fs::path& IndexFile);
+
+    // Files (path order) that may contain at least one of SearchStrings, plus every file modified or
+    // added since the index was built; search strings shorter than a trigram match every file
+    // Returns false if the index was not built for Location
+    bool Candidates(const std::vector<std::string>& SearchStrings, const fs::path& Location,
+                    std::vector<fs::path>& Files, bool IgnoreCase = false) const;
+
+    size_t fileCount() const;
+
+private:
+    // Path (relative to the root), size and write time of the indexed file FileId; false if malformed
+    bool FileRecord(size_t FileId, std::string_view& RelativePath, uint64_t& Size, uint64_t& WriteTime) const;
+
+    // Marks as candidates the indexed files modified since the index was built, and returns their
+    // count; AddedFiles receives the files found in directories modified since, but not indexed
+    size_t FindChangedFiles(const fs::path& Location, std::vector<bool>& IsCandidate,
+                            std::vector<fs::path>& AddedFiles) const;
+
+    // Decodes the posting list of Trigram; false if no file contains it
+    bool PostingList(uint32_t Trigram, std::vector<uint32_t>& FileIds) const;
+
+    // File ids of the files containing every trigram of SearchString (in any case when ignoring case)
+    std::vector<uint32_t> StringCandidates(const std::string& SearchString, bool IgnoreCase) const;
+
+    // File ids of the files containing Trigram or, when ignoring case, any of its case variants;
+    // false if there is none
+    bool TrigramCandidates(uint32_t Trigram, bool IgnoreCase, std::vector<uint32_t>& FileIds) const;
+
+    // Reports a malformed index and closes it
+    bool Invalid(const fs::path& IndexFile, const char* Reason);
+
+    MappedFile       _file;
+    std::string_view _contents;
+    std::string_view _root;
+    size_t           _fileCount;
+    size_t           _trigramCount;
+    size_t           _directoryCount;
+    const char*      _directories;
+    const char*      _fileTable;
+    const char*      _trigramTable;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -0,0 +1,226 @@
+#include "ahocorasick.h"
+#include "casefolding.h"
+
+#include <deque>
+#include <utility>
+#include <algorithm>
+
+using namespace std;
+
+AhoCorasickMatcher::AhoCorasickMatcher(const vector<string>& Patterns, bool IgnoreCase) : PatternMatcher(Patterns, IgnoreCase),
+    _byteClass{}, _numClasses{ 1 }
+{
+    Build();
+}
+
+void AhoCorasickMatcher::Build()
+{
+    // bytes used by the patterns get their own class, all other bytes share class 0
+    for (auto&& pattern : _patterns)
+    {
+        for (auto ch : pattern)
+        {
+            uint16_t& byteClass = _byteClass[static_cast<unsigned char>(ch)];
+
+            if (0 == byteClass)
+            {
+                byteClass = _numClasses++;
+
+                if ( _ignoreCase && IsAsciiLetter(ch) )
+                {
+                    _byteClass[static_cast<unsigned char>(ch) ^ 0x20] = byteClass;
+                }
+            }
+        }
+    }
+
+    // trie
+    vector< vector< pair<uint16_t, uint32_t> > > children(1);
+
+    _terminal.assign(1, NO_STATE);
+
+    for (size_t i = 0; i < _patterns.size(); ++i)
+    {
+        uint32_t state = 0;
+
+        for (auto ch : _patterns[i])
+        {
+            const uint16_t byteClass = _byteClass[static_cast<unsigned char>(ch)];
+            auto           child = find_if(children[state].begin(), children[state].end(),
+                                           [byteClass](const pair<uint16_t, uint32_t>& Edge)
+                                           { return Edge.first == byteClass; });
+
+            if (child != children[state].end())
+            {
+                state = child->second;
+            }
+            else
+            {
+                const uint32_t newState = static_cast<uint32_t>( children.size() );
+
+                children[state].emplace_back(byteClass, newState);
+                children.emplace_back();
+                _terminal.push_back(NO_STATE);
+                state = newState;
+            }
+        }
+
+        _terminal[state] = static_cast<uint32_t>(i);
+    }
+
+    // flatten the edges; sorted per state for lookups
+    const size_t numStates = children.size();
+
+    _edgeStart.reserve(numStates + 1);
+
+    for (auto&& edges : children)
+    {
+        sort(edges.begin(), edges.end());
+        _edgeStart.push_back( static_cast<uint32_t>( _edgeClass.size() ) );
+
+        for (auto&& edge : edges)
+        {
+            _edgeClass.push_back(edge.first);
+            _edgeTarget.push_back(edge.second);
+        }
+    }
+
+    _edgeStart.push_back( static_cast<uint32_t>( _edgeClass.size() ) );
+
+    // failure and output links, breadth first so parents are always resolved before children
+    _fail.assign(numStates, 0);
+    _output.assign(numStates, NO_STATE);
+    _outputLink.assign(numStates, NO_STATE);
+
+    deque<uint32_t> pending{ 0 };
+
+    while ( !pending.empty() )
+    {
+        const uint32_t state = pending.front();
+        pending.pop_front();
+
+        for (uint32_t edge = _edgeStart[state]; edge < _edgeStart[state + 1]; ++edge)
+        {
+            const uint32_t child = _edgeTarget[edge];
+
+            _fail[child] = (0 == state) ? 0 : NextState(_fail[state], _edgeClass[edge]);
+            _outputLink[child] = _output[ _fail[child] ];
+            _output[child] = (NO_STATE != _terminal[child]) ? child : _outputLink[child];
+
+            pending.push_back(child);
+        }
+    }
+
+    if (numStates * _numClasses <= AC_MAX_DENSE_TRANSITIONS)
+    {
+        BuildDenseTable();
+    }
+}
+
+void AhoCorasickMatcher::BuildDenseTable()
+{
+    const size_t numStates = _fail.size();
+
+    _dense.assign(numStates * _numClasses, 0);
+
+    // states are numbered in insertion order, so a failure state can have a higher number than
+    // the state itself; breadth first order guarantees it is filled in first
+    deque<uint32_t> pending{ 0 };
+
+    while ( !pending.empty() )
+    {
+        const uint32_t state = pending.front();
+        uint32_t*      row = &_dense[static_cast<size_t>(state) * _numClasses];
+        pending.pop_front();
+
+        if (0 != state)
+        {
+            const uint32_t* failRow = &_dense[static_cast<size_t>(_fail[state]) * _numClasses];
+            copy(failRow, failRow + _numClasses, row);
+        }
+
+        for (uint32_t edge = _edgeStart[state]; edge < _edgeStart[state + 1]; ++edge)
+        {
+            row[_edgeClass[edge]] = _edgeTarget[edge];
+            pending.push_back(_edgeTarget[edge]);
+        }
+    }
+}
+
+uint32_t AhoCorasickMatcher::NextState(uint32_t State, uint16_t Class) const
+{
+    while (true)
+    {
+        const uint16_t* first = _edgeClass.data() + _edgeStart[State];
+        const uint16_t* last = _edgeClass.data() + _edgeStart[State + 1];
+        const uint16_t* edge = lower_bound(first, last, Class);
+
+        if ( (edge != last) && (*edge == Class) )
+        {
+            return _edgeTarget[edge - _edgeClass.data()];
+        }
+
+        if (0 == State)
+        {
+            return 0;
+        }
+
+        State = _fail[State];
+    }
+}
+
+void AhoCorasickMatcher::ReportMatches(uint32_t Output, size_t Position, vector<Match>& Matches) const
+{
+    while (NO_STATE != Output)
+    {
+        const size_t pattern = _terminal[Output];
+
+        Matches.push_back({ Position + 1 - _patterns[pattern].size(), pattern, _patterns[pattern].size() });
+        Output = _outputLink[Output];
+    }
+}
+
+void AhoCorasickMatcher::FindAll(string_view Contents, vector<Match>& Matches) const
+{
+    const size_t   firstMatch = Matches.size();
+    const size_t   contentsSize = Contents.size();
+    const uint8_t* data = reinterpret_cast<const uint8_t*>( Contents.data() );
+    uint32_t       state = 0;
+
+    if ( !_dense.empty() )
+    {
+        const uint32_t* dense = _dense.data();
+        const size_t    numClasses = _numClasses;
+
+        for (size_t i = 0; i < contentsSize; ++i)
+        {
+            state = dense[state * numClasses + _byteClass[data[i]]];
+
+            if (NO_STATE != _output[state])
+            {
+                ReportMatches(_output[state], i, Matches);
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < contentsSize; ++i)
+        {
+            state = NextState(state, _byteClass[data[i]]);
+
+            if (NO_STATE != _output[state])
+            {
+                ReportMatches(_output[state], i, Matches);
+            }
+        }
+    }
+
+    // matches are found by end position
+    sort(Matches.begin() + firstMatch, Matches.end(), [](const Match& Lhs, const Match& Rhs)
+         { return (Lhs.position < Rhs.position) || ( (Lhs.position == Rhs.position) && (Lhs.pattern < Rhs.pattern) ); });
+}
+
+const char* AhoCorasickMatcher::name() const
+{
+    return _dense.empty() ? "Aho-Corasick (sparse)" : "Aho-Corasick (dense)";
+}
@@ -0,0 +1,613 @@
+#include "asyncreader.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+using namespace std;
+
+namespace {
+#ifdef _WIN32
+    // Reads a small regular file whole; returns false if it must be left to the consumer
+    bool ReadWhole(const fs::path& File, string& Contents)
+    {
+        error_code error;
+
+        if ( !fs::is_regular_file(File, error) )
+        {
+            return false;
+        }
+
+        const uint64_t size = fs::file_size(File, error);
+
+        if ( error || (0 == size) || (size > ASYNC_READ_MAX_SIZE) )
+        {
+            return false;
+        }
+
+        ifstream contentStream(File, ios::binary);
+
+        Contents.resize( static_cast<size_t>(size) );
+        contentStream.read( &Contents[0], static_cast<streamsize>(size) );
+        Contents.resize( static_cast<size_t>( max<streamsize>(contentStream.gcount(), 0) ) );
+
+        return !contentStream.bad();
+    }
+#else
+    // Reads a small regular file whole; returns false if it must be left to the consumer
+    bool ReadWhole(const fs::path& File, string& Contents)
+    {
+        const int descriptor = open(File.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (descriptor < 0)
+        {
+            return false;
+        }
+
+        struct stat fileStat{};
+        bool        isRead = (0 == fstat(descriptor, &fileStat)) && S_ISREG(fileStat.st_mode) &&
+                             (fileStat.st_size > 0) && (static_cast<uint64_t>(fileStat.st_size) <= ASYNC_READ_MAX_SIZE);
+        size_t      readBytes = 0;
+
+        if (isRead)
+        {
+            Contents.resize( static_cast<size_t>(fileStat.st_size) );
+        }
+
+        // the file may shrink (short read) while being read
+        while ( isRead && (readBytes < Contents.size()) )
+        {
+            const ssize_t bytesRead = pread(descriptor, &Contents[readBytes], Contents.size() - readBytes,
+                                            static_cast<off_t>(readBytes));
+
+            if (bytesRead > 0)
+            {
+                readBytes += static_cast<size_t>(bytesRead);
+            }
+            else if (0 == bytesRead)
+            {
+                Contents.resize(readBytes);
+            }
+            else if (EINTR != errno)
+            {
+                isRead = false;
+            }
+        }
+
+        close(descriptor);
+
+        return isRead;
+    }
+#endif
+}
+
+#ifdef __linux__
+class AsyncReader::IoRing
+{
+public:
+    IoRing() : _descriptor{ -1 }, _ringMemory{ MAP_FAILED }, _ringSize{ 0 }, _completionMemory{ MAP_FAILED },
+        _completionSize{ 0 }, _entries{ static_cast<io_uring_sqe*>(MAP_FAILED) }, _entriesSize{ 0 }, _toSubmit{ 0 }
+    {
+    }
+
+    IoRing(const IoRing& r) = delete;
+
+    IoRing& operator=(const IoRing& r) = delete;
+
+    ~IoRing()
+    {
+        if (MAP_FAILED != static_cast<void*>(_entries))
+        {
+            munmap(_entries, _entriesSize);
+        }
+
+        if ( (MAP_FAILED != _completionMemory) && (_completionMemory != _ringMemory) )
+        {
+            munmap(_completionMemory, _completionSize);
+        }
+
+        if (MAP_FAILED != _ringMemory)
+        {
+            munmap(_ringMemory, _ringSize);
+        }
+
+        if (_descriptor >= 0)
+        {
+            close(_descriptor);
+        }
+    }
+
+    // Creates a ring of at least Entries submissions; returns false if io_uring is not available
+    // (old kernel, or forbidden by a seccomp policy) or lacks the operations used here
+    bool Setup(unsigned Entries)
+    {
+        io_uring_params params{};
+
+        _descriptor = static_cast<int>( syscall(__NR_io_uring_setup, Entries, &params) );
+
+        // the open, stat and read operations came with the same kernel release as this feature
+        if ( (_descriptor < 0) || (0 == (params.features & IORING_FEAT_RW_CUR_POS)) )
+        {
+            return false;
+        }
+
+        _ringSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _completionSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        if (0 != (params.features & IORING_FEAT_SINGLE_MMAP))
+        {
+            _ringSize = max(_ringSize, _completionSize);
+        }
+
+        _ringMemory = mmap(nullptr, _ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _descriptor,
+                           IORING_OFF_SQ_RING);
+
+        if (MAP_FAILED == _ringMemory)
+        {
+            return false;
+        }
+
+        _completionMemory = (0 != (params.features & IORING_FEAT_SINGLE_MMAP)) ?
+                            _ringMemory :
+                            mmap(nullptr, _completionSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                 _descriptor, IORING_OFF_CQ_RING);
+
+        _entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+        _entries = static_cast<io_uring_sqe*>( mmap(nullptr, _entriesSize, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_POPULATE, _descriptor, IORING_OFF_SQES) );
+
+        if ( (MAP_FAILED == _completionMemory) || (MAP_FAILED == static_cast<void*>(_entries)) )
+        {
+            return false;
+        }
+
+        char* ring = static_cast<char*>(_ringMemory);
+        char* completion = static_cast<char*>(_completionMemory);
+
+        _submissionHead = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+        _submissionTail = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+        _submissionMask = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+        _submissionCount = params.sq_entries;
+        _submissionArray = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+        _completionHead = reinterpret_cast<unsigned*>(completion + params.cq_off.head);
+        _completionTail = reinterpret_cast<unsigned*>(completion + params.cq_off.tail);
+        _completionMask = *reinterpret_cast<unsigned*>(completion + params.cq_off.ring_mask);
+        _completions = reinterpret_cast<io_uring_cqe*>(completion + params.cq_off.cqes);
+
+        return true;
+    }
+
+    // Queues an operation, submitted by the next call to Submit(); the ring is sized so it never fills up
+    io_uring_sqe& Prepare(uint8_t Opcode, int Descriptor, uint64_t UserData)
+    {
+        const unsigned tail = *_submissionTail;
+        const unsigned index = tail & _submissionMask;
+        io_uring_sqe&  entry = _entries[index];
+
+        memset(&entry, 0, sizeof(entry));
+        entry.opcode = Opcode;
+        entry.fd = Descriptor;
+        entry.user_data = UserData;
+
+        _submissionArray[index] = index;
+        // the kernel must see the entry before the new tail
+        __atomic_store_n(_submissionTail, tail + 1, __ATOMIC_RELEASE);
+        ++_toSubmit;
+
+        return entry;
+    }
+
+    // Submits the queued operations and waits for at least WaitCount completions
+    bool Submit(unsigned WaitCount)
+    {
+        while ( (_toSubmit > 0) || (WaitCount > 0) )
+        {
+            const long submitted = syscall(__NR_io_uring_enter, _descriptor, _toSubmit, WaitCount,
+                                           (WaitCount > 0) ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+            if (submitted < 0)
+            {
+                if ( (EINTR == errno) || (EAGAIN == errno) || (EBUSY == errno) )
+                {
+                    continue;
+                }
+
+                return false;
+            }
+
+            _toSubmit -= static_cast<unsigned>(submitted);
+            WaitCount = 0;
+        }
+
+        return true;
+    }
+
+    // Takes the next completion, if any
+    bool Reap(io_uring_cqe& Completion)
+    {
+        const unsigned head = *_completionHead;
+
+        if ( head == __atomic_load_n(_completionTail, __ATOMIC_ACQUIRE) )
+        {
+            return false;
+        }
+
+        Completion = _completions[head & _completionMask];
+        __atomic_store_n(_completionHead, head + 1, __ATOMIC_RELEASE);
+
+        return true;
+    }
+
+    unsigned capacity() const
+    {
+        return _submissionCount;
+    }
+
+private:
+    int           _descriptor;
+    void*         _ringMemory;
+    size_t        _ringSize;
+    void*         _completionMemory;
+    size_t        _completionSize;
+    io_uring_sqe* _entries;
+    size_t        _entriesSize;
+    unsigned      _toSubmit;
+    unsigned*     _submissionHead;
+    unsigned*     _submissionTail;
+    unsigned      _submissionMask;
+    unsigned      _submissionCount;
+    unsigned*     _submissionArray;
+    unsigned*     _completionHead;
+    unsigned*     _completionTail;
+    unsigned      _completionMask;
+    io_uring_cqe* _completions;
+};
+#else
+// io_uring only exists on Linux
+class AsyncReader::IoRing
+{
+};
+#endif
+
+AsyncReader::AsyncReader(SourceFunction Source, int QueueDepth, bool UseRing) :
+    _source{ std::move(Source) }, _queueDepth{ max(QueueDepth, 1) }, _useRing{ UseRing }, _ring{}, _statistics{ nullptr },
+    _output{ static_cast<size_t>( max(QueueDepth, 1) ) }, _runningThreads{ 0 }
+{
+}
+
+AsyncReader::~AsyncReader()
+{
+    Wait();
+}
+
+void AsyncReader::UseStatistics(Statistics& Stats)
+{
+    _statistics = &Stats;
+}
+
+void AsyncReader::Start()
+{
+#ifdef __linux__
+    if (_useRing)
+    {
+        // open and stat of a file are in flight together
+        _ring = make_unique<IoRing>();
+
+        if ( _ring->Setup( static_cast<unsigned>(2 * _queueDepth) ) )
+        {
+            _threads.emplace_back(&AsyncReader::RunRing, this);
+            return;
+        }
+
+        _ring.reset();
+    }
+#endif
+
+    // blocking reads: a few threads keep the device busy, more only cost memory and context switches
+    const int numThreads = min(_queueDepth, MAX_READER_THREADS);
+
+    _runningThreads = numThreads;
+
+    for (int i = 0; i < numThreads; ++i)
+    {
+        _threads.emplace_back(&AsyncReader::RunThread, this);
+    }
+}
+
+bool AsyncReader::Pop(ReadFile& File)
+{
+    return _output.Pop(File);
+}
+
+void AsyncReader::Wait()
+{
+    for (auto&& thread : _threads)
+    {
+        if ( thread.joinable() )
+        {
+            thread.join();
+        }
+    }
+
+    _threads.clear();
+}
+
+const char* AsyncReader::backend() const
+{
+    return _ring ? "io_uring" : "pread";
+}
+
+#ifdef __linux__
+void AsyncReader::RunRing()
+{
+    enum Operation
+    {
+        OPEN,
+        STAT,
+        READ
+    };  // Low bits of the user data of the operations; high bits hold the slot
+
+    // One file in flight
+    struct Slot
+    {
+        ReadFile     file;
+        int          descriptor;
+        int          pendingOperations;
+        int          statResult;
+        struct statx status;
+        size_t       readBytes;
+    };
+
+    vector<Slot>   slots( static_cast<size_t>(_queueDepth) );
+    vector<size_t> freeSlots{};
+    bool           hasMoreFiles = true;
+    IoRing&        ring = *_ring;
+
+    for (size_t slot = slots.size(); slot > 0; --slot)
+    {
+        freeSlots.push_back(slot - 1);
+    }
+
+    const auto deliver = [this, &slots, &freeSlots](size_t Index, bool IsRead)
+    {
+        Slot& slot = slots[Index];
+
+        if (slot.descriptor >= 0)
+        {
+            close(slot.descriptor);
+        }
+
+        slot.file.isRead = IsRead;
+
+        if (!IsRead)
+        {
+            slot.file.contents = string();
+        }
+
+        CountRead(slot.file);
+        _output.Push( std::move(slot.file) );
+        freeSlots.push_back(Index);
+    };
+
+    const auto prepareRead = [&ring, &slots](size_t Index)
+    {
+        Slot&         slot = slots[Index];
+        io_uring_sqe& entry = ring.Prepare(IORING_OP_READ, slot.descriptor, (Index << 2) | READ);
+
+        entry.addr = reinterpret_cast<uint64_t>(&slot.file.contents[slot.readBytes]);
+        entry.len = static_cast<uint32_t>(slot.file.contents.size() - slot.readBytes);
+        entry.off = slot.readBytes;
+    };
+
+    while ( hasMoreFiles || (freeSlots.size() < slots.size()) )
+    {
+        // new files: their open and stat are submitted together; the source may only block while
+        // nothing is in flight, the files it has ready are taken otherwise
+        while ( hasMoreFiles && !freeSlots.empty() )
+        {
+            const size_t index = freeSlots.back();
+            Slot&        slot = slots[index];
+
+            {
+                lock_guard<mutex> lock(_sourceMutex);
+
+                hasMoreFiles = _source( slot.file.path, slot.file.sequence, freeSlots.size() == slots.size() );
+            }
+
+            if ( !hasMoreFiles || slot.file.path.empty() )
+            {
+                break;
+            }
+
+            freeSlots.pop_back();
+            slot.file.contents = string();
+            slot.descriptor = -1;
+            slot.pendingOperations = 2;
+            slot.statResult = -1;
+            slot.readBytes = 0;
+
+            // the path buffer stays valid until both operations complete
+            io_uring_sqe& open = ring.Prepare(IORING_OP_OPENAT, AT_FDCWD, (index << 2) | OPEN);
+
+            open.addr = reinterpret_cast<uint64_t>( slot.file.path.c_str() );
+            open.open_flags = O_RDONLY | O_CLOEXEC;
+
+            io_uring_sqe& stat = ring.Prepare(IORING_OP_STATX, AT_FDCWD, (index << 2) | STAT);
+
+            stat.addr = reinterpret_cast<uint64_t>( slot.file.path.c_str() );
+            stat.len = STATX_TYPE | STATX_SIZE;
+            stat.off = reinterpret_cast<uint64_t>(&slot.status);
+        }
+
+        if ( freeSlots.size() == slots.size() )
+        {
+            continue;
+        }
+
+        {
+            // the only place the ring thread blocks
+            Statistics::ScopedTimer timer(_statistics, Statistics::READ_TIME);
+
+            if ( !ring.Submit(1) )
+            {
+                break;
+            }
+        }
+
+        io_uring_cqe completion{};
+
+        while ( ring.Reap(completion) )
+        {
+            const size_t index = static_cast<size_t>(completion.user_data >> 2);
+            Slot&        slot = slots[index];
+
+            switch (completion.user_data & 3)
+            {
+            case OPEN:
+            case STAT:
+            {
+                if (OPEN == (completion.user_data & 3))
+                {
+                    slot.descriptor = completion.res;
+                }
+                else
+                {
+                    slot.statResult = completion.res;
+                }
+
+                if (0 != --slot.pendingOperations)
+                {
+                    break;
+                }
+
+                const bool isSmallFile = (slot.descriptor >= 0) && (0 == slot.statResult) &&
+                                         S_ISREG(slot.status.stx_mode) && (slot.status.stx_size > 0) &&
+                                         (slot.status.stx_size <= ASYNC_READ_MAX_SIZE);
+
+                if (!isSmallFile)
+                {
+                    deliver(index, false);
+                    break;
+                }
+
+                slot.file.contents.resize( static_cast<size_t>(slot.status.stx_size) );
+                prepareRead(index);
+                break;
+            }
+            default:
+            {
+                if ( (completion.res < 0) && (-EINTR != completion.res) && (-EAGAIN != completion.res) )
+                {
+                    deliver(index, false);
+                    break;
+                }
+
+                slot.readBytes += static_cast<size_t>( max(completion.res, 0) );
+
+                if (0 == completion.res)
+                {
+                    // the file shrank
+                    slot.file.contents.resize(slot.readBytes);
+                }
+
+                if ( slot.readBytes < slot.file.contents.size() )
+                {
+                    prepareRead(index);
+                }
+                else
+                {
+                    deliver(index, true);
+                }
+
+                break;
+            }
+            }
+        }
+    }
+
+    // only reached early if the ring failed: the remaining files are left to the consumer
+    for (size_t index = 0; index < slots.size(); ++index)
+    {
+        if ( find(freeSlots.begin(), freeSlots.end(), index) == freeSlots.end() )
+        {
+            deliver(index, false);
+        }
+    }
+
+    fs::path file;
+    uint64_t sequence = 0;
+
+    while ( _source(file, sequence, true) )
+    {
+        _output.Push( ReadFile{ std::move(file), sequence, false, string() } );
+    }
+
+    _output.Close();
+}
+#else
+void AsyncReader::RunRing()
+{
+}
+#endif
+
+void AsyncReader::RunThread()
+{
+    ReadFile file{};
+
+    while (true)
+    {
+        {
+            lock_guard<mutex> lock(_sourceMutex);
+
+            if ( !_source(file.path, file.sequence, true) )
+            {
+                break;
+            }
+        }
+
+        file.contents = string();
+
+        {
+            Statistics::ScopedTimer timer(_statistics, Statistics::READ_TIME);
+
+            file.isRead = ReadWhole(file.path, file.contents);
+        }
+
+        if (!file.isRead)
+        {
+            file.contents = string();
+        }
+
+        CountRead(file);
+        _output.Push( std::move(file) );
+    }
+
+    // the last thread closes the output
+    if (1 == _runningThreads.fetch_sub(1))
+    {
+        _output.Close();
+    }
+}
+
+void AsyncReader::CountRead(const ReadFile& File)
+{
+    if ( (nullptr != _statistics) && File.isRead )
+    {
+        _statistics->Add(Statistics::FILES_READ);
+        _statistics->Add( Statistics::BYTES_READ, File.contents.size() );
+    }
+}
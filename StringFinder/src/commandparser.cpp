@@ -1,40 +1,285 @@
 #include "commandparser.h"
 
 #include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
 #include <filesystem>
-#include <termcolor\termcolor.hpp>
+#include <termcolor/termcolor.hpp>
 
-namespace fs = std::experimental::filesystem;
+#include "threadpool.h"
+#include "asyncreader.h"
+#include "casefolding.h"
+#include "regexprogram.h"
+#include "pathfilter.h"
+#include "globset.h"
+
+namespace fs = std::filesystem;
 
 using namespace std;
 using namespace termcolor;
 
-CommandParser::CommandParser() : _location{}, _searchString{}
+CommandParser::CommandParser() : _location{}, _searchStrings{}, _options{}
 {
 }
 
 bool CommandParser::ValidateArguments(const int Argc, const char * const Argv[])
 {
-    bool areValid = false;
+    bool areValid = true;
+    bool hasPositionalString = false;
 
-    if (Argc != ARGUMENTS_NUMBER)
+    if (Argc < MIN_ARGUMENTS_NUMBER)
     {
         cout << red << "Invalid number of arguments: " << Argc << reset << endl;
 
         PrintHelp();
+        return false;
     }
-    else if ( IsPathValid(Argv[1]) && IsSearchStringValid(Argv[2]) )
+
+    for (int i = 1; areValid && (i < Argc); ++i)
     {
-        areValid = true;
+        const string argument(Argv[i]);
+
+        if ( ("-e" == argument) || ("-f" == argument) || ("-o" == argument) || ("--format" == argument) ||
+             ("-j" == argument) || ("--index" == argument) || ("--build-index" == argument) ||
+             ("--manifest" == argument) || ("--cache" == argument) || ("--cache-size" == argument) ||
+             ("--io-depth" == argument) || ("--serve" == argument) || ("--connect" == argument) ||
+             ("--binary" == argument) || ("--exclude-ext" == argument) || ("--exclude" == argument) ||
+             ("--include" == argument) )
+        {
+            if (i + 1 == Argc)
+            {
+                cout << red << "Missing value for option: " << argument << reset << endl;
+                areValid = false;
+            }
+            else if ("-e" == argument)
+            {
+                areValid = AddSearchString(Argv[++i]);
+            }
+            else if ("-f" == argument)
+            {
+                areValid = ReadPatternsFile(Argv[++i]);
+            }
+            else if ("-o" == argument)
+            {
+                _options.outputFile.assign(Argv[++i]);
+            }
+            else if ("-j" == argument)
+            {
+                areValid = ParseThreadCount(Argv[++i]);
+            }
+            else if ("--index" == argument)
+            {
+                _options.indexFile.assign(Argv[++i]);
+            }
+            else if ("--build-index" == argument)
+            {
+                _options.buildIndexFile.assign(Argv[++i]);
+            }
+            else if ("--manifest" == argument)
+            {
+                _options.manifestFile.assign(Argv[++i]);
+            }
+            else if ("--io-depth" == argument)
+            {
+                areValid = ParseIoDepth(Argv[++i]);
+            }
+            else if ("--cache" == argument)
+            {
+                _options.cacheDirectory.assign(Argv[++i]);
+            }
+            else if ("--cache-size" == argument)
+            {
+                areValid = ParseCacheSize(Argv[++i]);
+            }
+            else if ("--serve" == argument)
+            {
+                _options.serveSocket.assign(Argv[++i]);
+            }
+            else if ("--connect" == argument)
+            {
+                _options.connectSocket.assign(Argv[++i]);
+            }
+            else if ("--binary" == argument)
+            {
+                areValid = ParseBinaryFiles(Argv[++i]);
+            }
+            else if ("--exclude-ext" == argument)
+            {
+                areValid = ParseExtensions(Argv[++i]);
+            }
+            else if ("--exclude" == argument)
+            {
+                areValid = AddGlob(Argv[++i], _options.excludedGlobs);
+            }
+            else if ("--include" == argument)
+            {
+                areValid = AddGlob(Argv[++i], _options.includedGlobs);
+            }
+            else
+            {
+                areValid = ParseFormat(Argv[++i]);
+            }
+        }
+        else if ("--stream" == argument)
+        {
+            _options.streamOutput = true;
+        }
+        else if ("--ordered" == argument)
+        {
+            _options.streamOutput = true;
+            _options.orderedOutput = true;
+        }
+        else if ("--stats" == argument)
+        {
+            _options.showStatistics = true;
+        }
+        else if ("--progress" == argument)
+        {
+            _options.showProgress = true;
+        }
+        else if ("--watch" == argument)
+        {
+            _options.watchChanges = true;
+        }
+        else if ("--ignore-files" == argument)
+        {
+            _options.useIgnoreFiles = true;
+        }
+        else if ( ("-i" == argument) || ("--ignore-case" == argument) )
+        {
+            _options.ignoreCase = true;
+        }
+        else if ( ("-E" == argument) || ("--regex" == argument) )
+        {
+            _options.regex = true;
+        }
+        else if ( (argument.size() > 1) && ('-' == argument[0]) )
+        {
+            cout << red << "Unknown option: " << argument << reset << endl;
+            areValid = false;
+        }
+        else if ( _location.empty() )
+        {
+            areValid = IsPathValid(Argv[i]);
 
-        _location.assign(Argv[1]);
-        _searchString.assign(Argv[2]);
+            if (areValid)
+            {
+                _location.assign(Argv[i]);
+            }
+        }
+        else if (!hasPositionalString)
+        {
+            hasPositionalString = true;
+            areValid = AddSearchString(Argv[i]);
+        }
+        else
+        {
+            cout << red << "Unexpected argument: " << argument << reset << endl;
+            areValid = false;
+        }
     }
-    else
+
+    const bool isClient = !_options.connectSocket.empty();
+
+    if ( areValid && isClient && ( !_location.empty() || _searchStrings.empty() || !_options.serveSocket.empty() ) )
+    {
+        // the server searches its own location
+        cout << red << "--connect takes search strings (-e, -f) only: the location is the one of the server." << reset << endl;
+        areValid = false;
+    }
+
+    // building an index and serving do not need any search string
+    if ( areValid && !isClient && ( _location.empty() ||
+         ( _searchStrings.empty() && _options.buildIndexFile.empty() && _options.serveSocket.empty() ) ) )
+    {
+        cout << red << "A location and at least one search string are required." << reset << endl;
+        areValid = false;
+    }
+
+    // changed files are searched as they are on disk: neither the index nor the cache would know them,
+    // and a binary result file is only complete once written
+    if ( areValid && _options.watchChanges && ( isClient || !_options.serveSocket.empty() || _searchStrings.empty() ||
+         !_options.indexFile.empty() || !_options.buildIndexFile.empty() || !_options.cacheDirectory.empty() ||
+         (SearchOptions::BINARY == _options.outputFormat) ) )
+    {
+        cout << red << "--watch cannot be combined with --serve, --connect, --index, --build-index, --cache or the binary format."
+             << reset << endl;
+        areValid = false;
+    }
+
+    if (areValid && _options.regex)
+    {
+        for (auto&& searchString : _searchStrings)
+        {
+            string error{};
+
+            if ( !RegexProgram::Validate(searchString, error) )
+            {
+                cout << red << "Invalid regular expression: " << searchString << ". " << error << "." << reset << endl;
+                areValid = false;
+            }
+        }
+    }
+
+    // regular expressions are kept as given: only the search strings of a literal search are compared
+    if (areValid && _options.ignoreCase && !_options.regex)
+    {
+        // search strings differing only by case are the same search string (the first one is kept)
+        vector<string> foldedStrings{};
+        size_t         last = 0;
+
+        for (size_t i = 0; i < _searchStrings.size(); ++i)
+        {
+            string folded = FoldCase(_searchStrings[i]);
+
+            if ( find(foldedStrings.begin(), foldedStrings.end(), folded) == foldedStrings.end() )
+            {
+                foldedStrings.push_back( std::move(folded) );
+
+                if (last != i)
+                {
+                    _searchStrings[last] = std::move(_searchStrings[i]);
+                }
+
+                ++last;
+            }
+        }
+
+        _searchStrings.resize(last);
+    }
+
+    if ( areValid && !_options.buildIndexFile.empty() )
+    {
+        // searched right away with the new index
+        _options.indexFile = _options.buildIndexFile;
+    }
+
+    if ( areValid && (SearchOptions::TEXT != _options.outputFormat) && _options.outputFile.empty() )
+    {
+        // the standard output also carries the status messages
+        cout << red << "Machine readable formats must be written to an output file (-o <file>)." << reset << endl;
+        areValid = false;
+    }
+
+    if (0 == _options.numThreads)
+    {
+        _options.numThreads = ThreadPool::DefaultThreadCount();
+    }
+
+    if (!areValid)
     {
         cout << red << "Invalid arguments" << reset << endl;
         PrintHelp();
     }
+    else if (1 == _searchStrings.size())
+    {
+        cout << green << "Search string valid." << reset << endl;
+    }
+    else if (_searchStrings.size() > 1)
+    {
+        cout << green << _searchStrings.size() << " search strings valid." << reset << endl;
+    }
 
     return areValid;
 }
@@ -54,15 +299,20 @@ std::string CommandParser::location() const
     return _location;
 }
 
-std::string CommandParser::searchString() const
+std::vector<std::string> CommandParser::searchStrings() const
+{
+    return _searchStrings;
+}
+
+SearchOptions CommandParser::options() const
 {
-    return _searchString;
+    return _options;
 }
 
 bool CommandParser::HasValidLength(const char * const String, const int MinLength, const int MaxLength) const
 {
     const size_t stringLength = strlen(String);
-    const bool   hasValidLength = ( (MinLength < stringLength) && (stringLength < MaxLength) );
+    const bool   hasValidLength = ( (static_cast<size_t>(MinLength) < stringLength) && (stringLength < static_cast<size_t>(MaxLength)) );
 
     return hasValidLength;
 }
@@ -104,28 +354,230 @@ bool CommandParser::IsSearchStringValid(const char * const SearchString) const
     {
         cout << red << "Invalid search string: " << SearchString << ". Length: " << stringLength << " is invalid." << reset << endl;
     }
-    else if ( !ContainsOnlyValidChars(SearchString) )
+    else
+    {
+        isValid = true;
+    }
+
+    return isValid;
+}
+
+bool CommandParser::AddSearchString(const char * const SearchString)
+{
+    if ( !IsSearchStringValid(SearchString) )
     {
-        cout << red << "Invalid search string: " << SearchString << ". It contains invalid characters." << reset << endl;
+        return false;
+    }
+
+    if ( find(_searchStrings.begin(), _searchStrings.end(), SearchString) == _searchStrings.end() )
+    {
+        _searchStrings.emplace_back(SearchString);
+    }
+
+    return true;
+}
+
+bool CommandParser::ReadPatternsFile(const char * const FileName)
+{
+    ifstream patternsStream(FileName, ios::binary);
+    string   line{};
+
+    if ( !patternsStream.good() )
+    {
+        cout << red << "Patterns file: " << FileName << " cannot be open." << reset << endl;
+        return false;
+    }
+
+    while ( getline(patternsStream, line) )
+    {
+        // tolerate files written on Windows
+        if ( !line.empty() && ('\r' == line.back()) )
+        {
+            line.pop_back();
+        }
+
+        if ( !line.empty() && !AddSearchString( line.c_str() ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CommandParser::ParseFormat(const char * const Format)
+{
+    const string format(Format);
+
+    if ("text" == format)
+    {
+        _options.outputFormat = SearchOptions::TEXT;
+    }
+    else if ("json" == format)
+    {
+        _options.outputFormat = SearchOptions::JSON_LINES;
+    }
+    else if ("binary" == format)
+    {
+        _options.outputFormat = SearchOptions::BINARY;
     }
     else
     {
-        cout << green << "Search string valid." << reset << endl;
+        cout << red << "Unknown output format: " << format << reset << endl;
+        return false;
+    }
 
-        isValid = true;
+    return true;
+}
+
+bool CommandParser::ParseBinaryFiles(const char * const BinaryFiles)
+{
+    const string binaryFiles(BinaryFiles);
+
+    if ("search" == binaryFiles)
+    {
+        _options.binaryFiles = SearchOptions::SEARCH_BINARY;
+    }
+    else if ("skip" == binaryFiles)
+    {
+        _options.binaryFiles = SearchOptions::SKIP_BINARY;
+    }
+    else if ("no-affixes" == binaryFiles)
+    {
+        _options.binaryFiles = SearchOptions::BINARY_WITHOUT_AFFIXES;
+    }
+    else
+    {
+        cout << red << "Unknown binary files mode: " << binaryFiles << ". Expected skip, no-affixes or search." << reset << endl;
+        return false;
     }
 
-    return isValid;
+    return true;
 }
 
-bool CommandParser::ContainsOnlyValidChars(const char * const SearchString) const
+bool CommandParser::ParseExtensions(const char * const Extensions)
 {
-    // TODO: add logic as per requirements
+    const string extensions(Extensions);
+    size_t       start = 0;
+
+    while (start <= extensions.size())
+    {
+        const size_t end = min( extensions.find(',', start), extensions.size() );
+        const string extension = extensions.substr(start, end - start);
+
+        if ( extension.empty() || ("." == extension) || (extension.size() > MAX_EXTENSION_SIZE + 1) )
+        {
+            cout << red << "Invalid extension: <" << extension << "> in: " << Extensions << reset << endl;
+            return false;
+        }
+
+        _options.excludedExtensions.push_back(extension);
+        start = end + 1;
+    }
+
+    return true;
+}
+
+bool CommandParser::AddGlob(const char * const Glob, vector<string>& Globs)
+{
+    string error{};
+
+    if ( !GlobSet::Validate(Glob, error) )
+    {
+        cout << red << "Invalid glob: " << Glob << ". " << error << "." << reset << endl;
+        return false;
+    }
+
+    Globs.emplace_back(Glob);
+
+    return true;
+}
+
+bool CommandParser::ParseThreadCount(const char * const ThreadCount)
+{
+    char*      end = nullptr;
+    const long threadCount = strtol(ThreadCount, &end, 10);
+
+    if ( (end == ThreadCount) || ('\0' != *end) || (threadCount < 1) || (threadCount > MAX_THREADS_NUMBER) )
+    {
+        cout << red << "Invalid number of threads: " << ThreadCount << ". Expected a value between 1 and "
+             << MAX_THREADS_NUMBER << "." << reset << endl;
+        return false;
+    }
+
+    _options.numThreads = static_cast<int>(threadCount);
+
+    return true;
+}
+
+bool CommandParser::ParseIoDepth(const char * const IoDepth)
+{
+    char*      end = nullptr;
+    const long ioDepth = strtol(IoDepth, &end, 10);
+
+    if ( (end == IoDepth) || ('\0' != *end) || (ioDepth < 0) || (ioDepth > MAX_IO_DEPTH) )
+    {
+        cout << red << "Invalid I/O depth: " << IoDepth << ". Expected a value between 0 and "
+             << MAX_IO_DEPTH << "." << reset << endl;
+        return false;
+    }
+
+    _options.ioDepth = static_cast<int>(ioDepth);
+
+    return true;
+}
+
+bool CommandParser::ParseCacheSize(const char * const CacheSize)
+{
+    char*      end = nullptr;
+    const long cacheSize = strtol(CacheSize, &end, 10);
+
+    if ( (end == CacheSize) || ('\0' != *end) || (cacheSize < 1) || (cacheSize > MAX_CACHE_SIZE) )
+    {
+        cout << red << "Invalid cache size: " << CacheSize << ". Expected a value between 1 and "
+             << MAX_CACHE_SIZE << " (MB)." << reset << endl;
+        return false;
+    }
+
+    _options.cacheSize = static_cast<uint64_t>(cacheSize) * 1048576;
 
     return true;
 }
 
 void CommandParser::PrintHelp() const
 {
-    cout << yellow << "Usage: StringFinder.exe <path> <search_string>" << reset << endl;
+    cout << yellow << "Usage: StringFinder.exe <path> <search_string>" << endl
+         << "       StringFinder.exe <path> -e <search_string> [-e <search_string> ...] [-f <patterns_file>]" << endl
+         << "       StringFinder.exe <path> --build-index <index_file>" << endl
+         << "       StringFinder.exe <path> --serve <socket> [options]" << endl
+         << "       StringFinder.exe --connect <socket> -e <search_string> [-e <search_string> ...] [-f <patterns_file>]" << endl
+         << "Options:" << endl
+         << "  -e <search_string>   search string; may be repeated" << endl
+         << "  -f <patterns_file>   file containing one search string per line" << endl
+         << "  -i, --ignore-case    match ASCII letters whatever their case (results show the original bytes)" << endl
+         << "  -E, --regex          search strings are regular expressions (leftmost longest matches, not overlapping)" << endl
+         << "  --build-index <file> index the trigrams of all files of <path> into <file>; search strings are optional" << endl
+         << "  --index <file>       only search the files that may match according to the index <file>" << endl
+         << "  --manifest <file>    cache directory listings in <file>: unchanged directories are not read again" << endl
+         << "  --cache <directory>  cache the matches of every file in <directory>: unchanged files are not read again" << endl
+         << "  --cache-size <MB>    maximum size of the cache (default: 1024); least recently used entries are evicted" << endl
+         << "  --binary <mode>      files whose first bytes look binary: search (default), skip (also skips common binary" << endl
+         << "                       extensions unread) or no-affixes (matches reported without prefix and suffix)" << endl
+         << "  --exclude-ext <list> comma separated extensions of files never searched (e.g. o,so,png); may be repeated" << endl
+         << "  --exclude <glob>     skip the files and whole directories matching a gitignore style glob (e.g. node_modules/," << endl
+         << "                       '*.min.js', /build); may be repeated" << endl
+         << "  --include <glob>     only search the files matching a glob (e.g. '*.log', 'src/**/*.cpp'); may be repeated" << endl
+         << "  --ignore-files       also skip what the .gitignore and .ignore files under <path> ignore, and .git directories" << endl
+         << "  --io-depth <files>   number of small files read ahead of the search at once (default: 64; 0: disabled)" << endl
+         << "  -j <threads>         number of worker threads (default: one per hardware thread)" << endl
+         << "  --stream             display the data of every file as soon as the file is searched" << endl
+         << "  --ordered            same as --stream, keeping files in path order" << endl
+         << "  --format <format>    results format: text (default), json (JSON Lines, one object per file)" << endl
+         << "                       or binary (see resultreader.h); json and binary require -o" << endl
+         << "  -o <file>            write the results to a file instead of the standard output" << endl
+         << "  --stats              display the counters and timers of every stage after the results" << endl
+         << "  --progress           display the search progress on the standard error while searching" << endl
+         << "  --watch              once searched, keep watching <path> and display the new matches of every change" << endl
+         << "  --serve <socket>     keep <path> warm and answer the searches sent to the Unix domain socket <socket>" << endl
+         << "  --connect <socket>   send the search to the server listening on <socket> and display its results" << reset << endl;
 }
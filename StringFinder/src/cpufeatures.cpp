@@ -0,0 +1,49 @@
+#include "cpufeatures.h"
+
+#if defined(CPU_X86) && defined(_MSC_VER)
+#include <immintrin.h>
+#endif
+
+const CpuFeatures& CpuFeatures::Detect()
+{
+    static const CpuFeatures features = []
+    {
+        CpuFeatures detected{ false, false, false, false };
+
+#if defined(CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+
+        detected.sse2 = __builtin_cpu_supports("sse2");
+        detected.ssse3 = __builtin_cpu_supports("ssse3");
+        detected.avx2 = __builtin_cpu_supports("avx2");
+        detected.avx512bw = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#elif defined(CPU_X86) && defined(_MSC_VER)
+        int registers[4] = { 0 };  // eax, ebx, ecx, edx
+
+        __cpuid(registers, 0);
+        const int maxLeaf = registers[0];
+
+        __cpuid(registers, 1);
+        const bool hasOsxsave = (0 != (registers[2] & (1 << 27)));
+
+        detected.sse2 = (0 != (registers[3] & (1 << 26)));
+        detected.ssse3 = (0 != (registers[2] & (1 << 9)));
+
+        // the OS must save the wide registers on context switches
+        const unsigned long long xcr0 = hasOsxsave ? _xgetbv(0) : 0;
+        const bool osSavesYmm = ( (xcr0 & 0x6) == 0x6 );
+        const bool osSavesZmm = ( (xcr0 & 0xE6) == 0xE6 );
+
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(registers, 7, 0);
+            detected.avx2 = osSavesYmm && (0 != (registers[1] & (1 << 5)));
+            detected.avx512bw = osSavesZmm && (0 != (registers[1] & (1 << 16))) && (0 != (registers[1] & (1 << 30)));
+        }
+#endif
+
+        return detected;
+    }();
+
+    return features;
+}
@@ -1,24 +1,26 @@
 #include "dataextractor.h"
+#include "directorywalker.h"
+#include "resultcollector.h"
+#include "resultwriter.h"
+#include "outputbuffer.h"
+#include "mappedfile.h"
+#include "trigramindex.h"
+#include "streamscanner.h"
+#include "contentsniffer.h"
 
 #include <iostream>
 #include <algorithm>
-#include <omp.h>
-#include <termcolor\termcolor.hpp>
+#include <termcolor/termcolor.hpp>
 
 using namespace std;
 using namespace termcolor;
 
-void DataExtractor::AffixData::Clear()
-{
-    prefix.clear();
-    suffix.clear();
-}
-
-DataExtractor &DataExtractor::instance(string SearchString, string Location)
-{
-    static DataExtractor dataExtractor{SearchString, Location};
-
-    return dataExtractor;
+namespace {
+    // End of the last of Matches (in file order), 0 if there is none
+    uint64_t MatchEnd(const vector<PatternMatcher::Match>& Matches)
+    {
+        return Matches.empty() ? 0 : Matches.back().position + Matches.back().length;
+    }
 }
 
 DataExtractor::~DataExtractor()
@@ -26,235 +28,995 @@ DataExtractor::~DataExtractor()
     _extractedData.clear();
 }
 
-DataExtractor::DataExtractor(string SearchString, string Location) : _searchString{ SearchString },
-    _location{ Location }, _searchStringSize{ SearchString.size() }
+DataExtractor::DataExtractor(vector<string> SearchStrings, string Location, SearchOptions Options) :
+    _searchStrings{ SearchStrings }, _location{ Location }, _matcher{ PatternMatcher::Create(SearchStrings, Options.ignoreCase, Options.regex) },
+    _chunkOverlap{ _matcher->maxMatchSize() }, _options{ Options }, _pathFilter{}, _streamedFiles{ 0 }, _onResult{},
+    _sharedManifest{ nullptr }, _cancelled{ false }
 {
+    _pathFilter.ExcludeExtensions(_options.excludedExtensions);
+
+    if ( !_options.excludedGlobs.empty() )
+    {
+        _pathFilter.ExcludeGlobs(_options.excludedGlobs);
+    }
+
+    if ( !_options.includedGlobs.empty() )
+    {
+        _pathFilter.IncludeGlobs(_options.includedGlobs);
+    }
+
+    if (_options.useIgnoreFiles)
+    {
+        _pathFilter.UseIgnoreFiles();
+    }
+
+    // binary whatever their contents: not even open
+    if (SearchOptions::SKIP_BINARY == _options.binaryFiles)
+    {
+        _pathFilter.ExcludeExtensions( vector<string>( begin(BINARY_EXTENSIONS), end(BINARY_EXTENSIONS) ) );
+    }
 }
 
-void DataExtractor::ExtractData()
+void DataExtractor::ExtractData(ThreadPool& Pool, ResultFunction OnResult)
 {
-    fs::path path(_location);
+    fs::path   path(_location);
+    const bool streaming = _options.streamOutput || OnResult;
+
+    _onResult = std::move(OnResult);
+    _extractedData.clear();
 
     if ( !fs::exists(path) )
     {
         cout << red << "Location doesn't exit." << reset << endl;
+        return;
+    }
+
+    if (_options.watchChanges)
+    {
+        _watcher = make_unique<FileWatcher>();
+
+        if ( !_watcher->Open(path) )
+        {
+            _watcher.reset();
+            return;
+        }
+    }
+
+    // with an index, only the candidate files are searched, without walking the location
+    const bool       useIndex = !_options.indexFile.empty();
+    vector<fs::path> candidates{};
+    atomic<size_t>   nextCandidate{ 0 };
+
+    if (useIndex)
+    {
+        TrigramIndex index{};
+
+        if ( !index.Open(_options.indexFile) || !index.Candidates(_matcher->requiredLiterals(), path, candidates, _options.ignoreCase) )
+        {
+            return;
+        }
+
+        if ( !_pathFilter.empty() )
+        {
+            candidates.erase( remove_if(candidates.begin(), candidates.end(),
+                                        [this, &path](const fs::path& Candidate)
+                                        { return !_pathFilter.AcceptsPath(path, Candidate); }),
+                              candidates.end() );
+        }
+
+        cout << "Index: searching <" << green << candidates.size() << reset << "> candidate files out of <"
+             << green << index.fileCount() << reset << ">." << endl;
+    }
+
+    // results handed over to the caller are not displayed
+    if ( !_onResult && !_options.outputFile.empty() && !_output.Open(_options.outputFile) )
+    {
+        return;
+    }
+
+    if ( !_options.cacheDirectory.empty() )
+    {
+        _cache = make_unique<ResultCache>(_options.cacheDirectory, _options.cacheSize, _searchStrings, _options.ignoreCase,
+                                       _options.regex, _options.binaryFiles);
+
+        if ( !_cache->Open() )
+        {
+            _cache.reset();
+            return;
+        }
+    }
+
+    if (!_onResult)
+    {
+        _formatter = ResultFormatter::Create(_options.outputFormat, _output, _searchStrings);
+    }
+
+    if (_options.showStatistics || _options.showProgress)
+    {
+        _statistics = make_unique<Statistics>();
     }
-#pragma omp parallel num_threads(4)
+
+    // the tree is walked once, by a dedicated stage, while the workers below already search
+    // the files found so far
+    ConcurrentQueue<fs::path>               fileQueue{ FILE_QUEUE_CAPACITY };
+    DirectoryWalker                         walker(path, fileQueue, _options.orderedOutput);
+    DirectoryManifest                       localManifest{};
+    DirectoryManifest&                      manifest = (nullptr != _sharedManifest) ? *_sharedManifest : localManifest;
+    ThreadPool&                             pool = Pool;
+    ResultCollector< shared_ptr<FileData> > results( pool.size() );
+    ResultWriter< shared_ptr<FileData> >    writer([this](shared_ptr<FileData>& Data)
+                                                   {
+                                                       Statistics::ScopedTimer timer(_statistics.get(),
+                                                                                     Statistics::OUTPUT_TIME);
+
+                                                       if (_onResult)
+                                                       {
+                                                           _onResult(Data->path, Data->stringData);
+                                                       }
+                                                       else
+                                                       {
+                                                           _formatter->WriteFile(Data->path, Data->stringData);
+                                                       }
+
+                                                       ++_streamedFiles;
+
+                                                       // nobody reads the results anymore
+                                                       if ( _output.closed() )
+                                                       {
+                                                           Cancel();
+                                                       }
+                                                   },
+                                                   _options.orderedOutput, [this] { _output.Flush(); });
+
+    // ordered streaming needs every file, even without data, to move on
+    const DeliverFunction deliver = [this, streaming, &writer, &results](int WorkerId, uint64_t Sequence,
+                                                                          shared_ptr<FileData> Data)
     {
-        // obtains files located at the specified path
-        vector<fs::path> fileList = GetFileList(path);
-#pragma omp for
-        // extract data from each file
-        for (int i = 0; i < fileList.size(); ++i)
+        const bool hasData = Data && !IsEmpty(Data);
+
+        if (_statistics && Data)
         {
-            shared_ptr<FileData> fileData{};
-            uintmax_t            fileSize{ 0 };
+            _statistics->Add(Statistics::FILES_SEARCHED);
 
-            try
+            if (hasData)
             {
-                fileSize = fs::file_size(fileList[i]);
+                _statistics->Add( Statistics::MATCHES, Data->stringData.size() );
             }
-            catch (fs::filesystem_error& e)
+        }
+
+        if (streaming)
+        {
+            writer.Submit(Sequence, std::move(Data), hasData);
+        }
+        else if (hasData)
+        {
+            results.Add(WorkerId, std::move(Data));
+        }
+    };
+
+    _streamedFiles = 0;
+
+    if (streaming)
+    {
+        writer.Start();
+    }
+
+    if ( !useIndex && !_options.manifestFile.empty() )
+    {
+        // a shared manifest is already open
+        if (nullptr == _sharedManifest)
+        {
+            manifest.Open(_options.manifestFile, path);
+        }
+
+        walker.UseManifest(manifest);
+    }
+
+    if ( !_pathFilter.empty() )
+    {
+        walker.UsePathFilter(_pathFilter);
+    }
+
+    if (_statistics)
+    {
+        walker.UseStatistics(*_statistics);
+
+        if (_options.showProgress)
+        {
+            _statistics->StartProgress();
+        }
+    }
+
+    if (!useIndex)
+    {
+        walker.Start();
+    }
+
+    // next file to search, in enumeration order; without Wait, an empty File if the walk has none ready yet
+    const auto nextFile = [this, useIndex, &candidates, &nextCandidate, &fileQueue](fs::path& File, uint64_t& Sequence,
+                                                                                     bool Wait)
+    {
+        if (_cancelled)
+        {
+            return false;
+        }
+
+        if (useIndex)
+        {
+            Sequence = nextCandidate++;
+
+            if ( Sequence >= candidates.size() )
             {
-                std::cout << red << e.what() << reset << endl;
-                continue;
+                return false;
             }
-            
-            if (fileSize < MAX_FILE_SIZE)
+
+            File = candidates[Sequence];
+
+            return true;
+        }
+
+        if (Wait)
+        {
+            return fileQueue.Pop(File, Sequence);
+        }
+
+        bool isClosed = false;
+
+        if ( fileQueue.TryPop(File, Sequence, isClosed) )
+        {
+            return true;
+        }
+
+        File.clear();
+
+        return !isClosed;
+    };
+
+    // small files are open and read ahead of the workers; not with a result cache, which avoids
+    // reading unchanged files at all
+    // ordered streaming: files handed over to the workers (read, queued and being searched) must fit
+    // in the reorder window, or workers would wait for a file stuck behind them
+    const int   ioDepth = _options.orderedOutput ?
+                          min( _options.ioDepth, (static_cast<int>(REORDER_WINDOW) - pool.size()) / 2 ) :
+                          _options.ioDepth;
+    const bool  useReader = (ioDepth > 0) && !_cache;
+    AsyncReader reader(nextFile, ioDepth);
+
+    if (_statistics)
+    {
+        reader.UseStatistics(*_statistics);
+    }
+
+    if (useReader)
+    {
+        reader.Start();
+    }
+
+    // idle workers take the next file; chunks of large files are stolen by the others
+    pool.Run([this, useReader, &reader, &nextFile, &writer, &pool, &deliver](int WorkerId)
+             {
+                 AsyncReader::ReadFile file{};
+
+                 {
+                     Statistics::ScopedTimer timer(_statistics.get(), Statistics::WAIT_TIME);
+
+                     if ( useReader ? !reader.Pop(file) : !nextFile(file.path, file.sequence, true) )
+                     {
+                         return false;
+                     }
+                 }
+
+                 if (_cancelled)
+                 {
+                     // files already read ahead are dropped; ordered streaming still needs them all
+                     deliver(WorkerId, file.sequence, nullptr);
+                     return true;
+                 }
+
+                 // ordered streaming: do not run too far ahead of the writer
+                 writer.WaitForTurn(file.sequence);
+
+                 if (file.isRead)
+                 {
+                     SearchContents(WorkerId, file, deliver);
+                 }
+                 else
+                 {
+                     SearchFile(pool, WorkerId, file.path, file.sequence, deliver);
+                 }
+
+                 return true;
+             });
+
+    if (_cancelled)
+    {
+        walker.Stop();
+    }
+
+    reader.Wait();
+    walker.Wait();
+    writer.Finish();
+    _output.Flush();
+
+    if (_statistics)
+    {
+        _statistics->StopProgress();
+    }
+
+    // a cancelled walk did not list every directory; an unchanged tree is not saved again
+    if ( !useIndex && !_cancelled && !_options.manifestFile.empty() &&
+         manifest.Save(_options.manifestFile) )
+    {
+        cout << "Manifest: <" << green << walker.reusedDirectories() << reset << "> directories reused, <"
+             << green << walker.readDirectories() << reset << "> read." << endl;
+    }
+
+    if (_cache)
+    {
+        _cache->Finish();
+
+        cout << "Cache: <" << green << _cache->hits() << reset << "> hits, <"
+             << green << _cache->misses() << reset << "> misses." << endl;
+    }
+
+    // deterministic output, whatever the number of threads and the scheduling
+    _extractedData = results.Merge([](const shared_ptr<FileData>& Lhs, const shared_ptr<FileData>& Rhs)
+                                   { return Lhs->path < Rhs->path; });
+}
+
+void DataExtractor::WatchChanges(ThreadPool& Pool)
+{
+    if ( !_watcher || !_formatter )
+    {
+        return;
+    }
+
+    const fs::path              path(_location);
+    vector<FileWatcher::Change> changes{};
+    bool                        hasOverflown = false;
+
+    cout << green << "Watching location for changes ..." << reset << endl;
+
+    while (!_cancelled)
+    {
+        changes.clear();
+
+        if ( !_watcher->Wait(WATCH_POLL_INTERVAL, changes, hasOverflown) )
+        {
+            cout << red << "Location: " << path << " cannot be watched anymore." << reset << endl;
+            break;
+        }
+
+        if (hasOverflown)
+        {
+            // changes were lost: every file is looked at again, only the ones whose size changed are searched
+            cout << yellow << "Too many changes at once: searching the whole location again." << reset << endl;
+            changes.clear();
+
+            if ( fs::is_directory(path) )
             {
-                ExtractFileData(fileList[i], fileData);
+                _watcher->AddTree(path, changes);
             }
             else
             {
-                ExtractBigFileData(fileList[i], fileData);
+                changes.push_back( FileWatcher::Change{ path, false } );
             }
+        }
 
-            if (!IsEmpty(fileData))
+        if ( changes.empty() )
+        {
+            continue;
+        }
+
+        // a file written several times is searched once
+        sort(changes.begin(), changes.end(), [](const FileWatcher::Change& Lhs, const FileWatcher::Change& Rhs)
+                                             { return Lhs.path < Rhs.path; });
+
+        size_t last = 0;
+
+        for (size_t i = 1; i < changes.size(); ++i)
+        {
+            if (changes[i].path == changes[last].path)
             {
-                _extractedData.push_back(fileData);
+                changes[last].isReplaced = changes[last].isReplaced || changes[i].isReplaced;
+            }
+            else
+            {
+                changes[++last] = std::move(changes[i]);
             }
         }
+
+        changes.resize(last + 1);
+
+        ResultCollector< shared_ptr<FileData> > results( Pool.size() );
+        atomic<size_t>                          nextChange{ 0 };
+
+        Pool.Run([this, &changes, &nextChange, &results](int WorkerId)
+                 {
+                     const size_t change = nextChange++;
+
+                     if ( change >= changes.size() )
+                     {
+                         return false;
+                     }
+
+                     shared_ptr<FileData> fileData = SearchChanges(changes[change]);
+
+                     if ( fileData && !IsEmpty(fileData) )
+                     {
+                         results.Add( WorkerId, std::move(fileData) );
+                     }
+
+                     return true;
+                 });
+
+        for (auto&& fileData : results.Merge([](const shared_ptr<FileData>& Lhs, const shared_ptr<FileData>& Rhs)
+                                             { return Lhs->path < Rhs->path; }))
+        {
+            _formatter->WriteFile(fileData->path, fileData->stringData);
+        }
+
+        _output.Flush();
     }
 }
 
+void DataExtractor::SetOutput(int Descriptor, bool IsColorized)
+{
+    _output.Attach(Descriptor);
+    _output.SetColorized(IsColorized);
+}
+
+void DataExtractor::UseManifest(DirectoryManifest& Manifest)
+{
+    _sharedManifest = &Manifest;
+}
+
+void DataExtractor::Cancel()
+{
+    _cancelled = true;
+}
+
+bool DataExtractor::cancelled() const
+{
+    return _cancelled;
+}
+
+const vector< shared_ptr<DataExtractor::FileData> >& DataExtractor::results() const
+{
+    return _extractedData;
+}
+
+const Statistics* DataExtractor::statistics() const
+{
+    return _statistics.get();
+}
+
 void DataExtractor::DisplayData()
 {
-    size_t numberOfFiles = _extractedData.size();
+    if ( !_formatter )
+    {
+        // nothing was extracted (errors already reported)
+        return;
+    }
+
+    size_t numberOfFiles = _options.streamOutput ? _streamedFiles : _extractedData.size();
 
-    if (0 == numberOfFiles)
+    if (SearchOptions::TEXT == _options.outputFormat)
     {
-        cout << "No results to display for provided location: " << _location << endl;
+        DisplaySummary(numberOfFiles);
     }
-    else
+
+    // when streaming, the data itself was already displayed
+    if (!_options.streamOutput)
     {
-        cout << "Displaying data for search string: <" << green << _searchString << reset << "> found in: <" 
-             << green << numberOfFiles << reset << ( (1 == numberOfFiles) ? "> file." : "> files." ) << endl;
+        Statistics::ScopedTimer timer(_statistics.get(), Statistics::OUTPUT_TIME);
 
         for (auto&& fileData : _extractedData)
         {
-            cout << "Displaying data found inside <" << green << fileData->path << reset << ">:" << endl;
+            _formatter->WriteFile(fileData->path, fileData->stringData);
+        }
+    }
 
-            for (auto&& value : fileData->stringData)
-            {
-                cout << "Position: " << green << value.first << reset;
-                cout << "\t\tPrefix: ";
-                DisplayString(cout, value.second.prefix);
-                cout << "\tSuffix: ";
-                DisplayString(cout, value.second.suffix);
-                cout << endl;
-            }
+    _formatter->Finish();
+    _output.Flush();
 
-            cout << endl;
-        }
+    if ( (SearchOptions::TEXT != _options.outputFormat) && !_options.outputFile.empty() )
+    {
+        cout << "Results of <" << green << numberOfFiles << reset << "> files written to: <"
+             << green << _options.outputFile << reset << ">" << endl;
+    }
+
+    if (_statistics && _options.showStatistics)
+    {
+        _statistics->Display();
     }
 }
 
-void DataExtractor::ExtractFileData(const fs::path& FileName, shared_ptr<FileData>& Data)
+void DataExtractor::DisplaySummary(const size_t NumberOfFiles)
 {
-    StringData   stringData{};
-    const string contents = ReadFile(FileName);
-    size_t       position = contents.find(_searchString);
-
-    while (position != string::npos)
+    if (0 == NumberOfFiles)
     {
-        stringData[position] = GetAffixData(contents, position);
+        _output.Write("No results to display for provided location: ");
+        _output.Write(_location);
+        _output.Write('\n');
+        return;
+    }
+
+    _output.Write(_options.streamOutput ? "" : "Displaying data for ");
 
-        // search starting from next character
-        position = contents.find(_searchString, ++position);
+    if (1 == _searchStrings.size())
+    {
+        _output.Write(_options.streamOutput ? "Search string: <" : "search string: <");
+        DisplayValue(_searchStrings.front());
+        _output.Write("> found in: <");
+    }
+    else
+    {
+        _output.Write('<');
+        DisplayValue( _searchStrings.size() );
+        _output.Write("> search strings found in: <");
     }
 
-    Data = make_shared<FileData>(FileName, stringData);
+    DisplayValue(NumberOfFiles);
+    _output.Write( (1 == NumberOfFiles) ? "> file.\n" : "> files.\n" );
 }
 
-void DataExtractor::ExtractBigFileData(const fs::path& FileName, shared_ptr<FileData>& Data)
+void DataExtractor::DisplayValue(const string_view& Value)
 {
-    StringData stringData{};
-    char       block[BLOCK_SIZE] = { 0 };
-    string     blockString{};
-    char       buffer[BUFFER_SIZE] = { 0 };
-    string     bufferString{};
-    ifstream   contentStream(FileName);
-    int        blocksCount = 0;
-
-    // get content length
-    contentStream.seekg (0, contentStream.end);
-    streamoff length = contentStream.tellg();
-    contentStream.seekg (0, contentStream.beg);
-    
-    while (contentStream.good())
+    _output.SetColor(OutputBuffer::GREEN);
+    _output.Write(Value);
+    _output.ResetColor();
+}
+
+void DataExtractor::DisplayValue(const uint64_t Value)
+{
+    _output.SetColor(OutputBuffer::GREEN);
+    _output.WriteNumber(Value);
+    _output.ResetColor();
+}
+
+void DataExtractor::SearchFile(ThreadPool& Pool, int WorkerId, const fs::path& File, uint64_t Sequence,
+                               const DeliverFunction& Deliver)
+{
+    shared_ptr<ChunkedFile> chunkedFile = make_shared<ChunkedFile>();
+    string                  cacheKey{};
+
+    if (_cache)
     {
-        // reset block contents
-        fill(block, block + BLOCK_SIZE, 0);
+        StringData cachedData{};
+
+        // stat'ed before reading: a file changing while searched is searched again by the next run
+        cacheKey = _cache->Key(File);
 
-        // read block by block
-        if (BLOCK_SIZE <= length)
+        if ( !cacheKey.empty() && _cache->Lookup(cacheKey, cachedData) )
         {
-            // also read a buffer from the previous block to make sure no results were omitted
-            if (blocksCount > 0)
-            {
-                // ... start reading from the proper position 
-                contentStream.seekg( blocksCount * (BLOCK_SIZE - BUFFER_SIZE) );
-                contentStream.read(block, BLOCK_SIZE);
-                contentStream.read(buffer, BUFFER_SIZE);
-            }
-            else
-            {
-                contentStream.read(block, BLOCK_SIZE);
-            }
+            Deliver( WorkerId, Sequence, make_shared<FileData>( File, std::move(cachedData) ) );
+            return;
+        }
+    }
+
+    bool isMapped = false;
+
+    {
+        Statistics::ScopedTimer timer(_statistics.get(), Statistics::READ_TIME);
+
+        isMapped = chunkedFile->file.Open(File, MappedFile::MAP_ONLY);
+    }
+
+    if (!isMapped)
+    {
+        // pipes, devices and pseudo files: streamed with a bounded buffer
+        shared_ptr<FileData> fileData = SearchStream(File);
+
+        if ( fileData && _cache && !cacheKey.empty() )
+        {
+            _cache->Store(cacheKey, fileData->stringData);
+        }
+
+        Deliver( WorkerId, Sequence, std::move(fileData) );
+        return;
+    }
+
+    // searched in place, straight from the page cache
+    const string_view contents = chunkedFile->file.contents();
+    bool              withAffixes = true;
+
+    RecordSearchedSize( File, contents.size() );
+
+    // only the first pages of a binary file skipped are read
+    if ( !InspectContents(contents, withAffixes) )
+    {
+        Deliver(WorkerId, Sequence, nullptr);
+        return;
+    }
+
+    const size_t      numberOfChunks = (contents.size() + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE;
+
+    if (numberOfChunks <= 1)
+    {
+        vector<PatternMatcher::Match> matches{};
+
+        // all search strings, in a single pass
+        Search(contents, 0, matches);
+        RecordSearchedSize( File, contents.size(), MatchEnd(matches) );
+
+        shared_ptr<FileData> fileData = BuildFileData(File, contents, matches, withAffixes);
+
+        if ( _cache && !cacheKey.empty() )
+        {
+            _cache->Store(cacheKey, fileData->stringData);
+        }
+
+        Deliver( WorkerId, Sequence, std::move(fileData) );
+        return;
+    }
 
-            blockString.assign(block, block + BLOCK_SIZE);
-            bufferString.assign(buffer, buffer + BUFFER_SIZE);
+    chunkedFile->path = File;
+    chunkedFile->sequence = Sequence;
+    chunkedFile->chunkMatches.resize(numberOfChunks);
+    chunkedFile->remainingChunks = numberOfChunks;
+    chunkedFile->cacheKey = std::move(cacheKey);
+    chunkedFile->withAffixes = withAffixes;
+
+    // pushed last first: this worker then goes on with the next chunks in file order,
+    // while thieves start from the end of the file
+    for (size_t chunk = numberOfChunks - 1; chunk > 0; --chunk)
+    {
+        Pool.Push(WorkerId, [this, chunkedFile, chunk, &Deliver](int Worker)
+                            {
+                                SearchChunk(*chunkedFile, chunk, Worker, Deliver);
+                            });
+    }
+
+    SearchChunk(*chunkedFile, 0, WorkerId, Deliver);
+}
+
+void DataExtractor::SearchChunk(ChunkedFile& File, size_t Chunk, int WorkerId, const DeliverFunction& Deliver)
+{
+    const string_view              contents = File.file.contents();
+    const size_t                   chunkStart = Chunk * FILE_CHUNK_SIZE;
+    const size_t                   chunkSize = min(FILE_CHUNK_SIZE, contents.size() - chunkStart);
+    vector<PatternMatcher::Match>& matches = File.chunkMatches[Chunk];
+
+    // the remaining chunks of a cancelled search are only accounted for; the bytes before the chunk
+    // are only looked at by regular expressions
+    if (!_cancelled)
+    {
+        Search(contents.substr(0, chunkStart + chunkSize + _chunkOverlap), chunkStart, matches);
+    }
+
+    // matches starting inside the overlap belong to the next chunk
+    while ( !matches.empty() && (matches.back().position >= chunkStart + chunkSize) )
+    {
+        matches.pop_back();
+    }
+
+    if (1 == File.remainingChunks.fetch_sub(1))
+    {
+        if (_cancelled)
+        {
+            Deliver(WorkerId, File.sequence, nullptr);
+            return;
         }
-        else
+
+        // last chunk done: chunks are in file order, so are their matches
+        vector<PatternMatcher::Match> fileMatches{};
+        size_t                        numberOfMatches = 0;
+
+        for (auto&& chunkMatches : File.chunkMatches)
         {
-            contentStream.read(block, length);
-            blockString.assign(block, length);
-        }      
+            numberOfMatches += chunkMatches.size();
+        }
 
-        size_t position = blockString.find(_searchString);
+        fileMatches.reserve(numberOfMatches);
 
-        // find occurrences of search string in current block
-        while (position != string::npos)
+        for (size_t chunk = 0; chunk < File.chunkMatches.size(); ++chunk)
         {
-            size_t positionInFile = ( ( blocksCount * (BLOCK_SIZE - BUFFER_SIZE) ) + position );
+            const vector<PatternMatcher::Match>& chunkMatches = File.chunkMatches[chunk];
 
-            if (0 == blocksCount)
+            if ( _matcher->overlappingMatches() )
             {
-                // this is the first block
-                stringData[positionInFile] = GetAffixData(blockString, position);
+                fileMatches.insert(fileMatches.end(), chunkMatches.begin(), chunkMatches.end());
             }
             else
             {
-                stringData[positionInFile] = GetAffixData(bufferString + blockString, position + BUFFER_SIZE);
+                AppendChunkMatches( contents, min(contents.size(), (chunk + 1) * FILE_CHUNK_SIZE), chunkMatches,
+                                    fileMatches );
             }
+        }
 
-            // search starting from next character
-            position = blockString.find(_searchString, ++position);
+        RecordSearchedSize( File.path, contents.size(), MatchEnd(fileMatches) );
+
+        shared_ptr<FileData> fileData = BuildFileData(File.path, contents, fileMatches, File.withAffixes);
+
+        if ( _cache && !File.cacheKey.empty() )
+        {
+            _cache->Store(File.cacheKey, fileData->stringData);
         }
 
-        ++blocksCount;
+        Deliver( WorkerId, File.sequence, std::move(fileData) );
     }
+}
+
+void DataExtractor::SearchContents(int WorkerId, const AsyncReader::ReadFile& File, const DeliverFunction& Deliver)
+{
+    vector<PatternMatcher::Match> matches{};
+    bool                          withAffixes = true;
 
-    Data = make_shared<FileData>(FileName, stringData);
+    RecordSearchedSize( File.path, File.contents.size() );
+
+    if ( !InspectContents(File.contents, withAffixes) )
+    {
+        Deliver(WorkerId, File.sequence, nullptr);
+        return;
+    }
+
+    Search(File.contents, 0, matches);
+    RecordSearchedSize( File.path, File.contents.size(), MatchEnd(matches) );
+
+    Deliver( WorkerId, File.sequence, BuildFileData(File.path, File.contents, matches, withAffixes) );
 }
 
+shared_ptr<DataExtractor::FileData> DataExtractor::SearchStream(const fs::path& File)
+{
+    // reads and affixes included: they are interleaved with the search
+    Statistics::ScopedTimer timer(_statistics.get(), Statistics::SEARCH_TIME);
+    StreamScanner           scanner(*_matcher);
+    StringData              stringData{};
+    bool                    isSkipped = false;
+    bool                    withAffixes = true;
+    uint64_t                matchEnd = 0;
+
+    const bool isRead = scanner.Scan(File, [this, &stringData, &withAffixes, &matchEnd](string_view Window, uint64_t Offset,
+                                                                                       const vector<PatternMatcher::Match>& Matches)
+                                     {
+                                         if ( !Matches.empty() )
+                                         {
+                                             matchEnd = Offset + MatchEnd(Matches);
+                                         }
 
-vector<fs::path> DataExtractor::GetFileList(const fs::path& Path)
+                                         for (auto&& match : Matches)
+                                         {
+                                             const StringData::AffixView affixes = withAffixes ? GetAffixData(Window, match)
+                                                                                               : StringData::AffixView{};
+
+                                             stringData.Add(Offset + match.position, match.pattern, affixes.prefix,
+                                                            affixes.suffix);
+                                         }
+                                     },
+                                     [this, &isSkipped, &withAffixes](string_view Start)
+                                     {
+                                         isSkipped = !InspectContents(Start, withAffixes);
+                                         return !isSkipped;
+                                     });
+
+    if (!isRead || isSkipped)
+    {
+        return nullptr;
+    }
+
+    if (_statistics)
+    {
+        _statistics->Add( Statistics::BYTES_SEARCHED, scanner.inputSize() );
+    }
+
+    RecordSearchedSize( File, scanner.inputSize(), matchEnd );
+
+    stringData.ShrinkToFit();
+
+    return make_shared<FileData>(File, std::move(stringData));
+}
+
+bool DataExtractor::InspectContents(const string_view& Contents, bool& WithAffixes)
 {
-    vector<fs::path> fileList;
+    WithAffixes = true;
 
-    if ( !fs::exists(Path) )
+    if ( (SearchOptions::SEARCH_BINARY == _options.binaryFiles) || !IsBinaryContents(Contents) )
     {
-        cout << red << "Location doesn't exit." << reset << endl;
-        return fileList;
+        return true;
     }
 
-    if ( fs::is_regular_file(Path) )
+    if (_statistics)
     {
-        fileList.push_back(Path);
+        _statistics->Add(Statistics::BINARY_FILES);
     }
-    else if ( fs::is_directory(Path) )
+
+    WithAffixes = false;
+
+    return (SearchOptions::BINARY_WITHOUT_AFFIXES == _options.binaryFiles);
+}
+
+shared_ptr<DataExtractor::FileData> DataExtractor::BuildFileData(const fs::path& File, const string_view& Contents,
+                                                                 const vector<PatternMatcher::Match>& Matches,
+                                                                 bool WithAffixes)
+{
+    Statistics::ScopedTimer timer(_statistics.get(), Statistics::AFFIX_TIME);
+    StringData              stringData{};
+
+    stringData.Reserve( Matches.size() );
+
+    for (auto&& match : Matches)
+    {
+        const StringData::AffixView affixes = WithAffixes ? GetAffixData(Contents, match) : StringData::AffixView{};
+
+        stringData.Add(match.position, match.pattern, affixes.prefix, affixes.suffix);
+    }
+
+    stringData.ShrinkToFit();
+
+    return make_shared<FileData>(File, std::move(stringData));
+}
+
+shared_ptr<DataExtractor::FileData> DataExtractor::SearchChanges(const FileWatcher::Change& Change)
+{
+    MappedFile   file{};
+    SearchedSize searched{ 0, 0 };
+    bool         withAffixes = true;
+
+    // a location that is a file is searched whatever its name
+    if ( ( Change.path != fs::path(_location) ) && !_pathFilter.AcceptsPath(fs::path(_location), Change.path) )
+    {
+        return nullptr;
+    }
+
+    if (!Change.isReplaced)
     {
-        fs::recursive_directory_iterator recursiveIter(Path);
-        fs::recursive_directory_iterator endIter;
+        lock_guard<mutex> lock(_searchedSizesMutex);
+        const auto        searchedFile = _searchedSizes.find( Change.path.string() );
 
-        for (; recursiveIter != endIter; ++recursiveIter)
+        if ( searchedFile != _searchedSizes.end() )
         {
-            if ( fs::is_regular_file(*recursiveIter) )
-            {
-                fileList.push_back(recursiveIter->path());
-            }
+            searched = searchedFile->second;
         }
     }
 
-    return fileList;
+    if ( !file.Open(Change.path, MappedFile::MAP_ONLY) )
+    {
+        // removed, emptied or not a regular file anymore
+        RecordSearchedSize( Change.path, 0 );
+        return nullptr;
+    }
+
+    const string_view contents = file.contents();
+
+    if (contents.size() == searched.size)
+    {
+        // rewritten in place without growing: nothing to tell apart from the previous contents
+        return nullptr;
+    }
+
+    if (contents.size() < searched.size)
+    {
+        // truncated (e.g. a rotated log): everything is new
+        searched = SearchedSize{ 0, 0 };
+    }
+
+    // the start of the file is inspected again: it may have been replaced
+    if ( !InspectContents(contents, withAffixes) )
+    {
+        RecordSearchedSize( Change.path, contents.size() );
+        return nullptr;
+    }
+
+    // matches ending after the previous end of the file are new, even if they started before it
+    // Matches that do not overlap (regular expressions) never start inside one already reported: the
+    // search resumes where the last one ended, as a search of the whole file would (a match extended by
+    // the appended bytes is not reported again, its new bytes may start a new match)
+    const size_t                  overlapStart = (searched.size > _chunkOverlap) ? searched.size - _chunkOverlap : 0;
+    const size_t                  resumeEnd = _matcher->overlappingMatches() ? 0 : searched.matchEnd;
+    const size_t                  searchStart = max(overlapStart, resumeEnd);
+    vector<PatternMatcher::Match> matches{};
+
+    Search(contents, searchStart, matches);
+
+    size_t last = 0;
+
+    for (auto&& match : matches)
+    {
+        if ( (match.position + match.length > searched.size) && (match.position >= resumeEnd) )
+        {
+            matches[last++] = match;
+        }
+    }
+
+    matches.resize(last);
+    RecordSearchedSize( Change.path, contents.size(), matches.empty() ? resumeEnd : MatchEnd(matches) );
+
+    return BuildFileData(Change.path, contents, matches, withAffixes);
 }
 
-string DataExtractor::ReadFile(fs::path FileName) const
+void DataExtractor::RecordSearchedSize(const fs::path& File, uint64_t Size, uint64_t MatchEnd)
 {
-    ifstream contentStream(FileName);
-    string   contentString{};
-
-    if (contentStream.good())
+    if (_watcher)
     {
-        // get length of file
-        contentStream.seekg(0, ios::end);
-        contentString.reserve(contentStream.tellg());
-        contentStream.seekg(0, ios::beg);
+        lock_guard<mutex> lock(_searchedSizesMutex);
 
-        // read data
-        contentString.assign(istreambuf_iterator<char>(contentStream),
-                             istreambuf_iterator<char>());
+        _searchedSizes[ File.string() ] = SearchedSize{ Size, MatchEnd };
     }
-    else
+}
+
+void DataExtractor::Search(const string_view& Contents, size_t Start, vector<PatternMatcher::Match>& Matches)
+{
+    Statistics::ScopedTimer timer(_statistics.get(), Statistics::SEARCH_TIME);
+
+    _matcher->FindFrom(Contents, Start, Matches);
+
+    if (_statistics)
     {
-        cout << red << "File: " << FileName << " cannot be open.";
+        _statistics->Add( Statistics::BYTES_SEARCHED, Contents.size() - Start );
     }
+}
+
+void DataExtractor::AppendChunkMatches(const string_view& Contents, size_t ChunkEnd,
+                                       const vector<PatternMatcher::Match>& ChunkMatches,
+                                       vector<PatternMatcher::Match>& FileMatches)
+{
+    const size_t                  window = max(CHUNK_RESUME_WINDOW, 4 * _chunkOverlap);
+    vector<PatternMatcher::Match> resumed{};
+    size_t                        next = 0;
+    // a search of the whole file would be at position, and would find no match starting before clear
+    size_t                        position = FileMatches.empty() ? 0 :
+                                             FileMatches.back().position + FileMatches.back().length;
+    size_t                        clear = position;
 
-    return contentString;
+    // no match of the chunk runs past the clear bytes: from there, the chunk was searched as the whole
+    // file would have been
+    const auto isSynchronized = [&]()
+                                {
+                                    while ( (next < ChunkMatches.size()) && (ChunkMatches[next].position < position) )
+                                    {
+                                        ++next;
+                                    }
+
+                                    return (0 == next) ||
+                                           (ChunkMatches[next - 1].position + ChunkMatches[next - 1].length <= clear);
+                                };
+
+    while ( !isSynchronized() )
+    {
+        if (clear >= ChunkEnd)
+        {
+            return;
+        }
+
+        // searched again, trusting the matches with all their bytes inside the window
+        const size_t windowEnd = min(Contents.size(), clear + window);
+        const size_t trusted = (windowEnd == Contents.size()) ? windowEnd : windowEnd - _chunkOverlap;
+
+        bool         isResumed = false;
+
+        resumed.clear();
+        Search(Contents.substr(0, windowEnd), clear, resumed);
+
+        for (auto&& match : resumed)
+        {
+            if (match.position >= trusted)
+            {
+                break;
+            }
+
+            FileMatches.push_back(match);
+            position = match.position + match.length;
+            clear = position;
+
+            if ( isSynchronized() )
+            {
+                isResumed = true;
+                break;
+            }
+        }
+
+        // otherwise no match starts before the untrusted bytes
+        if (!isResumed)
+        {
+            clear = max(position, trusted);
+        }
+    }
+
+    FileMatches.insert( FileMatches.end(), ChunkMatches.begin() + static_cast<ptrdiff_t>(next), ChunkMatches.end() );
 }
 
-size_t DataExtractor::GetAvailableAffixChars(const AffixType Type, const size_t Pos,
+size_t DataExtractor::GetAvailableAffixChars(const AffixType Type, const size_t Pos, const size_t MatchSize,
                                              const size_t ContentsSize)
 {
     size_t availableChars{ 0 };
@@ -268,7 +1030,7 @@ size_t DataExtractor::GetAvailableAffixChars(const AffixType Type, const size_t
     }
     case SUFFIX:
     {
-        size_t difference = ContentsSize - (Pos + _searchStringSize);
+        size_t difference = ContentsSize - (Pos + MatchSize);
         
         availableChars = (difference > 2) ? AFFIX_SIZE : difference;
         break;
@@ -283,14 +1045,16 @@ size_t DataExtractor::GetAvailableAffixChars(const AffixType Type, const size_t
     return availableChars;
 }
 
-DataExtractor::AffixData DataExtractor::GetAffixData(const string& Contents, const size_t Pos)
+StringData::AffixView DataExtractor::GetAffixData(const string_view& Contents, const PatternMatcher::Match& Match)
 {
     const size_t contentsSize = Contents.size();
-    const size_t availablePrefixChars = GetAvailableAffixChars(PREFIX, Pos, contentsSize);
-    const size_t availableSuffixChars = GetAvailableAffixChars(SUFFIX, Pos, contentsSize);
+    const size_t Pos = Match.position;
+    const size_t matchSize = Match.length;
+    const size_t availablePrefixChars = GetAvailableAffixChars(PREFIX, Pos, matchSize, contentsSize);
+    const size_t availableSuffixChars = GetAvailableAffixChars(SUFFIX, Pos, matchSize, contentsSize);
 
-    AffixData affixData{ Contents.substr(Pos - availablePrefixChars, availablePrefixChars),
-                         Contents.substr(Pos + _searchStringSize, availableSuffixChars) };
+    StringData::AffixView affixData{ Contents.substr(Pos - availablePrefixChars, availablePrefixChars),
+                                     Contents.substr(Pos + matchSize, availableSuffixChars) };
 
     return affixData;
 }
@@ -300,70 +1064,10 @@ bool DataExtractor::IsEmpty(const shared_ptr<FileData>& Data)
     return (Data->stringData.size() == 0);
 }
 
-void DataExtractor::DisplayString(ostream& OutStream, const string& CppString)
-{
-    OutStream << green;
-    
-    for (auto ch : CppString)
-    {
-        switch (ch)
-        {
-        case '\'':
-            OutStream << "\\'";
-            break;
-
-        case '\"':
-            OutStream << "\\\"";
-            break;
-
-        case '\?':
-            OutStream << "\\?";
-            break;
-
-        case '\\':
-            OutStream << "\\\\";
-            break;
-
-        case '\a':
-            OutStream << "\\a";
-            break;
-
-        case '\b':
-            OutStream << "\\b";
-            break;
-
-        case '\f':
-            OutStream << "\\f";
-            break;
-
-        case '\n':
-            OutStream << "\\n";
-            break;
-
-        case '\r':
-            OutStream << "\\r";
-            break;
-
-        case '\t':
-            OutStream << "\\t";
-            break;
-
-        case '\v':
-            OutStream << "\\v";
-            break;
-
-        default:
-            OutStream << ch;
-        }
-    }
-
-    OutStream << reset;
-}
-
 DataExtractor::FileData::FileData() : path{}, stringData{}
 {
 }
 
-DataExtractor::FileData::FileData(fs::path Path, StringData Data) : path{ Path }, stringData{ Data }
+DataExtractor::FileData::FileData(fs::path Path, StringData Data) : path{ std::move(Path) }, stringData{ std::move(Data) }
 {
 }
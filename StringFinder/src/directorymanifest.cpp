@@ -0,0 +1,399 @@
+#include "directorymanifest.h"
+#include "outputbuffer.h"
+#include "encoding.h"
+
+#include <ctime>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <utility>
+#include <functional>
+#include <iostream>
+#include <algorithm>
+#include <termcolor/termcolor.hpp>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+    // Current time, same clock as the write times of the stamps
+    uint64_t Now()
+    {
+#ifdef _WIN32
+        return static_cast<uint64_t>( chrono::duration_cast<chrono::nanoseconds>(
+            fs::file_time_type::clock::now().time_since_epoch() ).count() );
+#else
+        timespec now{};
+
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+#endif
+    }
+
+    // Appends the bytes of the manifest file
+    class ManifestWriter
+    {
+    public:
+        explicit ManifestWriter(OutputBuffer& Output) : _output{ Output }, _offset{ 0 }
+        {
+        }
+
+        void WriteBytes(string_view Bytes)
+        {
+            _output.Write(Bytes);
+            _offset += Bytes.size();
+        }
+
+        void WriteVarint(uint64_t Value)
+        {
+            char buffer[MAX_VARINT_SIZE];
+
+            WriteBytes( string_view(buffer, EncodeVarint(Value, buffer)) );
+        }
+
+        void WriteFixed(uint64_t Value, size_t Size)
+        {
+            char buffer[sizeof(uint64_t)];
+
+            EncodeFixed(Value, buffer, Size);
+            WriteBytes( string_view(buffer, Size) );
+        }
+
+        uint64_t offset() const
+        {
+            return _offset;
+        }
+
+    private:
+        OutputBuffer& _output;
+        uint64_t      _offset;
+    };
+}
+
+DirectoryManifest::DirectoryManifest() : _file{}, _contents{}, _root{}, _directoryCount{ 0 },
+    _directoryTable{ nullptr }, _mutex{}, _records{}, _isModified{ false }, _saveMutex{}
+{
+}
+
+void DirectoryManifest::Open(const fs::path& ManifestFile, const fs::path& Root)
+{
+    error_code error;
+
+    _root = fs::canonical(Root, error).u8string();
+
+    if ( error || !fs::exists(ManifestFile, error) || !_file.Open(ManifestFile) )
+    {
+        return;
+    }
+
+    _contents = _file.contents();
+
+    bool isValid = (_contents.size() >= MANIFEST_FILE_HEADER_SIZE + MANIFEST_FILE_FOOTER_SIZE) &&
+                   (_contents.substr(0, MANIFEST_FILE_MAGIC.size()) == MANIFEST_FILE_MAGIC) &&
+                   (_contents.substr(_contents.size() - MANIFEST_FILE_END_MAGIC.size()) == MANIFEST_FILE_END_MAGIC) &&
+                   (DecodeFixed(_contents.data() + MANIFEST_FILE_MAGIC.size(), 4) == MANIFEST_FILE_VERSION);
+
+    if (isValid)
+    {
+        const char*    footer = _contents.data() + _contents.size() - MANIFEST_FILE_FOOTER_SIZE;
+        const uint64_t directoryCount = DecodeFixed(footer, 8);
+        const uint64_t tableOffset = DecodeFixed(footer + 8, 8);
+        const uint64_t footerOffset = _contents.size() - MANIFEST_FILE_FOOTER_SIZE;
+        const char*    data = _contents.data() + MANIFEST_FILE_HEADER_SIZE;
+        uint64_t       rootSize = 0;
+
+        isValid = (tableOffset >= MANIFEST_FILE_HEADER_SIZE) && (tableOffset <= footerOffset) &&
+                  (directoryCount == (footerOffset - tableOffset) / 8) &&
+                  DecodeVarint(data, _contents.data() + tableOffset, rootSize) &&
+                  (rootSize <= static_cast<uint64_t>(_contents.data() + tableOffset - data)) &&
+                  (string_view(data, static_cast<size_t>(rootSize)) == _root);
+
+        _directoryCount = static_cast<size_t>(directoryCount);
+        _directoryTable = _contents.data() + tableOffset;
+    }
+
+    if (!isValid)
+    {
+        // rebuilt from scratch by this run
+        cout << yellow << "Manifest: " << ManifestFile << " is invalid or was built for another location; ignored."
+             << reset << endl;
+        _file.Close();
+        _contents = string_view();
+        _directoryCount = 0;
+        _directoryTable = nullptr;
+    }
+}
+
+bool DirectoryManifest::GetStamp(const fs::path& Directory, Stamp& DirectoryStamp)
+{
+#ifdef _WIN32
+    error_code                error;
+    const fs::file_time_type  writeTime = fs::last_write_time(Directory, error);
+
+    if (error)
+    {
+        return false;
+    }
+
+    DirectoryStamp.device = 0;
+    DirectoryStamp.inode = 0;
+    DirectoryStamp.writeTime = static_cast<uint64_t>(
+        chrono::duration_cast<chrono::nanoseconds>( writeTime.time_since_epoch() ).count() );
+#else
+    struct stat status{};
+
+    if (0 != stat(Directory.c_str(), &status))
+    {
+        return false;
+    }
+
+    DirectoryStamp.device = static_cast<uint64_t>(status.st_dev);
+    DirectoryStamp.inode = static_cast<uint64_t>(status.st_ino);
+    DirectoryStamp.writeTime = static_cast<uint64_t>(status.st_mtim.tv_sec) * 1000000000 +
+                               static_cast<uint64_t>(status.st_mtim.tv_nsec);
+#endif
+
+    return true;
+}
+
+bool DirectoryManifest::Lookup(const string& RelativePath, const Stamp& DirectoryStamp, vector<Entry>& Entries)
+{
+    lock_guard<mutex> lock(_mutex);
+    const auto        record = _records.find(RelativePath);
+
+    // newer than the manifest file
+    if ( record != _records.end() )
+    {
+        const Stamp& stamp = record->second.stamp;
+
+        if ( (stamp.device != DirectoryStamp.device) || (stamp.inode != DirectoryStamp.inode) ||
+             (stamp.writeTime != DirectoryStamp.writeTime) )
+        {
+            return false;
+        }
+
+        Entries = record->second.entries;
+        return true;
+    }
+
+    if ( !LookupFile(RelativePath, DirectoryStamp, Entries) )
+    {
+        return false;
+    }
+
+    // kept by the next save
+    _records.emplace( RelativePath, DirectoryRecord{ DirectoryStamp, Entries } );
+
+    return true;
+}
+
+bool DirectoryManifest::LookupFile(string_view RelativePath, const Stamp& DirectoryStamp, vector<Entry>& Entries) const
+{
+    const char* end = _directoryTable;
+    size_t      low = 0;
+    size_t      high = _directoryCount;
+    const char* record = nullptr;
+    string_view path{};
+
+    // binary search in the directory table
+    while (low < high)
+    {
+        const size_t   middle = low + (high - low) / 2;
+        const uint64_t offset = DecodeFixed(_directoryTable + 8 * middle, 8);
+        const char*    data = _contents.data() + offset;
+        uint64_t       pathSize = 0;
+
+        if ( (offset < MANIFEST_FILE_HEADER_SIZE) || (data >= end) || !DecodeVarint(data, end, pathSize) ||
+             (pathSize > static_cast<uint64_t>(end - data)) )
+        {
+            return false;
+        }
+
+        path = string_view(data, static_cast<size_t>(pathSize));
+
+        if (path < RelativePath)
+        {
+            low = middle + 1;
+        }
+        else if (RelativePath < path)
+        {
+            high = middle;
+        }
+        else
+        {
+            record = data + pathSize;
+            break;
+        }
+    }
+
+    if ( (nullptr == record) || (end - record < 24) )
+    {
+        return false;
+    }
+
+    if ( (DecodeFixed(record, 8) != DirectoryStamp.device) || (DecodeFixed(record + 8, 8) != DirectoryStamp.inode) ||
+         (DecodeFixed(record + 16, 8) != DirectoryStamp.writeTime) )
+    {
+        return false;
+    }
+
+    const char* data = record + 24;
+    uint64_t    entryCount = 0;
+
+    if ( !DecodeVarint(data, end, entryCount) )
+    {
+        return false;
+    }
+
+    Entries.clear();
+
+    for (uint64_t i = 0; i < entryCount; ++i)
+    {
+        uint64_t nameSize = 0;
+
+        if (data == end)
+        {
+            return false;
+        }
+
+        const bool isDirectory = (0 != *data++);
+
+        if ( !DecodeVarint(data, end, nameSize) || (nameSize > static_cast<uint64_t>(end - data)) )
+        {
+            return false;
+        }
+
+        Entries.push_back( Entry{ string(data, static_cast<size_t>(nameSize)), isDirectory } );
+        data += nameSize;
+    }
+
+    return true;
+}
+
+void DirectoryManifest::Record(string RelativePath, const Stamp& DirectoryStamp, const vector<Entry>& Entries)
+{
+    Stamp stamp = DirectoryStamp;
+
+    // a write time in the future (clock skew) is just as racy
+    if (stamp.writeTime + RACY_WRITE_TIME > Now())
+    {
+        // may still change without its write time changing: never reused
+        stamp.writeTime = 0;
+    }
+
+    lock_guard<mutex> lock(_mutex);
+
+    _records.insert_or_assign( std::move(RelativePath), DirectoryRecord{ stamp, Entries } );
+    _isModified = true;
+}
+
+bool DirectoryManifest::Save(const fs::path& ManifestFile)
+{
+    lock_guard<mutex>                       saveLock(_saveMutex);
+    vector< pair<string, DirectoryRecord> > records{};
+    fs::path                                temporaryFile = ManifestFile;
+    bool                                    isWritten = false;
+    error_code                              error;
+
+    // sorted by path: the order of the map
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        if (!_isModified)
+        {
+            return true;
+        }
+
+        records.assign( _records.begin(), _records.end() );
+        _isModified = false;
+    }
+
+    // unique per process and per thread, as result cache entries: a manifest file is only ever
+    // replaced by a rename
+    static const uint64_t runId = ( static_cast<uint64_t>( random_device{}() ) << 32 ) | random_device{}();
+
+    temporaryFile += "." + to_string(runId) + "." + to_string( hash<thread::id>()( this_thread::get_id() ) ) + ".tmp";
+
+    {
+        OutputBuffer     output{};
+        ManifestWriter   writer(output);
+        vector<uint64_t> recordOffsets{};
+
+        if ( output.Open(temporaryFile) )
+        {
+            writer.WriteBytes(MANIFEST_FILE_MAGIC);
+            writer.WriteFixed(MANIFEST_FILE_VERSION, 4);
+            writer.WriteFixed(0, 4);
+            writer.WriteVarint( _root.size() );
+            writer.WriteBytes(_root);
+
+            for (auto&& record : records)
+            {
+                recordOffsets.push_back( writer.offset() );
+
+                writer.WriteVarint( record.first.size() );
+                writer.WriteBytes(record.first);
+                writer.WriteFixed(record.second.stamp.device, 8);
+                writer.WriteFixed(record.second.stamp.inode, 8);
+                writer.WriteFixed(record.second.stamp.writeTime, 8);
+                writer.WriteVarint( record.second.entries.size() );
+
+                for (auto&& entry : record.second.entries)
+                {
+                    writer.WriteBytes(entry.isDirectory ? string_view("\1", 1) : string_view("\0", 1));
+                    writer.WriteVarint( entry.name.size() );
+                    writer.WriteBytes(entry.name);
+                }
+            }
+
+            const uint64_t tableOffset = writer.offset();
+
+            for (auto&& recordOffset : recordOffsets)
+            {
+                writer.WriteFixed(recordOffset, 8);
+            }
+
+            writer.WriteFixed(recordOffsets.size(), 8);
+            writer.WriteFixed(tableOffset, 8);
+            writer.WriteBytes(MANIFEST_FILE_END_MAGIC);
+
+            // a write error (e.g. a full disk) is only known once everything is written
+            output.Flush();
+            isWritten = !output.closed();
+        }
+    }
+
+    if (isWritten)
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        // the previous manifest cannot be replaced while mapped on every system; what was looked up
+        // in it is in memory
+        _file.Close();
+        _contents = string_view();
+        _directoryCount = 0;
+        _directoryTable = nullptr;
+
+        fs::rename(temporaryFile, ManifestFile, error);
+    }
+
+    if (!isWritten || error)
+    {
+        cout << red << "Manifest: " << ManifestFile << " cannot be written"
+             << ( error ? ": " + error.message() : string() ) << "." << reset << endl;
+        fs::remove(temporaryFile, error);
+
+        // saved by the next try
+        lock_guard<mutex> lock(_mutex);
+
+        _isModified = true;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,354 @@
+#include "directorywalker.h"
+
+#include <iostream>
+#include <algorithm>
+#include <termcolor/termcolor.hpp>
+
+using namespace std;
+using namespace termcolor;
+
+DirectoryWalker::DirectoryWalker(const fs::path& Root, ConcurrentQueue<fs::path>& FileQueue, bool Ordered,
+                                 int NumThreads) :
+    _root{ Root }, _manifest{ nullptr }, _statistics{ nullptr }, _pathFilter{ nullptr }, _fileQueue{ FileQueue }, _ordered{ Ordered }, _numThreads{ (NumThreads > 0) ? NumThreads : 1 },
+    _pendingDirectories{}, _busyWalkers{ 0 }, _finished{ false }, _stopped{ false },
+    _reusedDirectories{ 0 }, _readDirectories{ 0 }
+{
+}
+
+DirectoryWalker::~DirectoryWalker()
+{
+    Wait();
+}
+
+void DirectoryWalker::UseManifest(DirectoryManifest& Manifest)
+{
+    _manifest = &Manifest;
+}
+
+void DirectoryWalker::UseStatistics(Statistics& Stats)
+{
+    _statistics = &Stats;
+}
+
+void DirectoryWalker::UsePathFilter(const PathFilter& Filter)
+{
+    _pathFilter = &Filter;
+}
+
+void DirectoryWalker::Start()
+{
+    error_code error;
+
+    if ( fs::is_regular_file(_root, error) )
+    {
+        // nothing to walk
+        if (nullptr != _statistics)
+        {
+            _statistics->Add(Statistics::FILES_FOUND);
+        }
+
+        _fileQueue.Push(_root);
+        _fileQueue.Close();
+        return;
+    }
+
+    if ( !fs::is_directory(_root, error) )
+    {
+        cout << red << "Location: " << _root << " is neither a regular file nor a directory." << reset << endl;
+        _fileQueue.Close();
+        return;
+    }
+
+    if (_ordered)
+    {
+        _threads.emplace_back([this]
+                              {
+                                  WalkOrdered( PendingDirectory{ _root, string(), nullptr } );
+                                  _fileQueue.Close();
+                              });
+        return;
+    }
+
+    _pendingDirectories.push_back( PendingDirectory{ _root, string(), nullptr } );
+
+    for (int i = 0; i < _numThreads; ++i)
+    {
+        _threads.emplace_back(&DirectoryWalker::WalkerThread, this);
+    }
+}
+
+void DirectoryWalker::Wait()
+{
+    for (auto&& thread : _threads)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+
+    _threads.clear();
+}
+
+void DirectoryWalker::Stop()
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        _stopped = true;
+        _pendingDirectories.clear();
+    }
+
+    // unblocks walkers waiting for room in the queue
+    _fileQueue.Close();
+}
+
+size_t DirectoryWalker::reusedDirectories() const
+{
+    return _reusedDirectories;
+}
+
+size_t DirectoryWalker::readDirectories() const
+{
+    return _readDirectories;
+}
+
+void DirectoryWalker::WalkerThread()
+{
+    unique_lock<mutex> lock(_mutex);
+
+    while (true)
+    {
+        _workAvailable.wait(lock, [this] { return _finished || !_pendingDirectories.empty(); });
+
+        if (_finished)
+        {
+            break;
+        }
+
+        // depth first: keeps the pending list short on deep trees
+        PendingDirectory directory = std::move(_pendingDirectories.back());
+        _pendingDirectories.pop_back();
+        ++_busyWalkers;
+
+        lock.unlock();
+        ListDirectory(directory);
+        lock.lock();
+
+        --_busyWalkers;
+
+        if ( (0 == _busyWalkers) && _pendingDirectories.empty() )
+        {
+            // nobody can produce new directories anymore
+            _finished = true;
+            _fileQueue.Close();
+            _workAvailable.notify_all();
+        }
+    }
+}
+
+void DirectoryWalker::ListDirectory(const PendingDirectory& Directory)
+{
+    vector<DirectoryManifest::Entry> entries;
+    vector<PendingDirectory>         subdirectories;
+
+    if ( _stopped || !ReadDirectory(Directory.path, entries) )
+    {
+        return;
+    }
+
+    const shared_ptr<const IgnoreRules> rules = DirectoryRules(Directory, entries);
+
+    for (auto&& entry : entries)
+    {
+        string relativePath{};
+
+        if ( IsExcluded(Directory, entry, rules.get(), relativePath) )
+        {
+            continue;
+        }
+
+        if (entry.isDirectory)
+        {
+            subdirectories.push_back( PendingDirectory{ Directory.path / fs::u8path(entry.name), std::move(relativePath), rules } );
+        }
+        else
+        {
+            _fileQueue.Push(Directory.path / fs::u8path(entry.name));
+        }
+    }
+
+    if ( !subdirectories.empty() )
+    {
+        {
+            lock_guard<mutex> lock(_mutex);
+
+            if (_stopped)
+            {
+                return;
+            }
+
+            for (auto&& subdirectory : subdirectories)
+            {
+                _pendingDirectories.push_back(std::move(subdirectory));
+            }
+        }
+
+        _workAvailable.notify_all();
+    }
+}
+
+void DirectoryWalker::WalkOrdered(const PendingDirectory& Directory)
+{
+    vector<DirectoryManifest::Entry> entries;
+
+    if ( _stopped || !ReadDirectory(Directory.path, entries) )
+    {
+        return;
+    }
+
+    // entries only differ by their name: sorting them sorts the full paths
+    sort(entries.begin(), entries.end(), [](const DirectoryManifest::Entry& Lhs, const DirectoryManifest::Entry& Rhs)
+                                         { return fs::u8path(Lhs.name) < fs::u8path(Rhs.name); });
+
+    const shared_ptr<const IgnoreRules> rules = DirectoryRules(Directory, entries);
+
+    for (auto&& entry : entries)
+    {
+        string relativePath{};
+
+        if ( IsExcluded(Directory, entry, rules.get(), relativePath) )
+        {
+            continue;
+        }
+
+        if (entry.isDirectory)
+        {
+            WalkOrdered( PendingDirectory{ Directory.path / fs::u8path(entry.name), std::move(relativePath), rules } );
+        }
+        else
+        {
+            _fileQueue.Push(Directory.path / fs::u8path(entry.name));
+        }
+    }
+}
+
+bool DirectoryWalker::ReadDirectory(const fs::path& Directory, vector<DirectoryManifest::Entry>& Entries)
+{
+    Statistics::ScopedTimer  timer(_statistics, Statistics::WALK_TIME);
+    DirectoryManifest::Stamp stamp{};
+    string                   relativePath{};
+    const bool               hasStamp = (nullptr != _manifest) && DirectoryManifest::GetStamp(Directory, stamp);
+
+    if (hasStamp)
+    {
+        const string directory = Directory.u8string();
+        const size_t separators = directory.find_first_not_of("/\\", _root.u8string().size());
+
+        relativePath = (string::npos == separators) ? string() : directory.substr(separators);
+
+        if ( _manifest->Lookup(relativePath, stamp, Entries) )
+        {
+            ++_reusedDirectories;
+            CountEntries(Entries);
+            return true;
+        }
+    }
+
+    error_code             error;
+    fs::directory_iterator dirIter(Directory, error);
+    fs::directory_iterator endIter;
+
+    Entries.clear();
+
+    if (error)
+    {
+        cout << red << "Directory: " << Directory << " cannot be open: " << error.message() << reset << endl;
+        return false;
+    }
+
+    for (; dirIter != endIter; dirIter.increment(error))
+    {
+        if (error)
+        {
+            cout << red << "Directory: " << Directory << " cannot be listed: " << error.message() << reset << endl;
+            break;
+        }
+
+        const fs::path& entryPath = dirIter->path();
+
+        // symbolic links to directories are not followed (same as recursive_directory_iterator)
+        if ( fs::is_directory(dirIter->symlink_status()) )
+        {
+            Entries.push_back( DirectoryManifest::Entry{ entryPath.filename().u8string(), true } );
+        }
+        // the type comes with the listing where the file system provides it: no stat per file
+        else if ( dirIter->is_regular_file(error) )
+        {
+            Entries.push_back( DirectoryManifest::Entry{ entryPath.filename().u8string(), false } );
+        }
+    }
+
+    if (hasStamp && !error)
+    {
+        _manifest->Record(std::move(relativePath), stamp, Entries);
+        ++_readDirectories;
+    }
+
+    CountEntries(Entries);
+
+    return true;
+}
+
+void DirectoryWalker::CountEntries(const vector<DirectoryManifest::Entry>& Entries)
+{
+    if (nullptr == _statistics)
+    {
+        return;
+    }
+
+    _statistics->Add(Statistics::DIRECTORIES_LISTED);
+    _statistics->Add( Statistics::FILES_FOUND, count_if(Entries.begin(), Entries.end(),
+                                                        [](const DirectoryManifest::Entry& Entry) { return !Entry.isDirectory; }) );
+}
+
+shared_ptr<const IgnoreRules> DirectoryWalker::DirectoryRules(const PendingDirectory& Directory,
+                                                              const vector<DirectoryManifest::Entry>& Entries) const
+{
+    if ( (nullptr == _pathFilter) || !_pathFilter->usesIgnoreFiles() )
+    {
+        return nullptr;
+    }
+
+    // only read when listed: most directories have none
+    const bool hasIgnoreFile = any_of(Entries.begin(), Entries.end(), [](const DirectoryManifest::Entry& Entry)
+                                      {
+                                          return !Entry.isDirectory && ( find( begin(IGNORE_FILE_NAMES), end(IGNORE_FILE_NAMES),
+                                                                               Entry.name ) != end(IGNORE_FILE_NAMES) );
+                                      });
+
+    return hasIgnoreFile ? IgnoreRules::Load(Directory.path, Directory.relativePath, Directory.rules) : Directory.rules;
+}
+
+bool DirectoryWalker::IsExcluded(const PendingDirectory& Directory, const DirectoryManifest::Entry& Entry,
+                                 const IgnoreRules* Rules, string& RelativePath)
+{
+    if (nullptr == _pathFilter)
+    {
+        return false;
+    }
+
+    RelativePath = Directory.relativePath.empty() ? Entry.name : Directory.relativePath + "/" + Entry.name;
+
+    if ( _pathFilter->Accepts(RelativePath, Entry.isDirectory, Rules) )
+    {
+        return false;
+    }
+
+    if (nullptr != _statistics)
+    {
+        _statistics->Add(Entry.isDirectory ? Statistics::DIRECTORIES_EXCLUDED : Statistics::FILES_EXCLUDED);
+    }
+
+    return true;
+}
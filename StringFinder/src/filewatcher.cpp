@@ -0,0 +1,202 @@
+#include "filewatcher.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <termcolor/termcolor.hpp>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+#ifdef __linux__
+    constexpr uint32_t DIRECTORY_EVENTS = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR;
+    constexpr uint32_t FILE_EVENTS = IN_MODIFY | IN_CLOSE_WRITE;
+#endif
+}
+
+FileWatcher::FileWatcher() : _descriptor{ -1 }, _isLimitReported{ false }, _watches{}
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (_descriptor >= 0)
+    {
+        close(_descriptor);
+    }
+#endif
+}
+
+#ifdef __linux__
+bool FileWatcher::Open(const fs::path& Location)
+{
+    error_code     error;
+    vector<Change> files{};
+
+    _descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (_descriptor < 0)
+    {
+        cout << red << "Location: " << Location << " cannot be watched: " << strerror(errno) << reset << endl;
+        return false;
+    }
+
+    if ( !fs::is_directory(Location, error) )
+    {
+        return AddWatch(Location, false);
+    }
+
+    // files already there are searched by the first scan
+    AddTree(Location, files);
+
+    return !_watches.empty();
+}
+
+bool FileWatcher::Wait(int Timeout, vector<Change>& Changes, bool& Overflow)
+{
+    pollfd          request{ _descriptor, POLLIN, 0 };
+    vector<char>    buffer(WATCH_EVENT_BUFFER_SIZE);
+
+    Overflow = false;
+
+    const int ready = poll(&request, 1, Timeout);
+
+    if (ready <= 0)
+    {
+        return (0 == ready) || (EINTR == errno);
+    }
+
+    while (true)
+    {
+        const ssize_t size = read( _descriptor, buffer.data(), buffer.size() );
+
+        if (size <= 0)
+        {
+            // drained
+            return (size == 0) || (EAGAIN == errno) || (EINTR == errno);
+        }
+
+        for (const char* next = buffer.data(); next < buffer.data() + size; )
+        {
+            const inotify_event& event = *reinterpret_cast<const inotify_event*>(next);
+
+            next += sizeof(inotify_event) + event.len;
+
+            if (0 != (event.mask & IN_Q_OVERFLOW))
+            {
+                Overflow = true;
+                continue;
+            }
+
+            const auto watch = _watches.find(event.wd);
+
+            if ( watch == _watches.end() )
+            {
+                continue;
+            }
+
+            if (0 != (event.mask & IN_IGNORED))
+            {
+                // removed, or moved away
+                _watches.erase(watch);
+                continue;
+            }
+
+            if (!watch->second.isDirectory)
+            {
+                Changes.push_back( Change{ watch->second.path, false } );
+                continue;
+            }
+
+            const fs::path path = watch->second.path / event.name;
+            const bool     isNew = (0 != ( event.mask & (IN_CREATE | IN_MOVED_TO) ));
+
+            if (0 != (event.mask & IN_ISDIR))
+            {
+                // new directory: its files may have been written before it was watched
+                if (isNew)
+                {
+                    AddTree(path, Changes);
+                }
+            }
+            else
+            {
+                Changes.push_back( Change{ path, isNew } );
+            }
+        }
+    }
+}
+
+void FileWatcher::AddTree(const fs::path& Directory, vector<Change>& Changes)
+{
+    error_code error;
+
+    if ( !AddWatch(Directory, true) )
+    {
+        return;
+    }
+
+    // symbolic links to directories are not followed (same as DirectoryWalker)
+    for (fs::recursive_directory_iterator entry(Directory, error), end; !error && (entry != end); entry.increment(error))
+    {
+        if ( fs::is_directory( entry->symlink_status() ) )
+        {
+            AddWatch(entry->path(), true);
+        }
+        else if ( fs::is_regular_file(entry->path(), error) )
+        {
+            // files already known (after an overflow) only changed if their size did
+            Changes.push_back( Change{ entry->path(), false } );
+        }
+    }
+}
+
+bool FileWatcher::AddWatch(const fs::path& Path, bool IsDirectory)
+{
+    const int watch = inotify_add_watch( _descriptor, Path.c_str(), IsDirectory ? DIRECTORY_EVENTS : FILE_EVENTS );
+
+    if (watch < 0)
+    {
+        if ( (ENOSPC != errno) || !_isLimitReported )
+        {
+            cout << red << "Location: " << Path << " cannot be watched: " << strerror(errno) << reset << endl;
+            _isLimitReported = _isLimitReported || (ENOSPC == errno);
+        }
+
+        return false;
+    }
+
+    // watched again after an overflow: same watch descriptor
+    _watches[watch] = Watch{ Path, IsDirectory };
+
+    return true;
+}
+#else
+bool FileWatcher::Open(const fs::path& Location)
+{
+    cout << red << "Watch mode is not supported on this platform." << reset << endl;
+    return false;
+}
+
+bool FileWatcher::Wait(int Timeout, vector<Change>& Changes, bool& Overflow)
+{
+    return false;
+}
+
+void FileWatcher::AddTree(const fs::path& Directory, vector<Change>& Changes)
+{
+}
+
+bool FileWatcher::AddWatch(const fs::path& Path, bool IsDirectory)
+{
+    return false;
+}
+#endif
@@ -0,0 +1,328 @@
+#include "globset.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    constexpr const char* ANY_BYTES = "[\\x00-\\xff]*";  // '/' included
+
+    // Glob byte as a regular expression: everything but letters and digits is escaped
+    string Escape(char Byte)
+    {
+        const bool isAlphanumeric = ( (Byte >= 'a') && (Byte <= 'z') ) || ( (Byte >= 'A') && (Byte <= 'Z') ) ||
+                                    ( (Byte >= '0') && (Byte <= '9') );
+
+        return isAlphanumeric ? string(1, Byte) : string{ '\\', Byte };
+    }
+
+    // Last of two glob indices, either of which may be NO_GLOB
+    size_t Later(size_t Lhs, size_t Rhs)
+    {
+        return (NO_GLOB == Lhs) ? Rhs : ( (NO_GLOB == Rhs) ? Lhs : max(Lhs, Rhs) );
+    }
+}
+
+GlobSet::GlobSet() : _globs{}, _names{}, _suffixes{}, _suffixSizes{}, _everything{}, _generalGlobs{}, _regexes{},
+    _automata{}, _fileAutomata{}
+{
+}
+
+bool GlobSet::Add(string_view Pattern, bool IsNegated, string& Error)
+{
+    string_view pattern = Pattern;
+    bool        isDirectoryOnly = false;
+    string      regex{};
+
+    while ( !pattern.empty() && ('/' == pattern.back()) )
+    {
+        isDirectoryOnly = true;
+        pattern.remove_suffix(1);
+    }
+
+    // a '/' anywhere but at the end anchors the glob to the base directory
+    const bool isAnchored = (string_view::npos != pattern.find('/'));
+
+    if ( !pattern.empty() && ('/' == pattern[0]) )
+    {
+        pattern.remove_prefix(1);
+    }
+
+    if ( pattern.empty() )
+    {
+        Error = "Empty glob";
+        return false;
+    }
+
+    if ( !Translate(pattern, isAnchored, regex, Error) )
+    {
+        return false;
+    }
+
+    const size_t index = _globs.size();
+    const size_t wildcard = pattern.find_first_of("*?[\\");
+
+    _globs.push_back( Glob{ string(Pattern), IsNegated, isDirectoryOnly } );
+
+    if ( !isAnchored && (string_view::npos == wildcard) )
+    {
+        _names[ string(pattern) ].push_back(index);
+    }
+    else if ( !isAnchored && (string_view::npos == pattern.find_first_not_of('*')) )
+    {
+        _everything.push_back(index);
+    }
+    else if ( !isAnchored && (0 == wildcard) && ('*' == pattern[0]) &&
+              (string_view::npos == pattern.find_first_of("*?[\\", 1)) )
+    {
+        _suffixes[ string( pattern.substr(1) ) ].push_back(index);
+        _suffixSizes.push_back(pattern.size() - 1);
+    }
+    else
+    {
+        _generalGlobs.push_back(index);
+        _regexes.push_back( std::move(regex) );
+    }
+
+    return true;
+}
+
+void GlobSet::Compile()
+{
+    vector<size_t> fileGlobs{};
+    vector<string> fileRegexes{};
+
+    sort(_suffixSizes.begin(), _suffixSizes.end());
+    _suffixSizes.erase( unique(_suffixSizes.begin(), _suffixSizes.end()), _suffixSizes.end() );
+
+    for (size_t i = 0; i < _generalGlobs.size(); ++i)
+    {
+        if (!_globs[ _generalGlobs[i] ].isDirectoryOnly)
+        {
+            fileGlobs.push_back(_generalGlobs[i]);
+            fileRegexes.push_back(_regexes[i]);
+        }
+    }
+
+    _automata = Build(_generalGlobs, _regexes);
+    _fileAutomata = Build(fileGlobs, fileRegexes);
+}
+
+bool GlobSet::Validate(string_view Pattern, string& Error)
+{
+    GlobSet set{};
+
+    return set.Add(Pattern, false, Error);
+}
+
+bool GlobSet::empty() const
+{
+    return _globs.empty();
+}
+
+const GlobSet::Glob& GlobSet::glob(size_t Index) const
+{
+    return _globs[Index];
+}
+
+size_t GlobSet::Match(string_view Path, bool IsDirectory) const
+{
+    const size_t      slash = Path.rfind('/');
+    const string_view name = (string_view::npos == slash) ? Path : Path.substr(slash + 1);
+    size_t            last = Last(_everything, IsDirectory);
+
+    if ( !_names.empty() )
+    {
+        const auto named = _names.find( string(name) );
+
+        if ( named != _names.end() )
+        {
+            last = Later( last, Last(named->second, IsDirectory) );
+        }
+    }
+
+    for (auto&& size : _suffixSizes)
+    {
+        if (size > name.size())
+        {
+            break;
+        }
+
+        const auto suffixed = _suffixes.find( string( name.substr(name.size() - size) ) );
+
+        if ( suffixed != _suffixes.end() )
+        {
+            last = Later( last, Last(suffixed->second, IsDirectory) );
+        }
+    }
+
+    // useless when a fast path found a glob later than every general one
+    if ( !_generalGlobs.empty() && ( (NO_GLOB == last) || (last < _generalGlobs.back()) ) )
+    {
+        string path("/");
+
+        path.append(Path);
+        last = Later( last, MatchAutomata(IsDirectory ? _automata : _fileAutomata, path) );
+    }
+
+    return last;
+}
+
+bool GlobSet::Translate(string_view Pattern, bool IsAnchored, string& Regex, string& Error)
+{
+    Regex = IsAnchored ? "/" : string(ANY_BYTES) + "/";
+
+    for (size_t i = 0; i < Pattern.size(); )
+    {
+        const char byte = Pattern[i];
+
+        if ('*' == byte)
+        {
+            size_t     end = min( Pattern.find_first_not_of('*', i), Pattern.size() );
+            // "**" alone between slashes crosses directories; anywhere else it is a plain '*'
+            const bool isSegment = (end - i >= 2) && ( (0 == i) || ('/' == Pattern[i - 1]) ) &&
+                                   ( (end == Pattern.size()) || ('/' == Pattern[end]) );
+
+            if ( isSegment && (end == Pattern.size()) )
+            {
+                Regex += ANY_BYTES;
+            }
+            else if (isSegment)
+            {
+                Regex += string("(?:") + ANY_BYTES + "/)?";
+                ++end;
+            }
+            else
+            {
+                Regex += "[^/]*";
+            }
+
+            i = end;
+        }
+        else if ('?' == byte)
+        {
+            Regex += "[^/]";
+            ++i;
+        }
+        else if ('[' == byte)
+        {
+            size_t     first = i + 1;
+            const bool isNegated = (first < Pattern.size()) && ( ('!' == Pattern[first]) || ('^' == Pattern[first]) );
+
+            first += isNegated ? 1 : 0;
+
+            // a leading ] is a member
+            size_t close = first + ( ( (first < Pattern.size()) && (']' == Pattern[first]) ) ? 1 : 0 );
+
+            while ( (close < Pattern.size()) && (']' != Pattern[close]) )
+            {
+                close += ('\\' == Pattern[close]) ? 2 : 1;
+            }
+
+            if (close >= Pattern.size())
+            {
+                Error = "Missing ]";
+                return false;
+            }
+
+            // sets never match '/'
+            Regex += isNegated ? "[^/" : "[";
+
+            for (size_t member = first; member < close; ++member)
+            {
+                const char memberByte = Pattern[member];
+
+                // a - between two members is a range
+                if ( ('-' == memberByte) && (member > first) && (member + 1 < close) )
+                {
+                    Regex += '-';
+                }
+                else if ('\\' == memberByte)
+                {
+                    Regex += Escape(Pattern[++member]);
+                }
+                else
+                {
+                    Regex += Escape(memberByte);
+                }
+            }
+
+            Regex += ']';
+            i = close + 1;
+        }
+        else if ('\\' == byte)
+        {
+            if (i + 1 == Pattern.size())
+            {
+                Error = "Trailing \\";
+                return false;
+            }
+
+            Regex += Escape(Pattern[i + 1]);
+            i += 2;
+        }
+        else
+        {
+            Regex += Escape(byte);
+            ++i;
+        }
+    }
+
+    return RegexProgram::Validate(Regex, Error);
+}
+
+size_t GlobSet::Last(const vector<size_t>& Indices, bool IsDirectory) const
+{
+    for (auto index = Indices.rbegin(); index != Indices.rend(); ++index)
+    {
+        if ( IsDirectory || !_globs[*index].isDirectoryOnly )
+        {
+            return *index;
+        }
+    }
+
+    return NO_GLOB;
+}
+
+vector<GlobSet::Automaton> GlobSet::Build(const vector<size_t>& Globs, const vector<string>& Regexes)
+{
+    vector<Automaton> automata{};
+
+    for (size_t first = 0; first < Globs.size(); first += GLOBS_PER_AUTOMATON)
+    {
+        const size_t   last = min(first + GLOBS_PER_AUTOMATON, Globs.size());
+        Automaton      automaton{};
+        vector<string> patterns{};
+
+        for (size_t i = last; i-- > first; )
+        {
+            automaton.globs.push_back(Globs[i]);
+            patterns.push_back(Regexes[i]);
+        }
+
+        automaton.matcher = make_unique<RegexMatcher>(patterns);
+        automata.push_back( std::move(automaton) );
+    }
+
+    return automata;
+}
+
+size_t GlobSet::MatchAutomata(const vector<Automaton>& Automata, string_view Path)
+{
+    vector<PatternMatcher::Match> matches{};
+
+    // later automata hold later globs
+    for (auto automaton = Automata.rbegin(); automaton != Automata.rend(); ++automaton)
+    {
+        matches.clear();
+        automaton->matcher->FindAll(Path, matches);
+
+        // leftmost longest: a glob matching the whole path is the first match
+        if ( !matches.empty() && (0 == matches[0].position) && (Path.size() == matches[0].length) )
+        {
+            return automaton->globs[ matches[0].pattern ];
+        }
+    }
+
+    return NO_GLOB;
+}
@@ -0,0 +1,95 @@
+#include "ignorerules.h"
+
+#include <fstream>
+
+using namespace std;
+
+IgnoreRules::IgnoreRules(string_view RelativePath, shared_ptr<const IgnoreRules> Parent) :
+    _parent{ std::move(Parent) }, _base( RelativePath.empty() ? string() : string(RelativePath) + "/" ), _rules{}
+{
+}
+
+shared_ptr<const IgnoreRules> IgnoreRules::Load(const fs::path& Directory, string_view RelativePath,
+                                                shared_ptr<const IgnoreRules> Parent)
+{
+    shared_ptr<IgnoreRules> rules = make_shared<IgnoreRules>(RelativePath, Parent);
+    bool                    isFound = false;
+
+    for (auto&& name : IGNORE_FILE_NAMES)
+    {
+        isFound = rules->Read( Directory / fs::u8path( string(name) ) ) || isFound;
+    }
+
+    if (!isFound)
+    {
+        return Parent;
+    }
+
+    rules->_rules.Compile();
+
+    return rules;
+}
+
+bool IgnoreRules::IsIgnored(string_view RelativePath, bool IsDirectory) const
+{
+    for (const IgnoreRules* rules = this; nullptr != rules; rules = rules->_parent.get())
+    {
+        if ( rules->_rules.empty() || (0 != RelativePath.compare(0, rules->_base.size(), rules->_base)) )
+        {
+            continue;
+        }
+
+        const size_t rule = rules->_rules.Match(RelativePath.substr( rules->_base.size() ), IsDirectory);
+
+        if (NO_GLOB != rule)
+        {
+            return !rules->_rules.glob(rule).isNegated;
+        }
+    }
+
+    return false;
+}
+
+bool IgnoreRules::Read(const fs::path& File)
+{
+    ifstream stream(File, ios::binary);
+    string   line{};
+    string   error{};
+
+    if ( !stream.is_open() )
+    {
+        return false;
+    }
+
+    while ( getline(stream, line) )
+    {
+        string_view rule(line);
+
+        if ( !rule.empty() && ('\r' == rule.back()) )
+        {
+            rule.remove_suffix(1);
+        }
+
+        while ( !rule.empty() && (' ' == rule.back()) && ( (rule.size() < 2) || ('\\' != rule[rule.size() - 2]) ) )
+        {
+            rule.remove_suffix(1);
+        }
+
+        if ( rule.empty() || ('#' == rule[0]) )
+        {
+            continue;
+        }
+
+        const bool isNegated = ('!' == rule[0]);
+
+        if ( isNegated || ( (rule.size() > 1) && ('\\' == rule[0]) && ( ('#' == rule[1]) || ('!' == rule[1]) ) ) )
+        {
+            rule.remove_prefix(1);
+        }
+
+        // invalid globs are skipped, as git does
+        _rules.Add(rule, isNegated, error);
+    }
+
+    return true;
+}
@@ -0,0 +1,264 @@
+#include "mappedfile.h"
+
+#include <iostream>
+#include <termcolor/termcolor.hpp>
+
+#ifdef _WIN32
+#include <fstream>
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+#ifdef _WIN32
+    // Reads a whole input, chunk by chunk, into Buffer
+    bool ReadStream(const fs::path& FileName, string& Buffer)
+    {
+        ifstream contentStream(FileName, ios::binary);
+
+        if ( !contentStream.good() )
+        {
+            return false;
+        }
+
+        while (contentStream)
+        {
+            const size_t oldSize = Buffer.size();
+
+            Buffer.resize(oldSize + READ_CHUNK_SIZE);
+            contentStream.read(&Buffer[oldSize], READ_CHUNK_SIZE);
+            Buffer.resize( oldSize + static_cast<size_t>(contentStream.gcount()) );
+        }
+
+        return true;
+    }
+#else
+    // Reads a whole input, chunk by chunk, into Buffer
+    bool ReadStream(int Descriptor, string& Buffer)
+    {
+        while (true)
+        {
+            const size_t  oldSize = Buffer.size();
+
+            Buffer.resize(oldSize + READ_CHUNK_SIZE);
+
+            const ssize_t bytesRead = read(Descriptor, &Buffer[oldSize], READ_CHUNK_SIZE);
+
+            if (bytesRead < 0)
+            {
+                Buffer.resize(oldSize);
+
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+
+                return false;
+            }
+
+            Buffer.resize( oldSize + static_cast<size_t>(bytesRead) );
+
+            if (0 == bytesRead)
+            {
+                return true;
+            }
+        }
+    }
+#endif
+}
+
+MappedFile::MappedFile() : _data{ nullptr }, _size{ 0 }, _mapped{ false }, _buffer{}
+#ifdef _WIN32
+    , _fileHandle{ INVALID_HANDLE_VALUE }, _mappingHandle{ nullptr }
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const fs::path& FileName, OpenMode Mode)
+{
+    Close();
+
+    _fileHandle = CreateFileW(FileName.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (INVALID_HANDLE_VALUE == _fileHandle)
+    {
+        if (MAP_ONLY == Mode)
+        {
+            return false;
+        }
+
+        cout << red << "File: " << FileName << " cannot be open." << reset << endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize{};
+
+    if ( (FILE_TYPE_DISK == GetFileType(_fileHandle)) && GetFileSizeEx(_fileHandle, &fileSize) &&
+         (fileSize.QuadPart > 0) )
+    {
+        _mappingHandle = CreateFileMappingW(_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (nullptr != _mappingHandle)
+        {
+            _data = static_cast<const char*>( MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0) );
+        }
+
+        if (nullptr != _data)
+        {
+            _size = static_cast<size_t>(fileSize.QuadPart);
+            _mapped = true;
+
+            return true;
+        }
+    }
+
+    if (MAP_ONLY == Mode)
+    {
+        Close();
+        return false;
+    }
+
+    // not mappable: read it
+    if ( !ReadStream(FileName, _buffer) )
+    {
+        cout << red << "File: " << FileName << " cannot be read." << reset << endl;
+        Close();
+        return false;
+    }
+
+    _data = _buffer.data();
+    _size = _buffer.size();
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (_mapped)
+    {
+        UnmapViewOfFile(_data);
+    }
+
+    if (nullptr != _mappingHandle)
+    {
+        CloseHandle(_mappingHandle);
+        _mappingHandle = nullptr;
+    }
+
+    if (INVALID_HANDLE_VALUE != _fileHandle)
+    {
+        CloseHandle(_fileHandle);
+        _fileHandle = INVALID_HANDLE_VALUE;
+    }
+
+    _data = nullptr;
+    _size = 0;
+    _mapped = false;
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+}
+#else
+bool MappedFile::Open(const fs::path& FileName, OpenMode Mode)
+{
+    Close();
+
+    const int descriptor = open(FileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (descriptor < 0)
+    {
+        if (MAP_ONLY == Mode)
+        {
+            return false;
+        }
+
+        cout << red << "File: " << FileName << " cannot be open." << reset << endl;
+        return false;
+    }
+
+    struct stat fileStat{};
+
+    if ( (0 == fstat(descriptor, &fileStat)) && S_ISREG(fileStat.st_mode) && (fileStat.st_size > 0) )
+    {
+        void* mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE,
+                             descriptor, 0);
+
+        if (MAP_FAILED != mapping)
+        {
+            // the file is scanned once, front to back: read ahead aggressively and let the kernel
+            // drop the pages behind the scan
+            madvise(mapping, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+            _data = static_cast<const char*>(mapping);
+            _size = static_cast<size_t>(fileStat.st_size);
+            _mapped = true;
+
+            // the mapping stays valid once the descriptor is closed
+            close(descriptor);
+
+            return true;
+        }
+    }
+
+    if (MAP_ONLY == Mode)
+    {
+        close(descriptor);
+        return false;
+    }
+
+    // not mappable (pipe, device, pseudo file...): read it
+    const bool isRead = ReadStream(descriptor, _buffer);
+
+    close(descriptor);
+
+    if (!isRead)
+    {
+        cout << red << "File: " << FileName << " cannot be read." << reset << endl;
+        Close();
+        return false;
+    }
+
+    _data = _buffer.data();
+    _size = _buffer.size();
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (_mapped)
+    {
+        munmap(const_cast<char*>(_data), _size);
+    }
+
+    _data = nullptr;
+    _size = 0;
+    _mapped = false;
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+}
+#endif
+
+string_view MappedFile::contents() const
+{
+    return string_view(_data, _size);
+}
+
+bool MappedFile::isMapped() const
+{
+    return _mapped;
+}
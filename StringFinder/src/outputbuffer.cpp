@@ -0,0 +1,418 @@
+#include "outputbuffer.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+
+#include <iostream>
+#include <termcolor/termcolor.hpp>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+    // Escape sequence of every byte; empty for bytes written as they are
+    const array<string_view, 256>& EscapeTable()
+    {
+        static const array<string_view, 256> table = []
+        {
+            array<string_view, 256> escapes{};
+
+            escapes[static_cast<unsigned char>('\'')] = "\\'";
+            escapes[static_cast<unsigned char>('\"')] = "\\\"";
+            escapes[static_cast<unsigned char>('\?')] = "\\?";
+            escapes[static_cast<unsigned char>('\\')] = "\\\\";
+            escapes[static_cast<unsigned char>('\a')] = "\\a";
+            escapes[static_cast<unsigned char>('\b')] = "\\b";
+            escapes[static_cast<unsigned char>('\f')] = "\\f";
+            escapes[static_cast<unsigned char>('\n')] = "\\n";
+            escapes[static_cast<unsigned char>('\r')] = "\\r";
+            escapes[static_cast<unsigned char>('\t')] = "\\t";
+            escapes[static_cast<unsigned char>('\v')] = "\\v";
+
+            return escapes;
+        }();
+
+        return table;
+    }
+
+    // Size of the UTF-8 sequence starting at Text[Index]; 0 if the bytes there are not valid UTF-8
+    size_t Utf8SequenceSize(string_view Text, size_t Index)
+    {
+        const unsigned char lead = static_cast<unsigned char>(Text[Index]);
+        size_t              size = 0;
+        unsigned            minimum = 0;
+
+        if ( (lead >= 0xC2) && (lead <= 0xDF) )
+        {
+            size = 2;
+            minimum = 0x80;
+        }
+        else if ( (lead >= 0xE0) && (lead <= 0xEF) )
+        {
+            size = 3;
+            minimum = 0x800;
+        }
+        else if ( (lead >= 0xF0) && (lead <= 0xF4) )
+        {
+            size = 4;
+            minimum = 0x10000;
+        }
+
+        if ( (0 == size) || (Index + size > Text.size()) )
+        {
+            return 0;
+        }
+
+        unsigned codePoint = lead & (0x7F >> size);
+
+        for (size_t i = 1; i < size; ++i)
+        {
+            const unsigned char next = static_cast<unsigned char>(Text[Index + i]);
+
+            if ( (next & 0xC0) != 0x80 )
+            {
+                return 0;
+            }
+
+            codePoint = (codePoint << 6) | (next & 0x3F);
+        }
+
+        // overlong forms, surrogates and values past U+10FFFF are invalid
+        const bool isValid = (codePoint >= minimum) && (codePoint <= 0x10FFFF) &&
+                             ( (codePoint < 0xD800) || (codePoint > 0xDFFF) );
+
+        return isValid ? size : 0;
+    }
+
+    // Returns true if Text is entirely made of valid UTF-8 sequences
+    bool IsValidUtf8(string_view Text)
+    {
+        for (size_t i = 0; i < Text.size(); )
+        {
+            const size_t size = (static_cast<unsigned char>(Text[i]) < 0x80) ? 1 : Utf8SequenceSize(Text, i);
+
+            if (0 == size)
+            {
+                return false;
+            }
+
+            i += size;
+        }
+
+        return true;
+    }
+
+    const string_view COLOR_CODES[] = { "\033[00m", "\033[32m", "\033[31m", "\033[33m" };
+
+    bool IsTerminal(int Descriptor)
+    {
+#ifdef _WIN32
+        if ( !_isatty(Descriptor) )
+        {
+            return false;
+        }
+
+        // colour codes need the virtual terminal mode of the console
+        HANDLE console = reinterpret_cast<HANDLE>( _get_osfhandle(Descriptor) );
+        DWORD  mode = 0;
+
+        return GetConsoleMode(console, &mode) &&
+               SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#else
+        return (1 == isatty(Descriptor));
+#endif
+    }
+}
+
+OutputBuffer::OutputBuffer(int Descriptor) : _descriptor{ Descriptor }, _ownsDescriptor{ false },
+    _isColorized{ IsTerminal(Descriptor) }, _isClosed{ false }, _buffer(OUTPUT_BUFFER_SIZE), _used{ 0 }
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    Flush();
+
+    if (_ownsDescriptor)
+    {
+#ifdef _WIN32
+        _close(_descriptor);
+#else
+        close(_descriptor);
+#endif
+    }
+}
+
+bool OutputBuffer::Open(const fs::path& FileName)
+{
+#ifdef _WIN32
+    const int descriptor = _wopen(FileName.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    const int descriptor = open(FileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+
+    if (descriptor < 0)
+    {
+        cout << red << "Output file: " << FileName << " cannot be created: " << strerror(errno) << reset << endl;
+        return false;
+    }
+
+    // whatever was buffered belongs to the previous output
+    Flush();
+
+    if (_ownsDescriptor)
+    {
+#ifdef _WIN32
+        _close(_descriptor);
+#else
+        close(_descriptor);
+#endif
+    }
+
+    _descriptor = descriptor;
+    _ownsDescriptor = true;
+    _isColorized = false;
+    _isClosed = false;
+
+    return true;
+}
+
+void OutputBuffer::Attach(int Descriptor)
+{
+    Flush();
+
+    if (_ownsDescriptor)
+    {
+#ifdef _WIN32
+        _close(_descriptor);
+#else
+        close(_descriptor);
+#endif
+    }
+
+    _descriptor = Descriptor;
+    _ownsDescriptor = false;
+    _isColorized = false;
+    _isClosed = false;
+}
+
+void OutputBuffer::Write(string_view Text)
+{
+    if (Text.size() > _buffer.size())
+    {
+        // too big to be buffered: written directly
+        Flush();
+        WriteDirect( Text.data(), Text.size() );
+        return;
+    }
+
+    Reserve( Text.size() );
+    memcpy(_buffer.data() + _used, Text.data(), Text.size());
+    _used += Text.size();
+}
+
+void OutputBuffer::Write(char Character)
+{
+    Reserve(1);
+    _buffer[_used++] = Character;
+}
+
+void OutputBuffer::WriteNumber(uint64_t Number)
+{
+    constexpr size_t MAX_DIGITS = 20;
+
+    Reserve(MAX_DIGITS);
+
+    const to_chars_result result = to_chars(_buffer.data() + _used, _buffer.data() + _used + MAX_DIGITS, Number);
+
+    _used = static_cast<size_t>(result.ptr - _buffer.data());
+}
+
+void OutputBuffer::WriteEscaped(string_view Text)
+{
+    const array<string_view, 256>& escapes = EscapeTable();
+    size_t                         runStart = 0;
+
+    for (size_t i = 0; i < Text.size(); ++i)
+    {
+        const string_view& escape = escapes[static_cast<unsigned char>(Text[i])];
+
+        if ( !escape.empty() )
+        {
+            // bytes before the special character go as one block
+            Write( Text.substr(runStart, i - runStart) );
+            Write(escape);
+            runStart = i + 1;
+        }
+    }
+
+    Write( Text.substr(runStart) );
+}
+
+void OutputBuffer::WriteJsonField(string_view Name, string_view Text)
+{
+    const bool isText = IsValidUtf8(Text);
+
+    Write('"');
+    Write(Name);
+    Write(isText ? "\":" : "_base64\":");
+
+    if (isText)
+    {
+        WriteJsonString(Text);
+    }
+    else
+    {
+        WriteBase64(Text);
+    }
+}
+
+void OutputBuffer::SetColor(Color NewColor)
+{
+    if (_isColorized)
+    {
+        Write(COLOR_CODES[NewColor]);
+    }
+}
+
+void OutputBuffer::ResetColor()
+{
+    SetColor(DEFAULT);
+}
+
+void OutputBuffer::Flush()
+{
+    WriteDirect(_buffer.data(), _used);
+    _used = 0;
+}
+
+void OutputBuffer::WriteDirect(const char* Data, size_t Size)
+{
+    const char* data = Data;
+    size_t      remaining = Size;
+
+    if (_isClosed)
+    {
+        return;
+    }
+
+    while (remaining > 0)
+    {
+#ifdef _WIN32
+        const int written = _write(_descriptor, data, static_cast<unsigned>(remaining));
+#else
+        const ssize_t written = write(_descriptor, data, remaining);
+#endif
+
+        if (written < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            // output closed (e.g. broken pipe): nothing else can be done
+            _isClosed = true;
+            break;
+        }
+
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+}
+
+void OutputBuffer::SetColorized(bool IsColorized)
+{
+    _isColorized = IsColorized;
+}
+
+bool OutputBuffer::closed() const
+{
+    return _isClosed;
+}
+
+void OutputBuffer::Reserve(size_t Size)
+{
+    if (_used + Size > _buffer.size())
+    {
+        Flush();
+    }
+}
+
+void OutputBuffer::WriteJsonString(string_view Text)
+{
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    size_t                runStart = 0;
+
+    Write('"');
+
+    for (size_t i = 0; i < Text.size(); ++i)
+    {
+        const unsigned char character = static_cast<unsigned char>(Text[i]);
+
+        // UTF-8 sequences go as they are
+        if ( (character >= 0x20) && ('"' != character) && ('\\' != character) )
+        {
+            continue;
+        }
+
+        Write( Text.substr(runStart, i - runStart) );
+
+        if ( ('"' == character) || ('\\' == character) )
+        {
+            Write('\\');
+            Write( static_cast<char>(character) );
+        }
+        else
+        {
+            const char escape[] = { '\\', 'u', '0', '0', HEX_DIGITS[character >> 4], HEX_DIGITS[character & 0xF] };
+
+            Write( string_view(escape, sizeof(escape)) );
+        }
+
+        runStart = i + 1;
+    }
+
+    Write( Text.substr(runStart) );
+    Write('"');
+}
+
+void OutputBuffer::WriteBase64(string_view Bytes)
+{
+    static constexpr char BASE64_DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    Write('"');
+
+    for (size_t i = 0; i < Bytes.size(); i += 3)
+    {
+        const size_t size = min<size_t>(3, Bytes.size() - i);
+        uint32_t     group = 0;
+        char         digits[4] = { '=', '=', '=', '=' };
+
+        for (size_t byte = 0; byte < 3; ++byte)
+        {
+            group = (group << 8) | ( (byte < size) ? static_cast<unsigned char>(Bytes[i + byte]) : 0u );
+        }
+
+        for (size_t digit = 0; digit <= size; ++digit)
+        {
+            digits[digit] = BASE64_DIGITS[(group >> (18 - 6 * digit)) & 0x3F];
+        }
+
+        Write( string_view(digits, sizeof(digits)) );
+    }
+
+    Write('"');
+}
@@ -0,0 +1,168 @@
+#include "pathfilter.h"
+#include "casefolding.h"
+
+#include <algorithm>
+
+using namespace std;
+
+PathFilter::PathFilter() : _excludedExtensions{}, _maxExtensionSize{ 0 }, _excludedGlobs{}, _includedGlobs{},
+    _useIgnoreFiles{ false }, _rulesMutex{}, _rulesCache{}
+{
+}
+
+void PathFilter::ExcludeExtensions(const vector<string>& Extensions)
+{
+    for (auto&& extension : Extensions)
+    {
+        const string_view name = ( !extension.empty() && ('.' == extension[0]) ) ? string_view(extension).substr(1)
+                                                                                  : string_view(extension);
+
+        if ( !name.empty() && (name.size() <= MAX_EXTENSION_SIZE) )
+        {
+            _excludedExtensions.insert( FoldCase(name) );
+            _maxExtensionSize = max( _maxExtensionSize, name.size() );
+        }
+    }
+}
+
+void PathFilter::ExcludeGlobs(const vector<string>& Globs)
+{
+    string error{};
+
+    for (auto&& glob : Globs)
+    {
+        _excludedGlobs.Add(glob, false, error);
+    }
+
+    _excludedGlobs.Compile();
+}
+
+void PathFilter::IncludeGlobs(const vector<string>& Globs)
+{
+    string error{};
+
+    for (auto&& glob : Globs)
+    {
+        _includedGlobs.Add(glob, false, error);
+    }
+
+    _includedGlobs.Compile();
+}
+
+void PathFilter::UseIgnoreFiles()
+{
+    _useIgnoreFiles = true;
+
+    // never holds anything to search, and git does not ignore it: no rule would
+    ExcludeGlobs({ ".git/" });
+}
+
+bool PathFilter::usesIgnoreFiles() const
+{
+    return _useIgnoreFiles;
+}
+
+bool PathFilter::empty() const
+{
+    return _excludedExtensions.empty() && _excludedGlobs.empty() && _includedGlobs.empty() && !_useIgnoreFiles;
+}
+
+bool PathFilter::Accepts(string_view RelativePath, bool IsDirectory, const IgnoreRules* Rules) const
+{
+    const size_t slash = RelativePath.rfind('/');
+
+    if ( !IsDirectory && !AcceptsExtension( (string_view::npos == slash) ? RelativePath : RelativePath.substr(slash + 1) ) )
+    {
+        return false;
+    }
+
+    if ( !_excludedGlobs.empty() && (NO_GLOB != _excludedGlobs.Match(RelativePath, IsDirectory)) )
+    {
+        return false;
+    }
+
+    if ( (nullptr != Rules) && Rules->IsIgnored(RelativePath, IsDirectory) )
+    {
+        return false;
+    }
+
+    return IsDirectory || _includedGlobs.empty() || (NO_GLOB != _includedGlobs.Match(RelativePath, false));
+}
+
+bool PathFilter::AcceptsPath(const fs::path& Root, const fs::path& File) const
+{
+    const string root = Root.u8string();
+    const string file = File.u8string();
+    const bool   isUnder = (file.size() > root.size()) && (0 == file.compare(0, root.size(), root)) &&
+                           ( root.empty() || ('/' == root.back()) || ('\\' == root.back()) ||
+                             ('/' == file[root.size()]) || ('\\' == file[root.size()]) );
+
+    // a file elsewhere is only known by its name
+    if (!isUnder)
+    {
+        return Accepts(File.filename().u8string(), false);
+    }
+
+    const size_t                  start = file.find_first_not_of("/\\", root.size());
+    const string                  relativePath = fs::u8path( file.substr( min(start, file.size()) ) ).generic_u8string();
+    shared_ptr<const IgnoreRules> rules = _useIgnoreFiles ? DirectoryRules(Root, string(), nullptr) : nullptr;
+
+    for (size_t slash = relativePath.find('/'); string::npos != slash; slash = relativePath.find('/', slash + 1))
+    {
+        const string directory = relativePath.substr(0, slash);
+
+        if ( !Accepts(directory, true, rules.get()) )
+        {
+            return false;
+        }
+
+        if (_useIgnoreFiles)
+        {
+            rules = DirectoryRules(Root, directory, rules);
+        }
+    }
+
+    return relativePath.empty() || Accepts(relativePath, false, rules.get());
+}
+
+bool PathFilter::AcceptsExtension(string_view FileName) const
+{
+    if ( _excludedExtensions.empty() )
+    {
+        return true;
+    }
+
+    // only the tail of the name may hold an excluded extension; the first byte is never a dot of one
+    const size_t first = (FileName.size() > _maxExtensionSize + 1) ? FileName.size() - _maxExtensionSize - 1 : 1;
+    char         folded[MAX_EXTENSION_SIZE];
+
+    for (size_t dot = FileName.find('.', first); dot != string_view::npos; dot = FileName.find('.', dot + 1))
+    {
+        const string_view extension = FileName.substr(dot + 1);
+
+        transform( extension.begin(), extension.end(), folded, [](char Byte) { return FoldCase(Byte); } );
+
+        if ( !extension.empty() && _excludedExtensions.count( string(folded, extension.size()) ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+shared_ptr<const IgnoreRules> PathFilter::DirectoryRules(const fs::path& Root, const string& RelativePath,
+                                                         shared_ptr<const IgnoreRules> Parent) const
+{
+    lock_guard<mutex> lock(_rulesMutex);
+    auto              cached = _rulesCache.find(RelativePath);
+
+    if ( cached == _rulesCache.end() )
+    {
+        const fs::path directory = RelativePath.empty() ? Root : Root / fs::u8path(RelativePath);
+
+        cached = _rulesCache.emplace( RelativePath, IgnoreRules::Load(directory, RelativePath, std::move(Parent)) ).first;
+    }
+
+    return cached->second;
+}
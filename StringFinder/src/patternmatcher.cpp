@@ -0,0 +1,104 @@
+#include "patternmatcher.h"
+#include "ahocorasick.h"
+#include "teddymatcher.h"
+#include "regexmatcher.h"
+
+#include <algorithm>
+
+using namespace std;
+
+PatternMatcher::PatternMatcher(const vector<string>& Patterns, bool IgnoreCase) : _patterns{ Patterns },
+    _ignoreCase{ IgnoreCase }
+{
+}
+
+PatternMatcher::~PatternMatcher()
+{
+}
+
+const vector<string>& PatternMatcher::patterns() const
+{
+    return _patterns;
+}
+
+bool PatternMatcher::ignoreCase() const
+{
+    return _ignoreCase;
+}
+
+void PatternMatcher::FindFrom(string_view Contents, size_t Start, vector<Match>& Matches) const
+{
+    const size_t firstMatch = Matches.size();
+
+    FindAll(Contents.substr(Start), Matches);
+
+    for (size_t i = firstMatch; i < Matches.size(); ++i)
+    {
+        Matches[i].position += Start;
+    }
+}
+
+size_t PatternMatcher::maxMatchSize() const
+{
+    size_t maxSize = 1;
+
+    for (auto&& pattern : _patterns)
+    {
+        maxSize = max( maxSize, pattern.size() );
+    }
+
+    return maxSize;
+}
+
+bool PatternMatcher::overlappingMatches() const
+{
+    return true;
+}
+
+vector<string> PatternMatcher::requiredLiterals() const
+{
+    return _patterns;
+}
+
+unique_ptr<PatternMatcher> PatternMatcher::Create(const vector<string>& Patterns, bool IgnoreCase, bool IsRegex)
+{
+    if (IsRegex)
+    {
+        return make_unique<RegexMatcher>(Patterns, IgnoreCase);
+    }
+
+    if (1 == Patterns.size())
+    {
+        return make_unique<LiteralMatcher>(Patterns.front(), IgnoreCase);
+    }
+
+    if ( (Patterns.size() <= TEDDY_MAX_PATTERNS) && TeddyMatcher::IsSupported() )
+    {
+        return make_unique<TeddyMatcher>(Patterns, IgnoreCase);
+    }
+
+    return make_unique<AhoCorasickMatcher>(Patterns, IgnoreCase);
+}
+
+LiteralMatcher::LiteralMatcher(const string& Pattern, bool IgnoreCase) : PatternMatcher({ Pattern }, IgnoreCase),
+    _searcher{ Pattern, IgnoreCase }
+{
+}
+
+void LiteralMatcher::FindAll(string_view Contents, vector<Match>& Matches) const
+{
+    size_t position = _searcher.Find(Contents);
+
+    while (position != string_view::npos)
+    {
+        Matches.push_back({ position, 0, _patterns.front().size() });
+
+        // search starting from next character
+        position = _searcher.Find(Contents, ++position);
+    }
+}
+
+const char* LiteralMatcher::name() const
+{
+    return Searcher::InstructionSetName( _searcher.instructionSet() );
+}
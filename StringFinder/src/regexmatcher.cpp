@@ -0,0 +1,579 @@
+#include "regexmatcher.h"
+
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <termcolor/termcolor.hpp>
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+    // state flags: what the byte before tells the assertions, and whether new threads start
+    constexpr uint8_t  PREV_LINE = 1;
+    constexpr uint8_t  PREV_WORD = 2;
+    constexpr uint8_t  ANCHORED = 4;
+
+    // transitions: next state, and what the transition tells
+    constexpr uint32_t UNKNOWN = UINT32_MAX;
+    constexpr uint32_t MATCH_BIT = 0x80000000;  // a match ends before the byte
+    constexpr uint32_t IDLE_BIT = 0x40000000;   // no thread is alive after the byte
+    constexpr uint32_t STATE_MASK = 0x3fffffff;
+    constexpr uint32_t DEAD = 0;                // anchored, no thread alive: never matches
+}
+
+struct RegexMatcher::DfaCache
+{
+    // state * classes + class
+    vector<uint32_t>                transitions;
+    // lowest pattern matching before the byte of the transition
+    vector<uint32_t>                matchPatterns;
+    // per state
+    vector<uint32_t>                endPatterns;
+    vector<string>                  keys;
+    unordered_map<string, uint32_t> states;
+    uint32_t                        startStates[8];
+    size_t                          maxStates;
+    // closure scratch space
+    vector<uint32_t>                visited;
+    uint32_t                        generation;
+    vector<uint32_t>                stack;
+    vector<uint32_t>                byteInstructions;
+    vector<uint32_t>                kernel;
+    // bytes run through the DFA by unanchored scans, so the prefilter knows what its hits cost
+    size_t                          scannedBytes;
+};
+
+RegexMatcher::RegexMatcher(const vector<string>& Patterns, bool IgnoreCase) : PatternMatcher(Patterns, IgnoreCase),
+    _program{}, _isValid{ false }, _byteClasses{}, _flagMask{ ANCHORED }, _maxMatchSize{ 1 }, _prefilter{},
+    _literalOffset{ 0 }, _cachesMutex{}, _caches{}
+{
+    string         error{};
+    vector<string> literals{};
+
+    _isValid = _program.Compile(Patterns, IgnoreCase, error);
+
+    if (!_isValid)
+    {
+        cout << red << "Invalid regular expression: " << error << reset << endl;
+        return;
+    }
+
+    for (unsigned byte = 0; byte < 256; ++byte)
+    {
+        _byteClasses[byte] = static_cast<uint8_t>( _program.byteClass( static_cast<uint8_t>(byte) ) );
+    }
+
+    // flags no assertion looks at would only multiply the states
+    _flagMask = ANCHORED | ( _program.hasLineAssertions() ? PREV_LINE : 0 ) | ( _program.hasWordAssertions() ? PREV_WORD : 0 );
+    _maxMatchSize = max<size_t>( 1, _program.maxMatchSize() );
+
+    // a single literal offset: candidates are then met in the order of the matches they belong to
+    for (auto&& literal : _program.literals())
+    {
+        literals.push_back(literal.bytes);
+        _literalOffset = max(_literalOffset, literal.offset);
+    }
+
+    if ( !literals.empty() && (literals.size() <= TEDDY_MAX_PATTERNS) )
+    {
+        _prefilter = PatternMatcher::Create(literals, IgnoreCase);
+    }
+}
+
+RegexMatcher::~RegexMatcher()
+{
+}
+
+void RegexMatcher::FindAll(string_view Contents, vector<Match>& Matches) const
+{
+    FindFrom(Contents, 0, Matches);
+}
+
+void RegexMatcher::FindFrom(string_view Contents, size_t Start, vector<Match>& Matches) const
+{
+    if (!_isValid)
+    {
+        return;
+    }
+
+    unique_ptr<DfaCache> cache = AcquireCache();
+    size_t               position = Start;
+    bool                 isDone = false;
+    Match                match{};
+
+    // every match starts at most _literalOffset bytes before a literal: the DFA only runs from there
+    // (matches before position are all reported)
+    if (_prefilter)
+    {
+        vector<Match> hits{};
+
+        bool isTooCommon = false;
+
+        for (size_t block = Start; !isTooCommon && (block < Contents.size()); block += REGEX_PREFILTER_BLOCK)
+        {
+            const size_t blockEnd = min(Contents.size(), block + REGEX_PREFILTER_BLOCK);
+
+            hits.clear();
+            _prefilter->FindFrom(Contents.substr( 0, blockEnd + _prefilter->maxMatchSize() - 1 ), block, hits);
+
+            // literals too common: scanning everything is faster than running the DFA around each of them
+            isTooCommon = (hits.size() * (REGEX_MIN_HIT_DISTANCE + _literalOffset) > REGEX_PREFILTER_BLOCK);
+            cache->scannedBytes = 0;
+
+            for (size_t hit = 0; !isTooCommon && (hit < hits.size()) && (hits[hit].position < blockEnd); ++hit)
+            {
+                const size_t hitPosition = hits[hit].position;
+
+                if (hitPosition < position)
+                {
+                    continue;
+                }
+
+                const size_t from = max( position, hitPosition - min(hitPosition, _literalOffset) );
+
+                if ( FindNext(Contents, from, hitPosition + 1, *cache, match) )
+                {
+                    Matches.push_back(match);
+                    position = match.position + match.length;
+                }
+                else
+                {
+                    position = hitPosition + 1;
+                }
+
+                // fewer hits, but each followed far (e.g. "x.*y"): the scans around them already cost
+                // more than scanning the block once
+                isTooCommon = (cache->scannedBytes > REGEX_PREFILTER_BLOCK);
+            }
+
+            isDone = !isTooCommon && (blockEnd == Contents.size());
+        }
+
+        isDone = isDone || (Start >= Contents.size());
+    }
+
+    while ( !isDone && FindNext(Contents, position, Contents.size(), *cache, match) )
+    {
+        Matches.push_back(match);
+        position = match.position + match.length;
+    }
+
+    ReleaseCache( std::move(cache) );
+}
+
+const char* RegexMatcher::name() const
+{
+    return "Regex (lazy DFA)";
+}
+
+size_t RegexMatcher::maxMatchSize() const
+{
+    return _maxMatchSize;
+}
+
+bool RegexMatcher::overlappingMatches() const
+{
+    return false;
+}
+
+vector<string> RegexMatcher::requiredLiterals() const
+{
+    vector<string> literals{};
+
+    for (auto&& literal : _program.literals())
+    {
+        literals.push_back(literal.bytes);
+    }
+
+    if ( literals.empty() )
+    {
+        literals.push_back("");
+    }
+
+    return literals;
+}
+
+bool RegexMatcher::FindNext(string_view Contents, size_t From, size_t StartLimit, DfaCache& Cache, Match& Result) const
+{
+    size_t end = 0;
+    size_t idle = From;
+
+    while ( (From < StartLimit) && FindFirstEnd(Contents, From, StartLimit, Cache, end, idle) )
+    {
+        // the leftmost match has not ended before end, so it starts after idle and at most
+        // _maxMatchSize bytes before end
+        const size_t first = max( { From, idle, end - min(end, _maxMatchSize) } );
+
+        for (size_t start = first; start < min(end, StartLimit); ++start)
+        {
+            if ( FindLongest(Contents, start, Cache, Result) )
+            {
+                return true;
+            }
+        }
+
+        // only matches longer than _maxMatchSize ended there
+        From = end;
+    }
+
+    return false;
+}
+
+bool RegexMatcher::FindFirstEnd(string_view Contents, size_t From, size_t StartLimit, DfaCache& Cache, size_t& End,
+                                size_t& Idle) const
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>( Contents.data() );
+    const size_t   numClasses = _program.numClasses();
+    const size_t   scanEnd = min( Contents.size(), StartLimit + _maxMatchSize );
+    uint32_t       state = StartState(Contents, From, false, Cache);
+    size_t         position = From;
+
+    Idle = From;
+
+    // new threads start up to StartLimit; then the alive ones are followed until they end
+    for (bool isAnchored : { false, true })
+    {
+        const size_t limit = isAnchored ? scanEnd : min(StartLimit, scanEnd);
+
+        if ( isAnchored && ( DEAD == ( state = AnchoredState(state, Cache) ) ) )
+        {
+            Cache.scannedBytes += position - From;
+            return false;
+        }
+
+        for (; position < limit; ++position)
+        {
+            const uint8_t byteClass = _byteClasses[data[position]];
+            uint32_t      transition = Cache.transitions[state * numClasses + byteClass];
+
+            if (UNKNOWN == transition)
+            {
+                transition = Step(state, byteClass, Cache);
+            }
+
+            if (0 != (transition & MATCH_BIT))
+            {
+                Cache.scannedBytes += position - From;
+                End = position;
+                return true;
+            }
+
+            state = transition & STATE_MASK;
+            Idle = (0 != (transition & IDLE_BIT)) ? position + 1 : Idle;
+
+            if (DEAD == state)
+            {
+                Cache.scannedBytes += position - From;
+                return false;
+            }
+        }
+    }
+
+    Cache.scannedBytes += position - From;
+
+    if ( (scanEnd == Contents.size()) && (NO_PATTERN != EndPattern(state, Cache)) )
+    {
+        End = scanEnd;
+        return true;
+    }
+
+    return false;
+}
+
+bool RegexMatcher::FindLongest(string_view Contents, size_t Start, DfaCache& Cache, Match& Result) const
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>( Contents.data() );
+    const size_t   numClasses = _program.numClasses();
+    uint32_t       state = StartState(Contents, Start, true, Cache);
+    bool           isFound = false;
+
+    for (size_t position = Start; position < Contents.size(); ++position)
+    {
+        const uint8_t byteClass = _byteClasses[data[position]];
+        uint32_t      transition = Cache.transitions[state * numClasses + byteClass];
+
+        if (UNKNOWN == transition)
+        {
+            transition = Step(state, byteClass, Cache);
+        }
+
+        if (0 != (transition & MATCH_BIT))
+        {
+            Result = { Start, Cache.matchPatterns[state * numClasses + byteClass], position - Start };
+            isFound = true;
+        }
+
+        state = transition & STATE_MASK;
+
+        // longer matches are cut
+        if ( (position == Start + _maxMatchSize) || (DEAD == state) )
+        {
+            return isFound;
+        }
+    }
+
+    const uint32_t pattern = EndPattern(state, Cache);
+
+    if (NO_PATTERN != pattern)
+    {
+        Result = { Start, pattern, Contents.size() - Start };
+        isFound = true;
+    }
+
+    return isFound;
+}
+
+uint32_t RegexMatcher::StartState(string_view Contents, size_t Position, bool IsAnchored, DfaCache& Cache) const
+{
+    uint8_t flags = IsAnchored ? ANCHORED : 0;
+
+    if ( (0 == Position) || ('\n' == Contents[Position - 1]) )
+    {
+        flags |= PREV_LINE;
+    }
+
+    if ( (Position > 0) && RegexProgram::IsWordByte( static_cast<uint8_t>(Contents[Position - 1]) ) )
+    {
+        flags |= PREV_WORD;
+    }
+
+    flags &= _flagMask;
+
+    uint32_t& state = Cache.startStates[flags];
+
+    if (UNKNOWN == state)
+    {
+        state = Intern( Key( flags, IsAnchored ? vector<uint32_t>{ _program.start() } : vector<uint32_t>{} ), Cache );
+    }
+
+    return state;
+}
+
+uint32_t RegexMatcher::AnchoredState(uint32_t State, DfaCache& Cache) const
+{
+    string key = Cache.keys[State];
+
+    // the dead state has no flags
+    key[0] = (1 == key.size()) ? ANCHORED : static_cast<char>(key[0] | ANCHORED);
+
+    return Intern(key, Cache);
+}
+
+uint32_t RegexMatcher::Step(uint32_t& State, uint8_t Class, DfaCache& Cache) const
+{
+    const vector<RegexProgram::Instruction>& instructions = _program.instructions();
+    const uint8_t                            byte = _program.classByte(Class);
+    const bool                               isWord = RegexProgram::IsWordByte(byte);
+    const string                             from = Cache.keys[State];
+    const uint32_t                           pattern = Closure(from, '\n' == byte, isWord, Cache);
+
+    Cache.kernel.clear();
+
+    for (auto&& instruction : Cache.byteInstructions)
+    {
+        if ( _program.Contains(instructions[instruction].argument, byte) )
+        {
+            Cache.kernel.push_back(instructions[instruction].next);
+        }
+    }
+
+    sort( Cache.kernel.begin(), Cache.kernel.end() );
+    Cache.kernel.erase( unique( Cache.kernel.begin(), Cache.kernel.end() ), Cache.kernel.end() );
+
+    const uint8_t flags = (from[0] & ANCHORED) | ( ('\n' == byte) ? PREV_LINE : 0 ) | ( isWord ? PREV_WORD : 0 );
+    const string  to = Key(flags, Cache.kernel);
+
+    // full: starts over with the state at hand
+    if (Cache.keys.size() + 2 > Cache.maxStates)
+    {
+        Reset(Cache);
+        State = Intern(from, Cache);
+    }
+
+    const uint32_t next = Intern(to, Cache);
+    const bool     isIdle = (1 == to.size()) && (0 == (flags & ANCHORED));
+    const uint32_t transition = next | ( (NO_PATTERN != pattern) ? MATCH_BIT : 0 ) | ( isIdle ? IDLE_BIT : 0 );
+    const size_t   index = State * _program.numClasses() + Class;
+
+    Cache.transitions[index] = transition;
+    Cache.matchPatterns[index] = pattern;
+
+    return transition;
+}
+
+uint32_t RegexMatcher::EndPattern(uint32_t State, DfaCache& Cache) const
+{
+    if (UNKNOWN == Cache.endPatterns[State])
+    {
+        Cache.endPatterns[State] = Closure(Cache.keys[State], true, false, Cache);
+    }
+
+    return Cache.endPatterns[State];
+}
+
+uint32_t RegexMatcher::Closure(const string& Key, bool IsLineEnd, bool IsNextWord, DfaCache& Cache) const
+{
+    const vector<RegexProgram::Instruction>& instructions = _program.instructions();
+    const uint8_t                            flags = static_cast<uint8_t>(Key[0]);
+    const bool                               isLineStart = (0 != (flags & PREV_LINE));
+    const bool                               isPrevWord = (0 != (flags & PREV_WORD));
+    uint32_t                                 pattern = NO_PATTERN;
+
+    if (0 == ++Cache.generation)
+    {
+        fill(Cache.visited.begin(), Cache.visited.end(), 0);
+        Cache.generation = 1;
+    }
+
+    Cache.stack.resize( (Key.size() - 1) / sizeof(uint32_t) );
+    Cache.byteInstructions.clear();
+
+    if ( !Cache.stack.empty() )
+    {
+        memcpy( Cache.stack.data(), Key.data() + 1, Key.size() - 1 );
+    }
+
+    if (0 == (flags & ANCHORED))
+    {
+        Cache.stack.push_back( _program.start() );
+    }
+
+    while ( !Cache.stack.empty() )
+    {
+        const uint32_t instruction = Cache.stack.back();
+
+        Cache.stack.pop_back();
+
+        if (Cache.visited[instruction] == Cache.generation)
+        {
+            continue;
+        }
+
+        Cache.visited[instruction] = Cache.generation;
+
+        const RegexProgram::Instruction& current = instructions[instruction];
+
+        switch (current.opcode)
+        {
+        case RegexProgram::BYTES:
+        {
+            Cache.byteInstructions.push_back(instruction);
+            break;
+        }
+        case RegexProgram::SPLIT:
+        {
+            Cache.stack.push_back(current.alternative);
+            Cache.stack.push_back(current.next);
+            break;
+        }
+        case RegexProgram::ASSERT:
+        {
+            const bool holds = (RegexProgram::LINE_START == current.argument) ? isLineStart :
+                               (RegexProgram::LINE_END == current.argument) ? IsLineEnd :
+                               (RegexProgram::WORD_BOUNDARY == current.argument) ? (isPrevWord != IsNextWord) :
+                               (isPrevWord == IsNextWord);
+
+            if (holds)
+            {
+                Cache.stack.push_back(current.next);
+            }
+
+            break;
+        }
+        case RegexProgram::MATCH:
+        {
+            pattern = min(pattern, current.argument);
+            break;
+        }
+        }
+    }
+
+    return pattern;
+}
+
+string RegexMatcher::Key(uint8_t Flags, const vector<uint32_t>& Instructions) const
+{
+    uint8_t flags = Flags & _flagMask;
+
+    // every dead state is the same
+    if ( (0 != (flags & ANCHORED)) && Instructions.empty() )
+    {
+        flags = ANCHORED;
+    }
+
+    string key( 1 + Instructions.size() * sizeof(uint32_t), static_cast<char>(flags) );
+
+    if ( !Instructions.empty() )
+    {
+        memcpy( &key[1], Instructions.data(), Instructions.size() * sizeof(uint32_t) );
+    }
+
+    return key;
+}
+
+uint32_t RegexMatcher::Intern(const string& Key, DfaCache& Cache) const
+{
+    const auto found = Cache.states.find(Key);
+
+    if ( found != Cache.states.end() )
+    {
+        return found->second;
+    }
+
+    const uint32_t state = static_cast<uint32_t>( Cache.keys.size() );
+
+    Cache.keys.push_back(Key);
+    Cache.states.emplace(Key, state);
+    Cache.transitions.resize(Cache.transitions.size() + _program.numClasses(), UNKNOWN);
+    Cache.matchPatterns.resize(Cache.matchPatterns.size() + _program.numClasses(), NO_PATTERN);
+    Cache.endPatterns.push_back(UNKNOWN);
+
+    return state;
+}
+
+void RegexMatcher::Reset(DfaCache& Cache) const
+{
+    Cache.transitions.clear();
+    Cache.matchPatterns.clear();
+    Cache.endPatterns.clear();
+    Cache.keys.clear();
+    Cache.states.clear();
+    fill(begin(Cache.startStates), end(Cache.startStates), UNKNOWN);
+    Cache.maxStates = max<size_t>(REGEX_CACHE_ENTRIES / _program.numClasses(), 16);
+
+    // state 0
+    Intern(Key(ANCHORED, {}), Cache);
+}
+
+unique_ptr<RegexMatcher::DfaCache> RegexMatcher::AcquireCache() const
+{
+    {
+        lock_guard<mutex> lock(_cachesMutex);
+
+        if ( !_caches.empty() )
+        {
+            unique_ptr<DfaCache> cache = std::move( _caches.back() );
+
+            _caches.pop_back();
+            return cache;
+        }
+    }
+
+    unique_ptr<DfaCache> cache = make_unique<DfaCache>();
+
+    cache->visited.assign(_program.instructions().size(), 0);
+    cache->generation = 0;
+    cache->scannedBytes = 0;
+    Reset(*cache);
+
+    return cache;
+}
+
+void RegexMatcher::ReleaseCache(unique_ptr<DfaCache> Cache) const
+{
+    lock_guard<mutex> lock(_cachesMutex);
+
+    _caches.push_back( std::move(Cache) );
+}
@@ -0,0 +1,1181 @@
+#include "regexprogram.h"
+#include "casefolding.h"
+
+#include <map>
+#include <algorithm>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+    constexpr uint32_t NO_NODE = UINT32_MAX;
+    constexpr uint32_t UNBOUNDED_REPEAT = UINT32_MAX;
+    constexpr size_t   UNBOUNDED_SIZE = SIZE_MAX;
+    constexpr uint32_t ANALYSED_COPIES = 16;  // copies of a repetition looked at for literals
+    constexpr size_t   MAX_LITERAL_RUN = 16;  // bytes of the literals looked for inside a concatenation
+
+    bitset<256> RangeSet(unsigned First, unsigned Last)
+    {
+        bitset<256> set{};
+
+        for (unsigned byte = First; byte <= Last; ++byte)
+        {
+            set.set(byte);
+        }
+
+        return set;
+    }
+
+    bitset<256> DigitSet()
+    {
+        return RangeSet('0', '9');
+    }
+
+    bitset<256> WordSet()
+    {
+        return RangeSet('0', '9') | RangeSet('A', 'Z') | RangeSet('a', 'z') | RangeSet('_', '_');
+    }
+
+    bitset<256> SpaceSet()
+    {
+        // space, \t, \n, \v, \f and \r
+        return RangeSet(' ', ' ') | RangeSet('\t', '\r');
+    }
+
+    // Adds the other case of every letter of Set
+    bitset<256> WithBothCases(bitset<256> Set)
+    {
+        for (unsigned byte = 'A'; byte <= 'Z'; ++byte)
+        {
+            if ( Set[byte] || Set[byte | 0x20] )
+            {
+                Set.set(byte);
+                Set.set(byte | 0x20);
+            }
+        }
+
+        return Set;
+    }
+
+    bool IsDigit(char Byte)
+    {
+        return (Byte >= '0') && (Byte <= '9');
+    }
+
+    int HexValue(char Byte)
+    {
+        if ( IsDigit(Byte) )
+        {
+            return Byte - '0';
+        }
+
+        const char lower = FoldCase(Byte);
+
+        return ( (lower >= 'a') && (lower <= 'f') ) ? lower - 'a' + 10 : -1;
+    }
+
+    size_t AddSizes(size_t Lhs, size_t Rhs)
+    {
+        return (Lhs > UNBOUNDED_SIZE - Rhs) ? UNBOUNDED_SIZE : Lhs + Rhs;
+    }
+
+    size_t MultiplySize(size_t Size, uint32_t Count)
+    {
+        return ( (0 != Count) && (Size > UNBOUNDED_SIZE / Count) ) ? UNBOUNDED_SIZE : Size * Count;
+    }
+}
+
+class RegexProgram::Compiler
+{
+public:
+    // What a syntax tree matches, as far as the search is concerned
+    struct Analysis
+    {
+        size_t              minSize;
+        size_t              maxSize;   // UNBOUNDED_SIZE without bound
+        // every string the tree matches, when there are few of them
+        bool                isExact;
+        std::vector<string> exact;
+        // every match contains one of them (none if empty), starting at most offset bytes after its start
+        std::vector<string> required;
+        size_t              offset;
+    };
+
+    Compiler(RegexProgram& Program, bool IgnoreCase);
+
+    // Parses Pattern into a syntax tree; returns its root, or NO_NODE with the reason in Error
+    uint32_t Parse(const string& Pattern, string& Error);
+
+    Analysis Analyse(uint32_t Index) const;
+
+    // Emits the instructions of a syntax tree continuing at Next; returns its first instruction, or
+    // NO_NODE once the program is too large
+    uint32_t Emit(uint32_t Index, uint32_t Next);
+
+private:
+    enum NodeKind
+    {
+        EMPTY,
+        BYTES,
+        ASSERTION,
+        CONCATENATION,
+        ALTERNATION,
+        REPETITION
+    };  // Used by Node
+
+    struct Node
+    {
+        NodeKind         kind;
+        uint32_t         argument;  // set or assertion
+        uint32_t         min;
+        uint32_t         max;
+        vector<uint32_t> children;
+    };
+
+    uint32_t AddNode(NodeKind Kind, uint32_t Argument = 0, uint32_t Min = 0, uint32_t Max = 0);
+
+    // Adds the node of a byte set, with both cases of its letters when ignoring case
+    uint32_t AddBytes(const bitset<256>& Set);
+
+    uint32_t ParseAlternation(int Depth);
+
+    uint32_t ParseConcatenation(int Depth);
+
+    uint32_t ParseRepetition(int Depth);
+
+    uint32_t ParseAtom(int Depth);
+
+    // After '['
+    uint32_t ParseSet();
+
+    // After '\': a byte set (Byte is set when it holds a single byte) or, outside sets, an assertion
+    bool ParseEscape(bool InSet, bitset<256>& Set, int& Byte, int& Assertion);
+
+    // {n}, {n,} or {n,m}; leaves the position unchanged if there is none (the brace is then a literal)
+    bool ParseCount(uint32_t& Min, uint32_t& Max);
+
+    bool ParseNumber(uint32_t& Value);
+
+    // Records the reason why the pattern is invalid; returns NO_NODE
+    uint32_t Fail(const string& Reason);
+
+    bool AtEnd() const;
+
+    char Peek() const;
+
+    // All concatenations of a string of Lhs and a string of Rhs; false if there are too many of them
+    static bool Cross(const vector<string>& Lhs, const vector<string>& Rhs, vector<string>& Product);
+
+    // Keeps Candidate as the required literals of Result if they are more selective
+    static void Choose(const vector<string>& Candidate, size_t Offset, Analysis& Result);
+
+    static Analysis Concatenate(const Analysis& Lhs, const Analysis& Rhs);
+
+    RegexProgram& _program;
+    bool          _ignoreCase;
+    vector<Node>  _nodes;
+    string        _pattern;
+    size_t        _position;
+    string        _error;
+};
+
+RegexProgram::Compiler::Compiler(RegexProgram& Program, bool IgnoreCase) : _program{ Program }, _ignoreCase{ IgnoreCase },
+    _nodes{}, _pattern{}, _position{ 0 }, _error{}
+{
+}
+
+uint32_t RegexProgram::Compiler::Parse(const string& Pattern, string& Error)
+{
+    _nodes.clear();
+    _pattern = Pattern;
+    _position = 0;
+    _error.clear();
+
+    uint32_t root = ParseAlternation(0);
+
+    // only a closing parenthesis stops the top level alternation early
+    if ( (NO_NODE != root) && !AtEnd() )
+    {
+        root = Fail("Unmatched )");
+    }
+
+    if (NO_NODE == root)
+    {
+        Error = _error;
+    }
+
+    return root;
+}
+
+uint32_t RegexProgram::Compiler::AddNode(NodeKind Kind, uint32_t Argument, uint32_t Min, uint32_t Max)
+{
+    _nodes.push_back({ Kind, Argument, Min, Max, {} });
+
+    return static_cast<uint32_t>(_nodes.size() - 1);
+}
+
+uint32_t RegexProgram::Compiler::AddBytes(const bitset<256>& Set)
+{
+    return AddNode( BYTES, _program.AddSet( _ignoreCase ? WithBothCases(Set) : Set ) );
+}
+
+uint32_t RegexProgram::Compiler::ParseAlternation(int Depth)
+{
+    const uint32_t first = ParseConcatenation(Depth);
+
+    if ( (NO_NODE == first) || AtEnd() || ('|' != Peek()) )
+    {
+        return first;
+    }
+
+    const uint32_t alternation = AddNode(ALTERNATION);
+
+    _nodes[alternation].children.push_back(first);
+
+    while ( !AtEnd() && ('|' == Peek()) )
+    {
+        ++_position;
+
+        const uint32_t branch = ParseConcatenation(Depth);
+
+        if (NO_NODE == branch)
+        {
+            return NO_NODE;
+        }
+
+        _nodes[alternation].children.push_back(branch);
+    }
+
+    return alternation;
+}
+
+uint32_t RegexProgram::Compiler::ParseConcatenation(int Depth)
+{
+    const uint32_t concatenation = AddNode(CONCATENATION);
+
+    // empty: matches the empty string
+    while ( !AtEnd() && ('|' != Peek()) && (')' != Peek()) )
+    {
+        const uint32_t item = ParseRepetition(Depth);
+
+        if (NO_NODE == item)
+        {
+            return NO_NODE;
+        }
+
+        _nodes[concatenation].children.push_back(item);
+    }
+
+    return concatenation;
+}
+
+uint32_t RegexProgram::Compiler::ParseRepetition(int Depth)
+{
+    uint32_t item = ParseAtom(Depth);
+
+    while ( (NO_NODE != item) && !AtEnd() )
+    {
+        uint32_t min = 0;
+        uint32_t max = UNBOUNDED_REPEAT;
+
+        if ('*' == Peek())
+        {
+            ++_position;
+        }
+        else if ('+' == Peek())
+        {
+            ++_position;
+            min = 1;
+        }
+        else if ('?' == Peek())
+        {
+            ++_position;
+            max = 1;
+        }
+        else if ( ('{' != Peek()) || !ParseCount(min, max) )
+        {
+            break;
+        }
+
+        if ( (min > REGEX_MAX_REPEAT) || ( (UNBOUNDED_REPEAT != max) && (max > REGEX_MAX_REPEAT) ) )
+        {
+            return Fail("Repetition larger than " + to_string(REGEX_MAX_REPEAT));
+        }
+
+        if ( (UNBOUNDED_REPEAT != max) && (min > max) )
+        {
+            return Fail("Invalid repetition {n,m}: n is larger than m");
+        }
+
+        const uint32_t repetition = AddNode(REPETITION, 0, min, max);
+
+        _nodes[repetition].children.push_back(item);
+        item = repetition;
+    }
+
+    return item;
+}
+
+uint32_t RegexProgram::Compiler::ParseAtom(int Depth)
+{
+    const char byte = _pattern[_position++];
+
+    switch (byte)
+    {
+    case '(':
+    {
+        if (Depth >= REGEX_MAX_DEPTH)
+        {
+            return Fail("Groups nested deeper than " + to_string(REGEX_MAX_DEPTH));
+        }
+
+        if ( !AtEnd() && ('?' == Peek()) )
+        {
+            if ( (_position + 1 >= _pattern.size()) || (':' != _pattern[_position + 1]) )
+            {
+                return Fail("Unsupported group (only (?: ) is)");
+            }
+
+            _position += 2;
+        }
+
+        const uint32_t group = ParseAlternation(Depth + 1);
+
+        if (NO_NODE == group)
+        {
+            return NO_NODE;
+        }
+
+        if ( AtEnd() )
+        {
+            return Fail("Missing )");
+        }
+
+        ++_position;
+
+        return group;
+    }
+    case '[':
+    {
+        return ParseSet();
+    }
+    case '.':
+    {
+        bitset<256> set{};
+
+        set.set();
+        set.reset('\n');
+
+        return AddBytes(set);
+    }
+    case '^':
+    case '$':
+    {
+        _program._hasLineAssertions = true;
+
+        return AddNode( ASSERTION, ('^' == byte) ? LINE_START : LINE_END );
+    }
+    case '*':
+    case '+':
+    case '?':
+    {
+        --_position;
+
+        return Fail("Nothing to repeat");
+    }
+    case '\\':
+    {
+        bitset<256> set{};
+        int         single = -1;
+        int         assertion = -1;
+
+        if ( !ParseEscape(false, set, single, assertion) )
+        {
+            return NO_NODE;
+        }
+
+        if (assertion >= 0)
+        {
+            _program._hasWordAssertions = true;
+
+            return AddNode( ASSERTION, static_cast<uint32_t>(assertion) );
+        }
+
+        return AddBytes(set);
+    }
+    default:
+    {
+        bitset<256> set{};
+
+        set.set( static_cast<unsigned char>(byte) );
+
+        return AddBytes(set);
+    }
+    }
+}
+
+uint32_t RegexProgram::Compiler::ParseSet()
+{
+    bitset<256> set{};
+    bool        isNegated = false;
+    bool        isFirst = true;
+
+    if ( !AtEnd() && ('^' == Peek()) )
+    {
+        isNegated = true;
+        ++_position;
+    }
+
+    while (true)
+    {
+        if ( AtEnd() )
+        {
+            return Fail("Missing ]");
+        }
+
+        const char byte = _pattern[_position++];
+
+        // a leading ] is a literal
+        if ( (']' == byte) && !isFirst )
+        {
+            break;
+        }
+
+        bitset<256> item{};
+        int         low = static_cast<unsigned char>(byte);
+        int         assertion = -1;
+
+        isFirst = false;
+
+        if ( ('\\' == byte) && !ParseEscape(true, item, low, assertion) )
+        {
+            return NO_NODE;
+        }
+
+        // ranges go from a single byte to a single byte; a trailing - is a literal
+        if ( (low >= 0) && (_position + 1 < _pattern.size()) && ('-' == Peek()) && (']' != _pattern[_position + 1]) )
+        {
+            const char last = _pattern[++_position];
+            int        high = static_cast<unsigned char>(last);
+            bitset<256> highItem{};
+
+            ++_position;
+
+            if ( ('\\' == last) && !ParseEscape(true, highItem, high, assertion) )
+            {
+                return NO_NODE;
+            }
+
+            if ( (high < 0) || (high < low) )
+            {
+                return Fail("Invalid range in []");
+            }
+
+            item = RangeSet(static_cast<unsigned>(low), static_cast<unsigned>(high));
+        }
+        else if ('\\' != byte)
+        {
+            item.set(static_cast<unsigned>(low));
+        }
+
+        set |= item;
+    }
+
+    // both cases before the complement: ignoring case, [^a] matches neither a nor A
+    if (_ignoreCase)
+    {
+        set = WithBothCases(set);
+    }
+
+    if (isNegated)
+    {
+        set.flip();
+    }
+
+    return AddNode( BYTES, _program.AddSet(set) );
+}
+
+bool RegexProgram::Compiler::ParseEscape(bool InSet, bitset<256>& Set, int& Byte, int& Assertion)
+{
+    if ( AtEnd() )
+    {
+        Fail("Trailing \\");
+        return false;
+    }
+
+    const char escaped = _pattern[_position++];
+
+    Byte = -1;
+    Set.reset();
+
+    switch (escaped)
+    {
+    case 'd': Set = DigitSet();  break;
+    case 'D': Set = ~DigitSet(); break;
+    case 'w': Set = WordSet();   break;
+    case 'W': Set = ~WordSet();  break;
+    case 's': Set = SpaceSet();  break;
+    case 'S': Set = ~SpaceSet(); break;
+    case 't': Byte = '\t';       break;
+    case 'n': Byte = '\n';       break;
+    case 'r': Byte = '\r';       break;
+    case 'f': Byte = '\f';       break;
+    case 'v': Byte = '\v';       break;
+    case 'x':
+    {
+        const int high = (_position < _pattern.size()) ? HexValue(_pattern[_position]) : -1;
+        const int low = (_position + 1 < _pattern.size()) ? HexValue(_pattern[_position + 1]) : -1;
+
+        if ( (high < 0) || (low < 0) )
+        {
+            Fail("Invalid \\x escape (two hexadecimal digits expected)");
+            return false;
+        }
+
+        _position += 2;
+        Byte = high * 16 + low;
+        break;
+    }
+    case 'b':
+    case 'B':
+    {
+        if (InSet)
+        {
+            Fail("Word boundary inside []");
+            return false;
+        }
+
+        Assertion = ('b' == escaped) ? WORD_BOUNDARY : NOT_WORD_BOUNDARY;
+        return true;
+    }
+    default:
+    {
+        // letters and digits are kept for escapes to come
+        if ( IsAsciiLetter(escaped) || IsDigit(escaped) )
+        {
+            Fail( string("Unknown escape \\") + escaped );
+            return false;
+        }
+
+        Byte = static_cast<unsigned char>(escaped);
+        break;
+    }
+    }
+
+    if (Byte >= 0)
+    {
+        Set.set( static_cast<unsigned>(Byte) );
+    }
+
+    return true;
+}
+
+bool RegexProgram::Compiler::ParseCount(uint32_t& Min, uint32_t& Max)
+{
+    const size_t start = _position++;
+
+    if ( ParseNumber(Min) )
+    {
+        Max = Min;
+
+        if ( !AtEnd() && (',' == Peek()) )
+        {
+            ++_position;
+            Max = UNBOUNDED_REPEAT;
+
+            if ( !AtEnd() && IsDigit( Peek() ) )
+            {
+                ParseNumber(Max);
+            }
+        }
+
+        if ( !AtEnd() && ('}' == Peek()) )
+        {
+            ++_position;
+            return true;
+        }
+    }
+
+    _position = start;
+
+    return false;
+}
+
+bool RegexProgram::Compiler::ParseNumber(uint32_t& Value)
+{
+    const size_t start = _position;
+
+    Value = 0;
+
+    while ( !AtEnd() && IsDigit( Peek() ) )
+    {
+        // saturated: only compared with REGEX_MAX_REPEAT
+        Value = min<uint32_t>(Value * 10 + static_cast<uint32_t>(Peek() - '0'), REGEX_MAX_REPEAT + 1);
+        ++_position;
+    }
+
+    return (_position != start);
+}
+
+uint32_t RegexProgram::Compiler::Fail(const string& Reason)
+{
+    _error = Reason + " at offset " + to_string(_position);
+
+    return NO_NODE;
+}
+
+bool RegexProgram::Compiler::AtEnd() const
+{
+    return ( _position >= _pattern.size() );
+}
+
+char RegexProgram::Compiler::Peek() const
+{
+    return _pattern[_position];
+}
+
+RegexProgram::Compiler::Analysis RegexProgram::Compiler::Analyse(uint32_t Index) const
+{
+    const Node& node = _nodes[Index];
+    Analysis    result{ 0, 0, true, { "" }, {}, 0 };
+
+    switch (node.kind)
+    {
+    case EMPTY:
+    case ASSERTION:
+    {
+        break;
+    }
+    case BYTES:
+    {
+        const bitset<256>& set = _program._sets[node.argument];
+
+        result.minSize = 1;
+        result.maxSize = 1;
+        result.exact.clear();
+
+        for (unsigned byte = 0; result.isExact && (byte < 256); ++byte)
+        {
+            const string literal( 1, _ignoreCase ? FoldCase( static_cast<char>(byte) ) : static_cast<char>(byte) );
+
+            if ( set[byte] && ( find(result.exact.begin(), result.exact.end(), literal) == result.exact.end() ) )
+            {
+                result.exact.push_back(literal);
+                result.isExact = (result.exact.size() <= REGEX_MAX_LITERALS);
+            }
+        }
+
+        if (result.isExact)
+        {
+            Choose(result.exact, 0, result);
+        }
+        else
+        {
+            result.exact.clear();
+        }
+
+        break;
+    }
+    case CONCATENATION:
+    {
+        vector<Analysis> children{};
+        size_t           offset = 0;
+
+        for (auto&& child : node.children)
+        {
+            children.push_back( Analyse(child) );
+            result = Concatenate( result, children.back() );
+        }
+
+        // literals starting inside the concatenation, e.g. "error" in "(fatal )?error"
+        for (size_t first = 0; first < children.size(); ++first)
+        {
+            Analysis run{ 0, 0, true, { "" }, {}, 0 };
+
+            for (size_t last = first; (last < children.size()) && children[last].isExact && (run.minSize < MAX_LITERAL_RUN);
+                 ++last)
+            {
+                run = Concatenate(run, children[last]);
+
+                if (!run.isExact)
+                {
+                    break;
+                }
+
+                Choose(run.exact, offset, result);
+            }
+
+            offset = AddSizes(offset, children[first].maxSize);
+        }
+
+        break;
+    }
+    case ALTERNATION:
+    {
+        vector<string> required{};
+        size_t         offset = 0;
+        bool           hasRequired = true;
+
+        result.minSize = UNBOUNDED_SIZE;
+        result.exact.clear();
+
+        // a literal of every branch
+        for (auto&& child : node.children)
+        {
+            const Analysis branch = Analyse(child);
+
+            result.minSize = min(result.minSize, branch.minSize);
+            result.maxSize = max(result.maxSize, branch.maxSize);
+            result.isExact = result.isExact && branch.isExact;
+            result.exact.insert( result.exact.end(), branch.exact.begin(), branch.exact.end() );
+            hasRequired = hasRequired && !branch.required.empty();
+            required.insert( required.end(), branch.required.begin(), branch.required.end() );
+            offset = max(offset, branch.offset);
+        }
+
+        sort( result.exact.begin(), result.exact.end() );
+        result.exact.erase( unique( result.exact.begin(), result.exact.end() ), result.exact.end() );
+        sort( required.begin(), required.end() );
+        required.erase( unique( required.begin(), required.end() ), required.end() );
+
+        result.isExact = result.isExact && (result.exact.size() <= REGEX_MAX_LITERALS);
+
+        if ( hasRequired && (required.size() <= REGEX_MAX_LITERALS) )
+        {
+            Choose(required, offset, result);
+        }
+
+        if (result.isExact)
+        {
+            Choose(result.exact, 0, result);
+        }
+        else
+        {
+            result.exact.clear();
+        }
+
+        break;
+    }
+    case REPETITION:
+    {
+        const Analysis child = Analyse( node.children.front() );
+        Analysis       prefix = result;
+
+        result.minSize = MultiplySize(child.minSize, node.min);
+        result.maxSize = (UNBOUNDED_REPEAT != node.max) ? MultiplySize(child.maxSize, node.max) :
+                         (0 == child.maxSize) ? 0 : UNBOUNDED_SIZE;
+
+        // the first copies start every match: their literals are required
+        for (uint32_t copy = 0; copy < min(node.min, ANALYSED_COPIES); ++copy)
+        {
+            prefix = Concatenate(prefix, child);
+        }
+
+        result.required = prefix.required;
+        result.offset = prefix.offset;
+
+        if ( (node.min == node.max) && (node.min <= ANALYSED_COPIES) )
+        {
+            result.isExact = prefix.isExact;
+            result.exact = prefix.exact;
+        }
+        else if ( (0 == node.min) && (1 == node.max) && child.isExact )
+        {
+            result.exact = child.exact;
+
+            if ( find(result.exact.begin(), result.exact.end(), "") == result.exact.end() )
+            {
+                result.exact.push_back("");
+            }
+
+            result.isExact = (result.exact.size() <= REGEX_MAX_LITERALS);
+        }
+        else
+        {
+            result.isExact = false;
+        }
+
+        if (!result.isExact)
+        {
+            result.exact.clear();
+        }
+
+        break;
+    }
+    }
+
+    return result;
+}
+
+bool RegexProgram::Compiler::Cross(const vector<string>& Lhs, const vector<string>& Rhs, vector<string>& Product)
+{
+    Product.clear();
+
+    if (Lhs.size() * Rhs.size() > REGEX_MAX_LITERALS)
+    {
+        return false;
+    }
+
+    for (auto&& lhs : Lhs)
+    {
+        for (auto&& rhs : Rhs)
+        {
+            Product.push_back(lhs + rhs);
+        }
+    }
+
+    sort( Product.begin(), Product.end() );
+    Product.erase( unique( Product.begin(), Product.end() ), Product.end() );
+
+    return true;
+}
+
+void RegexProgram::Compiler::Choose(const vector<string>& Candidate, size_t Offset, Analysis& Result)
+{
+    const auto shortest = [](const vector<string>& Literals)
+                          {
+                              size_t size = UNBOUNDED_SIZE;
+
+                              for (auto&& literal : Literals)
+                              {
+                                  size = min( size, literal.size() );
+                              }
+
+                              return size;
+                          };
+
+    const size_t candidateSize = shortest(Candidate);
+    const size_t currentSize = shortest(Result.required);
+
+    // an empty literal is found everywhere; then the longest shortest literal, the fewest literals,
+    // the closest to the start of the match
+    if ( Candidate.empty() || (0 == candidateSize) )
+    {
+        return;
+    }
+
+    if ( Result.required.empty() || (candidateSize > currentSize) ||
+         ( (candidateSize == currentSize) && ( (Candidate.size() < Result.required.size()) ||
+           ( (Candidate.size() == Result.required.size()) && (Offset < Result.offset) ) ) ) )
+    {
+        Result.required = Candidate;
+        Result.offset = Offset;
+    }
+}
+
+RegexProgram::Compiler::Analysis RegexProgram::Compiler::Concatenate(const Analysis& Lhs, const Analysis& Rhs)
+{
+    Analysis result{ AddSizes(Lhs.minSize, Rhs.minSize), AddSizes(Lhs.maxSize, Rhs.maxSize), false, {}, Lhs.required,
+                     Lhs.offset };
+
+    result.isExact = Lhs.isExact && Rhs.isExact && Cross(Lhs.exact, Rhs.exact, result.exact);
+
+    if (!result.isExact)
+    {
+        result.exact.clear();
+    }
+
+    // literals of the right side are further by the longest match of the left side
+    Choose( Rhs.required, AddSizes(Lhs.maxSize, Rhs.offset), result );
+
+    if (result.isExact)
+    {
+        Choose(result.exact, 0, result);
+    }
+
+    return result;
+}
+
+uint32_t RegexProgram::Compiler::Emit(uint32_t Index, uint32_t Next)
+{
+    if (_program._instructions.size() >= REGEX_MAX_INSTRUCTIONS)
+    {
+        return NO_NODE;
+    }
+
+    const Node& node = _nodes[Index];
+    uint32_t    entry = Next;
+
+    switch (node.kind)
+    {
+    case EMPTY:
+    {
+        break;
+    }
+    case BYTES:
+    {
+        entry = _program.AddInstruction(RegexProgram::BYTES, Next, 0, node.argument);
+        break;
+    }
+    case ASSERTION:
+    {
+        entry = _program.AddInstruction(ASSERT, Next, 0, node.argument);
+        break;
+    }
+    case CONCATENATION:
+    {
+        // emitted backwards: every item continues at the next one
+        for (size_t i = node.children.size(); (NO_NODE != entry) && (i > 0); --i)
+        {
+            entry = Emit(node.children[i - 1], entry);
+        }
+
+        break;
+    }
+    case ALTERNATION:
+    {
+        entry = Emit(node.children.back(), Next);
+
+        for (size_t i = node.children.size() - 1; (NO_NODE != entry) && (i > 0); --i)
+        {
+            const uint32_t branch = Emit(node.children[i - 1], Next);
+
+            entry = (NO_NODE != branch) ? _program.AddInstruction(SPLIT, branch, entry, 0) : NO_NODE;
+        }
+
+        break;
+    }
+    case REPETITION:
+    {
+        const uint32_t child = node.children.front();
+
+        if (UNBOUNDED_REPEAT == node.max)
+        {
+            // loop: the body continues at the split
+            const uint32_t loop = _program.AddInstruction(SPLIT, 0, Next, 0);
+            const uint32_t body = Emit(child, loop);
+
+            _program._instructions[loop].next = body;
+            entry = (NO_NODE != body) ? loop : NO_NODE;
+        }
+        else
+        {
+            // optional copies, nested: x{0,2} is (x(x)?)?
+            for (uint32_t copy = node.min; (NO_NODE != entry) && (copy < node.max); ++copy)
+            {
+                const uint32_t body = Emit(child, entry);
+
+                entry = (NO_NODE != body) ? _program.AddInstruction(SPLIT, body, Next, 0) : NO_NODE;
+            }
+        }
+
+        for (uint32_t copy = 0; (NO_NODE != entry) && (copy < node.min); ++copy)
+        {
+            entry = Emit(child, entry);
+        }
+
+        break;
+    }
+    }
+
+    return entry;
+}
+
+RegexProgram::RegexProgram() : _instructions{}, _sets{}, _start{ 0 }, _byteClass{}, _numClasses{ 1 }, _classBytes{ 0 },
+    _hasLineAssertions{ false }, _hasWordAssertions{ false }, _maxMatchSize{ 0 }, _literals{}
+{
+}
+
+bool RegexProgram::Compile(const vector<string>& Patterns, bool IgnoreCase, string& Error)
+{
+    Compiler            compiler(*this, IgnoreCase);
+    vector<uint32_t>    entries{};
+    map<string, size_t> literals{};
+    bool                hasLiterals = true;
+
+    _instructions.clear();
+    _sets.clear();
+    _literals.clear();
+    _hasLineAssertions = false;
+    _hasWordAssertions = false;
+    _maxMatchSize = 0;
+
+    if ( Patterns.empty() )
+    {
+        Error = "No pattern";
+        return false;
+    }
+
+    for (size_t i = 0; i < Patterns.size(); ++i)
+    {
+        const uint32_t root = compiler.Parse(Patterns[i], Error);
+
+        if (NO_NODE == root)
+        {
+            return false;
+        }
+
+        const Compiler::Analysis analysis = compiler.Analyse(root);
+
+        if (0 == analysis.minSize)
+        {
+            Error = "It matches the empty string";
+            return false;
+        }
+
+        _maxMatchSize = max( _maxMatchSize, min(analysis.maxSize, REGEX_MAX_MATCH_SIZE) );
+        hasLiterals = hasLiterals && !analysis.required.empty();
+
+        for (auto&& literal : analysis.required)
+        {
+            size_t& offset = literals[literal];
+
+            offset = max( offset, min(analysis.offset, REGEX_MAX_MATCH_SIZE) );
+        }
+
+        const uint32_t entry = compiler.Emit( root, AddInstruction( MATCH, 0, 0, static_cast<uint32_t>(i) ) );
+
+        if (NO_NODE == entry)
+        {
+            Error = "It is too large once its repetitions are expanded";
+            return false;
+        }
+
+        entries.push_back(entry);
+    }
+
+    // tries every pattern
+    _start = entries.back();
+
+    for (size_t i = entries.size() - 1; i > 0; --i)
+    {
+        _start = AddInstruction(SPLIT, entries[i - 1], _start, 0);
+    }
+
+    BuildByteClasses();
+
+    if (hasLiterals)
+    {
+        for (auto&& literal : literals)
+        {
+            _literals.push_back({ literal.first, literal.second });
+        }
+    }
+
+    return true;
+}
+
+bool RegexProgram::Validate(const string& Pattern, string& Error)
+{
+    RegexProgram program{};
+
+    return program.Compile({ Pattern }, false, Error);
+}
+
+bool RegexProgram::IsWordByte(uint8_t Byte)
+{
+    return IsAsciiLetter( static_cast<char>(Byte) ) || IsDigit( static_cast<char>(Byte) ) || ('_' == Byte);
+}
+
+const vector<RegexProgram::Instruction>& RegexProgram::instructions() const
+{
+    return _instructions;
+}
+
+uint32_t RegexProgram::start() const
+{
+    return _start;
+}
+
+bool RegexProgram::Contains(uint32_t Set, uint8_t Byte) const
+{
+    return _sets[Set][Byte];
+}
+
+uint16_t RegexProgram::byteClass(uint8_t Byte) const
+{
+    return _byteClass[Byte];
+}
+
+uint16_t RegexProgram::numClasses() const
+{
+    return _numClasses;
+}
+
+uint8_t RegexProgram::classByte(uint16_t Class) const
+{
+    return _classBytes[Class];
+}
+
+bool RegexProgram::hasLineAssertions() const
+{
+    return _hasLineAssertions;
+}
+
+bool RegexProgram::hasWordAssertions() const
+{
+    return _hasWordAssertions;
+}
+
+size_t RegexProgram::maxMatchSize() const
+{
+    return _maxMatchSize;
+}
+
+const vector<RegexProgram::Literal>& RegexProgram::literals() const
+{
+    return _literals;
+}
+
+uint32_t RegexProgram::AddSet(const bitset<256>& Set)
+{
+    _sets.push_back(Set);
+
+    return static_cast<uint32_t>(_sets.size() - 1);
+}
+
+uint32_t RegexProgram::AddInstruction(Opcode Code, uint32_t Next, uint32_t Alternative, uint32_t Argument)
+{
+    _instructions.push_back({ Code, Next, Alternative, Argument });
+
+    return static_cast<uint32_t>(_instructions.size() - 1);
+}
+
+void RegexProgram::BuildByteClasses()
+{
+    unordered_set< bitset<256> > splits( _sets.begin(), _sets.end() );
+    uint16_t                     renumbered[512];
+
+    // assertions look at the bytes around them
+    if (_hasLineAssertions)
+    {
+        splits.insert( RangeSet('\n', '\n') );
+    }
+
+    if (_hasWordAssertions)
+    {
+        splits.insert( WordSet() );
+    }
+
+    fill(begin(_byteClass), end(_byteClass), 0);
+    _numClasses = 1;
+
+    // every set splits the classes into the bytes it holds and the others
+    for (auto&& split : splits)
+    {
+        uint16_t numClasses = 0;
+
+        fill(begin(renumbered), end(renumbered), UINT16_MAX);
+
+        for (unsigned byte = 0; byte < 256; ++byte)
+        {
+            uint16_t& byteClass = renumbered[_byteClass[byte] * 2 + (split[byte] ? 1 : 0)];
+
+            if (UINT16_MAX == byteClass)
+            {
+                byteClass = numClasses++;
+            }
+
+            _byteClass[byte] = byteClass;
+        }
+
+        _numClasses = numClasses;
+    }
+
+    _classBytes.assign(_numClasses, 0);
+
+    for (unsigned byte = 256; byte-- > 0; )
+    {
+        _classBytes[_byteClass[byte]] = static_cast<uint8_t>(byte);
+    }
+}
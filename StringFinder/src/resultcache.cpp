@@ -0,0 +1,380 @@
+#include "resultcache.h"
+#include "mappedfile.h"
+#include "encoding.h"
+#include "directorymanifest.h"
+
+#include <ctime>
+#include <tuple>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <termcolor/termcolor.hpp>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+    void AppendVarint(string& Bytes, uint64_t Value)
+    {
+        char buffer[MAX_VARINT_SIZE];
+
+        Bytes.append( buffer, EncodeVarint(Value, buffer) );
+    }
+
+    void AppendFixed(string& Bytes, uint64_t Value, size_t Size)
+    {
+        char buffer[sizeof(uint64_t)];
+
+        EncodeFixed(Value, buffer, Size);
+        Bytes.append(buffer, Size);
+    }
+
+    // 64 bit FNV-1a
+    uint64_t Hash(const string& Bytes)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+
+        for (auto&& byte : Bytes)
+        {
+            hash ^= static_cast<unsigned char>(byte);
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+}
+
+ResultCache::ResultCache(const fs::path& Directory, uint64_t MaxSize, const vector<string>& SearchStrings,
+                         bool IgnoreCase, bool IsRegex, SearchOptions::BinaryFiles BinaryFiles) :
+    _directory{ Directory }, _maxSize{ MaxSize }, _searchStringsKey{}, _hits{ 0 }, _misses{ 0 }, _writtenBytes{ 0 }
+{
+    AppendFixed(_searchStringsKey, AFFIX_SIZE, 4);
+    AppendVarint( _searchStringsKey, SearchStrings.size() );
+
+    for (auto&& searchString : SearchStrings)
+    {
+        AppendVarint( _searchStringsKey, searchString.size() );
+        _searchStringsKey += searchString;
+    }
+
+    // only marked when ignoring case, so the entries of case sensitive searches stay valid
+    if (IgnoreCase)
+    {
+        _searchStringsKey += 'i';
+    }
+
+    if (IsRegex)
+    {
+        _searchStringsKey += 'r';
+    }
+
+    // binary files skipped, or stored without affixes
+    if (SearchOptions::SEARCH_BINARY != BinaryFiles)
+    {
+        _searchStringsKey += (SearchOptions::SKIP_BINARY == BinaryFiles) ? 's' : 'n';
+    }
+}
+
+bool ResultCache::Open()
+{
+    error_code error;
+
+    fs::create_directories(_directory, error);
+
+    if ( error || !fs::is_directory(_directory, error) )
+    {
+        cout << red << "Cache directory: " << _directory << " cannot be used." << reset << endl;
+        return false;
+    }
+
+    return true;
+}
+
+string ResultCache::Key(const fs::path& File) const
+{
+    string key = File.u8string();
+
+    key.push_back('\0');
+
+#ifdef _WIN32
+    error_code     error;
+    const uint64_t size = fs::file_size(File, error);
+    const auto     lastWriteTime = fs::last_write_time(File, error);
+    const uint64_t writeTime = static_cast<uint64_t>( lastWriteTime.time_since_epoch().count() );
+
+    // may still change without its write time changing (a write time in the future is just as racy)
+    if ( error || (lastWriteTime + chrono::nanoseconds(RACY_WRITE_TIME) > fs::file_time_type::clock::now()) )
+    {
+        return string();
+    }
+
+    AppendFixed(key, size, 8);
+    AppendFixed(key, writeTime, 8);
+    AppendFixed(key, 0, 8);
+    AppendFixed(key, 0, 8);
+#else
+    struct stat status{};
+
+    timespec    now{};
+
+    if (0 != stat(File.c_str(), &status))
+    {
+        return string();
+    }
+
+    const uint64_t writeTime = static_cast<uint64_t>(status.st_mtim.tv_sec) * 1000000000 +
+                               static_cast<uint64_t>(status.st_mtim.tv_nsec);
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    // may still change without its write time changing (a write time in the future is just as racy)
+    if (writeTime + RACY_WRITE_TIME > static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec))
+    {
+        return string();
+    }
+
+    AppendFixed(key, static_cast<uint64_t>(status.st_size), 8);
+    AppendFixed(key, writeTime, 8);
+    AppendFixed(key, static_cast<uint64_t>(status.st_dev), 8);
+    AppendFixed(key, static_cast<uint64_t>(status.st_ino), 8);
+#endif
+
+    key += _searchStringsKey;
+
+    return key;
+}
+
+bool ResultCache::Lookup(const string& Key, StringData& Data)
+{
+    const fs::path entryPath = EntryPath(Key);
+    error_code     error;
+    MappedFile     entry{};
+
+    if ( !fs::exists(entryPath, error) || !entry.Open(entryPath) )
+    {
+        ++_misses;
+        return false;
+    }
+
+    const string_view contents = entry.contents();
+    const char*       data = contents.data() + CACHE_ENTRY_MAGIC.size();
+    const char*       end = contents.data() + contents.size();
+    uint64_t          keySize = 0;
+    uint64_t          matchCount = 0;
+    uint64_t          position = 0;
+    bool              isValid = (contents.substr(0, CACHE_ENTRY_MAGIC.size()) == CACHE_ENTRY_MAGIC) &&
+                                DecodeVarint(data, end, keySize) && (keySize <= static_cast<uint64_t>(end - data)) &&
+                                (string_view(data, static_cast<size_t>(keySize)) == Key);
+
+    if (isValid)
+    {
+        data += keySize;
+        isValid = DecodeVarint(data, end, matchCount);
+    }
+
+    Data = StringData();
+    Data.Reserve( static_cast<size_t>( min<uint64_t>(matchCount, contents.size()) ) );
+
+    for (uint64_t i = 0; isValid && (i < matchCount); ++i)
+    {
+        uint64_t delta = 0;
+        uint64_t searchString = 0;
+
+        isValid = DecodeVarint(data, end, delta) && DecodeVarint(data, end, searchString) && (data < end);
+
+        if (isValid)
+        {
+            const size_t prefixSize = static_cast<uint8_t>(*data) >> 4;
+            const size_t suffixSize = static_cast<uint8_t>(*data) & 0xF;
+
+            ++data;
+            isValid = (prefixSize <= AFFIX_SIZE) && (suffixSize <= AFFIX_SIZE) &&
+                      (static_cast<size_t>(end - data) >= prefixSize + suffixSize);
+
+            if (isValid)
+            {
+                position += delta;
+                Data.Add(position, static_cast<size_t>(searchString), string_view(data, prefixSize),
+                         string_view(data + prefixSize, suffixSize));
+                data += prefixSize + suffixSize;
+            }
+        }
+    }
+
+    if (!isValid)
+    {
+        // hash collision, or damaged entry: replaced by the next Store()
+        Data = StringData();
+        ++_misses;
+        return false;
+    }
+
+    Data.ShrinkToFit();
+
+    // most recently used
+    fs::last_write_time(entryPath, fs::file_time_type::clock::now(), error);
+    ++_hits;
+
+    return true;
+}
+
+void ResultCache::Store(const string& Key, const StringData& Data)
+{
+    const fs::path entryPath = EntryPath(Key);
+    fs::path       temporaryPath = entryPath;
+    string         bytes{ CACHE_ENTRY_MAGIC };
+    uint64_t       previousPosition = 0;
+    error_code     error;
+
+    AppendVarint( bytes, Key.size() );
+    bytes += Key;
+    AppendVarint( bytes, Data.size() );
+
+    for (size_t i = 0; i < Data.size(); ++i)
+    {
+        const StringData::AffixView affixes = Data.affixes(i);
+
+        AppendVarint(bytes, Data.position(i) - previousPosition);
+        AppendVarint( bytes, Data.searchString(i) );
+        bytes.push_back( static_cast<char>( (affixes.prefix.size() << 4) | affixes.suffix.size() ) );
+        bytes.append( affixes.prefix.data(), affixes.prefix.size() );
+        bytes.append( affixes.suffix.data(), affixes.suffix.size() );
+        previousPosition = Data.position(i);
+    }
+
+    // unique per run and per thread: entries are only ever replaced by a rename
+    static const uint64_t runId = ( static_cast<uint64_t>( random_device{}() ) << 32 ) | random_device{}();
+
+    temporaryPath += "." + to_string(runId) + "." + to_string( hash<thread::id>()( this_thread::get_id() ) ) + ".tmp";
+
+    fs::create_directories(entryPath.parent_path(), error);
+
+    {
+        ofstream entryStream(temporaryPath, ios::binary | ios::trunc);
+
+        entryStream.write( bytes.data(), static_cast<streamsize>( bytes.size() ) );
+
+        if ( !entryStream.good() )
+        {
+            entryStream.close();
+            fs::remove(temporaryPath, error);
+            return;
+        }
+    }
+
+    fs::rename(temporaryPath, entryPath, error);
+
+    if (error)
+    {
+        fs::remove(temporaryPath, error);
+        return;
+    }
+
+    _writtenBytes += bytes.size();
+}
+
+void ResultCache::Finish()
+{
+    const fs::path statePath = _directory / fs::path( string(CACHE_STATE_FILE) );
+    uint64_t       totalSize = 0;
+
+    // approximate size (replaced entries are counted twice): an eviction recomputes it
+    {
+        ifstream stateStream(statePath);
+
+        stateStream >> totalSize;
+    }
+
+    totalSize += _writtenBytes;
+
+    if (totalSize > _maxSize)
+    {
+        totalSize = Evict();
+    }
+
+    ofstream stateStream(statePath, ios::trunc);
+
+    stateStream << totalSize << '\n';
+}
+
+uint64_t ResultCache::hits() const
+{
+    return _hits;
+}
+
+uint64_t ResultCache::misses() const
+{
+    return _misses;
+}
+
+fs::path ResultCache::EntryPath(const string& Key) const
+{
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    const uint64_t        hash = Hash(Key);
+    string                name(16, '0');
+
+    for (size_t i = 0; i < name.size(); ++i)
+    {
+        name[i] = HEX_DIGITS[(hash >> (60 - 4 * i)) & 0xF];
+    }
+
+    // 256 subdirectories keep directories small
+    return _directory / fs::path( name.substr(0, 2) ) / fs::path(name);
+}
+
+uint64_t ResultCache::Evict()
+{
+    vector< tuple<fs::file_time_type, uint64_t, fs::path> > entries{};  // last use, size, path
+    uint64_t                                               totalSize = 0;
+    error_code                                             error;
+
+    for (fs::recursive_directory_iterator iter(_directory, error), end; !error && (iter != end); iter.increment(error))
+    {
+        const fs::path& entryPath = iter->path();
+
+        if ( (entryPath.filename().string().size() != 16) || !fs::is_regular_file(iter->status()) )
+        {
+            continue;
+        }
+
+        // removed meanwhile (e.g. by a concurrent eviction): skipped, the walk goes on
+        error_code     entryError;
+        const uint64_t size = fs::file_size(entryPath, entryError);
+
+        if (entryError)
+        {
+            continue;
+        }
+
+        const fs::file_time_type lastUse = fs::last_write_time(entryPath, entryError);
+
+        if (entryError)
+        {
+            continue;
+        }
+
+        entries.emplace_back(lastUse, size, entryPath);
+        totalSize += size;
+    }
+
+    sort(entries.begin(), entries.end());
+
+    const uint64_t targetSize = static_cast<uint64_t>(_maxSize * CACHE_EVICTION_TARGET);
+
+    for (size_t i = 0; (i < entries.size()) && (totalSize > targetSize); ++i)
+    {
+        if ( fs::remove(get<2>(entries[i]), error) )
+        {
+            totalSize -= get<1>(entries[i]);
+        }
+    }
+
+    return totalSize;
+}
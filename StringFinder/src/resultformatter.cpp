@@ -0,0 +1,194 @@
+#include "resultformatter.h"
+#include "resultfile.h"
+
+using namespace std;
+
+ResultFormatter::ResultFormatter(OutputBuffer& Output, const vector<string>& SearchStrings) :
+    _output{ Output }, _searchStrings{ SearchStrings }
+{
+}
+
+ResultFormatter::~ResultFormatter()
+{
+}
+
+void ResultFormatter::Finish()
+{
+}
+
+unique_ptr<ResultFormatter> ResultFormatter::Create(SearchOptions::Format Format, OutputBuffer& Output,
+                                                    const vector<string>& SearchStrings)
+{
+    switch (Format)
+    {
+    case SearchOptions::JSON_LINES:
+        return make_unique<JsonLinesFormatter>(Output, SearchStrings);
+    case SearchOptions::BINARY:
+        return make_unique<BinaryFormatter>(Output, SearchStrings);
+    default:
+        return make_unique<TextFormatter>(Output, SearchStrings);
+    }
+}
+
+TextFormatter::TextFormatter(OutputBuffer& Output, const vector<string>& SearchStrings) :
+    ResultFormatter(Output, SearchStrings)
+{
+}
+
+void TextFormatter::WriteFile(const fs::path& Path, const StringData& Data)
+{
+    _output.Write("Displaying data found inside <");
+    _output.SetColor(OutputBuffer::GREEN);
+    _output.Write('"');
+    _output.Write( Path.string() );
+    _output.Write('"');
+    _output.ResetColor();
+    _output.Write(">:\n");
+
+    for (size_t i = 0; i < Data.size(); ++i)
+    {
+        const StringData::AffixView affixes = Data.affixes(i);
+
+        _output.Write("Position: ");
+        _output.SetColor(OutputBuffer::GREEN);
+        _output.WriteNumber( Data.position(i) );
+        _output.ResetColor();
+        _output.Write("\t\tPrefix: ");
+        WriteString(affixes.prefix);
+        _output.Write("\tSuffix: ");
+        WriteString(affixes.suffix);
+
+        if (_searchStrings.size() > 1)
+        {
+            _output.Write("\tSearch string: ");
+            WriteString(_searchStrings[Data.searchString(i)]);
+        }
+
+        _output.Write('\n');
+    }
+
+    _output.Write('\n');
+}
+
+void TextFormatter::WriteString(string_view String)
+{
+    _output.SetColor(OutputBuffer::GREEN);
+    _output.WriteEscaped(String);
+    _output.ResetColor();
+}
+
+JsonLinesFormatter::JsonLinesFormatter(OutputBuffer& Output, const vector<string>& SearchStrings) :
+    ResultFormatter(Output, SearchStrings)
+{
+}
+
+void JsonLinesFormatter::WriteFile(const fs::path& Path, const StringData& Data)
+{
+    _output.Write('{');
+    _output.WriteJsonField( "path", Path.u8string() );
+    _output.Write(",\"matches\":[");
+
+    for (size_t i = 0; i < Data.size(); ++i)
+    {
+        const StringData::AffixView affixes = Data.affixes(i);
+
+        _output.Write( (0 == i) ? "{\"position\":" : ",{\"position\":" );
+        _output.WriteNumber( Data.position(i) );
+        _output.Write(',');
+        _output.WriteJsonField("prefix", affixes.prefix);
+        _output.Write(',');
+        _output.WriteJsonField("suffix", affixes.suffix);
+
+        if (_searchStrings.size() > 1)
+        {
+            _output.Write(',');
+            _output.WriteJsonField("search_string", _searchStrings[Data.searchString(i)]);
+        }
+
+        _output.Write('}');
+    }
+
+    _output.Write("]}\n");
+}
+
+BinaryFormatter::BinaryFormatter(OutputBuffer& Output, const vector<string>& SearchStrings) :
+    ResultFormatter(Output, SearchStrings), _offset{ 0 }, _matchCount{ 0 }, _recordOffsets{}
+{
+    WriteBytes(RESULT_FILE_MAGIC);
+    WriteFixed(RESULT_FILE_VERSION, 4);
+    WriteFixed(_searchStrings.size(), 4);
+
+    for (auto&& searchString : _searchStrings)
+    {
+        WriteVarint( searchString.size() );
+        WriteBytes(searchString);
+    }
+}
+
+void BinaryFormatter::WriteFile(const fs::path& Path, const StringData& Data)
+{
+    const string path = Path.u8string();
+    uint64_t     previousPosition = 0;
+
+    _recordOffsets.push_back(_offset);
+    _matchCount += Data.size();
+
+    WriteVarint( path.size() );
+    WriteBytes(path);
+    WriteVarint( Data.size() );
+
+    for (size_t i = 0; i < Data.size(); ++i)
+    {
+        const StringData::AffixView affixes = Data.affixes(i);
+        const uint64_t              position = Data.position(i);
+
+        // positions are sorted: deltas are small and fit in one or two bytes
+        WriteVarint(position - previousPosition);
+        previousPosition = position;
+
+        if (_searchStrings.size() > 1)
+        {
+            WriteVarint( Data.searchString(i) );
+        }
+
+        WriteFixed( (affixes.prefix.size() << 4) | affixes.suffix.size(), 1 );
+        WriteBytes(affixes.prefix);
+        WriteBytes(affixes.suffix);
+    }
+}
+
+void BinaryFormatter::Finish()
+{
+    const uint64_t pathTableOffset = _offset;
+
+    for (auto&& recordOffset : _recordOffsets)
+    {
+        WriteFixed(recordOffset, 8);
+    }
+
+    WriteFixed(_recordOffsets.size(), 8);
+    WriteFixed(_matchCount, 8);
+    WriteFixed(pathTableOffset, 8);
+    WriteBytes(RESULT_FILE_END_MAGIC);
+}
+
+void BinaryFormatter::WriteBytes(string_view Bytes)
+{
+    _output.Write(Bytes);
+    _offset += Bytes.size();
+}
+
+void BinaryFormatter::WriteVarint(uint64_t Value)
+{
+    char buffer[MAX_VARINT_SIZE];
+
+    WriteBytes( string_view(buffer, EncodeVarint(Value, buffer)) );
+}
+
+void BinaryFormatter::WriteFixed(uint64_t Value, size_t Size)
+{
+    char buffer[sizeof(uint64_t)];
+
+    EncodeFixed(Value, buffer, Size);
+    WriteBytes( string_view(buffer, Size) );
+}
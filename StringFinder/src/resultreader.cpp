@@ -0,0 +1,240 @@
+#include "resultreader.h"
+#include "resultfile.h"
+
+#include <iostream>
+#include <termcolor/termcolor.hpp>
+
+using namespace std;
+using namespace termcolor;
+
+ResultReader::MatchIterator::MatchIterator() : _data{ nullptr }, _end{ nullptr }, _remaining{ 0 },
+    _hasSearchStrings{ false }, _match{}
+{
+}
+
+ResultReader::MatchIterator::MatchIterator(const char* Data, const char* End, uint64_t Count, bool HasSearchStrings) :
+    _data{ Data }, _end{ End }, _remaining{ Count }, _hasSearchStrings{ HasSearchStrings }, _match{}
+{
+    Decode();
+}
+
+const ResultReader::Match& ResultReader::MatchIterator::operator*() const
+{
+    return _match;
+}
+
+const ResultReader::Match* ResultReader::MatchIterator::operator->() const
+{
+    return &_match;
+}
+
+ResultReader::MatchIterator& ResultReader::MatchIterator::operator++()
+{
+    --_remaining;
+    Decode();
+
+    return *this;
+}
+
+bool ResultReader::MatchIterator::operator==(const MatchIterator& Other) const
+{
+    // all finished iterators are equal
+    return (_remaining == Other._remaining) && ( (0 == _remaining) || (_data == Other._data) );
+}
+
+bool ResultReader::MatchIterator::operator!=(const MatchIterator& Other) const
+{
+    return !(*this == Other);
+}
+
+void ResultReader::MatchIterator::Decode()
+{
+    if (0 == _remaining)
+    {
+        return;
+    }
+
+    uint64_t delta = 0;
+    uint64_t searchString = 0;
+
+    if ( !DecodeVarint(_data, _end, delta) ||
+         ( _hasSearchStrings && !DecodeVarint(_data, _end, searchString) ) ||
+         (_data == _end) )
+    {
+        _remaining = 0;
+        return;
+    }
+
+    const uint8_t sizes = static_cast<uint8_t>(*_data++);
+    const size_t  prefixSize = sizes >> 4;
+    const size_t  suffixSize = sizes & 0xF;
+
+    if (static_cast<size_t>(_end - _data) < prefixSize + suffixSize)
+    {
+        _remaining = 0;
+        return;
+    }
+
+    _match.position += delta;
+    _match.searchString = static_cast<size_t>(searchString);
+    _match.prefix = string_view(_data, prefixSize);
+    _match.suffix = string_view(_data + prefixSize, suffixSize);
+    _data += prefixSize + suffixSize;
+}
+
+ResultReader::FileRecord::FileRecord() : _path{}, _matchCount{ 0 }, _matches{ nullptr }, _end{ nullptr },
+    _hasSearchStrings{ false }
+{
+}
+
+ResultReader::FileRecord::FileRecord(string_view Path, uint64_t MatchCount, const char* Matches, const char* End,
+                                     bool HasSearchStrings) :
+    _path{ Path }, _matchCount{ MatchCount }, _matches{ Matches }, _end{ End }, _hasSearchStrings{ HasSearchStrings }
+{
+}
+
+string_view ResultReader::FileRecord::path() const
+{
+    return _path;
+}
+
+uint64_t ResultReader::FileRecord::matchCount() const
+{
+    return _matchCount;
+}
+
+ResultReader::MatchIterator ResultReader::FileRecord::begin() const
+{
+    return MatchIterator(_matches, _end, _matchCount, _hasSearchStrings);
+}
+
+ResultReader::MatchIterator ResultReader::FileRecord::end() const
+{
+    return MatchIterator();
+}
+
+ResultReader::ResultReader() : _file{}, _contents{}, _searchStrings{}, _fileCount{ 0 }, _matchCount{ 0 },
+    _pathTable{ nullptr }
+{
+}
+
+bool ResultReader::Open(const fs::path& FileName)
+{
+    Close();
+
+    if ( !_file.Open(FileName) )
+    {
+        return false;
+    }
+
+    _contents = _file.contents();
+
+    if ( (_contents.size() < RESULT_FILE_HEADER_SIZE + RESULT_FILE_FOOTER_SIZE) ||
+         (_contents.substr(0, RESULT_FILE_MAGIC.size()) != RESULT_FILE_MAGIC) ||
+         (_contents.substr(_contents.size() - RESULT_FILE_END_MAGIC.size()) != RESULT_FILE_END_MAGIC) )
+    {
+        return Invalid(FileName, "not a result file, or incomplete");
+    }
+
+    if (DecodeFixed(_contents.data() + RESULT_FILE_MAGIC.size(), 4) != RESULT_FILE_VERSION)
+    {
+        return Invalid(FileName, "unsupported version");
+    }
+
+    const char*    footer = _contents.data() + _contents.size() - RESULT_FILE_FOOTER_SIZE;
+    const uint64_t fileCount = DecodeFixed(footer, 8);
+    const uint64_t pathTableOffset = DecodeFixed(footer + 16, 8);
+
+    if ( (pathTableOffset < RESULT_FILE_HEADER_SIZE) ||
+         (pathTableOffset > _contents.size() - RESULT_FILE_FOOTER_SIZE) ||
+         (fileCount != (_contents.size() - RESULT_FILE_FOOTER_SIZE - pathTableOffset) / 8) )
+    {
+        return Invalid(FileName, "malformed path table");
+    }
+
+    _fileCount = static_cast<size_t>(fileCount);
+    _matchCount = DecodeFixed(footer + 8, 8);
+    _pathTable = _contents.data() + pathTableOffset;
+
+    // search strings table, right after the fixed part of the header
+    const uint64_t searchStringCount = DecodeFixed(_contents.data() + RESULT_FILE_MAGIC.size() + 4, 4);
+    const char*    data = _contents.data() + RESULT_FILE_HEADER_SIZE;
+
+    for (uint64_t i = 0; i < searchStringCount; ++i)
+    {
+        uint64_t size = 0;
+
+        if ( !DecodeVarint(data, _pathTable, size) || (size > static_cast<uint64_t>(_pathTable - data)) )
+        {
+            return Invalid(FileName, "malformed search strings");
+        }
+
+        _searchStrings.emplace_back(data, static_cast<size_t>(size));
+        data += size;
+    }
+
+    return true;
+}
+
+void ResultReader::Close()
+{
+    _file.Close();
+    _contents = string_view();
+    _searchStrings.clear();
+    _fileCount = 0;
+    _matchCount = 0;
+    _pathTable = nullptr;
+}
+
+size_t ResultReader::fileCount() const
+{
+    return _fileCount;
+}
+
+uint64_t ResultReader::matchCount() const
+{
+    return _matchCount;
+}
+
+const vector<string_view>& ResultReader::searchStrings() const
+{
+    return _searchStrings;
+}
+
+ResultReader::FileRecord ResultReader::file(size_t Index) const
+{
+    if (Index >= _fileCount)
+    {
+        return FileRecord();
+    }
+
+    const uint64_t offset = DecodeFixed(_pathTable + 8 * Index, 8);
+    const char*    data = _contents.data() + offset;
+    uint64_t       pathSize = 0;
+    uint64_t       matchCount = 0;
+
+    if ( (offset < RESULT_FILE_HEADER_SIZE) || (offset >= static_cast<uint64_t>(_pathTable - _contents.data())) ||
+         !DecodeVarint(data, _pathTable, pathSize) || (pathSize > static_cast<uint64_t>(_pathTable - data)) )
+    {
+        return FileRecord();
+    }
+
+    const string_view path(data, static_cast<size_t>(pathSize));
+
+    data += pathSize;
+
+    if ( !DecodeVarint(data, _pathTable, matchCount) )
+    {
+        return FileRecord();
+    }
+
+    return FileRecord(path, matchCount, data, _pathTable, _searchStrings.size() > 1);
+}
+
+bool ResultReader::Invalid(const fs::path& FileName, const char* Reason)
+{
+    cout << red << "Result file: " << FileName << " is invalid: " << Reason << reset << endl;
+    Close();
+
+    return false;
+}
@@ -0,0 +1,23 @@
+#include "searchengine.h"
+
+using namespace std;
+
+SearchEngine::SearchEngine(int NumThreads) :
+    _pool{ (NumThreads > 0) ? NumThreads : ThreadPool::DefaultThreadCount() }
+{
+}
+
+void SearchEngine::Run(DataExtractor& Search, DataExtractor::ResultFunction OnResult)
+{
+    Search.ExtractData( _pool, std::move(OnResult) );
+}
+
+void SearchEngine::Watch(DataExtractor& Search)
+{
+    Search.WatchChanges(_pool);
+}
+
+int SearchEngine::threadCount() const
+{
+    return _pool.size();
+}
@@ -0,0 +1,278 @@
+#include "searcher.h"
+#include "cpufeatures.h"
+#include "casefolding.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+    template <bool IgnoreCase>
+    size_t FindScalar(const char* Data, size_t Size, const char* Needle, size_t NeedleSize)
+    {
+        if (!IgnoreCase)
+        {
+            return string_view(Data, Size).find( string_view(Needle, NeedleSize) );
+        }
+
+        for (size_t i = 0; i + NeedleSize <= Size; ++i)
+        {
+            if ( EqualsFolded(Data + i, Needle, NeedleSize) )
+            {
+                return i;
+            }
+        }
+
+        return string_view::npos;
+    }
+
+    // Verifies the remaining bytes of the candidates set in Mask (first and last bytes already match);
+    // returns the offset, relative to Block, of the first real occurrence or npos
+    template <bool IgnoreCase, typename MaskType>
+    inline size_t VerifyCandidates(MaskType Mask, const char* Block, const char* Needle, size_t NeedleSize)
+    {
+        while (0 != Mask)
+        {
+            const unsigned offset = (sizeof(MaskType) > 4) ? TrailingZeros64(Mask)
+                                                            : TrailingZeros( static_cast<uint32_t>(Mask) );
+
+            // needles of 1 byte (only vectorized when ignoring case) or 2 bytes have nothing left to verify
+            if ( (NeedleSize < 3) || ( IgnoreCase ? EqualsFolded(Block + offset + 1, Needle + 1, NeedleSize - 2)
+                                                  : ( 0 == memcmp(Block + offset + 1, Needle + 1, NeedleSize - 2) ) ) )
+            {
+                return offset;
+            }
+
+            // clear lowest set bit
+            Mask &= (Mask - 1);
+        }
+
+        return string_view::npos;
+    }
+
+    // Scans the bytes left after the last full vector
+    template <bool IgnoreCase>
+    inline size_t FindTail(const char* Data, size_t Size, size_t Start, const char* Needle, size_t NeedleSize)
+    {
+        const size_t position = FindScalar<IgnoreCase>(Data + Start, Size - Start, Needle, NeedleSize);
+
+        return (string_view::npos == position) ? position : (Start + position);
+    }
+
+    // Bits ORed into the haystack bytes compared with Byte: 0x20 folds letters when ignoring case
+    inline char CaseBits(bool IgnoreCase, char Byte)
+    {
+        return (IgnoreCase && IsAsciiLetter(Byte)) ? 0x20 : 0;
+    }
+
+#ifdef CPU_X86
+    template <bool IgnoreCase>
+    TARGET_SSE2
+    size_t FindSse2(const char* Data, size_t Size, const char* Needle, size_t NeedleSize)
+    {
+        const __m128i first = _mm_set1_epi8(Needle[0]);
+        const __m128i last = _mm_set1_epi8(Needle[NeedleSize - 1]);
+        const __m128i firstCase = _mm_set1_epi8( CaseBits(IgnoreCase, Needle[0]) );
+        const __m128i lastCase = _mm_set1_epi8( CaseBits(IgnoreCase, Needle[NeedleSize - 1]) );
+        size_t        i = 0;
+
+        for (; i + NeedleSize - 1 + 16 <= Size; i += 16)
+        {
+            __m128i blockFirst = _mm_loadu_si128( reinterpret_cast<const __m128i*>(Data + i) );
+            __m128i blockLast = _mm_loadu_si128( reinterpret_cast<const __m128i*>(Data + i + NeedleSize - 1) );
+
+            if (IgnoreCase)
+            {
+                blockFirst = _mm_or_si128(blockFirst, firstCase);
+                blockLast = _mm_or_si128(blockLast, lastCase);
+            }
+
+            const __m128i matches = _mm_and_si128( _mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast) );
+            const uint32_t mask = static_cast<uint32_t>( _mm_movemask_epi8(matches) );
+            const size_t   offset = VerifyCandidates<IgnoreCase>(mask, Data + i, Needle, NeedleSize);
+
+            if (string_view::npos != offset)
+            {
+                return i + offset;
+            }
+        }
+
+        return FindTail<IgnoreCase>(Data, Size, i, Needle, NeedleSize);
+    }
+
+    template <bool IgnoreCase>
+    TARGET_AVX2
+    size_t FindAvx2(const char* Data, size_t Size, const char* Needle, size_t NeedleSize)
+    {
+        const __m256i first = _mm256_set1_epi8(Needle[0]);
+        const __m256i last = _mm256_set1_epi8(Needle[NeedleSize - 1]);
+        const __m256i firstCase = _mm256_set1_epi8( CaseBits(IgnoreCase, Needle[0]) );
+        const __m256i lastCase = _mm256_set1_epi8( CaseBits(IgnoreCase, Needle[NeedleSize - 1]) );
+        size_t        i = 0;
+
+        for (; i + NeedleSize - 1 + 32 <= Size; i += 32)
+        {
+            __m256i blockFirst = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(Data + i) );
+            __m256i blockLast = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(Data + i + NeedleSize - 1) );
+
+            if (IgnoreCase)
+            {
+                blockFirst = _mm256_or_si256(blockFirst, firstCase);
+                blockLast = _mm256_or_si256(blockLast, lastCase);
+            }
+
+            const __m256i matches = _mm256_and_si256( _mm256_cmpeq_epi8(first, blockFirst),
+                                                      _mm256_cmpeq_epi8(last, blockLast) );
+            const uint32_t mask = static_cast<uint32_t>( _mm256_movemask_epi8(matches) );
+            const size_t   offset = VerifyCandidates<IgnoreCase>(mask, Data + i, Needle, NeedleSize);
+
+            if (string_view::npos != offset)
+            {
+                return i + offset;
+            }
+        }
+
+        return FindTail<IgnoreCase>(Data, Size, i, Needle, NeedleSize);
+    }
+
+    template <bool IgnoreCase>
+    TARGET_AVX512
+    size_t FindAvx512(const char* Data, size_t Size, const char* Needle, size_t NeedleSize)
+    {
+        const __m512i first = _mm512_set1_epi8(Needle[0]);
+        const __m512i last = _mm512_set1_epi8(Needle[NeedleSize - 1]);
+        const __m512i firstCase = _mm512_set1_epi8( CaseBits(IgnoreCase, Needle[0]) );
+        const __m512i lastCase = _mm512_set1_epi8( CaseBits(IgnoreCase, Needle[NeedleSize - 1]) );
+        size_t        i = 0;
+
+        for (; i + NeedleSize - 1 + 64 <= Size; i += 64)
+        {
+            __m512i blockFirst = _mm512_loadu_si512( reinterpret_cast<const void*>(Data + i) );
+            __m512i blockLast = _mm512_loadu_si512( reinterpret_cast<const void*>(Data + i + NeedleSize - 1) );
+
+            if (IgnoreCase)
+            {
+                blockFirst = _mm512_or_si512(blockFirst, firstCase);
+                blockLast = _mm512_or_si512(blockLast, lastCase);
+            }
+
+            const uint64_t mask = _mm512_cmpeq_epi8_mask(first, blockFirst) & _mm512_cmpeq_epi8_mask(last, blockLast);
+            const size_t   offset = VerifyCandidates<IgnoreCase>(mask, Data + i, Needle, NeedleSize);
+
+            if (string_view::npos != offset)
+            {
+                return i + offset;
+            }
+        }
+
+        return FindTail<IgnoreCase>(Data, Size, i, Needle, NeedleSize);
+    }
+#endif
+}
+
+Searcher::Searcher(string Needle, bool IgnoreCase) : Searcher(std::move(Needle), DetectInstructionSet(), IgnoreCase)
+{
+}
+
+Searcher::Searcher(string Needle, InstructionSet Set, bool IgnoreCase) :
+    _needle{ IgnoreCase ? FoldCase(Needle) : std::move(Needle) }, _instructionSet{ SCALAR }, _find{ FindScalar<false> }
+{
+    const InstructionSet supportedSet = DetectInstructionSet();
+
+    if (Set > supportedSet)
+    {
+        Set = supportedSet;
+    }
+
+    // the vector kernels compare the first and the last byte of the needle separately;
+    // shorter needles are served by memchr through the scalar kernel (which cannot ignore case)
+    if ( (_needle.size() < 2) && !IgnoreCase )
+    {
+        Set = SCALAR;
+    }
+
+    switch (Set)
+    {
+#ifdef CPU_X86
+    case AVX512:
+        _find = IgnoreCase ? FindAvx512<true> : FindAvx512<false>;
+        break;
+
+    case AVX2:
+        _find = IgnoreCase ? FindAvx2<true> : FindAvx2<false>;
+        break;
+
+    case SSE2:
+        _find = IgnoreCase ? FindSse2<true> : FindSse2<false>;
+        break;
+#endif
+    default:
+        Set = SCALAR;
+        _find = IgnoreCase ? FindScalar<true> : FindScalar<false>;
+        break;
+    }
+
+    _instructionSet = Set;
+}
+
+size_t Searcher::Find(string_view Haystack, size_t From) const
+{
+    if (From > Haystack.size())
+    {
+        return string_view::npos;
+    }
+
+    const size_t position = _find(Haystack.data() + From, Haystack.size() - From, _needle.data(), _needle.size());
+
+    return (string_view::npos == position) ? position : (From + position);
+}
+
+const string& Searcher::needle() const
+{
+    return _needle;
+}
+
+Searcher::InstructionSet Searcher::instructionSet() const
+{
+    return _instructionSet;
+}
+
+Searcher::InstructionSet Searcher::DetectInstructionSet()
+{
+    const CpuFeatures& features = CpuFeatures::Detect();
+
+    if (features.avx512bw)
+    {
+        return AVX512;
+    }
+
+    if (features.avx2)
+    {
+        return AVX2;
+    }
+
+    return features.sse2 ? SSE2 : SCALAR;
+}
+
+const char* Searcher::InstructionSetName(InstructionSet Set)
+{
+    switch (Set)
+    {
+    case SSE2:
+        return "SSE2";
+
+    case AVX2:
+        return "AVX2";
+
+    case AVX512:
+        return "AVX-512";
+
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,422 @@
+#include "searchserver.h"
+#include "dataextractor.h"
+#include "directorywalker.h"
+#include "directorymanifest.h"
+#include "outputbuffer.h"
+#include "encoding.h"
+#include "regexprogram.h"
+
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <termcolor/termcolor.hpp>
+
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+#endif
+
+using namespace std;
+using namespace termcolor;
+
+#ifndef _WIN32
+namespace {
+    // Fills the address of a socket file; returns false if the path is too long for it
+    bool SocketAddress(const fs::path& SocketFile, sockaddr_un& Address)
+    {
+        const string& path = SocketFile.native();
+
+        memset(&Address, 0, sizeof(Address));
+        Address.sun_family = AF_UNIX;
+
+        if ( path.empty() || (path.size() >= sizeof(Address.sun_path)) )
+        {
+            cout << red << "Socket: " << SocketFile << " is not a valid socket path (at most "
+                 << sizeof(Address.sun_path) - 1 << " bytes)." << reset << endl;
+            return false;
+        }
+
+        memcpy( Address.sun_path, path.data(), path.size() );
+
+        return true;
+    }
+
+    // Connected socket, or -1
+    int Connect(const sockaddr_un& Address)
+    {
+        const int descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        if ( (descriptor >= 0) && (0 != connect( descriptor, reinterpret_cast<const sockaddr*>(&Address), sizeof(Address) )) )
+        {
+            close(descriptor);
+            return -1;
+        }
+
+        return descriptor;
+    }
+
+    bool WriteAll(int Descriptor, string_view Data)
+    {
+        while ( !Data.empty() )
+        {
+            const ssize_t written = write( Descriptor, Data.data(), Data.size() );
+
+            if (written < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+
+                return false;
+            }
+
+            Data.remove_prefix( static_cast<size_t>(written) );
+        }
+
+        return true;
+    }
+
+    // Parses a query; returns false if it is not valid
+    bool ParseQuery(const string& Request, uint8_t& Flags, uint8_t& Format, vector<string>& SearchStrings)
+    {
+        const char* data = Request.data();
+        const char* end = data + Request.size();
+        uint64_t    count = 0;
+
+        if ( (Request.size() < SERVER_QUERY_MAGIC.size() + 2) || (0 != Request.compare(0, SERVER_QUERY_MAGIC.size(), SERVER_QUERY_MAGIC)) )
+        {
+            return false;
+        }
+
+        data += SERVER_QUERY_MAGIC.size();
+        Flags = static_cast<uint8_t>(*data++);
+        Format = static_cast<uint8_t>(*data++);
+
+        if ( (Format > SearchOptions::BINARY) || !DecodeVarint(data, end, count) || (count > Request.size()) )
+        {
+            return false;
+        }
+
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            uint64_t size = 0;
+
+            if ( !DecodeVarint(data, end, size) || (0 == size) || (size > static_cast<uint64_t>(end - data)) )
+            {
+                return false;
+            }
+
+            SearchStrings.emplace_back(data, static_cast<size_t>(size));
+            data += size;
+        }
+
+        // clients validate their regular expressions, but the server does not rely on it
+        for (auto&& searchString : SearchStrings)
+        {
+            string error{};
+
+            if ( (0 != (Flags & SearchServer::REGEX_QUERY)) && !RegexProgram::Validate(searchString, error) )
+            {
+                return false;
+            }
+        }
+
+        return !SearchStrings.empty() && (data == end);
+    }
+}
+#endif
+
+SearchServer::SearchServer(string Location, SearchOptions Options) : _location{ std::move(Location) },
+    _options{ std::move(Options) }, _engine{ _options.numThreads }, _manifest{},
+    _activeQueries{ 0 }
+{
+}
+
+#ifdef _WIN32
+bool SearchServer::Serve(const fs::path& SocketFile)
+{
+    cout << red << "Server mode is not supported on this platform." << reset << endl;
+    return false;
+}
+
+bool SearchServer::Query(const fs::path& SocketFile, const vector<string>& SearchStrings, const SearchOptions& Options)
+{
+    cout << red << "Server mode is not supported on this platform." << reset << endl;
+    return false;
+}
+
+void SearchServer::HandleConnection(int Connection)
+{
+}
+#else
+bool SearchServer::Serve(const fs::path& SocketFile)
+{
+    sockaddr_un address{};
+    error_code  error;
+
+    if ( !SocketAddress(SocketFile, address) )
+    {
+        return false;
+    }
+
+    if ( fs::exists(SocketFile, error) )
+    {
+        const int connection = Connect(address);
+
+        if (connection >= 0)
+        {
+            close(connection);
+            cout << red << "Socket: " << SocketFile << " is used by another server." << reset << endl;
+            return false;
+        }
+
+        // left over by a server that is gone
+        fs::remove(SocketFile, error);
+    }
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if ( (listener < 0) || (0 != bind( listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address) )) ||
+         (0 != listen(listener, SERVER_BACKLOG)) )
+    {
+        cout << red << "Socket: " << SocketFile << " cannot be created: " << strerror(errno) << reset << endl;
+
+        if (listener >= 0)
+        {
+            close(listener);
+        }
+
+        return false;
+    }
+
+    // clients going away must not kill the server: their writes fail instead
+    signal(SIGPIPE, SIG_IGN);
+
+    // the listing of the location is always kept, next to the socket by default
+    if ( _options.manifestFile.empty() )
+    {
+        _options.manifestFile = SocketFile.string() + ".manifest";
+    }
+
+    _manifest.Open(_options.manifestFile, _location);
+    WarmUp();
+
+    cout << green << "Serving <" << _location << "> on " << SocketFile << " using <" << _engine.threadCount()
+         << "> threads ..." << reset << endl;
+
+    while (true)
+    {
+        const int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if (connection < 0)
+        {
+            if ( (EINTR == errno) || (ECONNABORTED == errno) )
+            {
+                continue;
+            }
+
+            cout << red << "Socket: " << SocketFile << " cannot accept connections: " << strerror(errno) << reset << endl;
+            break;
+        }
+
+        // queries run concurrently, on the workers of the engine
+        ++_activeQueries;
+        thread([this, connection]
+               {
+                   HandleConnection(connection);
+                   --_activeQueries;
+               }).detach();
+    }
+
+    close(listener);
+    fs::remove(SocketFile, error);
+
+    // the running queries use this server
+    while (_activeQueries > 0)
+    {
+        this_thread::sleep_for( chrono::milliseconds(10) );
+    }
+
+    return false;
+}
+
+bool SearchServer::Query(const fs::path& SocketFile, const vector<string>& SearchStrings, const SearchOptions& Options)
+{
+    sockaddr_un address{};
+
+    if ( !SocketAddress(SocketFile, address) )
+    {
+        return false;
+    }
+
+    const int connection = Connect(address);
+
+    if (connection < 0)
+    {
+        cout << red << "Server: " << SocketFile << " cannot be reached: " << strerror(errno) << reset << endl;
+        return false;
+    }
+
+    const bool   isColorized = Options.outputFile.empty() && (1 == isatty(1));
+    string       request(SERVER_QUERY_MAGIC);
+    char         varint[MAX_VARINT_SIZE];
+    OutputBuffer output{};
+
+    request += static_cast<char>( (Options.orderedOutput ? ORDERED_QUERY : 0) | (isColorized ? COLORIZED_QUERY : 0) |
+                                  (Options.ignoreCase ? IGNORE_CASE_QUERY : 0) | (Options.regex ? REGEX_QUERY : 0) |
+                                  ( (SearchOptions::SKIP_BINARY == Options.binaryFiles) ? SKIP_BINARY_QUERY : 0 ) |
+                                  ( (SearchOptions::BINARY_WITHOUT_AFFIXES == Options.binaryFiles) ?
+                                    BINARY_WITHOUT_AFFIXES_QUERY : 0 ) );
+    request += static_cast<char>(Options.outputFormat);
+    request.append( varint, EncodeVarint(SearchStrings.size(), varint) );
+
+    for (auto&& searchString : SearchStrings)
+    {
+        request.append( varint, EncodeVarint(searchString.size(), varint) );
+        request += searchString;
+    }
+
+    // the end of the request is the end of the client's side of the connection
+    if ( !WriteAll(connection, request) || (0 != shutdown(connection, SHUT_WR)) ||
+         ( !Options.outputFile.empty() && !output.Open(Options.outputFile) ) )
+    {
+        close(connection);
+        return false;
+    }
+
+    vector<char> buffer(OUTPUT_BUFFER_SIZE);
+    ssize_t      received = 0;
+
+    // the results are written as they arrive
+    while ( ( received = read( connection, buffer.data(), buffer.size() ) ) != 0 )
+    {
+        if (received < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            cout << red << "Server: " << SocketFile << " connection lost: " << strerror(errno) << reset << endl;
+            break;
+        }
+
+        output.Write( string_view( buffer.data(), static_cast<size_t>(received) ) );
+        output.Flush();
+    }
+
+    close(connection);
+
+    return (0 == received);
+}
+
+void SearchServer::HandleConnection(int Connection)
+{
+    string         request{};
+    vector<char>   buffer(65536);
+    ssize_t        received = 0;
+    uint8_t        flags = 0;
+    uint8_t        format = 0;
+    vector<string> searchStrings{};
+
+    while ( ( received = read( Connection, buffer.data(), buffer.size() ) ) != 0 )
+    {
+        if ( (received < 0) && (EINTR == errno) )
+        {
+            continue;
+        }
+
+        if ( (received < 0) || (request.size() + static_cast<size_t>(received) > MAX_QUERY_SIZE) )
+        {
+            close(Connection);
+            return;
+        }
+
+        request.append( buffer.data(), static_cast<size_t>(received) );
+    }
+
+    if ( !ParseQuery(request, flags, format, searchStrings) )
+    {
+        // empty: another server checking whether the socket is in use
+        if ( !request.empty() )
+        {
+            cout << red << "Server: invalid query ignored." << reset << endl;
+        }
+
+        close(Connection);
+        return;
+    }
+
+    const auto    start = chrono::steady_clock::now();
+    SearchOptions options = _options;
+
+    // results are streamed back as they are found, into the connection
+    options.streamOutput = true;
+    options.orderedOutput = (0 != (flags & ORDERED_QUERY));
+    options.ignoreCase = (0 != (flags & IGNORE_CASE_QUERY));
+    options.regex = (0 != (flags & REGEX_QUERY));
+
+    // binary files are handled as the server was told to, unless the query says otherwise
+    if (0 != (flags & SKIP_BINARY_QUERY))
+    {
+        options.binaryFiles = SearchOptions::SKIP_BINARY;
+    }
+    else if (0 != (flags & BINARY_WITHOUT_AFFIXES_QUERY))
+    {
+        options.binaryFiles = SearchOptions::BINARY_WITHOUT_AFFIXES;
+    }
+    options.outputFormat = static_cast<SearchOptions::Format>(format);
+    options.outputFile.clear();
+
+    {
+        DataExtractor search(searchStrings, _location, options);
+
+        search.SetOutput( Connection, 0 != (flags & COLORIZED_QUERY) );
+        search.UseManifest(_manifest);
+        _engine.Run(search);
+        search.DisplayData();
+    }
+
+    close(Connection);
+
+    const chrono::duration<double> time = chrono::steady_clock::now() - start;
+
+    cout << "Query: <" << green << searchStrings.size() << reset << "> search strings answered in: <"
+         << green << time.count() << reset << "> sec." << endl;
+}
+#endif
+
+void SearchServer::WarmUp()
+{
+    ConcurrentQueue<fs::path> fileQueue{ FILE_QUEUE_CAPACITY };
+    DirectoryWalker           walker(_location, fileQueue);
+    fs::path                  file{};
+    size_t                    numberOfFiles = 0;
+
+    if ( !_options.indexFile.empty() )
+    {
+        // queries do not walk the location
+        return;
+    }
+
+    walker.UseManifest(_manifest);
+    walker.Start();
+
+    while ( fileQueue.Pop(file) )
+    {
+        ++numberOfFiles;
+    }
+
+    walker.Wait();
+
+    if ( _manifest.Save(_options.manifestFile) )
+    {
+        cout << "Warm up: <" << green << numberOfFiles << reset << "> files in <" << green
+             << walker.reusedDirectories() + walker.readDirectories() << reset << "> directories." << endl;
+    }
+}
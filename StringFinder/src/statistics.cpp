@@ -0,0 +1,192 @@
+#include "statistics.h"
+
+#include <iostream>
+#include <termcolor/termcolor.hpp>
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+    atomic<uint64_t> nextStatisticsId{ 1 };
+
+    // Block of the statistics the calling thread updated last
+    struct LocalCache
+    {
+        uint64_t owner;
+        void*    block;
+    };
+
+    thread_local LocalCache localCache{ 0, nullptr };
+
+    // Single writer: a plain load and store, no locked instruction
+    void Increase(atomic<uint64_t>& Value, uint64_t Increment)
+    {
+        Value.store(Value.load(memory_order_relaxed) + Increment, memory_order_relaxed);
+    }
+}
+
+Statistics::ScopedTimer::ScopedTimer(Statistics* Stats, Timer Type) : _statistics{ Stats }, _type{ Type },
+    _start{ (nullptr != Stats) ? chrono::steady_clock::now() : chrono::steady_clock::time_point() }
+{
+}
+
+Statistics::ScopedTimer::~ScopedTimer()
+{
+    if (nullptr != _statistics)
+    {
+        _statistics->AddTime(_type, chrono::steady_clock::now() - _start);
+    }
+}
+
+Statistics::Statistics() : _id{ nextStatisticsId++ }, _start{ chrono::steady_clock::now() }, _threadBlocks{},
+    _blocks{}, _stopProgress{ false }
+{
+}
+
+Statistics::~Statistics()
+{
+    StopProgress();
+}
+
+void Statistics::Add(Counter Type, uint64_t Value)
+{
+    Increase(Local().counters[Type], Value);
+}
+
+void Statistics::AddTime(Timer Type, chrono::steady_clock::duration Time)
+{
+    Increase( Local().times[Type], static_cast<uint64_t>( chrono::duration_cast<chrono::nanoseconds>(Time).count() ) );
+}
+
+uint64_t Statistics::counter(Counter Type) const
+{
+    lock_guard<mutex> lock(_mutex);
+    uint64_t          value = 0;
+
+    for (auto&& block : _blocks)
+    {
+        value += block->counters[Type].load(memory_order_relaxed);
+    }
+
+    return value;
+}
+
+double Statistics::seconds(Timer Type) const
+{
+    lock_guard<mutex> lock(_mutex);
+    uint64_t          nanoseconds = 0;
+
+    for (auto&& block : _blocks)
+    {
+        nanoseconds += block->times[Type].load(memory_order_relaxed);
+    }
+
+    return nanoseconds / 1e9;
+}
+
+void Statistics::StartProgress()
+{
+    if ( _progressThread.joinable() )
+    {
+        return;
+    }
+
+    _stopProgress = false;
+    _progressThread = thread([this]
+                             {
+                                 unique_lock<mutex> lock(_mutex);
+
+                                 while ( !_progressStopped.wait_for(lock, chrono::milliseconds(PROGRESS_INTERVAL),
+                                                                    [this] { return _stopProgress; }) )
+                                 {
+                                     lock.unlock();
+                                     DisplayProgress();
+                                     lock.lock();
+                                 }
+                             });
+}
+
+void Statistics::StopProgress()
+{
+    if ( !_progressThread.joinable() )
+    {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        _stopProgress = true;
+    }
+
+    _progressStopped.notify_all();
+    _progressThread.join();
+
+    // last values, and the line is kept
+    DisplayProgress();
+    cerr << endl;
+}
+
+void Statistics::Display() const
+{
+    const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+
+    cout << "Statistics:" << endl
+         << "  Files: <" << green << counter(FILES_FOUND) << reset << "> found in <"
+         << green << counter(DIRECTORIES_LISTED) << reset << "> directories (<"
+         << green << counter(DIRECTORIES_EXCLUDED) << reset << "> excluded), <"
+         << green << counter(FILES_EXCLUDED) << reset << "> excluded, <"
+         << green << counter(FILES_SEARCHED) << reset << "> searched, <"
+         << green << counter(BINARY_FILES) << reset << "> binary, <"
+         << green << counter(FILES_READ) << reset << "> read ahead (<"
+         << green << counter(BYTES_READ) << reset << "> bytes)" << endl
+         << "  Searched: <" << green << counter(BYTES_SEARCHED) << reset << "> bytes, <"
+         << green << counter(MATCHES) << reset << "> matches, <"
+         << green << counter(BYTES_SEARCHED) / elapsed / 1048576 << reset << "> MB/s overall" << endl
+         << "  Time (sec., summed over threads): walk <" << green << seconds(WALK_TIME) << reset
+         << ">, read <" << green << seconds(READ_TIME) << reset
+         << ">, waiting for files <" << green << seconds(WAIT_TIME) << reset
+         << ">, search <" << green << seconds(SEARCH_TIME) << reset
+         << ">, affixes <" << green << seconds(AFFIX_TIME) << reset
+         << ">, output <" << green << seconds(OUTPUT_TIME) << reset << ">" << endl;
+}
+
+Statistics::ThreadBlock& Statistics::Local()
+{
+    if (localCache.owner != _id)
+    {
+        lock_guard<mutex> lock(_mutex);
+        ThreadBlock*&     block = _threadBlocks[this_thread::get_id()];
+
+        if (nullptr == block)
+        {
+            _blocks.push_back( make_unique<ThreadBlock>() );
+            block = _blocks.back().get();
+
+            for (auto&& value : block->counters)
+            {
+                value = 0;
+            }
+
+            for (auto&& value : block->times)
+            {
+                value = 0;
+            }
+        }
+
+        localCache = LocalCache{ _id, block };
+    }
+
+    return *static_cast<ThreadBlock*>(localCache.block);
+}
+
+void Statistics::DisplayProgress() const
+{
+    const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+    const double megabytes = counter(BYTES_SEARCHED) / 1048576.0;
+
+    // rewritten in place
+    cerr << "\rSearched <" << counter(FILES_SEARCHED) << "> of <" << counter(FILES_FOUND) << "> files, <"
+         << static_cast<uint64_t>(megabytes) << "> MB (" << static_cast<uint64_t>(megabytes / elapsed)
+         << " MB/s), <" << counter(MATCHES) << "> matches   " << flush;
+}
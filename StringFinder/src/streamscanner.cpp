@@ -0,0 +1,168 @@
+#include "streamscanner.h"
+#include "stringdata.h"
+
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <termcolor/termcolor.hpp>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace termcolor;
+
+StreamScanner::StreamScanner(const PatternMatcher& Matcher, size_t BlockSize) :
+    _matcher{ Matcher }, _blockSize{ max<size_t>(BlockSize, 1) }, _overlap{ AFFIX_SIZE + Matcher.maxMatchSize() - 1 },
+    _buffer{}, _matches{}, _inputSize{ 0 }
+{
+}
+
+bool StreamScanner::Scan(const fs::path& FileName, const MatchFunction& OnMatches, const InspectFunction& Inspect)
+{
+#ifdef _WIN32
+    ifstream contentStream(FileName, ios::binary);
+
+    if ( !contentStream.good() )
+    {
+        cout << red << "File: " << FileName << " cannot be open." << reset << endl;
+        return false;
+    }
+
+    const bool isRead = Scan([&contentStream](char* Buffer, size_t Size, size_t& BytesRead)
+                             {
+                                 contentStream.read( Buffer, static_cast<streamsize>(Size) );
+                                 BytesRead = static_cast<size_t>( contentStream.gcount() );
+
+                                 return !contentStream.bad();
+                             }, OnMatches, Inspect);
+#else
+    const int descriptor = open(FileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (descriptor < 0)
+    {
+        cout << red << "File: " << FileName << " cannot be open." << reset << endl;
+        return false;
+    }
+
+    const bool isRead = Scan([descriptor](char* Buffer, size_t Size, size_t& BytesRead)
+                             {
+                                 ssize_t bytesRead = 0;
+
+                                 do
+                                 {
+                                     bytesRead = read(descriptor, Buffer, Size);
+                                 } while ( (bytesRead < 0) && (EINTR == errno) );
+
+                                 BytesRead = (bytesRead > 0) ? static_cast<size_t>(bytesRead) : 0;
+
+                                 return (bytesRead >= 0);
+                             }, OnMatches, Inspect);
+
+    close(descriptor);
+#endif
+
+    if (!isRead)
+    {
+        cout << red << "File: " << FileName << " cannot be read." << reset << endl;
+    }
+
+    return isRead;
+}
+
+bool StreamScanner::Scan(const ReadFunction& Read, const MatchFunction& OnMatches, const InspectFunction& Inspect)
+{
+    const size_t history = AFFIX_SIZE;
+    const size_t capacity = history + _overlap + _blockSize;
+    size_t       filled = 0;
+    size_t       searchStart = 0;  // window position of the first byte not searched yet
+    uint64_t     offset = 0;
+    bool         atEnd = false;
+    bool         isFirstWindow = true;
+
+    _inputSize = 0;
+
+    // allocated once per scanner; the bytes are always written before being read
+    if (_buffer.size() < capacity)
+    {
+        _buffer.resize(capacity);
+    }
+
+    while (!atEnd)
+    {
+        // pipes may return less than requested
+        while ( !atEnd && (filled < capacity) )
+        {
+            size_t bytesRead = 0;
+
+            if ( !Read(&_buffer[filled], capacity - filled, bytesRead) )
+            {
+                return false;
+            }
+
+            atEnd = (0 == bytesRead);
+            filled += bytesRead;
+        }
+
+        const string_view window(_buffer.data(), filled);
+
+        if ( isFirstWindow && Inspect && !Inspect(window) )
+        {
+            break;
+        }
+
+        isFirstWindow = false;
+
+        // matches starting from here are reported with the next window
+        const size_t      limit = atEnd ? filled : filled - _overlap;
+
+        _matches.clear();
+        _matcher.FindFrom(window, searchStart, _matches);
+
+        // matches starting inside the overlap are found again, complete, in the next window
+        while ( !_matches.empty() && (_matches.back().position >= limit) )
+        {
+            _matches.pop_back();
+        }
+
+        // matches not overlapping: the next window is searched from the end of the last one reported,
+        // which may lie past the limits of several windows
+        size_t nextStart = max(limit, searchStart);
+
+        if ( !_matcher.overlappingMatches() && !_matches.empty() )
+        {
+            nextStart = max(nextStart, _matches.back().position + _matches.back().length);
+        }
+
+        if ( !_matches.empty() )
+        {
+            OnMatches(window, offset, _matches);
+        }
+
+        if (!atEnd)
+        {
+            // only the history and the overlap are kept
+            const size_t keepStart = limit - history;
+
+            memmove(&_buffer[0], &_buffer[keepStart], filled - keepStart);
+
+            offset += keepStart;
+            filled -= keepStart;
+            searchStart = nextStart - keepStart;
+        }
+    }
+
+    _inputSize = offset + filled;
+
+    return true;
+}
+
+uint64_t StreamScanner::inputSize() const
+{
+    return _inputSize;
+}
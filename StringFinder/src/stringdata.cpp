@@ -0,0 +1,124 @@
+#include "stringdata.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    constexpr uint8_t FULL_AFFIXES = (AFFIX_SIZE << 4) | AFFIX_SIZE;
+}
+
+StringData::StringData() : _positions{}, _searchStrings{}, _affixes{}, _shortAffixes{}
+{
+}
+
+void StringData::Add(uint64_t Position, size_t SearchString, string_view Prefix, string_view Suffix)
+{
+    const size_t  index = _positions.size();
+    const uint8_t affixSizes = static_cast<uint8_t>( (Prefix.size() << 4) | Suffix.size() );
+
+    _positions.push_back(Position);
+
+    // search string indexes are only stored once a search string other than the first one was found
+    if ( (0 != SearchString) && _searchStrings.empty() )
+    {
+        _searchStrings.assign(index, 0);
+    }
+
+    if ( (0 != SearchString) || !_searchStrings.empty() )
+    {
+        _searchStrings.push_back( static_cast<uint32_t>(SearchString) );
+    }
+
+    // the arena is only stored once a match has affixes (none when affixes are off)
+    if ( Prefix.empty() && Suffix.empty() && _affixes.empty() )
+    {
+        return;
+    }
+
+    if ( _affixes.empty() )
+    {
+        _affixes.reserve(_positions.capacity() * 2 * AFFIX_SIZE);
+        _affixes.assign(index * 2 * AFFIX_SIZE, '\0');
+
+        for (size_t i = 0; i < index; ++i)
+        {
+            _shortAffixes.emplace_back(i, 0);
+        }
+    }
+
+    // fixed width slots: prefix right aligned, suffix left aligned
+    _affixes.resize(_affixes.size() + 2 * AFFIX_SIZE, '\0');
+
+    char* slot = _affixes.data() + index * 2 * AFFIX_SIZE;
+
+    copy(Prefix.begin(), Prefix.end(), slot + AFFIX_SIZE - Prefix.size());
+    copy(Suffix.begin(), Suffix.end(), slot + AFFIX_SIZE);
+
+    if (FULL_AFFIXES != affixSizes)
+    {
+        _shortAffixes.emplace_back(index, affixSizes);
+    }
+}
+
+void StringData::Reserve(size_t Count)
+{
+    // the arena is reserved along with the first affixes
+    _positions.reserve(Count);
+}
+
+void StringData::ShrinkToFit()
+{
+    _positions.shrink_to_fit();
+    _searchStrings.shrink_to_fit();
+    _affixes.shrink_to_fit();
+    _shortAffixes.shrink_to_fit();
+}
+
+size_t StringData::size() const
+{
+    return _positions.size();
+}
+
+bool StringData::empty() const
+{
+    return _positions.empty();
+}
+
+uint64_t StringData::position(size_t Index) const
+{
+    return _positions[Index];
+}
+
+size_t StringData::searchString(size_t Index) const
+{
+    return _searchStrings.empty() ? 0 : _searchStrings[Index];
+}
+
+StringData::AffixView StringData::affixes(size_t Index) const
+{
+    size_t prefixSize = AFFIX_SIZE;
+    size_t suffixSize = AFFIX_SIZE;
+
+    if ( _affixes.empty() )
+    {
+        return {};
+    }
+
+    if ( !_shortAffixes.empty() )
+    {
+        auto shortAffix = lower_bound(_shortAffixes.begin(), _shortAffixes.end(), Index,
+                                      [](const pair<uint64_t, uint8_t>& Entry, size_t Value)
+                                      { return Entry.first < Value; });
+
+        if ( (shortAffix != _shortAffixes.end()) && (shortAffix->first == Index) )
+        {
+            prefixSize = shortAffix->second >> 4;
+            suffixSize = shortAffix->second & 0x0F;
+        }
+    }
+
+    const char* slot = _affixes.data() + Index * 2 * AFFIX_SIZE;
+
+    return { string_view(slot + AFFIX_SIZE - prefixSize, prefixSize), string_view(slot + AFFIX_SIZE, suffixSize) };
+}
@@ -0,0 +1,249 @@
+#include "teddymatcher.h"
+#include "cpufeatures.h"
+#include "casefolding.h"
+
+#include <cstring>
+#include <algorithm>
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+#ifdef CPU_X86
+    // Runs the bucket filter over 16 positions at a time; OnCandidates(Position, Buckets) is called
+    // for every position where at least one bucket may match
+    // Returns the first position that was not filtered (tail left to the caller)
+    template <typename OnCandidatesType>
+    TARGET_SSSE3
+    size_t ScanSsse3(const uint8_t (*LowNibbles)[16], const uint8_t (*HighNibbles)[16], size_t FingerprintSize,
+                     const char* Data, size_t Size, OnCandidatesType&& OnCandidates)
+    {
+        const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+        const __m128i zero = _mm_setzero_si128();
+        __m128i       lowTables[TEDDY_MAX_FINGERPRINT];
+        __m128i       highTables[TEDDY_MAX_FINGERPRINT];
+        size_t        i = 0;
+
+        for (size_t j = 0; j < FingerprintSize; ++j)
+        {
+            lowTables[j] = _mm_load_si128( reinterpret_cast<const __m128i*>(LowNibbles[j]) );
+            highTables[j] = _mm_load_si128( reinterpret_cast<const __m128i*>(HighNibbles[j]) );
+        }
+
+        for (; i + 16 + FingerprintSize - 1 <= Size; i += 16)
+        {
+            __m128i buckets = _mm_set1_epi8(-1);
+
+            for (size_t j = 0; j < FingerprintSize; ++j)
+            {
+                const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>(Data + i + j) );
+                const __m128i lows = _mm_and_si128(chunk, nibbleMask);
+                const __m128i highs = _mm_and_si128(_mm_srli_epi16(chunk, 4), nibbleMask);
+
+                buckets = _mm_and_si128( buckets, _mm_and_si128( _mm_shuffle_epi8(lowTables[j], lows),
+                                                                 _mm_shuffle_epi8(highTables[j], highs) ) );
+            }
+
+            uint32_t candidates = ~static_cast<uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8(buckets, zero) ) ) & 0xFFFF;
+
+            if (0 != candidates)
+            {
+                alignas(16) uint8_t lanes[16];
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes), buckets);
+
+                while (0 != candidates)
+                {
+                    const unsigned lane = TrailingZeros(candidates);
+
+                    OnCandidates(i + lane, lanes[lane]);
+                    candidates &= (candidates - 1);
+                }
+            }
+        }
+
+        return i;
+    }
+
+    // Same as ScanSsse3, 32 positions at a time
+    template <typename OnCandidatesType>
+    TARGET_AVX2
+    size_t ScanAvx2(const uint8_t (*LowNibbles)[16], const uint8_t (*HighNibbles)[16], size_t FingerprintSize,
+                    const char* Data, size_t Size, OnCandidatesType&& OnCandidates)
+    {
+        const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i       lowTables[TEDDY_MAX_FINGERPRINT];
+        __m256i       highTables[TEDDY_MAX_FINGERPRINT];
+        size_t        i = 0;
+
+        // shuffles work per 128 bit lane: same table in both lanes
+        for (size_t j = 0; j < FingerprintSize; ++j)
+        {
+            lowTables[j] = _mm256_broadcastsi128_si256( _mm_load_si128( reinterpret_cast<const __m128i*>(LowNibbles[j]) ) );
+            highTables[j] = _mm256_broadcastsi128_si256( _mm_load_si128( reinterpret_cast<const __m128i*>(HighNibbles[j]) ) );
+        }
+
+        for (; i + 32 + FingerprintSize - 1 <= Size; i += 32)
+        {
+            __m256i buckets = _mm256_set1_epi8(-1);
+
+            for (size_t j = 0; j < FingerprintSize; ++j)
+            {
+                const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(Data + i + j) );
+                const __m256i lows = _mm256_and_si256(chunk, nibbleMask);
+                const __m256i highs = _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibbleMask);
+
+                buckets = _mm256_and_si256( buckets, _mm256_and_si256( _mm256_shuffle_epi8(lowTables[j], lows),
+                                                                       _mm256_shuffle_epi8(highTables[j], highs) ) );
+            }
+
+            uint32_t candidates = ~static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpeq_epi8(buckets, zero) ) );
+
+            if (0 != candidates)
+            {
+                alignas(32) uint8_t lanes[32];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), buckets);
+
+                while (0 != candidates)
+                {
+                    const unsigned lane = TrailingZeros(candidates);
+
+                    OnCandidates(i + lane, lanes[lane]);
+                    candidates &= (candidates - 1);
+                }
+            }
+        }
+
+        return i;
+    }
+#endif
+}
+
+TeddyMatcher::TeddyMatcher(const vector<string>& Patterns, bool IgnoreCase) : PatternMatcher(Patterns, IgnoreCase),
+    _fingerprintSize{ TEDDY_MAX_FINGERPRINT }, _useAvx2{ CpuFeatures::Detect().avx2 }, _lowNibbles{},
+    _highNibbles{}, _buckets(TEDDY_NUM_BUCKETS), _foldedPatterns{}
+{
+    for (auto&& pattern : _patterns)
+    {
+        _fingerprintSize = min(_fingerprintSize, pattern.size());
+        _foldedPatterns.push_back( _ignoreCase ? FoldCase(pattern) : pattern );
+    }
+
+    // patterns sharing a fingerprint prefix go to the same bucket, which keeps the number of
+    // buckets flagged per position (and so the verification work) low
+    vector<size_t> order(_patterns.size());
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+
+    sort(order.begin(), order.end(), [this](size_t Lhs, size_t Rhs)
+         { return _foldedPatterns[Lhs].compare(0, _fingerprintSize, _foldedPatterns[Rhs], 0, _fingerprintSize) < 0; });
+
+    for (size_t rank = 0; rank < order.size(); ++rank)
+    {
+        const size_t  bucket = (rank * TEDDY_NUM_BUCKETS) / order.size();
+        const string& pattern = _foldedPatterns[order[rank]];
+
+        _buckets[bucket].push_back(order[rank]);
+
+        for (size_t j = 0; j < _fingerprintSize; ++j)
+        {
+            const unsigned char ch = static_cast<unsigned char>(pattern[j]);
+
+            _lowNibbles[j][ch & 0x0F] |= static_cast<uint8_t>(1 << bucket);
+            _highNibbles[j][ch >> 4] |= static_cast<uint8_t>(1 << bucket);
+
+            // uppercase letters only differ by their high nibble
+            if ( _ignoreCase && IsAsciiLetter(pattern[j]) )
+            {
+                _highNibbles[j][(ch ^ 0x20) >> 4] |= static_cast<uint8_t>(1 << bucket);
+            }
+        }
+    }
+}
+
+bool TeddyMatcher::IsSupported()
+{
+    return CpuFeatures::Detect().ssse3;
+}
+
+uint8_t TeddyMatcher::Candidates(const char* Data, size_t Position) const
+{
+    uint8_t buckets = 0xFF;
+
+    for (size_t j = 0; j < _fingerprintSize; ++j)
+    {
+        const unsigned char ch = static_cast<unsigned char>(Data[Position + j]);
+
+        buckets &= (_lowNibbles[j][ch & 0x0F] & _highNibbles[j][ch >> 4]);
+    }
+
+    return buckets;
+}
+
+void TeddyMatcher::Verify(string_view Contents, size_t Position, uint8_t Buckets, vector<Match>& Matches) const
+{
+    while (0 != Buckets)
+    {
+        const unsigned bucket = TrailingZeros(Buckets);
+
+        for (auto pattern : _buckets[bucket])
+        {
+            const string& patternString = _foldedPatterns[pattern];
+
+            if ( (Position + patternString.size() <= Contents.size()) &&
+                 ( _ignoreCase ? EqualsFolded( Contents.data() + Position, patternString.data(), patternString.size() )
+                               : ( 0 == memcmp(Contents.data() + Position, patternString.data(), patternString.size()) ) ) )
+            {
+                Matches.push_back({ Position, pattern, patternString.size() });
+            }
+        }
+
+        Buckets &= static_cast<uint8_t>(Buckets - 1);
+    }
+}
+
+void TeddyMatcher::FindAll(string_view Contents, vector<Match>& Matches) const
+{
+    const size_t firstMatch = Matches.size();
+    size_t       position = 0;
+
+#ifdef CPU_X86
+    auto onCandidates = [this, Contents, &Matches](size_t Position, uint8_t Buckets)
+                        { Verify(Contents, Position, Buckets, Matches); };
+
+    if (_useAvx2)
+    {
+        position = ScanAvx2(_lowNibbles, _highNibbles, _fingerprintSize, Contents.data(), Contents.size(), onCandidates);
+    }
+    else
+    {
+        position = ScanSsse3(_lowNibbles, _highNibbles, _fingerprintSize, Contents.data(), Contents.size(), onCandidates);
+    }
+#endif
+
+    // tail: less than one vector left
+    for (; position + _fingerprintSize <= Contents.size(); ++position)
+    {
+        const uint8_t buckets = Candidates(Contents.data(), position);
+
+        if (0 != buckets)
+        {
+            Verify(Contents, position, buckets, Matches);
+        }
+    }
+
+    // positions are increasing, patterns of a same position are reported bucket by bucket
+    sort(Matches.begin() + firstMatch, Matches.end(), [](const Match& Lhs, const Match& Rhs)
+         { return (Lhs.position < Rhs.position) || ( (Lhs.position == Rhs.position) && (Lhs.pattern < Rhs.pattern) ); });
+}
+
+const char* TeddyMatcher::name() const
+{
+    return _useAvx2 ? "Teddy (AVX2)" : "Teddy (SSSE3)";
+}
@@ -0,0 +1,267 @@
+#include "threadpool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(int NumThreads) : _numThreads{ (NumThreads > 0) ? NumThreads : 1 }, _queues{}, _jobs{},
+    _queuedTasks{ 0 }, _taskEvents{ 0 }, _waitingWorkers{ 0 }, _stopping{ false }, _threads{}
+{
+    for (int i = 0; i < _numThreads; ++i)
+    {
+        _queues.push_back( make_unique<WorkerQueue>() );
+        _queues.back()->currentJob = nullptr;
+    }
+
+    for (int i = 0; i < _numThreads; ++i)
+    {
+        _threads.emplace_back(&ThreadPool::WorkerThread, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        _stopping = true;
+    }
+
+    _stateChanged.notify_all();
+
+    for (auto&& worker : _threads)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::Run(Source WorkSource)
+{
+    unique_lock<mutex> lock(_mutex);
+
+    _jobs.push_back( Job{ std::move(WorkSource), 0, 0, false, false } );
+
+    const auto job = prev( _jobs.end() );
+
+    _stateChanged.notify_all();
+    _stateChanged.wait(lock, [&job] { return job->isDone; });
+
+    _jobs.erase(job);
+}
+
+void ThreadPool::Push(int WorkerId, Task NewTask)
+{
+    Job* const job = _queues[WorkerId]->currentJob;
+
+    // counted first: a task can never be taken before being accounted for
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        ++_queuedTasks;
+        ++job->queuedTasks;
+    }
+
+    {
+        lock_guard<mutex> lock(_queues[WorkerId]->mutex);
+
+        _queues[WorkerId]->tasks.push_front( QueuedTask{ job, std::move(NewTask) } );
+    }
+
+    // the mutex is only taken when a worker waits for this event: it then either sees the event before
+    // sleeping, or sleeps already and gets the notification
+    ++_taskEvents;
+
+    if (0 != _waitingWorkers)
+    {
+        {
+            lock_guard<mutex> lock(_mutex);
+        }
+
+        _stateChanged.notify_all();
+    }
+    else
+    {
+        _stateChanged.notify_one();
+    }
+}
+
+int ThreadPool::size() const
+{
+    return _numThreads;
+}
+
+int ThreadPool::DefaultThreadCount()
+{
+    const unsigned hardwareThreads = thread::hardware_concurrency();
+
+    return (hardwareThreads > 0) ? static_cast<int>(hardwareThreads) : 1;
+}
+
+void ThreadPool::WorkerThread(int WorkerId)
+{
+    QueuedTask task{};
+
+    while (true)
+    {
+        if ( TakeTask(WorkerId, task) )
+        {
+            _queues[WorkerId]->currentJob = task.job;
+            task.task(WorkerId);
+            task.task = nullptr;
+            Finished(*task.job);
+            continue;
+        }
+
+        unique_lock<mutex> lock(_mutex);
+
+        if (0 != _queuedTasks)
+        {
+            // being pushed, or taken by another worker, right now: sleeps until it is in a deque, or gone
+            // A push that did not see this worker waiting counted its event before, and is found by
+            // looking at the deques again
+            ++_waitingWorkers;
+
+            const uint64_t taskEvents = _taskEvents;
+
+            if ( !HasQueuedTask() )
+            {
+                _stateChanged.wait(lock, [this, taskEvents] { return (taskEvents != _taskEvents) || _stopping; });
+            }
+
+            --_waitingWorkers;
+            continue;
+        }
+
+        Job* const job = NextSource();
+
+        if (nullptr != job)
+        {
+            ++job->runningTasks;
+            lock.unlock();
+
+            _queues[WorkerId]->currentJob = job;
+
+            const bool hasMoreWork = job->source(WorkerId);
+
+            lock.lock();
+
+            if (!hasMoreWork)
+            {
+                job->sourceExhausted = true;
+            }
+
+            lock.unlock();
+            Finished(*job);
+            continue;
+        }
+
+        if (_stopping)
+        {
+            break;
+        }
+
+        // running tasks may still push new ones, and new jobs may come
+        _stateChanged.wait(lock, [this] { return (0 != _queuedTasks) || _stopping || (nullptr != NextSource()); });
+    }
+}
+
+bool ThreadPool::TakeTask(int WorkerId, QueuedTask& NextTask)
+{
+    bool found = false;
+
+    // own tasks first, newest first
+    {
+        WorkerQueue&      own = *_queues[WorkerId];
+        lock_guard<mutex> lock(own.mutex);
+
+        if ( !own.tasks.empty() )
+        {
+            NextTask = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    // then the oldest task of the next workers
+    for (int i = 1; !found && (i < _numThreads); ++i)
+    {
+        WorkerQueue&      victim = *_queues[(WorkerId + i) % _numThreads];
+        lock_guard<mutex> lock(victim.mutex);
+
+        if ( !victim.tasks.empty() )
+        {
+            NextTask = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    if (found)
+    {
+        bool hasWaiters = false;
+
+        {
+            lock_guard<mutex> lock(_mutex);
+
+            --_queuedTasks;
+            --NextTask.job->queuedTasks;
+            ++NextTask.job->runningTasks;
+            ++_taskEvents;
+            hasWaiters = (0 != _waitingWorkers);
+        }
+
+        if (hasWaiters)
+        {
+            _stateChanged.notify_all();
+        }
+    }
+
+    return found;
+}
+
+bool ThreadPool::HasQueuedTask()
+{
+    for (auto&& queue : _queues)
+    {
+        lock_guard<mutex> lock(queue->mutex);
+
+        if ( !queue->tasks.empty() )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+ThreadPool::Job* ThreadPool::NextSource()
+{
+    Job* next = nullptr;
+
+    // the job with the fewest busy workers: a source blocked on I/O does not starve the other jobs
+    for (auto&& job : _jobs)
+    {
+        if ( !job.sourceExhausted && ( (nullptr == next) || (job.runningTasks < next->runningTasks) ) )
+        {
+            next = &job;
+        }
+    }
+
+    return next;
+}
+
+void ThreadPool::Finished(Job& FinishedJob)
+{
+    bool isDone = false;
+
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        --FinishedJob.runningTasks;
+        isDone = FinishedJob.sourceExhausted && (0 == FinishedJob.runningTasks) && (0 == FinishedJob.queuedTasks);
+        FinishedJob.isDone = isDone;
+    }
+
+    if (isDone)
+    {
+        _stateChanged.notify_all();
+    }
+}
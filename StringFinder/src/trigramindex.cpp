@@ -0,0 +1,794 @@
+#include "trigramindex.h"
+#include "directorywalker.h"
+#include "concurrentqueue.h"
+#include "resultwriter.h"
+#include "outputbuffer.h"
+#include "threadpool.h"
+#include "encoding.h"
+#include "casefolding.h"
+
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+#include <termcolor/termcolor.hpp>
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+    // Trigrams of a single file, handed over to the index writer in path order
+    struct IndexedFile
+    {
+        fs::path         path;
+        uint64_t         size;
+        uint64_t         writeTime;
+        vector<uint32_t> trigrams;  // sorted, unique
+    };
+
+    // Set of the trigrams found in a file: a bitmap of all possible trigrams plus the list of those set,
+    // so resetting the set costs as much as the number of trigrams found, not the size of the bitmap
+    class TrigramSet
+    {
+    public:
+        TrigramSet() : _bits(TRIGRAM_COUNT / 64), _found{}
+        {
+        }
+
+        void Insert(uint32_t Trigram)
+        {
+            uint64_t&      word = _bits[Trigram >> 6];
+            const uint64_t mask = uint64_t{ 1 } << (Trigram & 63);
+
+            if ( !(word & mask) )
+            {
+                word |= mask;
+                _found.push_back(Trigram);
+            }
+        }
+
+        // Moves the trigrams found so far, sorted, into Trigrams and resets the set
+        void Take(vector<uint32_t>& Trigrams)
+        {
+            for (auto&& trigram : _found)
+            {
+                _bits[trigram >> 6] = 0;
+            }
+
+            sort(_found.begin(), _found.end());
+            Trigrams.swap(_found);
+            _found.clear();
+        }
+
+    private:
+        vector<uint64_t> _bits;
+        vector<uint32_t> _found;
+    };
+
+    // Posting list being built, already delta encoded
+    struct PostingBuilder
+    {
+        vector<char> bytes;
+        uint32_t     count = 0;
+        uint32_t     lastFileId = 0;
+    };
+
+    // Writes the index file: file records as files are indexed, then posting lists, tables and footer
+    class IndexWriter
+    {
+    public:
+        IndexWriter(OutputBuffer& Output, const fs::path& Location, const fs::path& Root) :
+            _output{ Output }, _location{ Location.string() }, _offset{ 0 }, _fileOffsets{}, _postings{}, _directories{}
+        {
+            const string root = Root.u8string();
+
+            WriteBytes(INDEX_FILE_MAGIC);
+            WriteFixed(INDEX_FILE_VERSION, 4);
+            WriteFixed(0, 4);
+            WriteVarint( root.size() );
+            WriteBytes(root);
+        }
+
+        void AddFile(const IndexedFile& File)
+        {
+            const uint32_t fileId = static_cast<uint32_t>( _fileOffsets.size() );
+            const string   relativePath = RelativePath(File.path);
+
+            _fileOffsets.push_back(_offset);
+
+            WriteVarint( relativePath.size() );
+            WriteBytes(relativePath);
+            WriteFixed(File.size, 8);
+            WriteFixed(File.writeTime, 8);
+
+            for (auto&& trigram : File.trigrams)
+            {
+                PostingBuilder& posting = _postings[trigram];
+                char            buffer[MAX_VARINT_SIZE];
+                const size_t    size = EncodeVarint( (0 == posting.count) ? fileId : fileId - posting.lastFileId, buffer );
+
+                posting.bytes.insert(posting.bytes.end(), buffer, buffer + size);
+                posting.lastFileId = fileId;
+                ++posting.count;
+            }
+        }
+
+        // Directories are written by Finish()
+        void AddDirectory(const fs::path& Directory, uint64_t WriteTime)
+        {
+            _directories.emplace_back(RelativePath(Directory), WriteTime);
+        }
+
+        void Finish()
+        {
+            vector<uint32_t> trigrams{};
+            vector<uint64_t> postingOffsets{};
+
+            trigrams.reserve( _postings.size() );
+
+            for (auto&& posting : _postings)
+            {
+                trigrams.push_back(posting.first);
+            }
+
+            sort(trigrams.begin(), trigrams.end());
+
+            for (auto&& trigram : trigrams)
+            {
+                const vector<char>& bytes = _postings[trigram].bytes;
+
+                postingOffsets.push_back(_offset);
+                WriteBytes( string_view(bytes.data(), bytes.size()) );
+            }
+
+            const uint64_t directoriesOffset = _offset;
+
+            for (auto&& directory : _directories)
+            {
+                WriteVarint( directory.first.size() );
+                WriteBytes(directory.first);
+                WriteFixed(directory.second, 8);
+            }
+
+            const uint64_t fileTableOffset = _offset;
+
+            for (auto&& fileOffset : _fileOffsets)
+            {
+                WriteFixed(fileOffset, 8);
+            }
+
+            const uint64_t trigramTableOffset = _offset;
+
+            for (size_t i = 0; i < trigrams.size(); ++i)
+            {
+                WriteFixed(trigrams[i], 4);
+                WriteFixed(_postings[trigrams[i]].count, 4);
+                WriteFixed(postingOffsets[i], 8);
+            }
+
+            WriteFixed(_fileOffsets.size(), 8);
+            WriteFixed(trigrams.size(), 8);
+            WriteFixed(fileTableOffset, 8);
+            WriteFixed(trigramTableOffset, 8);
+            WriteFixed(_directories.size(), 8);
+            WriteFixed(directoriesOffset, 8);
+            WriteBytes(INDEX_FILE_END_MAGIC);
+        }
+
+        size_t fileCount() const
+        {
+            return _fileOffsets.size();
+        }
+
+        size_t trigramCount() const
+        {
+            return _postings.size();
+        }
+
+    private:
+        // Files are found under the location as given on the command line
+        string RelativePath(const fs::path& File) const
+        {
+            string       path = File.string();
+            const size_t separators = path.find_first_not_of("/\\", _location.size());
+
+            path.erase(0, (string::npos == separators) ? path.size() : separators);
+
+            return path;
+        }
+
+        void WriteBytes(string_view Bytes)
+        {
+            _output.Write(Bytes);
+            _offset += Bytes.size();
+        }
+
+        void WriteVarint(uint64_t Value)
+        {
+            char buffer[MAX_VARINT_SIZE];
+
+            WriteBytes( string_view(buffer, EncodeVarint(Value, buffer)) );
+        }
+
+        void WriteFixed(uint64_t Value, size_t Size)
+        {
+            char buffer[sizeof(uint64_t)];
+
+            EncodeFixed(Value, buffer, Size);
+            WriteBytes( string_view(buffer, Size) );
+        }
+
+        OutputBuffer&                              _output;
+        string                                     _location;
+        uint64_t                                   _offset;
+        vector<uint64_t>                           _fileOffsets;
+        unordered_map<uint32_t, PostingBuilder>    _postings;
+        vector< pair<string, uint64_t> >           _directories;
+    };
+
+    uint64_t WriteTime(const fs::path& File)
+    {
+        error_code error;
+
+        return static_cast<uint64_t>( fs::last_write_time(File, error).time_since_epoch().count() );
+    }
+
+    // Write time of a file or directory as it is indexed: 0 if it cannot be read, or may still change
+    // within the same write time (then it always looks modified)
+    uint64_t IndexedWriteTime(const fs::path& Path)
+    {
+        error_code               error;
+        const fs::file_time_type writeTime = fs::last_write_time(Path, error);
+
+        if ( error || (writeTime + chrono::nanoseconds(RACY_WRITE_TIME) > fs::file_time_type::clock::now()) )
+        {
+            return 0;
+        }
+
+        return static_cast<uint64_t>( writeTime.time_since_epoch().count() );
+    }
+
+    // Collects the trigrams of a single file
+    bool CollectTrigrams(const fs::path& File, TrigramSet& Trigrams, IndexedFile& Indexed)
+    {
+        MappedFile file{};
+
+        // before reading: a file modified while it is read looks modified
+        Indexed.writeTime = IndexedWriteTime(File);
+
+        if ( !file.Open(File) )
+        {
+            return false;
+        }
+
+        const string_view contents = file.contents();
+        uint32_t          trigram = 0;
+
+        for (size_t i = 0; i < contents.size(); ++i)
+        {
+            trigram = ( (trigram << 8) | static_cast<unsigned char>(contents[i]) ) & (TRIGRAM_COUNT - 1);
+
+            if (i >= 2)
+            {
+                Trigrams.Insert(trigram);
+            }
+        }
+
+        Indexed.path = File;
+        Indexed.size = contents.size();
+        Trigrams.Take(Indexed.trigrams);
+
+        return true;
+    }
+
+    uint32_t Trigram(const string& String, size_t Position)
+    {
+        return (static_cast<uint32_t>( static_cast<unsigned char>(String[Position]) ) << 16) |
+               (static_cast<uint32_t>( static_cast<unsigned char>(String[Position + 1]) ) << 8) |
+                static_cast<uint32_t>( static_cast<unsigned char>(String[Position + 2]) );
+    }
+}
+
+TrigramIndex::TrigramIndex() : _file{}, _contents{}, _root{}, _fileCount{ 0 }, _trigramCount{ 0 }, _directoryCount{ 0 },
+    _directories{ nullptr }, _fileTable{ nullptr }, _trigramTable{ nullptr }
+{
+}
+
+bool TrigramIndex::Build(const fs::path& Location, const fs::path& IndexFile, int NumThreads)
+{
+    error_code     error;
+    const fs::path root = fs::canonical(Location, error);
+    OutputBuffer   output{};
+
+    if (error)
+    {
+        cout << red << "Location: " << Location << " cannot be indexed: " << error.message() << reset << endl;
+        return false;
+    }
+
+    if ( !output.Open(IndexFile) )
+    {
+        return false;
+    }
+
+    // files are indexed in parallel, but recorded in path order: file ids follow the path order
+    ConcurrentQueue<fs::path> fileQueue{ FILE_QUEUE_CAPACITY };
+    DirectoryWalker           walker(Location, fileQueue, true);
+    ThreadPool                pool(NumThreads);
+    vector<TrigramSet>        trigramSets( pool.size() );
+    IndexWriter               indexWriter(output, Location, root);
+    ResultWriter<IndexedFile> writer([&indexWriter](IndexedFile& File) { indexWriter.AddFile(File); }, true);
+
+    // stamped before the walk: a directory changed while it is walked looks modified
+    if ( fs::is_directory(Location, error) )
+    {
+        indexWriter.AddDirectory( Location, IndexedWriteTime(Location) );
+
+        for (fs::recursive_directory_iterator iter(Location, error), end; !error && (iter != end); iter.increment(error))
+        {
+            if ( fs::is_directory( iter->symlink_status() ) )
+            {
+                indexWriter.AddDirectory( iter->path(), IndexedWriteTime( iter->path() ) );
+            }
+        }
+    }
+
+    writer.Start();
+    walker.Start();
+
+    pool.Run([&fileQueue, &writer, &trigramSets](int WorkerId)
+             {
+                 fs::path    file;
+                 uint64_t    sequence{ 0 };
+                 IndexedFile indexed{};
+
+                 if ( !fileQueue.Pop(file, sequence) )
+                 {
+                     return false;
+                 }
+
+                 writer.WaitForTurn(sequence);
+
+                 const bool isIndexed = CollectTrigrams(file, trigramSets[WorkerId], indexed);
+
+                 writer.Submit(sequence, std::move(indexed), isIndexed);
+
+                 return true;
+             });
+
+    walker.Wait();
+    writer.Finish();
+    indexWriter.Finish();
+    output.Flush();
+
+    cout << green << "Indexed <" << indexWriter.fileCount() << "> files, <" << indexWriter.trigramCount()
+         << "> trigrams into: " << IndexFile << reset << endl;
+
+    return true;
+}
+
+bool TrigramIndex::Open(const fs::path& IndexFile)
+{
+    if ( !_file.Open(IndexFile) )
+    {
+        return false;
+    }
+
+    _contents = _file.contents();
+
+    if ( (_contents.size() < INDEX_FILE_HEADER_SIZE + INDEX_FILE_FOOTER_SIZE) ||
+         (_contents.substr(0, INDEX_FILE_MAGIC.size()) != INDEX_FILE_MAGIC) ||
+         (_contents.substr(_contents.size() - INDEX_FILE_END_MAGIC.size()) != INDEX_FILE_END_MAGIC) )
+    {
+        return Invalid(IndexFile, "not an index file, or incomplete");
+    }
+
+    if (DecodeFixed(_contents.data() + INDEX_FILE_MAGIC.size(), 4) != INDEX_FILE_VERSION)
+    {
+        return Invalid(IndexFile, "unsupported version");
+    }
+
+    const char*    footer = _contents.data() + _contents.size() - INDEX_FILE_FOOTER_SIZE;
+    const uint64_t fileCount = DecodeFixed(footer, 8);
+    const uint64_t trigramCount = DecodeFixed(footer + 8, 8);
+    const uint64_t fileTableOffset = DecodeFixed(footer + 16, 8);
+    const uint64_t trigramTableOffset = DecodeFixed(footer + 24, 8);
+    const uint64_t directoryCount = DecodeFixed(footer + 32, 8);
+    const uint64_t directoriesOffset = DecodeFixed(footer + 40, 8);
+    const uint64_t footerOffset = _contents.size() - INDEX_FILE_FOOTER_SIZE;
+
+    if ( (trigramTableOffset > footerOffset) || (trigramCount != (footerOffset - trigramTableOffset) / TRIGRAM_ENTRY_SIZE) ||
+         (fileTableOffset < INDEX_FILE_HEADER_SIZE) || (fileTableOffset > trigramTableOffset) ||
+         (fileCount != (trigramTableOffset - fileTableOffset) / 8) || (directoriesOffset < INDEX_FILE_HEADER_SIZE) ||
+         (directoriesOffset > fileTableOffset) || (directoryCount > fileTableOffset - directoriesOffset) )
+    {
+        return Invalid(IndexFile, "malformed tables");
+    }
+
+    _fileCount = static_cast<size_t>(fileCount);
+    _trigramCount = static_cast<size_t>(trigramCount);
+    _directoryCount = static_cast<size_t>(directoryCount);
+    _directories = _contents.data() + directoriesOffset;
+    _fileTable = _contents.data() + fileTableOffset;
+    _trigramTable = _contents.data() + trigramTableOffset;
+
+    const char* data = _contents.data() + INDEX_FILE_HEADER_SIZE;
+    uint64_t    rootSize = 0;
+
+    if ( !DecodeVarint(data, _directories, rootSize) || (rootSize > static_cast<uint64_t>(_directories - data)) )
+    {
+        return Invalid(IndexFile, "malformed root");
+    }
+
+    _root = string_view(data, static_cast<size_t>(rootSize));
+
+    return true;
+}
+
+bool TrigramIndex::Candidates(const vector<string>& SearchStrings, const fs::path& Location,
+                              vector<fs::path>& Files, bool IgnoreCase) const
+{
+    error_code     error;
+    const fs::path location = fs::canonical(Location, error);
+
+    if ( error || (location.u8string() != _root) )
+    {
+        cout << red << "Index was built for: " << _root << ", not for: " << Location << reset << endl;
+        return false;
+    }
+
+    vector<uint32_t> fileIds{};
+    bool             matchesAll = false;
+
+    for (auto&& searchString : SearchStrings)
+    {
+        if (searchString.size() < 3)
+        {
+            // no trigram to filter on
+            matchesAll = true;
+            break;
+        }
+
+        const vector<uint32_t> stringFileIds = StringCandidates(searchString, IgnoreCase);
+
+        fileIds.insert(fileIds.end(), stringFileIds.begin(), stringFileIds.end());
+    }
+
+    if (matchesAll)
+    {
+        fileIds.resize(_fileCount);
+
+        for (size_t i = 0; i < _fileCount; ++i)
+        {
+            fileIds[i] = static_cast<uint32_t>(i);
+        }
+    }
+    else
+    {
+        sort(fileIds.begin(), fileIds.end());
+        fileIds.erase(unique(fileIds.begin(), fileIds.end()), fileIds.end());
+    }
+
+    vector<bool>     isCandidate(_fileCount, false);
+    vector<fs::path> addedFiles{};
+
+    for (auto&& fileId : fileIds)
+    {
+        isCandidate[fileId] = true;
+    }
+
+    // still searched: the contents of the files decide, whatever the index says
+    const size_t changedFiles = FindChangedFiles(Location, isCandidate, addedFiles);
+
+    Files.clear();
+
+    for (size_t fileId = 0; fileId < _fileCount; ++fileId)
+    {
+        string_view relativePath{};
+        uint64_t    size = 0;
+        uint64_t    writeTime = 0;
+
+        if ( isCandidate[fileId] && FileRecord(fileId, relativePath, size, writeTime) )
+        {
+            Files.push_back( relativePath.empty() ? Location : Location / fs::path( string(relativePath) ) );
+        }
+    }
+
+    Files.insert( Files.end(), addedFiles.begin(), addedFiles.end() );
+
+    if ( (changedFiles > 0) || !addedFiles.empty() )
+    {
+        cout << yellow << changedFiles << " indexed files changed and " << addedFiles.size() << " files added since "
+             << "the index was built: they are all searched; rebuild the index (--build-index)." << reset << endl;
+    }
+
+    return true;
+}
+
+size_t TrigramIndex::fileCount() const
+{
+    return _fileCount;
+}
+
+bool TrigramIndex::FileRecord(size_t FileId, string_view& RelativePath, uint64_t& Size, uint64_t& WriteTime) const
+{
+    const char* data = _contents.data() + DecodeFixed(_fileTable + 8 * FileId, 8);
+    uint64_t    pathSize = 0;
+
+    if ( (data < _contents.data() + INDEX_FILE_HEADER_SIZE) || (data >= _fileTable) ||
+         !DecodeVarint(data, _fileTable, pathSize) || (pathSize + 16 > static_cast<uint64_t>(_fileTable - data)) )
+    {
+        return false;
+    }
+
+    RelativePath = string_view(data, static_cast<size_t>(pathSize));
+    Size = DecodeFixed(data + pathSize, 8);
+    WriteTime = DecodeFixed(data + pathSize + 8, 8);
+
+    return true;
+}
+
+size_t TrigramIndex::FindChangedFiles(const fs::path& Location, vector<bool>& IsCandidate, vector<fs::path>& AddedFiles) const
+{
+    unordered_set<string_view> indexedFiles{};
+    unordered_set<string_view> indexedDirectories{};
+    size_t                     changedFiles = 0;
+    error_code                 error;
+
+    indexedFiles.reserve(_fileCount);
+
+    // a stat per indexed file
+    for (size_t fileId = 0; fileId < _fileCount; ++fileId)
+    {
+        string_view relativePath{};
+        uint64_t    size = 0;
+        uint64_t    writeTime = 0;
+
+        if ( !FileRecord(fileId, relativePath, size, writeTime) )
+        {
+            continue;
+        }
+
+        const fs::path file = relativePath.empty() ? Location : Location / fs::path( string(relativePath) );
+        const uint64_t currentSize = fs::file_size(file, error);
+
+        indexedFiles.insert(relativePath);
+
+        // removed files are not searched
+        if ( error || (currentSize != size) || (WriteTime(file) != writeTime) )
+        {
+            ++changedFiles;
+            IsCandidate[fileId] = IsCandidate[fileId] || !error;
+        }
+    }
+
+    vector< pair<string_view, uint64_t> > directories{};
+    const char*                           data = _directories;
+
+    for (size_t i = 0; i < _directoryCount; ++i)
+    {
+        uint64_t pathSize = 0;
+
+        if ( !DecodeVarint(data, _fileTable, pathSize) || (pathSize + 8 > static_cast<uint64_t>(_fileTable - data)) )
+        {
+            break;
+        }
+
+        directories.emplace_back( string_view(data, static_cast<size_t>(pathSize)), DecodeFixed(data + pathSize, 8) );
+        indexedDirectories.insert(directories.back().first);
+        data += pathSize + 8;
+    }
+
+    // entries are only added to (or renamed into) a directory by changing its write time
+    for (auto&& directory : directories)
+    {
+        const fs::path path = directory.first.empty() ? Location : Location / fs::path( string(directory.first) );
+
+        if (WriteTime(path) == directory.second)
+        {
+            continue;
+        }
+
+        const fs::path relativeDirectory( string(directory.first) );
+
+        for (fs::directory_iterator iter(path, error), end; !error && (iter != end); iter.increment(error))
+        {
+            // same form as the indexed paths
+            const string relativePath = (relativeDirectory / iter->path().filename()).string();
+            error_code   entryError;
+
+            if ( fs::is_directory( iter->symlink_status() ) )
+            {
+                if ( indexedDirectories.count(relativePath) > 0 )
+                {
+                    continue;
+                }
+
+                // everything under a new directory is new
+                error_code walkError;
+
+                for (fs::recursive_directory_iterator file(iter->path(), walkError), last; !walkError && (file != last);
+                     file.increment(walkError))
+                {
+                    if ( file->is_regular_file(entryError) )
+                    {
+                        AddedFiles.push_back( file->path() );
+                    }
+                }
+            }
+            else if ( iter->is_regular_file(entryError) && (0 == indexedFiles.count(relativePath)) )
+            {
+                AddedFiles.push_back( iter->path() );
+            }
+        }
+
+        error.clear();
+    }
+
+    sort( AddedFiles.begin(), AddedFiles.end() );
+
+    return changedFiles;
+}
+
+bool TrigramIndex::PostingList(uint32_t Trigram, vector<uint32_t>& FileIds) const
+{
+    size_t low = 0;
+    size_t high = _trigramCount;
+
+    FileIds.clear();
+
+    // binary search in the trigram table
+    while (low < high)
+    {
+        const size_t middle = low + (high - low) / 2;
+
+        if (DecodeFixed(_trigramTable + middle * TRIGRAM_ENTRY_SIZE, 4) < Trigram)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    const char* entry = _trigramTable + low * TRIGRAM_ENTRY_SIZE;
+
+    if ( (low == _trigramCount) || (DecodeFixed(entry, 4) != Trigram) )
+    {
+        return false;
+    }
+
+    const uint64_t count = DecodeFixed(entry + 4, 4);
+    const uint64_t offset = DecodeFixed(entry + 8, 8);
+    const char*    data = _contents.data() + offset;
+    uint64_t       fileId = 0;
+
+    if ( (offset < INDEX_FILE_HEADER_SIZE) || (data > _directories) )
+    {
+        return false;
+    }
+
+    FileIds.reserve(static_cast<size_t>(count));
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        uint64_t delta = 0;
+
+        if ( !DecodeVarint(data, _directories, delta) )
+        {
+            break;
+        }
+
+        fileId = (0 == i) ? delta : fileId + delta;
+
+        if (fileId >= _fileCount)
+        {
+            break;
+        }
+
+        FileIds.push_back( static_cast<uint32_t>(fileId) );
+    }
+
+    return !FileIds.empty();
+}
+
+vector<uint32_t> TrigramIndex::StringCandidates(const string& SearchString, bool IgnoreCase) const
+{
+    const string     searchString = IgnoreCase ? FoldCase(SearchString) : SearchString;
+    vector<uint32_t> trigrams{};
+    vector<uint32_t> candidates{};
+    vector<uint32_t> postingList{};
+    vector<uint32_t> intersection{};
+
+    for (size_t i = 0; i + 3 <= searchString.size(); ++i)
+    {
+        trigrams.push_back( Trigram(searchString, i) );
+    }
+
+    sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    for (size_t i = 0; i < trigrams.size(); ++i)
+    {
+        if ( !TrigramCandidates(trigrams[i], IgnoreCase, postingList) )
+        {
+            // a trigram found nowhere: the search string cannot be found either
+            return vector<uint32_t>();
+        }
+
+        if (0 == i)
+        {
+            candidates.swap(postingList);
+        }
+        else
+        {
+            // both lists are sorted
+            intersection.clear();
+            set_intersection(candidates.begin(), candidates.end(), postingList.begin(), postingList.end(),
+                             back_inserter(intersection));
+            candidates.swap(intersection);
+        }
+
+        if ( candidates.empty() )
+        {
+            break;
+        }
+    }
+
+    return candidates;
+}
+
+bool TrigramIndex::TrigramCandidates(uint32_t Trigram, bool IgnoreCase, vector<uint32_t>& FileIds) const
+{
+    vector<uint32_t> variants{ Trigram };
+    vector<uint32_t> postingList{};
+
+    if (IgnoreCase)
+    {
+        // the trigram is folded: every letter also gets its uppercase variant
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            if ( IsAsciiLetter( static_cast<char>(Trigram >> shift) ) )
+            {
+                const size_t count = variants.size();
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    variants.push_back( variants[i] ^ (0x20u << shift) );
+                }
+            }
+        }
+    }
+
+    if (1 == variants.size())
+    {
+        return PostingList(Trigram, FileIds);
+    }
+
+    FileIds.clear();
+
+    for (auto&& variant : variants)
+    {
+        if ( PostingList(variant, postingList) )
+        {
+            FileIds.insert( FileIds.end(), postingList.begin(), postingList.end() );
+        }
+    }
+
+    sort(FileIds.begin(), FileIds.end());
+    FileIds.erase(unique(FileIds.begin(), FileIds.end()), FileIds.end());
+
+    return !FileIds.empty();
+}
+
+bool TrigramIndex::Invalid(const fs::path& IndexFile, const char* Reason)
+{
+    cout << red << "Index file: " << IndexFile << " is invalid: " << Reason << reset << endl;
+    _file.Close();
+    _contents = string_view();
+
+    return false;
+}
@@ -0,0 +1,157 @@
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <termcolor/termcolor.hpp>
+
+#include "benchmark.h"
+#include "corpusgenerator.h"
+#include "threadpool.h"
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+    void PrintHelp()
+    {
+        cout << yellow << "Usage: StringFinderBench.exe [options]" << endl
+             << "Options:" << endl
+             << "  -h, --help           prints this help" << endl
+             << "  --corpus <directory> where the synthetic corpora are generated (default: <temp>/stringfinder-bench)" << endl
+             << "  --scale <factor>     multiplies the number of files (or their size, for huge files); default: 1" << endl
+             << "  --only <corpus>      only runs this corpus; may be repeated" << endl
+             << "  -j <threads>         number of search threads (default: one per hardware thread)" << endl
+             << "  --repeat <count>     repetitions of every corpus, the fastest is kept (default: 3)" << endl
+             << "  --engine <engine>    literal (default) or regex: the patterns of the corpora, escaped, run as regular expressions" << endl
+             << "  --json <file>        also writes the results to <file>, as JSON" << reset << endl;
+    }
+
+    // Regular expression matching Pattern literally
+    string EscapeRegex(const string& Pattern)
+    {
+        string escaped{};
+
+        for (auto&& c : Pattern)
+        {
+            if ( !isalnum( static_cast<unsigned char>(c) ) && (static_cast<unsigned char>(c) < 0x80) )
+            {
+                escaped += '\\';
+            }
+
+            escaped += c;
+        }
+
+        return escaped;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    fs::path       corpusRoot = fs::temp_directory_path() / "stringfinder-bench";
+    fs::path       jsonFile{};
+    double         scale = 1.0;
+    int            numThreads = ThreadPool::DefaultThreadCount();
+    int            repetitions = 3;
+    bool           isRegex = false;
+    vector<string> only{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string argument(argv[i]);
+
+        // the only option without a value
+        if ( ("-h" == argument) || ("--help" == argument) )
+        {
+            PrintHelp();
+            return 0;
+        }
+
+        // every other option takes a value
+        if (i + 1 == argc)
+        {
+            cout << red << "Missing value for option: " << argument << reset << endl;
+            PrintHelp();
+            return 1;
+        }
+        else if ("--corpus" == argument)
+        {
+            corpusRoot = argv[++i];
+        }
+        else if ("--scale" == argument)
+        {
+            scale = atof(argv[++i]);
+        }
+        else if ("--only" == argument)
+        {
+            only.emplace_back(argv[++i]);
+        }
+        else if ("-j" == argument)
+        {
+            numThreads = atoi(argv[++i]);
+        }
+        else if ("--repeat" == argument)
+        {
+            repetitions = atoi(argv[++i]);
+        }
+        else if ("--json" == argument)
+        {
+            jsonFile = argv[++i];
+        }
+        else if ( ("--engine" == argument) && ( ("literal" == string(argv[i + 1])) || ("regex" == string(argv[i + 1])) ) )
+        {
+            isRegex = ("regex" == string(argv[++i]));
+        }
+        else
+        {
+            PrintHelp();
+            return 1;
+        }
+    }
+
+    if ( (scale <= 0) || (numThreads < 1) || (repetitions < 1) )
+    {
+        cout << red << "Invalid arguments" << reset << endl;
+        PrintHelp();
+        return 1;
+    }
+
+    CorpusGenerator         generator(corpusRoot);
+    Benchmark               benchmark(numThreads, repetitions, isRegex);
+    vector<BenchmarkResult> results{};
+
+    cout << green << "Benchmarking using <" << numThreads << "> threads, corpora in " << corpusRoot << reset << endl;
+
+    for (auto&& spec : CorpusGenerator::DefaultSpecs(scale))
+    {
+        fs::path directory{};
+
+        if ( !only.empty() && (find(only.begin(), only.end(), spec.name) == only.end()) )
+        {
+            continue;
+        }
+
+        if ( !generator.Generate(spec, directory) )
+        {
+            return 1;
+        }
+
+        vector<string> patterns = spec.patterns;
+
+        if (isRegex)
+        {
+            transform(patterns.begin(), patterns.end(), patterns.begin(), EscapeRegex);
+        }
+
+        results.push_back( benchmark.Run(spec.name, directory, patterns) );
+        Benchmark::Print( results.back() );
+    }
+
+    if ( !jsonFile.empty() && !Benchmark::WriteJson(jsonFile, results, numThreads) )
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+#include "searchengine.h"
+
+namespace fs = std::filesystem;
+
+// Measurements of one corpus, from the fastest of all repetitions; times are in seconds
+struct BenchmarkResult
+{
+    std::string name;
+    uint64_t    files;        // searched
+    uint64_t    bytes;        // searched
+    uint64_t    matches;
+    double      elapsedTime;  // wall clock time of the whole search
+    double      walkTime;     // stages (see Statistics), summed over the threads running them
+    double      readTime;
+    double      waitTime;
+    double      searchTime;
+    double      affixTime;
+    double      outputTime;   // formatting the results as text (ResultFormatter)
+    uint64_t    peakMemory;   // peak resident set size while running the corpus, in bytes; 0 if unknown
+};
+
+// Class used to time searches over a corpus, run exactly as the command line runs them: a
+// DataExtractor on a SearchEngine, its results handed to a callback that formats them as text to the
+// null device
+// Stages overlap (files are searched while the tree is walked), so the time of each stage comes from
+// the statistics of the search, while throughput is computed from the elapsed time
+// Results can be written as JSON, to track them across versions
+class Benchmark
+{
+public:
+    // With IsRegex, patterns are regular expressions (see RegexMatcher)
+    Benchmark(int NumThreads, int Repetitions, bool IsRegex = false);
+
+    Benchmark(const Benchmark& b) = delete;
+
+    Benchmark& operator=(const Benchmark& b) = delete;
+
+    // Searches Directory for Patterns
+    BenchmarkResult Run(const std::string& Name, const fs::path& Directory, const std::vector<std::string>& Patterns);
+
+    // Displays a result on the standard output
+    static void Print(const BenchmarkResult& Result);
+
+    // Writes all results to a JSON file; returns false if it cannot be written
+    static bool WriteJson(const fs::path& FileName, const std::vector<BenchmarkResult>& Results, int NumThreads);
+
+private:
+    // Resets the peak resident set size, where the system allows it
+    static void ResetPeakMemory();
+
+    // Peak resident set size since the last reset, in bytes; 0 if unknown
+    static uint64_t PeakMemory();
+
+    int          _numThreads;
+    int          _repetitions;
+    bool         _isRegex;
+    SearchEngine _engine;
+};
+
+#endif // BENCHMARK_H
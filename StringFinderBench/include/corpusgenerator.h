@@ -0,0 +1,63 @@
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr uint64_t CORPUS_SEED = 20180426;
+    constexpr size_t   FILES_PER_DIRECTORY = 256;
+    constexpr size_t   TEXT_LINE_SIZE = 80;
+    constexpr char     CORPUS_STAMP_FILE[] = "corpus.stamp";
+}
+
+// Parameters of one synthetic corpus
+struct CorpusSpec
+{
+    std::string              name;
+    size_t                   fileCount;
+    uint64_t                 fileSize;    // in bytes
+    bool                     isBinary;    // random bytes instead of lines of words
+    double                   hitDensity;  // planted pattern occurrences per MB
+    std::vector<std::string> patterns;
+};
+
+// Class used to write reproducible synthetic corpora: the same seed and parameters always give
+// byte identical files, so results of different versions are comparable
+// Text corpora are lines of words drawn from a fixed vocabulary which contains none of the patterns;
+// binary corpora are random bytes; patterns are planted at random positions, hitDensity times per
+// MB on average
+// Files are spread over subdirectories of FILES_PER_DIRECTORY files; a stamp file records the
+// parameters, so a corpus already generated with the same ones is reused as is
+class CorpusGenerator
+{
+public:
+    explicit CorpusGenerator(const fs::path& Root, uint64_t Seed = CORPUS_SEED);
+
+    CorpusGenerator(const CorpusGenerator& g) = delete;
+
+    CorpusGenerator& operator=(const CorpusGenerator& g) = delete;
+
+    // Writes the corpus of Spec into Root/<name>, unless already there; returns false on write errors
+    bool Generate(const CorpusSpec& Spec, fs::path& Directory);
+
+    // The standard corpora; Scale multiplies the number of files (or their size, for huge files)
+    static std::vector<CorpusSpec> DefaultSpecs(double Scale);
+
+private:
+    // Text of the stamp file of Spec
+    std::string Stamp(const CorpusSpec& Spec) const;
+
+    // Writes a single file of Spec
+    bool WriteFile(const fs::path& File, const CorpusSpec& Spec, std::mt19937_64& Random) const;
+
+    fs::path _root;
+    uint64_t _seed;
+};
+
+#endif // CORPUSGENERATOR_H
@@ -0,0 +1,182 @@
+#include "benchmark.h"
+#include "corpusgenerator.h"
+#include "dataextractor.h"
+#include "outputbuffer.h"
+#include "resultformatter.h"
+#include "searchoptions.h"
+#include "statistics.h"
+
+#include <chrono>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <termcolor/termcolor.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+    double SecondsSince(chrono::steady_clock::time_point Start)
+    {
+        return chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+    }
+}
+
+Benchmark::Benchmark(int NumThreads, int Repetitions, bool IsRegex) : _numThreads{ NumThreads },
+    _repetitions{ max(Repetitions, 1) }, _isRegex{ IsRegex }, _engine{ NumThreads }
+{
+}
+
+BenchmarkResult Benchmark::Run(const string& Name, const fs::path& Directory, const vector<string>& Patterns)
+{
+    BenchmarkResult result{ Name, 0, 0, 0, 1e9, 0, 0, 0, 0, 0, 0, 0 };
+    SearchOptions   options{};
+
+    options.numThreads = _numThreads;
+    options.regex = _isRegex;
+    // the stage times come from the statistics, which are not displayed
+    options.showStatistics = true;
+    // not part of the corpus
+    options.excludedGlobs = { CORPUS_STAMP_FILE };
+
+    ResetPeakMemory();
+
+    for (int repetition = 0; repetition < _repetitions; ++repetition)
+    {
+        DataExtractor search(Patterns, Directory.string(), options);
+        OutputBuffer  output{};
+
+#ifdef _WIN32
+        output.Open("NUL");
+#else
+        output.Open("/dev/null");
+#endif
+
+        unique_ptr<ResultFormatter> formatter = ResultFormatter::Create(SearchOptions::TEXT, output, Patterns);
+        const auto                  start = chrono::steady_clock::now();
+
+        // handed over one file at a time, as soon as it is searched: the corpus is never held in memory
+        _engine.Run(search, [&formatter](const fs::path& File, const StringData& Data)
+                            {
+                                formatter->WriteFile(File, Data);
+                            });
+
+        formatter->Finish();
+        output.Flush();
+
+        const double      elapsedTime = SecondsSince(start);
+        const Statistics& statistics = *search.statistics();
+
+        if (elapsedTime < result.elapsedTime)
+        {
+            result.files = statistics.counter(Statistics::FILES_SEARCHED);
+            result.bytes = statistics.counter(Statistics::BYTES_SEARCHED);
+            result.matches = statistics.counter(Statistics::MATCHES);
+            result.elapsedTime = elapsedTime;
+            result.walkTime = statistics.seconds(Statistics::WALK_TIME);
+            result.readTime = statistics.seconds(Statistics::READ_TIME);
+            result.waitTime = statistics.seconds(Statistics::WAIT_TIME);
+            result.searchTime = statistics.seconds(Statistics::SEARCH_TIME);
+            result.affixTime = statistics.seconds(Statistics::AFFIX_TIME);
+            result.outputTime = statistics.seconds(Statistics::OUTPUT_TIME);
+        }
+    }
+
+    result.peakMemory = PeakMemory();
+
+    return result;
+}
+
+void Benchmark::Print(const BenchmarkResult& Result)
+{
+    const double elapsedTime = Result.elapsedTime;
+
+    cout << "Corpus <" << green << Result.name << reset << ">: " << Result.files << " files, " << Result.bytes
+         << " bytes, " << Result.matches << " matches in <" << green << elapsedTime << reset << "> sec." << endl
+         << "  throughput: <" << green << Result.bytes / elapsedTime / 1e9 << reset << "> GB/s, <"
+         << green << Result.files / elapsedTime << reset << "> files/s, <"
+         << green << Result.matches / elapsedTime << reset << "> matches/s" << endl
+         << "  stages (sec., all threads): walk <" << green << Result.walkTime << reset << ">, read <"
+         << green << Result.readTime << reset << ">, wait <" << green << Result.waitTime << reset << ">, search <"
+         << green << Result.searchTime << reset << ">, affixes <" << green << Result.affixTime << reset
+         << ">, output <" << green << Result.outputTime << reset << ">" << endl
+         << "  peak memory: <" << green << Result.peakMemory / 1048576 << reset << "> MB" << endl;
+}
+
+bool Benchmark::WriteJson(const fs::path& FileName, const vector<BenchmarkResult>& Results, int NumThreads)
+{
+    ofstream jsonStream(FileName, ios::trunc);
+
+    jsonStream << "{\"threads\":" << NumThreads << ",\"corpora\":[";
+
+    for (size_t i = 0; i < Results.size(); ++i)
+    {
+        const BenchmarkResult& result = Results[i];
+        const double           elapsedTime = result.elapsedTime;
+
+        // corpus names are plain ASCII: no escaping needed
+        jsonStream << (i > 0 ? "," : "") << "\n{\"name\":\"" << result.name << "\",\"files\":" << result.files
+                   << ",\"bytes\":" << result.bytes << ",\"matches\":" << result.matches
+                   << ",\"gb_per_s\":" << result.bytes / elapsedTime / 1e9 << ",\"files_per_s\":" << result.files / elapsedTime
+                   << ",\"matches_per_s\":" << result.matches / elapsedTime << ",\"peak_rss\":" << result.peakMemory
+                   << ",\"elapsed\":" << elapsedTime << ",\"stages\":{\"walk\":" << result.walkTime
+                   << ",\"read\":" << result.readTime << ",\"wait\":" << result.waitTime
+                   << ",\"search\":" << result.searchTime << ",\"affixes\":" << result.affixTime
+                   << ",\"output\":" << result.outputTime << "}}";
+    }
+
+    jsonStream << "\n]}\n";
+
+    if ( !jsonStream.good() )
+    {
+        cout << red << "Results file: " << FileName << " cannot be written." << reset << endl;
+        return false;
+    }
+
+    return true;
+}
+
+void Benchmark::ResetPeakMemory()
+{
+#ifdef __linux__
+    // Linux 4.0 and later: resets VmHWM
+    ofstream clearStream("/proc/self/clear_refs");
+
+    clearStream << "5";
+#endif
+}
+
+uint64_t Benchmark::PeakMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ) )
+    {
+        return counters.PeakWorkingSetSize;
+    }
+
+    return 0;
+#elif defined(__linux__)
+    ifstream statusStream("/proc/self/status");
+    string   line{};
+
+    while ( getline(statusStream, line) )
+    {
+        if (0 == line.compare(0, 6, "VmHWM:"))
+        {
+            return stoull( line.substr(6) ) * 1024;
+        }
+    }
+
+    return 0;
+#else
+    return 0;
+#endif
+}
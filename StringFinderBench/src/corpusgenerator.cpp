@@ -0,0 +1,209 @@
+#include "corpusgenerator.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <termcolor/termcolor.hpp>
+
+using namespace std;
+using namespace termcolor;
+
+namespace {
+    // No word contains a pattern of the default specs, so only planted occurrences are found
+    const char* const VOCABULARY[] = { "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+                                       "elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore",
+                                       "et", "dolore", "magna", "aliqua", "enim", "ad", "minim", "veniam",
+                                       "quis", "nostrud", "exercitation", "ullamco", "laboris", "nisi",
+                                       "aliquip", "ex", "ea", "commodo", "consequat", "duis", "aute", "irure",
+                                       "in", "reprehenderit", "voluptate", "velit", "esse", "cillum", "fugiat",
+                                       "nulla", "pariatur", "excepteur", "sint", "occaecat", "cupidatat" };
+
+    // 64 bit FNV-1a; unlike std::hash, the same on every platform
+    uint64_t NameHash(const string& Name)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+
+        for (auto&& character : Name)
+        {
+            hash ^= static_cast<unsigned char>(character);
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+    // Pseudo random lowercase strings
+    vector<string> RandomPatterns(size_t Count, size_t MinSize, size_t MaxSize, uint64_t Seed)
+    {
+        mt19937_64     random(Seed);
+        vector<string> patterns{};
+
+        while (patterns.size() < Count)
+        {
+            string pattern(MinSize + random() % (MaxSize - MinSize + 1), ' ');
+
+            for (auto&& character : pattern)
+            {
+                character = static_cast<char>( 'a' + random() % 26 );
+            }
+
+            // marks them as planted: the vocabulary has no 'q' followed by 'x'
+            pattern[0] = 'q';
+            pattern[1] = 'x';
+
+            if ( find(patterns.begin(), patterns.end(), pattern) == patterns.end() )
+            {
+                patterns.push_back(pattern);
+            }
+        }
+
+        return patterns;
+    }
+}
+
+CorpusGenerator::CorpusGenerator(const fs::path& Root, uint64_t Seed) : _root{ Root }, _seed{ Seed }
+{
+}
+
+bool CorpusGenerator::Generate(const CorpusSpec& Spec, fs::path& Directory)
+{
+    const string stamp = Stamp(Spec);
+    error_code   error;
+
+    Directory = _root / Spec.name;
+
+    {
+        ifstream      stampStream(Directory / CORPUS_STAMP_FILE, ios::binary);
+        ostringstream previousStamp{};
+
+        previousStamp << stampStream.rdbuf();
+
+        if ( stampStream.good() && (previousStamp.str() == stamp) )
+        {
+            return true;
+        }
+    }
+
+    cout << yellow << "Generating corpus <" << Spec.name << "> (" << Spec.fileCount << " files of "
+         << Spec.fileSize << " bytes) ..." << reset << endl;
+
+    fs::remove_all(Directory, error);
+
+    // every corpus has its own sequence, whatever the corpora generated before it
+    mt19937_64 random( _seed ^ NameHash(Spec.name) );
+
+    for (size_t i = 0; i < Spec.fileCount; ++i)
+    {
+        const fs::path subdirectory = Directory / ( "d" + to_string(i / FILES_PER_DIRECTORY) );
+
+        fs::create_directories(subdirectory, error);
+
+        if ( error || !WriteFile(subdirectory / ( "f" + to_string(i) + (Spec.isBinary ? ".bin" : ".txt") ), Spec, random) )
+        {
+            cout << red << "Corpus: " << Directory << " cannot be written." << reset << endl;
+            return false;
+        }
+    }
+
+    ofstream stampStream(Directory / CORPUS_STAMP_FILE, ios::binary | ios::trunc);
+
+    stampStream << stamp;
+
+    return stampStream.good();
+}
+
+vector<CorpusSpec> CorpusGenerator::DefaultSpecs(double Scale)
+{
+    const auto count = [Scale](size_t Count) { return max<size_t>(1, static_cast<size_t>(Count * Scale)); };
+
+    return {
+        { "tiny-files",    count(20000), 2048,             false, 50,    { "qxneedle", "qxhaystack" } },
+        { "huge-files",    2,            count(268435456), false, 5,     { "qxneedle" } },
+        { "dense-hits",    count(64),    1048576,          false, 20000, { "qxneedle", "qxpin" } },
+        { "sparse-hits",   count(64),    1048576,          false, 1,     { "qxneedle", "qxpin" } },
+        { "binary",        count(64),    1048576,          true,  10,    { "qxneedle" } },
+        { "long-patterns", count(64),    1048576,          false, 50,    RandomPatterns(8, 100, 120, 1) },
+        { "many-patterns", count(64),    1048576,          false, 100,   RandomPatterns(300, 6, 12, 2) }
+    };
+}
+
+string CorpusGenerator::Stamp(const CorpusSpec& Spec) const
+{
+    ostringstream stamp{};
+
+    stamp << "seed " << _seed << "\nfiles " << Spec.fileCount << "\nsize " << Spec.fileSize << "\nbinary "
+          << Spec.isBinary << "\ndensity " << Spec.hitDensity << "\n";
+
+    for (auto&& pattern : Spec.patterns)
+    {
+        stamp << "pattern " << pattern << "\n";
+    }
+
+    return stamp.str();
+}
+
+bool CorpusGenerator::WriteFile(const fs::path& File, const CorpusSpec& Spec, mt19937_64& Random) const
+{
+    const size_t vocabularySize = sizeof(VOCABULARY) / sizeof(VOCABULARY[0]);
+    string       contents{};
+    size_t       lineSize = 0;
+
+    contents.reserve( static_cast<size_t>(Spec.fileSize) );
+
+    if (Spec.isBinary)
+    {
+        while ( contents.size() < Spec.fileSize )
+        {
+            contents.push_back( static_cast<char>( Random() & 0xFF ) );
+        }
+    }
+
+    while ( contents.size() < Spec.fileSize )
+    {
+        const char* word = VOCABULARY[Random() % vocabularySize];
+
+        contents += word;
+        lineSize += strlen(word) + 1;
+
+        if (lineSize >= TEXT_LINE_SIZE)
+        {
+            contents.push_back('\n');
+            lineSize = 0;
+        }
+        else
+        {
+            contents.push_back(' ');
+        }
+    }
+
+    contents.resize( static_cast<size_t>(Spec.fileSize) );
+
+    // exponential gaps: occurrences are independent, hitDensity per MB on average
+    // (computed here: the standard distributions differ between libraries)
+    const double meanGap = 1048576.0 / Spec.hitDensity;
+    const auto   gap = [&Random, meanGap]
+                       {
+                           // uniform in [0, 1), from the 53 high bits
+                           return -log( 1.0 - static_cast<double>(Random() >> 11) / 9007199254740992.0 ) * meanGap;
+                       };
+
+    for (double position = gap(); position < contents.size(); position += gap())
+    {
+        const string& pattern = Spec.patterns[Random() % Spec.patterns.size()];
+        const size_t  start = static_cast<size_t>(position);
+
+        if ( start + pattern.size() <= contents.size() )
+        {
+            contents.replace( start, pattern.size(), pattern );
+        }
+    }
+
+    ofstream fileStream(File, ios::binary | ios::trunc);
+
+    fileStream.write( contents.data(), static_cast<streamsize>( contents.size() ) );
+
+    return fileStream.good();
+}
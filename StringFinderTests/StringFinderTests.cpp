@@ -0,0 +1,63 @@
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <termcolor/termcolor.hpp>
+
+#include "testcontext.h"
+
+using namespace std;
+using namespace termcolor;
+
+// Runs every test suite, or only the suites given as arguments; returns 1 if any check failed
+int main(int argc, char *argv[])
+{
+    const vector< pair<string, TestSuite> > suites{
+        { "patternmatcher", TestPatternMatchers },
+        { "streamscanner",  TestStreamScanner },
+        { "regex",          TestRegexMatcher },
+        { "filefilter",     TestFileFilters },
+        { "searchengine",   TestSearchEngine },
+        { "resultfiles",    TestResultFiles },
+        { "persistence",    TestPersistence },
+        { "watch",          TestWatchMode }
+    };
+    vector<string> selected(argv + 1, argv + argc);
+    size_t         failedSuites = 0;
+
+    for (auto&& name : selected)
+    {
+        if ( find_if(suites.begin(), suites.end(), [&name](const pair<string, TestSuite>& Suite) { return Suite.first == name; })
+             == suites.end() )
+        {
+            cout << red << "Unknown test suite: " << name << reset << endl;
+            return 1;
+        }
+    }
+
+    for (auto&& suite : suites)
+    {
+        if ( !selected.empty() && (find(selected.begin(), selected.end(), suite.first) == selected.end()) )
+        {
+            continue;
+        }
+
+        TestContext context(suite.first);
+
+        suite.second(context);
+
+        if (0 == context.failures())
+        {
+            cout << green << "[" << suite.first << "] passed: <" << context.checks() << "> checks." << reset << endl;
+        }
+        else
+        {
+            cout << red << "[" << suite.first << "] failed: <" << context.failures() << "> of <" << context.checks()
+                 << "> checks." << reset << endl;
+            ++failedSuites;
+        }
+    }
+
+    return (0 == failedSuites) ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#ifndef TESTCONTEXT_H
+#define TESTCONTEXT_H
+
+#include <string>
+#include <cstdint>
+#include <functional>
+
+namespace {
+    constexpr size_t   MAX_REPORTED_FAILURES = 20;  // per suite; the others are only counted
+    constexpr uint64_t TEST_SEED = 20240517;        // inputs are random, but the same on every run
+}
+
+// Class used to record the checks of a test suite
+// A failed check does not stop the suite: it is reported with its description and counted, so a
+// single run shows every failure (up to MAX_REPORTED_FAILURES)
+class TestContext
+{
+public:
+    explicit TestContext(std::string Suite);
+
+    TestContext(const TestContext& c) = delete;
+
+    TestContext& operator=(const TestContext& c) = delete;
+
+    // Records a check; reports Description if Condition is false; returns Condition
+    bool Check(bool Condition, const std::string& Description);
+
+    const std::string& suite() const;
+
+    size_t checks() const;
+
+    size_t failures() const;
+
+private:
+    std::string _suite;
+    size_t      _checks;
+    size_t      _failures;
+};
+
+// A test suite: runs all its checks on Context
+using TestSuite = std::function<void(TestContext& Context)>;
+
+// Compares every matcher (and every kernel of the single pattern searcher), with and without case
+// folding, with a naive search
+void TestPatternMatchers(TestContext& Context);
+
+// Compares the matches reported by StreamScanner, for every block size and read size, with a
+// search of the whole input
+void TestStreamScanner(TestContext& Context);
+
+// Compares the regular expression matcher with a reference evaluator of the expression trees
+// (ReferenceFindAll) on random expressions, and checks its syntax errors, required literals, cache
+// clearing and chunked file searches
+void TestRegexMatcher(TestContext& Context);
+
+// Checks the binary file detection and the extension filter, and searches a location mixing text and
+// binary files in every binary mode
+void TestFileFilters(TestContext& Context);
+
+// Runs searches with hundreds of workers over thousands of small files (and a few chunked ones),
+// in every output mode and concurrently, and checks every run finds every match exactly once, and that
+// the read stage hands files over while the enumeration is stalled
+void TestSearchEngine(TestContext& Context);
+
+// Writes binary result files and reads them back with ResultReader, and checks that every string
+// written as JSON is valid and that a standard JSON decoder gets its exact bytes back
+void TestResultFiles(TestContext& Context);
+
+// Checks the files kept between runs: the candidates of a trigram index, the directory listings a
+// manifest reuses or reads again, and the hits, misses and evictions of the result cache
+void TestPersistence(TestContext& Context);
+
+// Watches a location (Linux only) while its files are appended to, truncated, and changed faster than
+// the watcher can follow, and checks that only the new matches are reported, exactly once
+void TestWatchMode(TestContext& Context);
+
+#endif // TESTCONTEXT_H
@@ -0,0 +1,497 @@
+#include "testcontext.h"
+#include "pathfilter.h"
+#include "globset.h"
+#include "contentsniffer.h"
+#include "searchengine.h"
+#include "dataextractor.h"
+
+#include <map>
+#include <set>
+#include <random>
+#include <string>
+#include <vector>
+#include <string_view>
+#include <fstream>
+#include <utility>
+#include <filesystem>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+namespace {
+    void TestContentSniffer(TestContext& Context)
+    {
+        const vector< pair<string, bool> > cases{
+            { "",                                  false },
+            { "plain ASCII text\n",                false },
+            { "UTF-8: caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\n", false },
+            { "Latin-1: caf\xe9, na\xefve\n",      false },
+            { string("NUL\0byte", 8),              true },
+            { "\x7f" "ELF\x02\x01\x01",            false },  // control bytes are valid: executables hold NUL bytes
+            { "\xff\xfe\xfd\xfc\xc0\xaf\xed\xa0\x80", true },   // invalid, overlong and surrogate sequences
+        };
+
+        for (auto&& test : cases)
+        {
+            Context.Check( IsBinaryContents(test.first) == test.second, "sniffed contents: <" + test.first + ">" );
+        }
+
+        // random bytes; a sequence cut at SNIFF_SIZE is not invalid; only the start of a file is looked at
+        mt19937_64 random(TEST_SEED);
+        string     noise(SNIFF_SIZE, '\0');
+        string     text{};
+
+        for (auto&& c : noise)
+        {
+            c = static_cast<char>( 1 + random() % 255 );
+        }
+
+        while (text.size() < SNIFF_SIZE - 1)
+        {
+            text += "\xe2\x82\xac";
+        }
+
+        Context.Check( IsBinaryContents(noise), "random bytes without NUL" );
+        Context.Check( !IsBinaryContents(text.substr(0, SNIFF_SIZE) + "\x82\xac"), "sequence cut at the sniffed size" );
+        Context.Check( !IsBinaryContents(string(SNIFF_SIZE, 'a') + noise), "binary past the sniffed size" );
+    }
+
+    void TestPathFilter(TestContext& Context)
+    {
+        PathFilter filter{};
+
+        Context.Check( filter.empty() && filter.Accepts("a.o", false), "empty filter" );
+
+        filter.ExcludeExtensions({ "o", ".PNG", "tar.gz", "" });
+
+        const vector< pair<string, bool> > cases{
+            { "main.o",        false },
+            { "main.O",        false },
+            { "image.png",     false },
+            { "logs.tar.gz",   false },
+            { "logs.gz",       true },
+            { "main.cpp",      true },
+            { "o",             true },
+            { ".o",            true },   // a hidden file, not an extension
+            { "archive.o.txt", true },
+            { "a.b.c.o",       false },
+            { "noextension",   true },
+        };
+
+        for (auto&& test : cases)
+        {
+            Context.Check( filter.Accepts(test.first, false) == test.second, "path filter: " + test.first );
+        }
+    }
+
+    // Reference glob matcher: Glob (without its leading and trailing '/') against the whole of Path,
+    // backtracking over every way to match the wildcards
+    bool MatchesGlob(string_view Glob, string_view Path, bool IsSegmentStart)
+    {
+        if ( Glob.empty() )
+        {
+            return Path.empty();
+        }
+
+        // two stars or more alone between slashes
+        const size_t stars = min( Glob.find_first_not_of('*'), Glob.size() );
+
+        if ( IsSegmentStart && (stars >= 2) && (stars == Glob.size()) )
+        {
+            return true;
+        }
+
+        if ( IsSegmentStart && (stars >= 2) && ('/' == Glob[stars]) )
+        {
+            for (size_t start = 0; start <= Path.size(); start = Path.find('/', start) + 1)
+            {
+                if ( MatchesGlob(Glob.substr(stars + 1), Path.substr(start), true) )
+                {
+                    return true;
+                }
+
+                if (string_view::npos == Path.find('/', start))
+                {
+                    break;
+                }
+            }
+
+            return false;
+        }
+
+        if ('*' == Glob[0])
+        {
+            const string_view rest = Glob.substr(stars);
+
+            for (size_t size = 0; size <= Path.size(); ++size)
+            {
+                if ( MatchesGlob(rest, Path.substr(size), false) )
+                {
+                    return true;
+                }
+
+                if ( (size < Path.size()) && ('/' == Path[size]) )
+                {
+                    break;
+                }
+            }
+
+            return false;
+        }
+
+        if ( Path.empty() )
+        {
+            return false;
+        }
+
+        if ('?' == Glob[0])
+        {
+            return ('/' != Path[0]) && MatchesGlob(Glob.substr(1), Path.substr(1), false);
+        }
+
+        if ('[' == Glob[0])
+        {
+            const bool isNegated = ('!' == Glob[1]) || ('^' == Glob[1]);
+            size_t     member = isNegated ? 2 : 1;
+            bool       isMember = false;
+
+            for (bool isFirst = true; isFirst || (']' != Glob[member]); isFirst = false)
+            {
+                char low = Glob[member];
+
+                low = ('\\' == low) ? Glob[++member] : low;
+
+                if ( ('-' == Glob[member + 1]) && (']' != Glob[member + 2]) )
+                {
+                    isMember = isMember || ( (Path[0] >= low) && (Path[0] <= Glob[member + 2]) );
+                    member += 3;
+                }
+                else
+                {
+                    isMember = isMember || (Path[0] == low);
+                    member += 1;
+                }
+            }
+
+            return ('/' != Path[0]) && (isMember != isNegated) && MatchesGlob(Glob.substr(member + 1), Path.substr(1), false);
+        }
+
+        const size_t size = ('\\' == Glob[0]) ? 2 : 1;
+
+        return (Glob[size - 1] == Path[0]) && MatchesGlob(Glob.substr(size), Path.substr(1), '/' == Path[0]);
+    }
+
+    // Reference GlobSet::Match() for a single glob
+    bool MatchesGlobSet(string_view Glob, string_view Path, bool IsDirectory)
+    {
+        const bool isDirectoryOnly = ('/' == Glob.back());
+
+        while ( !Glob.empty() && ('/' == Glob.back()) )
+        {
+            Glob.remove_suffix(1);
+        }
+
+        const bool isAnchored = (string_view::npos != Glob.find('/'));
+
+        Glob = ('/' == Glob[0]) ? Glob.substr(1) : Glob;
+
+        if (isDirectoryOnly && !IsDirectory)
+        {
+            return false;
+        }
+
+        if (isAnchored)
+        {
+            return MatchesGlob(Glob, Path, true);
+        }
+
+        return MatchesGlob(Glob, Path.substr(Path.rfind('/') + 1), true);
+    }
+
+    void TestGlobSet(TestContext& Context)
+    {
+        struct GlobTest
+        {
+            string glob;
+            string path;
+            bool   isDirectory;
+            bool   matches;
+        };
+
+        const vector<GlobTest> cases{
+            { "node_modules",  "web/node_modules",      true,  true },
+            { "node_modules/", "web/node_modules",      false, false },   // directories only
+            { "*.log",         "a/b/c.log",             false, true },
+            { "*.log",         "a/b/c.log.1",           false, false },
+            { "*.log",         ".log",                  false, true },
+            { "/build",        "build",                 true,  true },
+            { "/build",        "src/build",             true,  false },   // anchored
+            { "src/*.cpp",     "src/main.cpp",          false, true },
+            { "src/*.cpp",     "src/sub/main.cpp",      false, false },   // * stops at '/'
+            { "src/**/*.cpp",  "src/main.cpp",          false, true },
+            { "src/**/*.cpp",  "src/a/b/main.cpp",      false, true },
+            { "**/gen",        "gen",                   true,  true },
+            { "**/gen",        "x/y/gen",               true,  true },
+            { "doc/**",        "doc/a/b.txt",           false, true },
+            { "doc/**",        "doc",                   true,  false },
+            { "a**b",          "axxb",                  false, true },    // not between slashes: a plain *
+            { "a**b",          "ax/xb",                 false, false },
+            { "file?.txt",     "file1.txt",             false, true },
+            { "file?.txt",     "file10.txt",            false, false },
+            { "[a-c]x",        "bx",                    false, true },
+            { "[!a-c]x",       "dx",                    false, true },
+            { "[!a-c]x",       "ax",                    false, false },
+            { "[]]",           "]",                     false, true },
+            { "\\*.txt",       "*.txt",                 false, true },
+            { "\\*.txt",       "a.txt",                 false, false },
+            { "a.b",           "axb",                   false, false },   // no regular expression bytes
+            { "*",             "anything/at/all",       false, true },
+            { "caf\xc3\xa9*",  "dir/caf\xc3\xa9-menu",  false, true },
+        };
+
+        for (auto&& test : cases)
+        {
+            GlobSet set{};
+            string  error{};
+
+            Context.Check( set.Add(test.glob, false, error), "glob added: " + test.glob );
+            set.Compile();
+
+            Context.Check( (NO_GLOB != set.Match(test.path, test.isDirectory)) == test.matches,
+                           "glob: " + test.glob + " on: " + test.path );
+            Context.Check( MatchesGlobSet(test.glob, test.path, test.isDirectory) == test.matches,
+                           "reference glob: " + test.glob + " on: " + test.path );
+        }
+
+        for (auto&& invalid : { "", "/", "[ab", "ab\\" })
+        {
+            string error{};
+
+            Context.Check( !GlobSet::Validate(invalid, error) && !error.empty(), string("invalid glob: ") + invalid );
+        }
+
+        // random sets (enough general globs for several automata) against the reference: the last glob
+        // matching wins
+        const vector<string> tokens{ "a", "b", ".", "*", "**", "?", "[ab]", "[!a]", "[a-b]", "/", "**/" };
+        mt19937_64           random(TEST_SEED);
+
+        for (int round = 0; round < 40; ++round)
+        {
+            GlobSet        set{};
+            vector<string> globs{};
+            const size_t   count = (0 == round % 10) ? 600 : 1 + random() % 12;
+
+            while (globs.size() < count)
+            {
+                string glob{};
+                string error{};
+
+                for (size_t i = 0, size = 1 + random() % 5; i < size; ++i)
+                {
+                    glob += tokens[ random() % tokens.size() ];
+                }
+
+                if ( set.Add(glob, false, error) )
+                {
+                    globs.push_back(glob);
+                }
+            }
+
+            set.Compile();
+
+            for (int i = 0; i < 50; ++i)
+            {
+                string     path{};
+                const bool isDirectory = (0 == random() % 2);
+
+                for (size_t segment = 0, segments = 1 + random() % 3; segment < segments; ++segment)
+                {
+                    path += segment ? "/" : "";
+
+                    for (size_t j = 0, size = 1 + random() % 3; j < size; ++j)
+                    {
+                        path += "ab."[random() % 3];
+                    }
+                }
+
+                size_t expected = NO_GLOB;
+
+                for (size_t glob = 0; glob < globs.size(); ++glob)
+                {
+                    expected = MatchesGlobSet(globs[glob], path, isDirectory) ? glob : expected;
+                }
+
+                const size_t found = set.Match(path, isDirectory);
+
+                Context.Check( found == expected, "glob set on: " + path + " expected: " +
+                               ( (NO_GLOB == expected) ? string("none") : globs[expected] ) + " found: " +
+                               ( (NO_GLOB == found) ? string("none") : globs[found] ) );
+            }
+        }
+    }
+
+    // A tree with ignore files at several levels, searched with and without them, walked in both
+    // orders; files found through an index or a change (AcceptsPath) must be filtered the same way
+    void TestIgnoreFiles(TestContext& Context)
+    {
+        const fs::path root = fs::temp_directory_path() / ( "stringfinder-ignore-" + to_string( random_device()() ) );
+        error_code     error;
+
+        for (auto&& directory : { "src/gen", "src/lib", "build/out", "node_modules/pkg", ".git", "logs/old" })
+        {
+            fs::create_directories(root / directory, error);
+        }
+
+        const map<string, string> files{
+            { ".gitignore",              "# build outputs\nbuild/\n*.log\n!keep.log\n/top.txt\n" },
+            { "src/.gitignore",          "gen/\n!debug.log\n" },
+            { "src/.ignore",             "*.tmp\n" },
+            { "top.txt",                 "needle" },
+            { "src/top.txt",             "needle" },       // anchored to the root: kept
+            { "src/main.cpp",            "needle" },
+            { "src/scratch.tmp",         "needle" },
+            { "src/debug.log",           "needle" },       // negated in a deeper directory
+            { "src/gen/parser.cpp",      "needle" },
+            { "src/lib/util.cpp",        "needle" },
+            { "src/lib/util.min.js",     "needle" },
+            { "build/out/app",           "needle" },
+            { "node_modules/pkg/i.js",   "needle" },
+            { ".git/config",             "needle" },
+            { "logs/app.log",            "needle" },
+            { "logs/keep.log",           "needle" },
+            { "logs/old/keep.log",       "needle" },
+        };
+
+        for (auto&& file : files)
+        {
+            ofstream(root / file.first, ios::binary) << file.second;
+        }
+
+        SearchEngine engine(4);
+
+        // through a callback: ordered searches only stream their results
+        const auto search = [&](const SearchOptions& Options)
+        {
+            DataExtractor extractor({ "needle" }, root.string(), Options);
+            set<string>   found{};
+
+            engine.Run(extractor, [&](const fs::path& File, const StringData&)
+                                  { found.insert( fs::relative(File, root).generic_string() ); });
+
+            return found;
+        };
+
+        const set<string> ignored{ "logs/keep.log", "logs/old/keep.log", "node_modules/pkg/i.js", "src/debug.log",
+                                   "src/lib/util.cpp", "src/lib/util.min.js", "src/main.cpp", "src/top.txt" };
+        const set<string> excluded{ "logs/keep.log", "logs/old/keep.log", "src/debug.log", "src/lib/util.cpp",
+                                    "src/main.cpp", "src/top.txt" };
+        const set<string> included{ "src/gen/parser.cpp", "src/lib/util.cpp", "src/main.cpp" };
+
+        for (bool isOrdered : { false, true })
+        {
+            SearchOptions options{};
+            const string  order = isOrdered ? " (ordered)" : "";
+
+            options.orderedOutput = isOrdered;
+            options.useIgnoreFiles = true;
+            Context.Check( search(options) == ignored, "ignore files" + order );
+
+            options.excludedGlobs = { "node_modules/", "*.min.js" };
+            Context.Check( search(options) == excluded, "ignore files and excluded globs" + order );
+
+            options.useIgnoreFiles = false;
+            options.excludedGlobs.clear();
+            options.includedGlobs = { "src/**/*.cpp" };
+            Context.Check( search(options) == included, "included globs" + order );
+        }
+
+        PathFilter filter{};
+
+        filter.UseIgnoreFiles();
+        filter.ExcludeGlobs({ "node_modules/", "*.min.js" });
+
+        for (auto&& file : files)
+        {
+            const bool isKept = (excluded.count(file.first) > 0) || (".gitignore" == file.first) ||
+                                ("src/.gitignore" == file.first) || ("src/.ignore" == file.first);
+
+            Context.Check( filter.AcceptsPath(root, root / file.first) == isKept, "accepted path: " + file.first );
+        }
+
+        fs::remove_all(root, error);
+    }
+
+    // A location mixing text and binary files, searched in every binary mode: files are counted by the
+    // matches reported, with or without affixes
+    void TestBinaryModes(TestContext& Context)
+    {
+        const fs::path root = fs::temp_directory_path() / ( "stringfinder-binary-" + to_string( random_device()() ) );
+        error_code     error;
+
+        fs::create_directories(root / "sub", error);
+
+        const map<string, string> files{
+            { "text.txt",       "a needle here\n" },
+            { "sub/latin1.txt", "caf\xe9 needle\n" },
+            { "data.bin",       string("x\0needle\0", 9) },
+            { "object.o",       "needle, but object files are binary" },
+            // larger than a chunk: skipped from its first bytes, whatever follows them
+            { "sub/core",       string("\0\0\0\0", 4) + string(FILE_CHUNK_SIZE + 4096, 'n') + "needle\n" },
+        };
+
+        for (auto&& file : files)
+        {
+            ofstream stream(root / file.first, ios::binary);
+
+            stream.write( file.second.data(), static_cast<streamsize>( file.second.size() ) );
+        }
+
+        SearchEngine engine(4);
+
+        const auto search = [&](SearchOptions::BinaryFiles Mode, const vector<string>& Extensions)
+        {
+            SearchOptions options{};
+
+            options.binaryFiles = Mode;
+            options.excludedExtensions = Extensions;
+
+            DataExtractor     extractor({ "needle" }, root.string(), options);
+            map<string, bool> found{};  // with affixes
+
+            engine.Run(extractor);
+
+            for (auto&& fileData : extractor.results())
+            {
+                const StringData& data = fileData->stringData;
+
+                found[ fs::relative(fileData->path, root).generic_string() ] = (data.size() > 0) && !data.affixes(0).suffix.empty();
+            }
+
+            return found;
+        };
+
+        const map<string, bool> all{ { "data.bin", true }, { "object.o", true }, { "sub/core", true },
+                                     { "sub/latin1.txt", true }, { "text.txt", true } };
+        const map<string, bool> text{ { "sub/latin1.txt", true }, { "text.txt", true } };
+        const map<string, bool> noAffixes{ { "data.bin", false }, { "object.o", true }, { "sub/core", false },
+                                           { "sub/latin1.txt", true }, { "text.txt", true } };
+        const map<string, bool> excluded{ { "data.bin", true }, { "sub/core", true } };
+
+        Context.Check( search(SearchOptions::SEARCH_BINARY, {}) == all, "binary files searched" );
+        Context.Check( search(SearchOptions::SKIP_BINARY, {}) == text, "binary files skipped" );
+        Context.Check( search(SearchOptions::BINARY_WITHOUT_AFFIXES, {}) == noAffixes, "binary files without affixes" );
+        Context.Check( search(SearchOptions::SEARCH_BINARY, { "o", "TXT" }) == excluded, "extensions excluded" );
+
+        fs::remove_all(root, error);
+    }
+}
+
+void TestFileFilters(TestContext& Context)
+{
+    TestContentSniffer(Context);
+    TestPathFilter(Context);
+    TestGlobSet(Context);
+    TestIgnoreFiles(Context);
+    TestBinaryModes(Context);
+}
@@ -0,0 +1,183 @@
+#include "testcontext.h"
+#include "patternmatcher.h"
+#include "teddymatcher.h"
+#include "ahocorasick.h"
+#include "searcher.h"
+#include "casefolding.h"
+
+#include <set>
+#include <random>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    constexpr int    MATCHER_ROUNDS = 300;
+    constexpr size_t MAX_CONTENTS_SIZE = 700;  // covers several 64 byte vector blocks, and their tails
+
+    // Every occurrence of every pattern, ordered by position and then by pattern index
+    vector<PatternMatcher::Match> NaiveFindAll(string_view Contents, const vector<string>& Patterns, bool IgnoreCase)
+    {
+        const string                  contents = IgnoreCase ? FoldCase(Contents) : string(Contents);
+        vector<PatternMatcher::Match> matches{};
+
+        for (size_t position = 0; position < contents.size(); ++position)
+        {
+            for (size_t pattern = 0; pattern < Patterns.size(); ++pattern)
+            {
+                const string searched = IgnoreCase ? FoldCase(Patterns[pattern]) : Patterns[pattern];
+
+                if (0 == contents.compare(position, searched.size(), searched))
+                {
+                    matches.push_back({ position, pattern, searched.size() });
+                }
+            }
+        }
+
+        return matches;
+    }
+
+    bool AreEqual(const vector<PatternMatcher::Match>& Lhs, const vector<PatternMatcher::Match>& Rhs)
+    {
+        return equal(Lhs.begin(), Lhs.end(), Rhs.begin(), Rhs.end(),
+                     [](const PatternMatcher::Match& L, const PatternMatcher::Match& R)
+                     { return (L.position == R.position) && (L.pattern == R.pattern) && (L.length == R.length); });
+    }
+
+    // Small alphabets make overlapping matches and patterns sharing prefixes (or fingerprints) likely
+    string RandomString(mt19937_64& Random, size_t Size, const string& Alphabet)
+    {
+        uniform_int_distribution<size_t> letter(0, Alphabet.size() - 1);
+        string                           result(Size, '\0');
+
+        for (auto&& c : result)
+        {
+            c = Alphabet[letter(Random)];
+        }
+
+        return result;
+    }
+
+    // Unique, non empty patterns; some are cut from Contents, so they are found
+    vector<string> RandomPatterns(mt19937_64& Random, size_t Count, size_t MaxSize, const string& Alphabet,
+                                  const string& Contents)
+    {
+        uniform_int_distribution<size_t> size(1, MaxSize);
+        set<string>                      unique{};
+        vector<string>                   patterns{};
+
+        while (patterns.size() < Count)
+        {
+            string pattern = RandomString(Random, size(Random), Alphabet);
+
+            if ( (0 == Random() % 2) && (Contents.size() > pattern.size()) )
+            {
+                pattern = Contents.substr(Random() % (Contents.size() - pattern.size()), pattern.size());
+            }
+
+            if ( unique.insert(pattern).second )
+            {
+                patterns.push_back(std::move(pattern));
+            }
+        }
+
+        return patterns;
+    }
+
+    // Keeps the first of the patterns equal once folded
+    vector<string> UniqueFolded(const vector<string>& Patterns)
+    {
+        set<string>    folded{};
+        vector<string> patterns{};
+
+        for (auto&& pattern : Patterns)
+        {
+            if ( folded.insert( FoldCase(pattern) ).second )
+            {
+                patterns.push_back(pattern);
+            }
+        }
+
+        return patterns;
+    }
+
+    string Describe(const char* Engine, bool IgnoreCase, const vector<string>& Patterns, size_t ContentsSize)
+    {
+        return string(Engine) + ( IgnoreCase ? " (ignoring case): " : ": " ) + to_string( Patterns.size() ) +
+               " patterns (first one: \"" + Patterns.front() + "\") over " + to_string(ContentsSize) + " bytes";
+    }
+}
+
+void TestPatternMatchers(TestContext& Context)
+{
+    // the bytes next to the letter ranges ('@', '[', '`', '{') differ from letters by the case bit only
+    const vector<string> alphabets{ "ab", "abcd", "abcdefghijklmnopqrstuvwxyz \n", string("\0\x01\xff", 3), "aAbB",
+                                    "azAZ@[`{ \xc3\xa9" };
+    const vector<Searcher::InstructionSet> kernels{ Searcher::SCALAR, Searcher::SSE2, Searcher::AVX2, Searcher::AVX512 };
+    mt19937_64 random(TEST_SEED);
+
+    for (int round = 0; round < MATCHER_ROUNDS; ++round)
+    {
+        const string& alphabet = alphabets[round % alphabets.size()];
+        const string  contents = RandomString(random, random() % MAX_CONTENTS_SIZE, alphabet);
+
+        // unaligned starts and ends: the vector kernels read their blocks from Contents.data()
+        const size_t      start = random() % 64;
+        const string_view view = string_view(contents).substr( min(start, contents.size()) );
+
+        // single pattern: every kernel the CPU has
+        const vector<string> single = RandomPatterns(random, 1, 1 + round % 40, alphabet, contents);
+
+        for (auto&& kernel : kernels)
+        {
+            for (bool ignoreCase : { false, true })
+            {
+                const Searcher                      searcher(single.front(), kernel, ignoreCase);
+                const vector<PatternMatcher::Match> expected = NaiveFindAll(view, single, ignoreCase);
+                size_t                              position = 0;
+                bool                                isEqual = true;
+
+                for (auto&& match : expected)
+                {
+                    isEqual = isEqual && ( searcher.Find(view, position) == match.position );
+                    position = match.position + 1;
+                }
+
+                isEqual = isEqual && ( searcher.Find(view, position) == string_view::npos );
+                Context.Check( isEqual, Describe(Searcher::InstructionSetName( searcher.instructionSet() ), ignoreCase,
+                                                 single, view.size()) );
+            }
+        }
+
+        // sets of every size Teddy takes, and beyond it (long enough to be unique, even over 2 letters)
+        const vector<string> patterns = RandomPatterns(random, 2 + round % 60, 6 + round % 24, alphabet, contents);
+        const vector<string> foldedPatterns = UniqueFolded(patterns);
+        vector< unique_ptr<PatternMatcher> > matchers{};
+
+        for (bool ignoreCase : { false, true })
+        {
+            const vector<string>& unique = ignoreCase ? foldedPatterns : patterns;
+
+            matchers.push_back( PatternMatcher::Create(single, ignoreCase) );
+            matchers.push_back( PatternMatcher::Create(unique, ignoreCase) );
+            matchers.push_back( make_unique<AhoCorasickMatcher>(unique, ignoreCase) );
+
+            if ( (unique.size() <= TEDDY_MAX_PATTERNS) && TeddyMatcher::IsSupported() )
+            {
+                matchers.push_back( make_unique<TeddyMatcher>(unique, ignoreCase) );
+            }
+        }
+
+        for (auto&& matcher : matchers)
+        {
+            vector<PatternMatcher::Match> matches{};
+
+            matcher->FindAll(view, matches);
+            Context.Check( AreEqual( matches, NaiveFindAll( view, matcher->patterns(), matcher->ignoreCase() ) ),
+                           Describe( matcher->name(), matcher->ignoreCase(), matcher->patterns(), view.size() ) );
+        }
+    }
+}
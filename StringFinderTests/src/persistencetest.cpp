@@ -0,0 +1,438 @@
+#include "testcontext.h"
+#include "stringdata.h"
+#include "resultcache.h"
+#include "trigramindex.h"
+#include "concurrentqueue.h"
+#include "directorywalker.h"
+#include "directorymanifest.h"
+
+#include <set>
+#include <cctype>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr int      INDEXED_FILES = 60;
+    constexpr int      INDEX_QUERIES = 300;
+    constexpr uint64_t EVICTION_CACHE_SIZE = 16384;  // in bytes
+    constexpr int      EVICTION_ENTRIES = 40;        // of about 1 KB each
+    constexpr int      REFRESHED_ENTRIES = 4;
+
+    void WriteFile(const fs::path& File, const string& Contents)
+    {
+        ofstream stream(File, ios::binary | ios::trunc);
+
+        stream << Contents;
+    }
+
+    // Sets the write time of Path Age in the past: older than RACY_WRITE_TIME, so reusable
+    void Backdate(const fs::path& Path, chrono::minutes Age)
+    {
+        error_code error;
+
+        fs::last_write_time(Path, fs::file_time_type::clock::now() - Age, error);
+    }
+
+    string Lowercase(string Text)
+    {
+        transform( Text.begin(), Text.end(), Text.begin(), [](char c) { return static_cast<char>( tolower(c) ); } );
+
+        return Text;
+    }
+
+    // Files the index must return: those holding every trigram of one of the search strings (in any
+    // case when ignoring case), all of them for a search string shorter than a trigram
+    set<string> ExpectedCandidates(const vector< pair<string, string> >& Files, const vector<string>& SearchStrings,
+                                   bool IgnoreCase)
+    {
+        set<string> candidates{};
+
+        for (auto&& file : Files)
+        {
+            const string contents = IgnoreCase ? Lowercase(file.second) : file.second;
+
+            for (auto&& searchString : SearchStrings)
+            {
+                const string searched = IgnoreCase ? Lowercase(searchString) : searchString;
+                bool         hasAll = true;
+
+                for (size_t i = 0; hasAll && (i + 3 <= searched.size()); ++i)
+                {
+                    hasAll = ( string::npos != contents.find( searched.substr(i, 3) ) );
+                }
+
+                if (hasAll)
+                {
+                    candidates.insert(file.first);
+                    break;
+                }
+            }
+        }
+
+        return candidates;
+    }
+
+    // Builds the index of random files, reopens it and compares its candidates for random search
+    // strings with those of every file's trigrams
+    void TestTrigramIndex(TestContext& Context, const fs::path& Root)
+    {
+        const fs::path                 location = Root / "indexed";
+        const fs::path                 indexFile = Root / "index.sfi";
+        mt19937_64                     random(TEST_SEED);
+        vector< pair<string, string> > files{};
+        error_code                     error;
+
+        fs::create_directories(location / "sub", error);
+
+        // few letters: most trigrams are found in many files, and files hold most of them
+        for (int i = 0; i < INDEXED_FILES; ++i)
+        {
+            string contents( random() % 80, '\0' );
+
+            for (auto&& c : contents)
+            {
+                c = "abcdAB"[ random() % 6 ];
+            }
+
+            files.emplace_back( ( (0 == i % 3) ? "sub/file-" : "file-" ) + to_string(i), contents );
+            WriteFile(location / files.back().first, contents);
+            Backdate(location / files.back().first, chrono::minutes(60));
+        }
+
+        // files and directories modified just before the build always look modified
+        Backdate(location / "sub", chrono::minutes(60));
+        Backdate(location, chrono::minutes(60));
+
+        TrigramIndex index{};
+
+        if ( !Context.Check(TrigramIndex::Build(location, indexFile, 2), "index built") ||
+             !Context.Check(index.Open(indexFile), "index open") )
+        {
+            return;
+        }
+
+        Context.Check( index.fileCount() == files.size(), "indexed file count" );
+
+        size_t failures = 0;
+
+        for (int query = 0; query < INDEX_QUERIES; ++query)
+        {
+            vector<string>   searchStrings( 1 + random() % 2 );
+            vector<fs::path> candidates{};
+            set<string>      found{};
+            const bool       ignoreCase = (0 == query % 2);
+
+            for (auto&& searchString : searchStrings)
+            {
+                searchString.resize( 2 + random() % 4 );
+
+                for (auto&& c : searchString)
+                {
+                    c = "abcdAB"[ random() % 6 ];
+                }
+            }
+
+            if ( !index.Candidates(searchStrings, location, candidates, ignoreCase) )
+            {
+                ++failures;
+                continue;
+            }
+
+            for (auto&& candidate : candidates)
+            {
+                found.insert( candidate.lexically_relative(location).generic_string() );
+            }
+
+            if ( (found.size() != candidates.size()) || (found != ExpectedCandidates(files, searchStrings, ignoreCase)) )
+            {
+                ++failures;
+            }
+        }
+
+        Context.Check( 0 == failures, "index candidates: " + to_string(failures) + " wrong queries" );
+
+        vector<fs::path> candidates{};
+
+        Context.Check( !index.Candidates({ "abc" }, Root, candidates), "index of another location" );
+
+        // a file that was no candidate now holds the search string, another is added under a new
+        // directory, a third one in an indexed directory: all are searched, though the index ignores them
+        const string searched = "qqqzzz";
+        set<string>  expected = ExpectedCandidates(files, { searched }, false);
+        set<string>  found{};
+
+        WriteFile(location / files[1].first, files[1].second + searched);
+        Backdate(location / files[1].first, chrono::minutes(30));
+        fs::create_directories(location / "new/deeper", error);
+        WriteFile(location / "new/deeper/added", searched);
+        WriteFile(location / "sub/added", searched);
+        expected.insert({ files[1].first, "new/deeper/added", "sub/added" });
+
+        Context.Check( index.Candidates({ searched }, location, candidates), "index candidates after changes" );
+
+        for (auto&& candidate : candidates)
+        {
+            found.insert( candidate.lexically_relative(location).generic_string() );
+        }
+
+        Context.Check( found == expected, "modified and added files are candidates" );
+
+        // removed files are not
+        fs::remove(location / files[1].first, error);
+        index.Candidates({ searched }, location, candidates);
+        Context.Check( candidates.size() == expected.size() - 1, "removed file is no candidate" );
+    }
+
+    // Walks Root with Manifest; Reused and Read are the directories the walk took from the manifest,
+    // and read again
+    set<string> Walk(const fs::path& Root, DirectoryManifest& Manifest, size_t& Reused, size_t& Read)
+    {
+        ConcurrentQueue<fs::path> fileQueue{ FILE_QUEUE_CAPACITY };
+        DirectoryWalker           walker(Root, fileQueue);
+        fs::path                  file{};
+        set<string>               files{};
+
+        walker.UseManifest(Manifest);
+        walker.Start();
+
+        while ( fileQueue.Pop(file) )
+        {
+            files.insert( file.lexically_relative(Root).generic_string() );
+        }
+
+        walker.Wait();
+        Reused = walker.reusedDirectories();
+        Read = walker.readDirectories();
+
+        return files;
+    }
+
+    // Saves listings, reuses them in the next runs while their directories are unchanged, and reads
+    // again the directories modified since (or too recently)
+    void TestDirectoryManifest(TestContext& Context, const fs::path& Root)
+    {
+        const fs::path location = Root / "walked";
+        const fs::path manifestFile = Root / "walked.manifest";
+        set<string>    files{ "f", "a/x", "a/y", "b/z" };
+        size_t         reused = 0;
+        size_t         read = 0;
+        error_code     error;
+
+        fs::create_directories(location / "a", error);
+        fs::create_directories(location / "b", error);
+
+        for (auto&& file : files)
+        {
+            WriteFile(location / file, "contents");
+        }
+
+        for (auto&& directory : { location, location / "a", location / "b" })
+        {
+            Backdate(directory, chrono::minutes(180));
+        }
+
+        {
+            DirectoryManifest manifest{};
+
+            manifest.Open(manifestFile, location);
+            Context.Check( Walk(location, manifest, reused, read) == files, "manifest: first walk" );
+            Context.Check( (0 == reused) && (3 == read), "manifest: first walk reads every directory" );
+            Context.Check( manifest.Save(manifestFile), "manifest saved" );
+        }
+
+        {
+            DirectoryManifest manifest{};
+
+            manifest.Open(manifestFile, location);
+            Context.Check( Walk(location, manifest, reused, read) == files, "manifest: unchanged tree" );
+            Context.Check( (3 == reused) && (0 == read), "manifest: unchanged tree reuses every directory" );
+
+            // kept in memory too, as by a server
+            Walk(location, manifest, reused, read);
+            Context.Check( (3 == reused) && (0 == read), "manifest: reused by a second walk" );
+        }
+
+        // a file added: its directory gets a new write time
+        files.insert("a/w");
+        WriteFile(location / "a/w", "contents");
+        Backdate(location / "a", chrono::minutes(120));
+
+        {
+            DirectoryManifest manifest{};
+
+            manifest.Open(manifestFile, location);
+            Context.Check( Walk(location, manifest, reused, read) == files, "manifest: file added" );
+            Context.Check( (2 == reused) && (1 == read), "manifest: modified directory read again" );
+            manifest.Save(manifestFile);
+        }
+
+        // a file renamed just now: its directory may still change within the same write time
+        files.erase("b/z");
+        files.insert("b/renamed");
+        fs::rename(location / "b/z", location / "b/renamed", error);
+
+        for (int run = 0; run < 2; ++run)
+        {
+            DirectoryManifest manifest{};
+
+            manifest.Open(manifestFile, location);
+            Context.Check( Walk(location, manifest, reused, read) == files, "manifest: file renamed, run " + to_string(run) );
+            Context.Check( (2 == reused) && (1 == read), "manifest: recent directory never reused, run " + to_string(run) );
+            manifest.Save(manifestFile);
+        }
+
+        // the manifest of another location is not used
+        {
+            DirectoryManifest manifest{};
+
+            manifest.Open(manifestFile, location / "a");
+            Walk(location / "a", manifest, reused, read);
+            Context.Check( (0 == reused) && (1 == read), "manifest of another location" );
+        }
+    }
+
+    bool IsSameData(const StringData& Lhs, const StringData& Rhs)
+    {
+        bool isSame = ( Lhs.size() == Rhs.size() );
+
+        for (size_t i = 0; isSame && (i < Lhs.size()); ++i)
+        {
+            isSame = ( Lhs.position(i) == Rhs.position(i) ) && ( Lhs.searchString(i) == Rhs.searchString(i) ) &&
+                     ( Lhs.affixes(i).prefix == Rhs.affixes(i).prefix ) && ( Lhs.affixes(i).suffix == Rhs.affixes(i).suffix );
+        }
+
+        return isSame;
+    }
+
+    // Matches of a file: Count of them, with short affixes at both ends
+    StringData Matches(size_t Count)
+    {
+        StringData data{};
+
+        for (size_t i = 0; i < Count; ++i)
+        {
+            data.Add( 3 + 37 * i, i % 2, (0 == i) ? string_view("ab") : string_view("a\0c", 3),
+                      (i + 1 == Count) ? string_view() : string_view("\"\n\xff") );
+        }
+
+        return data;
+    }
+
+    // Stores matches, finds them back in the same and in later runs, misses them once the file or the
+    // search changed, and evicts the least recently used entries past the maximum size
+    void TestResultCache(TestContext& Context, const fs::path& Root)
+    {
+        const fs::path       directory = Root / "cache";
+        const fs::path       file = Root / "cached.txt";
+        const vector<string> searchStrings{ "needle", "pin" };
+        const StringData     data = Matches(20);
+        StringData           found{};
+        error_code           error;
+
+        WriteFile(file, "contents of the cached file");
+        Backdate(file, chrono::minutes(60));
+
+        {
+            ResultCache cache(directory, 1 << 20, searchStrings);
+
+            if ( !Context.Check(cache.Open(), "cache open") )
+            {
+                return;
+            }
+
+            const string key = cache.Key(file);
+
+            Context.Check( !key.empty(), "cache key" );
+            Context.Check( !cache.Lookup(key, found) && (1 == cache.misses()), "cache: missing entry" );
+            cache.Store(key, data);
+            Context.Check( cache.Lookup(key, found) && IsSameData(found, data) && (1 == cache.hits()), "cache: hit" );
+            cache.Finish();
+        }
+
+        ResultCache cache(directory, 1 << 20, searchStrings);
+        const string key = cache.Key(file);
+
+        Context.Check( cache.Lookup(key, found) && IsSameData(found, data), "cache: hit in a later run" );
+
+        // the key changes with the search
+        ResultCache otherStrings(directory, 1 << 20, { "needle" });
+        ResultCache ignoringCase(directory, 1 << 20, searchStrings, true);
+
+        Context.Check( !otherStrings.Lookup(otherStrings.Key(file), found), "cache: other search strings" );
+        Context.Check( !ignoringCase.Lookup(ignoringCase.Key(file), found), "cache: ignoring case" );
+
+        // and with the file: same size, new write time
+        WriteFile(file, "contents of the edited file");
+        Backdate(file, chrono::minutes(30));
+        Context.Check( (cache.Key(file) != key) && !cache.Lookup(cache.Key(file), found), "cache: file modified" );
+
+        WriteFile(Root / "recent.txt", "contents");
+        Context.Check( cache.Key(Root / "recent.txt").empty(), "cache: recent file never cached" );
+
+        // eviction
+        const fs::path   evictedDirectory = Root / "evicted";
+        ResultCache      small(evictedDirectory, EVICTION_CACHE_SIZE, searchStrings);
+        const StringData entryData = Matches(100);
+        bool             isFound = true;
+        uint64_t         size = 0;
+
+        small.Open();
+
+        for (int i = 0; i < EVICTION_ENTRIES; ++i)
+        {
+            small.Store("entry-" + to_string(i), entryData);
+        }
+
+        // hits make the oldest entries the most recently used
+        this_thread::sleep_for( chrono::milliseconds(20) );
+
+        for (int i = 0; i < REFRESHED_ENTRIES; ++i)
+        {
+            isFound = small.Lookup("entry-" + to_string(i), found) && isFound;
+        }
+
+        small.Finish();
+
+        for (fs::recursive_directory_iterator iter(evictedDirectory, error), end; !error && (iter != end); iter.increment(error))
+        {
+            if ( (16 == iter->path().filename().string().size()) && fs::is_regular_file(iter->status()) )
+            {
+                size += fs::file_size(iter->path(), error);
+            }
+        }
+
+        Context.Check( size <= EVICTION_CACHE_SIZE * CACHE_EVICTION_TARGET, "cache: evicted down to its target size" );
+
+        for (int i = 0; i < REFRESHED_ENTRIES; ++i)
+        {
+            isFound = small.Lookup("entry-" + to_string(i), found) && isFound;
+        }
+
+        Context.Check( isFound, "cache: recently used entries kept" );
+    }
+}
+
+void TestPersistence(TestContext& Context)
+{
+    const fs::path root = fs::temp_directory_path() / ( "stringfinder-persistence-" + to_string( random_device()() ) );
+    error_code     error;
+
+    fs::create_directories(root, error);
+
+    TestTrigramIndex(Context, root);
+    TestDirectoryManifest(Context, root);
+    TestResultCache(Context, root);
+
+    fs::remove_all(root, error);
+}
@@ -0,0 +1,572 @@
+#include "testcontext.h"
+#include "regexmatcher.h"
+#include "regexprogram.h"
+#include "searchengine.h"
+#include "dataextractor.h"
+
+#include <set>
+#include <bitset>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <utility>
+#include <cstdint>
+#include <filesystem>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr int    REGEX_ROUNDS = 400;
+    constexpr size_t MAX_REGEX_CONTENTS_SIZE = 160;
+    constexpr int    MAX_REGEX_DEPTH = 2;            // nested groups of the random regular expressions
+    constexpr size_t TIMED_CONTENTS_SIZE = 4194304;  // in bytes
+    constexpr int    TIMED_RUNS = 3;                 // the fastest one counts
+
+    // Positions and lengths of the matches, e.g. "0+2 6+2"
+    string Describe(const vector<PatternMatcher::Match>& Matches)
+    {
+        string description{};
+
+        for (auto&& match : Matches)
+        {
+            description += to_string(match.position) + "+" + to_string(match.length) + "/" + to_string(match.pattern) + " ";
+        }
+
+        return description;
+    }
+
+    bool AreEqual(const vector<PatternMatcher::Match>& Lhs, const vector<PatternMatcher::Match>& Rhs)
+    {
+        return equal(Lhs.begin(), Lhs.end(), Rhs.begin(), Rhs.end(),
+                     [](const PatternMatcher::Match& L, const PatternMatcher::Match& R)
+                     { return (L.position == R.position) && (L.pattern == R.pattern) && (L.length == R.length); });
+    }
+
+    // Random regular expression, generated with its own evaluation: the bytes a position may hold, a
+    // sequence or an alternation of its children, repeated Min to Max times
+    struct RegexNode
+    {
+        enum class Kind { BYTES, SEQUENCE, ALTERNATION };
+
+        Kind                   kind;
+        bitset<256>            bytes;
+        vector<RegexNode>      children;
+        size_t                 min;
+        size_t                 max;
+        string                 text;
+    };
+
+    bitset<256> Folded(bitset<256> Bytes, bool IgnoreCase)
+    {
+        for (size_t c = 'a'; IgnoreCase && (c <= 'z'); ++c)
+        {
+            const size_t upper = c - 'a' + 'A';
+
+            Bytes[c] = Bytes[upper] = Bytes[c] || Bytes[upper];
+        }
+
+        return Bytes;
+    }
+
+    RegexNode RandomRegex(mt19937_64& Random, const string& Alphabet, bool IgnoreCase, int Depth)
+    {
+        RegexNode sequence{ RegexNode::Kind::SEQUENCE, {}, {}, 1, 1, "" };
+
+        for (size_t items = 1 + Random() % 3; sequence.children.size() < items; )
+        {
+            const auto letter = static_cast<unsigned char>( Alphabet[Random() % Alphabet.size()] );
+            const auto other = static_cast<unsigned char>( Alphabet[Random() % Alphabet.size()] );
+            RegexNode  item{ RegexNode::Kind::BYTES, {}, {}, 1, 1, "" };
+
+            switch ( Random() % ( (Depth > 0) ? 7 : 4 ) )
+            {
+            case 0:
+            case 1:
+                item.bytes = Folded(bitset<256>().set(letter), IgnoreCase);
+                item.text = string(1, static_cast<char>(letter));
+                break;
+            case 2:
+                item.bytes = bitset<256>().set().reset('\n');
+                item.text = ".";
+                break;
+            case 3:
+                item.bytes = Folded(bitset<256>().set(letter).set(other), IgnoreCase);
+                item.text = string("[") + static_cast<char>(letter) + static_cast<char>(other) + "]";
+
+                if (0 == Random() % 3)
+                {
+                    item.bytes.flip();
+                    item.text.insert(1, "^");
+                }
+                break;
+            case 4:
+                item = RandomRegex(Random, Alphabet, IgnoreCase, Depth - 1);
+                item.text = "(" + item.text + ")";
+                break;
+            default:
+                item.kind = RegexNode::Kind::ALTERNATION;
+                item.children = { RandomRegex(Random, Alphabet, IgnoreCase, Depth - 1),
+                                  RandomRegex(Random, Alphabet, IgnoreCase, Depth - 1) };
+                item.text = "(" + item.children[0].text + "|" + item.children[1].text + ")";
+                break;
+            }
+
+            switch (Random() % 10)
+            {
+            case 0: item.min = 0; item.max = SIZE_MAX; item.text += '*'; break;
+            case 1: item.min = 1; item.max = SIZE_MAX; item.text += '+'; break;
+            case 2: item.min = 0; item.max = 1; item.text += '?'; break;
+            case 3:
+                item.min = Random() % 3;
+                item.max = 2 + Random() % 2;
+                item.text += "{" + to_string(item.min) + "," + to_string(item.max) + "}";
+                break;
+            case 4:
+                item.min = item.max = 1 + Random() % 3;
+                item.text += "{" + to_string(item.min) + "}";
+                break;
+            default:
+                break;
+            }
+
+            sequence.text += item.text;
+            sequence.children.push_back(std::move(item));
+        }
+
+        return sequence;
+    }
+
+    // Positions where Node may end, starting from any of Starts
+    set<size_t> Ends(const RegexNode& Node, const string& Contents, const set<size_t>& Starts);
+
+    set<size_t> EndsOnce(const RegexNode& Node, const string& Contents, const set<size_t>& Starts)
+    {
+        set<size_t> ends{};
+
+        switch (Node.kind)
+        {
+        case RegexNode::Kind::BYTES:
+            for (auto&& start : Starts)
+            {
+                if ( (start < Contents.size()) && Node.bytes[static_cast<unsigned char>( Contents[start] )] )
+                {
+                    ends.insert(start + 1);
+                }
+            }
+            break;
+        case RegexNode::Kind::SEQUENCE:
+            ends = Starts;
+
+            for (auto&& child : Node.children)
+            {
+                ends = Ends(child, Contents, ends);
+            }
+            break;
+        case RegexNode::Kind::ALTERNATION:
+            for (auto&& child : Node.children)
+            {
+                const set<size_t> childEnds = Ends(child, Contents, Starts);
+
+                ends.insert(childEnds.begin(), childEnds.end());
+            }
+            break;
+        }
+
+        return ends;
+    }
+
+    set<size_t> Ends(const RegexNode& Node, const string& Contents, const set<size_t>& Starts)
+    {
+        set<size_t> current = Starts;
+        set<size_t> ends = (0 == Node.min) ? Starts : set<size_t>{};
+
+        // past Min repetitions, only the positions not reached yet are repeated from
+        for (size_t count = 1; (count <= Node.max) && !current.empty(); ++count)
+        {
+            current = EndsOnce(Node, Contents, current);
+
+            if (count >= Node.min)
+            {
+                set<size_t> added{};
+
+                for (auto&& end : current)
+                {
+                    if ( ends.insert(end).second )
+                    {
+                        added.insert(end);
+                    }
+                }
+
+                current = std::move(added);
+            }
+        }
+
+        return ends;
+    }
+
+    // Leftmost longest matches, the lowest pattern among the longest ones, searched again from the end
+    // of every match
+    vector<PatternMatcher::Match> ReferenceFindAll(const string& Contents, size_t Start, const vector<RegexNode>& Regexes)
+    {
+        vector<PatternMatcher::Match> matches{};
+        size_t                        position = Start;
+
+        while (position < Contents.size())
+        {
+            PatternMatcher::Match longest{ 0, 0, 0 };
+
+            for (size_t start = position; (start < Contents.size()) && (0 == longest.length); ++start)
+            {
+                for (size_t pattern = 0; pattern < Regexes.size(); ++pattern)
+                {
+                    const set<size_t> ends = Ends(Regexes[pattern], Contents, { start });
+
+                    if ( !ends.empty() && (*ends.rbegin() - start > longest.length) )
+                    {
+                        longest = { start, pattern, *ends.rbegin() - start };
+                    }
+                }
+            }
+
+            if (0 == longest.length)
+            {
+                break;
+            }
+
+            matches.push_back(longest);
+            position = longest.position + longest.length;
+        }
+
+        return matches;
+    }
+
+    vector<PatternMatcher::Match> FindAll(const vector<string>& Patterns, const string& Contents, bool IgnoreCase = false)
+    {
+        const RegexMatcher            matcher(Patterns, IgnoreCase);
+        vector<PatternMatcher::Match> matches{};
+
+        matcher.FindAll(Contents, matches);
+
+        return matches;
+    }
+
+    void TestSyntax(TestContext& Context)
+    {
+        const vector<string> valid{ "a{2,}", "[]a]", "a{", "a{x}", "[a-]", "(?:ab)+", "\\.\\*", "[\\]\\\\]",
+                                    "\\x41", "[^\\n]", "a{0,1000}b", "\\bab", "^a|b$" };
+        const vector<string> invalid{ "a(b", "a)", "*a", "[ab", "a{2,1}", "\\q", "a|", "x*", "(a){1001}", "\\b",
+                                      "a**", "[b-a]", "(?=a)", "a\\", "\\xg1", "[\\b]", "^$", "(((((((((((((((((((((((((((("
+                                      "((((((((((((((((((((((((((((((((((((((((a))))))))))))))))))))))))))))))))))))))))"
+                                      "))))))))))))))))))))))))))))", "(a{1000}){1000}" };
+        string               error{};
+
+        for (auto&& pattern : valid)
+        {
+            Context.Check(RegexProgram::Validate(pattern, error), "valid regular expression: " + pattern + " (" + error + ")");
+        }
+
+        for (auto&& pattern : invalid)
+        {
+            error.clear();
+            Context.Check( !RegexProgram::Validate(pattern, error) && !error.empty(), "invalid regular expression: " + pattern );
+        }
+    }
+
+    void TestMatches(TestContext& Context)
+    {
+        struct Case
+        {
+            vector<string>                   patterns;
+            string                           contents;
+            vector< pair<size_t, size_t> >   expected;  // positions and lengths
+            bool                             ignoreCase;
+        };
+
+        const vector<Case> cases{
+            { { "^ab" },             "ab ab\nab",             { { 0, 2 }, { 6, 2 } },           false },
+            { { "ab$" },             "ab ab\nab",             { { 3, 2 }, { 6, 2 } },           false },
+            { { "\\bab\\b" },        "ab xab ab_ ab",         { { 0, 2 }, { 11, 2 } },          false },
+            { { "\\Bab" },           "ab xab",                { { 4, 2 } },                     false },
+            { { "a\\w+" },           "a1_b-ab",               { { 0, 4 }, { 5, 2 } },           false },
+            { { "[0-9]+\\.[0-9]+" }, "v1.25 x.3 7.",          { { 1, 4 } },                     false },
+            { { "(?:ab)+" },         "abababa",               { { 0, 6 } },                     false },
+            { { "a|ab|abc" },        "abcab",                 { { 0, 3 }, { 3, 2 } },           false },
+            { { "\\x41\\t" },        "A\tA",                  { { 0, 2 } },                     false },
+            { { "colou?r" },         "color colour",          { { 0, 5 }, { 6, 6 } },           false },
+            { { "[^\\n]+$" },        "ab\ncd",                { { 0, 2 }, { 3, 2 } },           false },
+            { { "\\s+" },            "a \t\nb",               { { 1, 3 } },                     false },
+            { { "aa" },              "aaaaa",                 { { 0, 2 }, { 2, 2 } },           false },
+            { { "[a-c]+" },          "xAbCy",                 { { 1, 3 } },                     true  },
+            { { "[^a]+" },           "AaxB",                  { { 2, 2 } },                     true  },
+            { { "\\xc3\\xa9+" },     "caf\xc3\xa9\xc3\xa9",   { { 3, 2 }, { 5, 2 } },           false },  // bytes
+            { { "(?:\\xc3\\xa9)+" }, "caf\xc3\xa9\xc3\xa9",   { { 3, 4 } },                     false },
+            { { "b", "ab" },         "ab b",                  { { 0, 2 }, { 3, 1 } },           false },
+            { { "x.*y" },            "x1y2y\nx3y",            { { 0, 5 }, { 6, 3 } },           false },
+        };
+
+        for (auto&& test : cases)
+        {
+            const vector<PatternMatcher::Match> matches = FindAll(test.patterns, test.contents, test.ignoreCase);
+            bool                                isEqual = ( matches.size() == test.expected.size() );
+
+            for (size_t i = 0; isEqual && (i < matches.size()); ++i)
+            {
+                isEqual = (matches[i].position == test.expected[i].first) && (matches[i].length == test.expected[i].second);
+            }
+
+            Context.Check( isEqual, "matches of " + test.patterns.front() + ": " + Describe(matches) );
+        }
+
+        // the lowest pattern among the longest matches
+        const vector<PatternMatcher::Match> matches = FindAll({ "a.", "ab", "abc|ab" }, "ab");
+
+        Context.Check( (1 == matches.size()) && (0 == matches.front().pattern), "lowest pattern: " + Describe(matches) );
+    }
+
+    void TestLiterals(TestContext& Context)
+    {
+        const vector< pair< string, vector<string> > > cases{
+            { "(fatal )?error [0-9]+", { "error " } },
+            { "foo|bar",               { "bar", "foo" } },
+            { "[Ee]rror",              { "Error", "error" } },
+            { "x\\d+yz",               { "yz" } },
+            { "(ab){3}",               { "ababab" } },
+            { "a.*",                   { "a" } },
+            { ".*",                    {} },
+            { "\\w+",                  { "" } },
+        };
+
+        for (auto&& test : cases)
+        {
+            // ".*" matches the empty string: nothing to search for
+            string error{};
+
+            if ( test.second.empty() )
+            {
+                Context.Check( !RegexProgram::Validate(test.first, error), "no literal: " + test.first );
+                continue;
+            }
+
+            const RegexMatcher matcher({ test.first });
+
+            Context.Check( matcher.requiredLiterals() == test.second, "literals of " + test.first );
+        }
+
+        // ignoring case, literals are folded
+        Context.Check( RegexMatcher({ "ERROR \\w" }, true).requiredLiterals() == vector<string>{ "error " }, "folded literals" );
+    }
+
+    // Random regular expressions compared with their own evaluation, from the start of the contents
+    // and from any position
+    void TestRandomRegexes(TestContext& Context)
+    {
+        const vector<string> alphabets{ "ab", "abc", "aAbB" };
+        mt19937_64           random(TEST_SEED);
+
+        for (int round = 0; round < REGEX_ROUNDS; ++round)
+        {
+            const string&     alphabet = alphabets[round % alphabets.size()];
+            const bool        ignoreCase = (2 == round % alphabets.size()) && (0 == round % 2);
+            vector<string>    patterns{};
+            vector<RegexNode> regexes{};
+            string            contents( random() % MAX_REGEX_CONTENTS_SIZE, '\0' );
+            string            description{};
+            string            error{};
+
+            for (auto&& c : contents)
+            {
+                c = alphabet[random() % alphabet.size()];
+            }
+
+            while ( patterns.size() < 1 + random() % 3 )
+            {
+                RegexNode regex = RandomRegex(random, alphabet, ignoreCase, MAX_REGEX_DEPTH);
+
+                // patterns matching the empty string are rejected
+                if ( RegexProgram::Validate(regex.text, error) )
+                {
+                    patterns.push_back(regex.text);
+                    description += regex.text + " ";
+                    regexes.push_back(std::move(regex));
+                }
+            }
+
+            const size_t                  start = contents.empty() ? 0 : random() % contents.size();
+            const RegexMatcher            matcher(patterns, ignoreCase);
+            vector<PatternMatcher::Match> matches{};
+            vector<PatternMatcher::Match> fromStart{};
+
+            matcher.FindAll(contents, matches);
+            matcher.FindFrom(contents, start, fromStart);
+
+            const vector<PatternMatcher::Match> expected = ReferenceFindAll(contents, 0, regexes);
+            const vector<PatternMatcher::Match> expectedFromStart = ReferenceFindAll(contents, start, regexes);
+
+            description += ( ignoreCase ? "(ignoring case) over \"" : "over \"" ) + contents + "\"";
+
+            Context.Check( AreEqual(matches, expected), description + ": " + Describe(matches) + "expected: " + Describe(expected) );
+            Context.Check( AreEqual(fromStart, expectedFromStart), description + " from " + to_string(start) + ": " +
+                           Describe(fromStart) + "expected: " + Describe(expectedFromStart) );
+        }
+    }
+
+    // A pattern whose DFA has too many states for the cache: it keeps being cleared, and the matches
+    // stay the same
+    void TestCacheThrashing(TestContext& Context)
+    {
+        const size_t                  tail = 16;
+        mt19937_64                    random(TEST_SEED);
+        string                        contents{};
+        vector<PatternMatcher::Match> expected{};
+
+        // runs of a and b separated by c: a match runs from the start of a run to tail bytes past its last a
+        // followed by tail bytes
+        for (int run = 0; run < 4000; ++run)
+        {
+            const size_t runStart = contents.size();
+            const size_t runSize = random() % 200;
+            size_t       lastA = string::npos;
+
+            for (size_t i = 0; i < runSize; ++i)
+            {
+                contents += (0 == random() % 2) ? 'a' : 'b';
+                lastA = ( ('a' == contents.back()) && (i + tail < runSize) ) ? i : lastA;
+            }
+
+            if (string::npos != lastA)
+            {
+                expected.push_back({ runStart, 0, lastA + tail + 1 });
+            }
+
+            contents += 'c';
+        }
+
+        const vector<PatternMatcher::Match> matches = FindAll({ "(a|b)*a(a|b){16}" }, contents);
+
+        Context.Check( AreEqual(matches, expected), "cache cleared while searching: " + to_string( matches.size() ) +
+                       " matches found, " + to_string( expected.size() ) + " expected" );
+    }
+
+    // Seconds the fastest of TIMED_RUNS searches of Contents for Pattern takes; no match expected
+    double SearchTime(const string& Pattern, const string& Contents, bool& IsFound)
+    {
+        RegexMatcher                  matcher({ Pattern });
+        vector<PatternMatcher::Match> matches{};
+        double                        fastest = 0;
+
+        for (int run = 0; run < TIMED_RUNS; ++run)
+        {
+            const auto start = chrono::steady_clock::now();
+
+            matcher.FindAll(Contents, matches);
+
+            const double elapsed = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+            fastest = (0 == run) ? elapsed : min(fastest, elapsed);
+        }
+
+        IsFound = !matches.empty();
+
+        return fastest;
+    }
+
+    // A literal found every few dozen bytes, each followed far by the DFA without a match ("x.*y"):
+    // the prefilter gives up on the block, so the search costs about a plain scan, not a scan of
+    // REGEX_MAX_MATCH_SIZE bytes per literal; compared with the same literals where the DFA stops at
+    // once (a newline follows each of them)
+    void TestCommonLiterals(TestContext& Context)
+    {
+        string followed(TIMED_CONTENTS_SIZE, 'a');
+        string stopped(TIMED_CONTENTS_SIZE, 'a');
+        bool   isFollowedFound = false;
+        bool   isStoppedFound = false;
+
+        for (size_t i = 0; i + 1 < TIMED_CONTENTS_SIZE; i += 64)
+        {
+            followed[i] = 'x';
+            stopped[i] = 'x';
+            stopped[i + 1] = '\n';
+        }
+
+        const double followedTime = SearchTime("x.*y", followed, isFollowedFound);
+        const double stoppedTime = SearchTime("x.*y", stopped, isStoppedFound);
+
+        Context.Check( !isFollowedFound && !isStoppedFound, "common literals: no match" );
+        Context.Check( followedTime <= 16 * stoppedTime + 0.01, "common literals: " + to_string(followedTime) +
+                       " s, stopping at once: " + to_string(stoppedTime) + " s" );
+    }
+
+    // A file split into chunks, with matches running from one chunk into the next: the matches are the
+    // same as those of a search of the whole file
+    void TestChunkedFile(TestContext& Context)
+    {
+        const fs::path       file = fs::temp_directory_path() / ( "stringfinder-regex-" + to_string( random_device()() ) );
+        const vector<string> patterns{ "aaa", "ca+b" };
+        mt19937_64           random(TEST_SEED);
+        string               contents(2 * FILE_CHUNK_SIZE + 4096, 'x');
+        error_code           error;
+
+        for (size_t position = 0; position + 64 < contents.size(); position += 500 + random() % 1000)
+        {
+            contents.replace( position, 0, string(1 + random() % 40, 'a') + ( (0 == random() % 2) ? "b" : "c" ) );
+        }
+
+        contents.resize(2 * FILE_CHUNK_SIZE + 4096);
+
+        // "aaa" out of step with the chunk boundary for longer than a resumed window; a match straddling
+        // the second boundary
+        fill(contents.begin() + FILE_CHUNK_SIZE - 1000, contents.begin() + FILE_CHUNK_SIZE + 200000, 'a');
+        contents.replace(2 * FILE_CHUNK_SIZE - 2000, 3002, 'c' + string(3000, 'a') + 'b');
+
+        {
+            ofstream stream(file, ios::binary);
+
+            stream.write( contents.data(), static_cast<streamsize>( contents.size() ) );
+        }
+
+        SearchOptions options{};
+
+        options.regex = true;
+
+        const vector<PatternMatcher::Match> expected = FindAll(patterns, contents);
+        DataExtractor                       search(patterns, file.string(), options);
+        SearchEngine                        engine(4);
+        bool                                isEqual = false;
+
+        engine.Run(search);
+
+        if (1 == search.results().size())
+        {
+            const StringData& data = search.results().front()->stringData;
+
+            isEqual = ( data.size() == expected.size() );
+
+            for (size_t i = 0; isEqual && (i < data.size()); ++i)
+            {
+                const size_t end = expected[i].position + expected[i].length;
+
+                isEqual = (data.position(i) == expected[i].position) && (data.searchString(i) == expected[i].pattern) &&
+                          ( data.affixes(i).suffix == string_view(contents).substr( end, data.affixes(i).suffix.size() ) );
+            }
+        }
+
+        Context.Check( isEqual, "chunked file: " + to_string( expected.size() ) + " matches expected" );
+
+        fs::remove(file, error);
+    }
+}
+
+void TestRegexMatcher(TestContext& Context)
+{
+    TestSyntax(Context);
+    TestMatches(Context);
+    TestLiterals(Context);
+    TestRandomRegexes(Context);
+    TestCacheThrashing(Context);
+    TestCommonLiterals(Context);
+    TestChunkedFile(Context);
+}
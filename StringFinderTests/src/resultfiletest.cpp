@@ -0,0 +1,465 @@
+#include "testcontext.h"
+#include "stringdata.h"
+#include "outputbuffer.h"
+#include "resultreader.h"
+#include "resultformatter.h"
+
+#include <random>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <string_view>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr int    RESULT_FILES = 50;
+    constexpr size_t MAX_FILE_MATCHES = 300;
+    constexpr int    JSON_RANDOM_STRINGS = 500;
+
+    // A match as it is expected back
+    struct ExpectedMatch
+    {
+        uint64_t position;
+        size_t   searchString;
+        string   prefix;
+        string   suffix;
+    };
+
+    struct ExpectedFile
+    {
+        fs::path              path;
+        vector<ExpectedMatch> matches;
+    };
+
+    string RandomBytes(size_t Size, mt19937_64& Random)
+    {
+        string bytes(Size, '\0');
+
+        for (auto&& byte : bytes)
+        {
+            byte = static_cast<char>( Random() % 256 );
+        }
+
+        return bytes;
+    }
+
+    string ReadFile(const fs::path& File)
+    {
+        ifstream stream(File, ios::binary);
+
+        return string( istreambuf_iterator<char>(stream), istreambuf_iterator<char>() );
+    }
+
+    // Writes Files with BinaryFormatter, reads them back with ResultReader and compares every match
+    void TestBinaryRoundTrip(TestContext& Context, const fs::path& ResultFile, const vector<string>& SearchStrings)
+    {
+        const string         description = "binary round trip (" + to_string( SearchStrings.size() ) + " search strings)";
+        mt19937_64           random( TEST_SEED + SearchStrings.size() );
+        vector<ExpectedFile> expected{};
+        vector<StringData>   data(RESULT_FILES);
+        uint64_t             matchCount = 0;
+
+        for (int i = 0; i < RESULT_FILES; ++i)
+        {
+            ExpectedFile file{ fs::u8path( "dir " + to_string(i % 4) + "/caf\xc3\xa9-" + to_string(i) + ".txt" ), {} };
+            uint64_t     position = random() % 4;
+
+            // a few files past 4 GB, with positions that need long varints
+            if (0 == i % 10)
+            {
+                position += uint64_t{ 1 } << 33;
+            }
+
+            // a few files searched without affixes
+            const bool withAffixes = (3 != i % 5);
+
+            for (size_t match = random() % MAX_FILE_MATCHES; match > 0; --match)
+            {
+                // short affixes, as next to the edges of a file, once in a while
+                const size_t prefixSize = !withAffixes ? 0 : (0 == random() % 8) ? random() % AFFIX_SIZE : AFFIX_SIZE;
+                const size_t suffixSize = !withAffixes ? 0 : (0 == random() % 8) ? random() % AFFIX_SIZE : AFFIX_SIZE;
+
+                file.matches.push_back( ExpectedMatch{ position, random() % SearchStrings.size(),
+                                                       RandomBytes(prefixSize, random), RandomBytes(suffixSize, random) } );
+                position += 1 + ( (0 == random() % 16) ? random() % 100000 : random() % 64 );
+            }
+
+            for (auto&& match : file.matches)
+            {
+                data[i].Add(match.position, match.searchString, match.prefix, match.suffix);
+            }
+
+            matchCount += file.matches.size();
+            expected.push_back( std::move(file) );
+        }
+
+        {
+            OutputBuffer output{};
+
+            if ( !Context.Check(output.Open(ResultFile), description + ": result file created") )
+            {
+                return;
+            }
+
+            BinaryFormatter formatter(output, SearchStrings);
+
+            for (int i = 0; i < RESULT_FILES; ++i)
+            {
+                formatter.WriteFile(expected[i].path, data[i]);
+            }
+
+            formatter.Finish();
+            output.Flush();
+        }
+
+        ResultReader reader{};
+
+        if ( !Context.Check(reader.Open(ResultFile), description + ": result file read") )
+        {
+            return;
+        }
+
+        Context.Check( reader.fileCount() == expected.size(), description + ": file count" );
+        Context.Check( reader.matchCount() == matchCount, description + ": match count" );
+        Context.Check( vector<string>( reader.searchStrings().begin(), reader.searchStrings().end() ) == SearchStrings,
+                       description + ": search strings" );
+
+        for (size_t i = 0; (i < reader.fileCount()) && (i < expected.size()); ++i)
+        {
+            const ResultReader::FileRecord record = reader.file(i);
+            const vector<ExpectedMatch>&   matches = expected[i].matches;
+            size_t                         index = 0;
+            bool                           isSame = (record.path() == expected[i].path.u8string()) &&
+                                                    (record.matchCount() == matches.size());
+
+            for (auto&& match : record)
+            {
+                isSame = isSame && (index < matches.size()) && (match.position == matches[index].position) &&
+                         (match.searchString == matches[index].searchString) &&
+                         (match.prefix == matches[index].prefix) && (match.suffix == matches[index].suffix);
+                ++index;
+            }
+
+            Context.Check( isSame && (index == matches.size()), description + ": record " + to_string(i) );
+        }
+
+        reader.Close();
+
+        // a file cut anywhere (e.g. by a full disk) is rejected rather than read partially
+        const string contents = ReadFile(ResultFile);
+
+        for (auto&& size : { size_t{ 0 }, size_t{ 7 }, contents.size() / 2, contents.size() - 1 })
+        {
+            {
+                ofstream stream(ResultFile, ios::binary | ios::trunc);
+
+                stream.write( contents.data(), static_cast<streamsize>(size) );
+            }
+
+            Context.Check( !reader.Open(ResultFile), description + ": file cut at " + to_string(size) + " bytes rejected" );
+        }
+    }
+
+    // Returns true if Text is made of valid UTF-8 sequences only (no overlong form, no surrogate)
+    bool IsValidUtf8(string_view Text)
+    {
+        for (size_t i = 0; i < Text.size(); )
+        {
+            const unsigned char byte = static_cast<unsigned char>(Text[i]);
+            size_t              size = 1;
+            unsigned char       low = 0x80;   // bounds of the second byte
+            unsigned char       high = 0xbf;
+
+            if ( (byte >= 0xc2) && (byte <= 0xdf) )
+            {
+                size = 2;
+            }
+            else if ( (byte >= 0xe0) && (byte <= 0xef) )
+            {
+                size = 3;
+                low = (0xe0 == byte) ? 0xa0 : 0x80;
+                high = (0xed == byte) ? 0x9f : 0xbf;
+            }
+            else if ( (byte >= 0xf0) && (byte <= 0xf4) )
+            {
+                size = 4;
+                low = (0xf0 == byte) ? 0x90 : 0x80;
+                high = (0xf4 == byte) ? 0x8f : 0xbf;
+            }
+            else if (byte >= 0x80)
+            {
+                return false;
+            }
+
+            for (size_t next = 1; next < size; ++next)
+            {
+                const unsigned char continuation = (i + next < Text.size()) ? static_cast<unsigned char>(Text[i + next]) : 0;
+
+                if ( (continuation < ( (1 == next) ? low : 0x80 )) || (continuation > ( (1 == next) ? high : 0xbf )) )
+                {
+                    return false;
+                }
+            }
+
+            i += size;
+        }
+
+        return true;
+    }
+
+    void AppendUtf8(uint32_t CodePoint, string& Text)
+    {
+        if (CodePoint < 0x80)
+        {
+            Text.push_back( static_cast<char>(CodePoint) );
+        }
+        else if (CodePoint < 0x800)
+        {
+            Text.push_back( static_cast<char>( 0xc0 | (CodePoint >> 6) ) );
+            Text.push_back( static_cast<char>( 0x80 | (CodePoint & 0x3f) ) );
+        }
+        else if (CodePoint < 0x10000)
+        {
+            Text.push_back( static_cast<char>( 0xe0 | (CodePoint >> 12) ) );
+            Text.push_back( static_cast<char>( 0x80 | ( (CodePoint >> 6) & 0x3f ) ) );
+            Text.push_back( static_cast<char>( 0x80 | (CodePoint & 0x3f) ) );
+        }
+        else
+        {
+            Text.push_back( static_cast<char>( 0xf0 | (CodePoint >> 18) ) );
+            Text.push_back( static_cast<char>( 0x80 | ( (CodePoint >> 12) & 0x3f ) ) );
+            Text.push_back( static_cast<char>( 0x80 | ( (CodePoint >> 6) & 0x3f ) ) );
+            Text.push_back( static_cast<char>( 0x80 | (CodePoint & 0x3f) ) );
+        }
+    }
+
+    // Decodes the JSON string starting at Json[Index] (its opening quote) as any JSON parser does
+    // (Json is known to be valid UTF-8):
+    // escapes stand for characters (é is "é"), Text receives them UTF-8 encoded; Index is moved
+    // past the closing quote. Returns false if the string is not valid JSON
+    bool DecodeJsonString(string_view Json, size_t& Index, string& Text)
+    {
+        Text.clear();
+
+        if ( (Index >= Json.size()) || ('"' != Json[Index]) )
+        {
+            return false;
+        }
+
+        size_t i = Index + 1;
+
+        while ( (i < Json.size()) && ('"' != Json[i]) )
+        {
+            const unsigned char byte = static_cast<unsigned char>(Json[i]);
+
+            if (byte < 0x20)
+            {
+                return false;
+            }
+
+            if ('\\' != byte)
+            {
+                Text.push_back(Json[i++]);
+                continue;
+            }
+
+            if (i + 1 >= Json.size())
+            {
+                return false;
+            }
+
+            const char   escape = Json[i + 1];
+            const size_t simple = string_view("\"\\/bfnrt").find(escape);
+
+            if (string_view::npos != simple)
+            {
+                Text.push_back( "\"\\/\b\f\n\r\t"[simple] );
+                i += 2;
+                continue;
+            }
+
+            if ( ('u' != escape) || (i + 6 > Json.size()) )
+            {
+                return false;
+            }
+
+            uint32_t codePoint = static_cast<uint32_t>( stoul( string( Json.substr(i + 2, 4) ), nullptr, 16 ) );
+
+            i += 6;
+
+            // surrogate pair
+            if ( (codePoint >= 0xd800) && (codePoint <= 0xdbff) && (i + 6 <= Json.size()) && (0 == Json.compare(i, 2, "\\u")) )
+            {
+                const uint32_t low = static_cast<uint32_t>( stoul( string( Json.substr(i + 2, 4) ), nullptr, 16 ) );
+
+                codePoint = 0x10000 + ( (codePoint - 0xd800) << 10 ) + (low - 0xdc00);
+                i += 6;
+            }
+
+            AppendUtf8(codePoint, Text);
+        }
+
+        if (i >= Json.size())
+        {
+            return false;
+        }
+
+        Index = i + 1;
+
+        return true;
+    }
+
+    // Bytes of a base64 string (RFC 4648, padded); false if it is not
+    bool DecodeBase64(string_view Base64, string& Bytes)
+    {
+        static constexpr string_view BASE64_DIGITS = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        Bytes.clear();
+
+        if (0 != Base64.size() % 4)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < Base64.size(); i += 4)
+        {
+            uint32_t group = 0;
+            size_t   padding = 0;
+
+            for (size_t digit = 0; digit < 4; ++digit)
+            {
+                const size_t value = BASE64_DIGITS.find(Base64[i + digit]);
+
+                padding += ('=' == Base64[i + digit]) ? 1 : 0;
+
+                if ( (string_view::npos == value) && ( ('=' != Base64[i + digit]) || (i + 4 != Base64.size()) || (digit < 2) ) )
+                {
+                    return false;
+                }
+
+                group = (group << 6) | ( (string_view::npos == value) ? 0 : static_cast<uint32_t>(value) );
+            }
+
+            for (size_t byte = 0; byte < 3 - padding; ++byte)
+            {
+                Bytes.push_back( static_cast<char>( (group >> (16 - 8 * byte)) & 0xff ) );
+            }
+        }
+
+        return true;
+    }
+
+    // Writes Text with WriteJsonField, in an object of its own, and reads the object back
+    string WriteJsonField(const fs::path& File, string_view Text)
+    {
+        {
+            OutputBuffer output{};
+
+            output.Open(File);
+            output.Write('{');
+            output.WriteJsonField("field", Text);
+            output.Write('}');
+        }
+
+        return ReadFile(File);
+    }
+
+    // Bytes a consumer gets back from the object {"field":"..."} or {"field_base64":"..."}
+    bool DecodeJsonField(string_view Json, string& Bytes)
+    {
+        size_t index = 1;
+        string name{};
+        string value{};
+
+        if ( !IsValidUtf8(Json) || (Json.size() < 2) || ('{' != Json.front()) || ('}' != Json.back()) || !DecodeJsonString(Json, index, name) ||
+             (index >= Json.size()) || (':' != Json[index++]) || !DecodeJsonString(Json, index, value) ||
+             (index + 1 != Json.size()) )
+        {
+            return false;
+        }
+
+        if ("field" == name)
+        {
+            Bytes = value;
+            return true;
+        }
+
+        return ("field_base64" == name) && DecodeBase64(value, Bytes);
+    }
+
+    // Every field written by WriteJsonField is valid JSON, and a standard JSON decoder gets its exact
+    // bytes back: text as a JSON string, anything else base64 encoded
+    void TestJsonFields(TestContext& Context, const fs::path& JsonFile)
+    {
+        const vector< pair<string, string> > cases{
+            { "",                        "{\"field\":\"\"}" },
+            { "plain",                   "{\"field\":\"plain\"}" },
+            { "a\"b\\c",                 "{\"field\":\"a\\\"b\\\\c\"}" },
+            { "tab\tline\n\r",           "{\"field\":\"tab\\u0009line\\u000a\\u000d\"}" },
+            { string("nul\0", 4),        "{\"field\":\"nul\\u0000\"}" },
+            { "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80", "{\"field\":\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"}" },
+            { "caf\xe9",                 "{\"field_base64\":\"Y2Fm6Q==\"}" },  // Latin-1
+            { "\xc0\xaf",                "{\"field_base64\":\"wK8=\"}" },      // overlong '/'
+            { "\xed\xa0\x80",            "{\"field_base64\":\"7aCA\"}" },      // surrogate
+            { "\xe2\x82",                "{\"field_base64\":\"4oI=\"}" },      // cut sequence
+        };
+        string decoded{};
+
+        for (auto&& test : cases)
+        {
+            const string json = WriteJsonField(JsonFile, test.first);
+
+            Context.Check( (json == test.second) && DecodeJsonField(json, decoded) && (decoded == test.first),
+                           "JSON field: <" + test.second + ">" );
+        }
+
+        // "é" and the Latin-1 byte of "é" must not read back the same
+        string latin1{};
+
+        DecodeJsonField(WriteJsonField(JsonFile, "\xe9"), latin1);
+        DecodeJsonField(WriteJsonField(JsonFile, "\xc3\xa9"), decoded);
+        Context.Check( (latin1 == "\xe9") && (decoded == "\xc3\xa9"), "JSON field: Latin-1 byte is not a character" );
+
+        // random bytes, and random valid sequences among invalid ones
+        const vector<string> pieces{ "a", "\"", "\\", "\n", string(1, '\0'), "\x7f", "\xc3\xa9", "\xe2\x82\xac",
+                                     "\xf0\x9f\x98\x80", "\xc3", "\xe2\x82", "\xff", "\xf5\x80\x80\x80", "\xed\xbf\xbf" };
+        mt19937_64           random(TEST_SEED);
+        size_t               failures = 0;
+
+        for (int i = 0; i < JSON_RANDOM_STRINGS; ++i)
+        {
+            string text = (0 == i % 2) ? RandomBytes(random() % 16, random) : string();
+
+            for (size_t piece = random() % 24; piece > 0; --piece)
+            {
+                text += pieces[ random() % pieces.size() ];
+            }
+
+            if ( !DecodeJsonField(WriteJsonField(JsonFile, text), decoded) || (decoded != text) )
+            {
+                ++failures;
+            }
+        }
+
+        Context.Check( 0 == failures, "JSON round trip of random strings: " + to_string(failures) + " failures" );
+    }
+}
+
+void TestResultFiles(TestContext& Context)
+{
+    const fs::path root = fs::temp_directory_path() / ( "stringfinder-results-" + to_string( random_device()() ) );
+    error_code     error;
+
+    fs::create_directories(root, error);
+
+    TestBinaryRoundTrip(Context, root / "single.bin", { "needle" });
+    TestBinaryRoundTrip(Context, root / "several.bin", { "needle", "pin", string("bin\0ary", 7) });
+    TestJsonFields(Context, root / "field.json");
+
+    fs::remove_all(root, error);
+}
@@ -0,0 +1,289 @@
+#include "testcontext.h"
+#include "searchengine.h"
+#include "dataextractor.h"
+#include "asyncreader.h"
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <condition_variable>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr int    STRESS_THREADS = 256;
+    constexpr int    STRESS_ROUNDS = 4;
+    constexpr int    STRESS_DIRECTORIES = 40;
+    constexpr int    STRESS_FILES_PER_DIRECTORY = 60;
+    constexpr size_t STRESS_FILE_SIZE = 2048;
+    constexpr int    STRESS_HUGE_FILES = 2;  // split into chunks (see FILE_CHUNK_SIZE)
+    constexpr auto   STALLED_SOURCE_TIME = chrono::seconds(4);
+
+    // Matches expected in every file, per search string
+    using ExpectedMatches = map< string, vector<size_t> >;
+
+    // Writes a file of Size random letters holding the search strings at random positions, and at
+    // Boundaries (straddling them); records how many times each search string was written
+    bool WriteFile(const fs::path& File, size_t Size, const vector<string>& SearchStrings, const vector<size_t>& Boundaries,
+                   mt19937_64& Random, ExpectedMatches& Expected)
+    {
+        string         contents(Size, '\0');
+        vector<size_t> counts( SearchStrings.size(), 0 );
+
+        // the search strings start with letters never written otherwise: they cannot overlap
+        for (auto&& c : contents)
+        {
+            c = static_cast<char>( 'a' + Random() % 16 );
+        }
+
+        const auto place = [&](size_t Position, size_t SearchString)
+                           {
+                               contents.replace( Position, SearchStrings[SearchString].size(), SearchStrings[SearchString] );
+                               ++counts[SearchString];
+                           };
+
+        for (size_t slot = 0; slot + 16 <= Size; slot += 16)
+        {
+            if (0 == Random() % 8)
+            {
+                place( slot, Random() % SearchStrings.size() );
+            }
+        }
+
+        for (auto&& boundary : Boundaries)
+        {
+            // the slots around the boundary are overwritten: remove what they held first
+            for (size_t slot = (boundary / 16 - 1) * 16; slot < (boundary / 16 + 1) * 16; slot += 16)
+            {
+                for (size_t searchString = 0; searchString < SearchStrings.size(); ++searchString)
+                {
+                    if (0 == contents.compare( slot, SearchStrings[searchString].size(), SearchStrings[searchString] ))
+                    {
+                        --counts[searchString];
+                    }
+                }
+
+                fill(contents.begin() + slot, contents.begin() + slot + 16, 'a');
+            }
+
+            place(boundary - 3, 0);
+        }
+
+        ofstream file(File, ios::binary);
+
+        file.write( contents.data(), static_cast<streamsize>( contents.size() ) );
+        Expected[ File.string() ] = counts;
+
+        return file.good();
+    }
+
+    // Compares the matches of a search with the matches written
+    bool AreExpected(const map< string, vector<size_t> >& Found, const ExpectedMatches& Expected)
+    {
+        for (auto&& file : Expected)
+        {
+            const bool isEmpty = all_of(file.second.begin(), file.second.end(), [](size_t Count) { return 0 == Count; });
+            const auto found = Found.find(file.first);
+
+            if ( isEmpty ? ( found != Found.end() ) : ( (found == Found.end()) || (found->second != file.second) ) )
+            {
+                return false;
+            }
+        }
+
+        return ( Found.size() <= Expected.size() );
+    }
+
+    // The read stage hands a file over while the enumeration is stalled: a source that blocks must not
+    // hold the reads already in flight
+    void TestStalledSource(TestContext& Context, const fs::path& File)
+    {
+        mutex              stateMutex;
+        condition_variable consumed;
+        bool               isConsumed = false;
+        bool               isSent = false;
+
+        AsyncReader reader([&](fs::path& Path, uint64_t& Sequence, bool Wait)
+                           {
+                               if (!isSent)
+                               {
+                                   isSent = true;
+                                   Path = File;
+                                   Sequence = 0;
+                                   return true;
+                               }
+
+                               if (!Wait)
+                               {
+                                   Path.clear();
+                                   return true;
+                               }
+
+                               unique_lock<mutex> lock(stateMutex);
+
+                               consumed.wait_for(lock, STALLED_SOURCE_TIME, [&isConsumed] { return isConsumed; });
+
+                               return false;
+                           });
+        AsyncReader::ReadFile file{};
+
+        const auto start = chrono::steady_clock::now();
+
+        reader.Start();
+
+        const bool isPopped = reader.Pop(file);
+        const auto elapsed = chrono::steady_clock::now() - start;
+
+        {
+            lock_guard<mutex> lock(stateMutex);
+
+            isConsumed = true;
+        }
+
+        consumed.notify_all();
+        reader.Wait();
+
+        Context.Check( isPopped && (file.path == File) && file.isRead && (elapsed < STALLED_SOURCE_TIME / 2),
+                       string("read stage (") + reader.backend() + "): file handed over while the source is stalled" );
+    }
+
+    void CountMatches(const fs::path& File, const StringData& Data, size_t NumSearchStrings,
+                      map< string, vector<size_t> >& Found)
+    {
+        vector<size_t>& counts = Found[ File.string() ];
+
+        counts.assign(NumSearchStrings, 0);
+
+        for (size_t i = 0; i < Data.size(); ++i)
+        {
+            ++counts[ Data.searchString(i) ];
+        }
+    }
+}
+
+void TestSearchEngine(TestContext& Context)
+{
+    const vector<string> searchStrings{ "xyneedle", "xzpin", "yzhaystack" };
+    const fs::path       root = fs::temp_directory_path() / ( "stringfinder-tests-" + to_string( random_device()() ) );
+    mt19937_64           random(TEST_SEED);
+    ExpectedMatches      expected{};
+    bool                 isWritten = true;
+    error_code           error;
+
+    for (int directory = 0; directory < STRESS_DIRECTORIES; ++directory)
+    {
+        const fs::path path = root / ( "dir" + to_string(directory) );
+
+        fs::create_directories(path, error);
+
+        for (int file = 0; file < STRESS_FILES_PER_DIRECTORY; ++file)
+        {
+            isWritten = isWritten && WriteFile(path / ( "file" + to_string(file) + ".txt" ), STRESS_FILE_SIZE, searchStrings,
+                                               {}, random, expected);
+        }
+    }
+
+    for (int file = 0; file < STRESS_HUGE_FILES; ++file)
+    {
+        isWritten = isWritten && WriteFile(root / ( "huge" + to_string(file) + ".txt" ), 2 * FILE_CHUNK_SIZE + 4096,
+                                           searchStrings, { FILE_CHUNK_SIZE, 2 * FILE_CHUNK_SIZE }, random, expected);
+    }
+
+    if ( !Context.Check(isWritten, "corpus written to " + root.string()) )
+    {
+        fs::remove_all(root, error);
+        return;
+    }
+
+    TestStalledSource( Context, expected.begin()->first );
+
+    SearchEngine engine(STRESS_THREADS);
+
+    for (int round = 0; round < STRESS_ROUNDS; ++round)
+    {
+        SearchOptions options{};
+
+        // every other round without the read ahead stage
+        options.ioDepth = (0 == round % 2) ? 64 : 0;
+
+        // all results kept, in path order
+        {
+            DataExtractor                 search(searchStrings, root.string(), options);
+            map< string, vector<size_t> > found{};
+            bool                          isOrdered = true;
+
+            engine.Run(search);
+
+            for (size_t i = 0; i < search.results().size(); ++i)
+            {
+                CountMatches(search.results()[i]->path, search.results()[i]->stringData, searchStrings.size(), found);
+                isOrdered = isOrdered && ( (0 == i) || (search.results()[i - 1]->path < search.results()[i]->path) );
+            }
+
+            Context.Check(isOrdered && AreExpected(found, expected), "round " + to_string(round) + ": collected results");
+        }
+
+        // streamed results, in path order then as soon as found
+        for (bool isOrderedOutput : { true, false })
+        {
+            options.orderedOutput = isOrderedOutput;
+
+            DataExtractor                 search(searchStrings, root.string(), options);
+            map< string, vector<size_t> > found{};
+            fs::path                      previous{};
+            bool                          isOrdered = true;
+
+            engine.Run(search, [&](const fs::path& File, const StringData& Data)
+                               {
+                                   CountMatches(File, Data, searchStrings.size(), found);
+                                   isOrdered = isOrdered && (previous < File);
+                                   previous = File;
+                               });
+
+            Context.Check( (isOrdered || !isOrderedOutput) && AreExpected(found, expected),
+                           "round " + to_string(round) + ( isOrderedOutput ? ": ordered" : ": streamed" ) + " results" );
+        }
+
+        // concurrent searches sharing the workers
+        {
+            vector< map< string, vector<size_t> > > found(4);
+            vector<thread>                          searches{};
+
+            for (auto&& results : found)
+            {
+                searches.emplace_back([&engine, &searchStrings, &root, &options, &results]
+                                      {
+                                          DataExtractor search(searchStrings, root.string(), options);
+                                          mutex         resultsMutex;
+
+                                          engine.Run(search, [&](const fs::path& File, const StringData& Data)
+                                                             {
+                                                                 lock_guard<mutex> lock(resultsMutex);
+                                                                 CountMatches(File, Data, searchStrings.size(), results);
+                                                             });
+                                      });
+            }
+
+            for (auto&& search : searches)
+            {
+                search.join();
+            }
+
+            for (auto&& results : found)
+            {
+                Context.Check( AreExpected(results, expected), "round " + to_string(round) + ": concurrent results" );
+            }
+        }
+    }
+
+    fs::remove_all(root, error);
+}
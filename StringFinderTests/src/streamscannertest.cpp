@@ -0,0 +1,131 @@
+#include "testcontext.h"
+#include "streamscanner.h"
+#include "patternmatcher.h"
+#include "stringdata.h"
+
+#include <set>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    constexpr int    SCANNER_ROUNDS = 60;
+    constexpr size_t MAX_INPUT_SIZE = 400;
+    constexpr size_t MAX_BLOCK_SIZE = 48;  // every block size up to it, then a block larger than the input
+
+    string RandomInput(mt19937_64& Random, size_t Size)
+    {
+        static const char alphabet[] = "abc";
+        string            input(Size, '\0');
+
+        for (auto&& c : input)
+        {
+            c = alphabet[Random() % 3];
+        }
+
+        return input;
+    }
+
+    // Scans Input with reads of random sizes (as a pipe would return them); returns false if a match
+    // was reported twice or without its affixes, Matches holding the absolute positions otherwise
+    bool Scan(StreamScanner& Scanner, const string& Input, mt19937_64& Random, vector<PatternMatcher::Match>& Matches)
+    {
+        size_t          consumed = 0;
+        set<uint64_t>   previousWindows{};
+        bool            isValid = true;
+
+        const bool isScanned = Scanner.Scan([&](char* Buffer, size_t Size, size_t& BytesRead)
+                                            {
+                                                BytesRead = min( Input.size() - consumed, 1 + Random() % Size );
+                                                memcpy(Buffer, Input.data() + consumed, BytesRead);
+                                                consumed += BytesRead;
+                                                return true;
+                                            },
+                                            [&](string_view Window, uint64_t Offset, const vector<PatternMatcher::Match>& Found)
+                                            {
+                                                // every window reports its matches at once
+                                                isValid = isValid && previousWindows.insert(Offset).second;
+                                                isValid = isValid && ( Window == string_view(Input).substr(Offset, Window.size()) );
+
+                                                for (auto&& match : Found)
+                                                {
+                                                    const uint64_t position = Offset + match.position;
+                                                    const size_t   end = match.position + match.length;
+                                                    const size_t   prefix = min<uint64_t>(AFFIX_SIZE, position);
+                                                    const size_t   suffix = min<uint64_t>(AFFIX_SIZE, Input.size() - Offset - end);
+
+                                                    isValid = isValid && (match.position >= prefix) && (end + suffix <= Window.size());
+                                                    Matches.push_back({ static_cast<size_t>(position), match.pattern, match.length });
+                                                }
+                                            });
+
+        return isScanned && isValid && (Scanner.inputSize() == Input.size());
+    }
+}
+
+void TestStreamScanner(TestContext& Context)
+{
+    mt19937_64 random(TEST_SEED);
+
+    for (int round = 0; round < SCANNER_ROUNDS; ++round)
+    {
+        const string   input = RandomInput(random, random() % MAX_INPUT_SIZE);
+        vector<string> patterns{};
+
+        // one pattern (literal search), or a few of them of every length up to the block sizes tested
+        while ( patterns.size() < ( (0 == round % 3) ? 1 : 2 + random() % 6 ) )
+        {
+            string pattern = RandomInput(random, 1 + random() % MAX_BLOCK_SIZE);
+
+            if ( find(patterns.begin(), patterns.end(), pattern) == patterns.end() )
+            {
+                patterns.push_back(std::move(pattern));
+            }
+        }
+
+        // patterns cut from the input are found, across block boundaries
+        if ( input.size() > MAX_BLOCK_SIZE )
+        {
+            string pattern = input.substr(random() % (input.size() - MAX_BLOCK_SIZE), 1 + random() % MAX_BLOCK_SIZE);
+
+            if ( find(patterns.begin(), patterns.end(), pattern) == patterns.end() )
+            {
+                patterns.back() = std::move(pattern);
+            }
+        }
+
+        // every fourth round as regular expressions: matches do not overlap, so every window goes on from
+        // the end of the last match of the previous one
+        const bool                       isRegex = (3 == round % 4);
+        const unique_ptr<PatternMatcher> matcher = PatternMatcher::Create(patterns, false, isRegex);
+        vector<PatternMatcher::Match>    expected{};
+
+        matcher->FindAll(input, expected);
+
+        for (size_t blockSize = 1; blockSize <= MAX_BLOCK_SIZE + 1; ++blockSize)
+        {
+            // a last block larger than the input: a single window
+            StreamScanner                 scanner( *matcher, (blockSize > MAX_BLOCK_SIZE) ? MAX_INPUT_SIZE : blockSize );
+            vector<PatternMatcher::Match> matches{};
+            const bool                    isValid = Scan(scanner, input, random, matches);
+
+            sort(matches.begin(), matches.end(), [](const PatternMatcher::Match& Lhs, const PatternMatcher::Match& Rhs)
+                                                 { return (Lhs.position != Rhs.position) ? (Lhs.position < Rhs.position)
+                                                                                         : (Lhs.pattern < Rhs.pattern); });
+
+            const bool isEqual = equal(matches.begin(), matches.end(), expected.begin(), expected.end(),
+                                       [](const PatternMatcher::Match& L, const PatternMatcher::Match& R)
+                                       { return (L.position == R.position) && (L.pattern == R.pattern) && (L.length == R.length); });
+
+            Context.Check( isValid && isEqual, "block size " + to_string(blockSize) + ", " + to_string( patterns.size() ) +
+                           ( isRegex ? " regular expressions over " : " patterns over " ) + to_string( input.size() ) +
+                           " bytes: " + to_string( matches.size() ) + " matches reported, " + to_string( expected.size() ) +
+                           " expected" );
+        }
+    }
+}
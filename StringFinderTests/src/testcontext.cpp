@@ -0,0 +1,43 @@
+#include "testcontext.h"
+
+#include <iostream>
+#include <termcolor/termcolor.hpp>
+
+using namespace std;
+using namespace termcolor;
+
+TestContext::TestContext(string Suite) : _suite{ std::move(Suite) }, _checks{ 0 }, _failures{ 0 }
+{
+}
+
+bool TestContext::Check(bool Condition, const string& Description)
+{
+    ++_checks;
+
+    if (!Condition)
+    {
+        if (_failures < MAX_REPORTED_FAILURES)
+        {
+            cout << red << "[" << _suite << "] FAILED: " << Description << reset << endl;
+        }
+
+        ++_failures;
+    }
+
+    return Condition;
+}
+
+const string& TestContext::suite() const
+{
+    return _suite;
+}
+
+size_t TestContext::checks() const
+{
+    return _checks;
+}
+
+size_t TestContext::failures() const
+{
+    return _failures;
+}
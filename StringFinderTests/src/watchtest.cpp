@@ -0,0 +1,393 @@
+#include "testcontext.h"
+#include "searchengine.h"
+#include "dataextractor.h"
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#endif
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+#ifdef __linux__
+namespace {
+    constexpr int    WATCH_TIMEOUT = 10000;                        // in milliseconds, per expected result
+    constexpr int    WATCH_SETTLE_TIME = 3 * WATCH_POLL_INTERVAL;  // unexpected results show up within it
+    constexpr size_t BURST_MATCHES = 8000;                         // their results do not fit in a pipe
+
+    // Results of a file, as written by the watcher: its name and the positions of its matches
+    struct Record
+    {
+        string           name;
+        vector<uint64_t> positions;
+    };
+
+    // A search of a location in watch mode, its results (JSON lines) read from a pipe by a dedicated
+    // thread; while the reader is paused, the watcher blocks as soon as the pipe is full
+    class WatchedSearch
+    {
+    public:
+        WatchedSearch(const fs::path& Root, const vector<string>& SearchStrings, bool IsRegex) :
+            _engine{ 2 }, _search{}, _pipe{ -1, -1 }, _watchThread{}, _readThread{}, _mutex{}, _output{}, _taken{ 0 },
+            _isPaused{ false }
+        {
+            SearchOptions options{};
+
+            options.watchChanges = true;
+            options.regex = IsRegex;
+            options.outputFormat = SearchOptions::JSON_LINES;
+
+            _search = make_unique<DataExtractor>(SearchStrings, Root.string(), options);
+        }
+
+        WatchedSearch(const WatchedSearch& s) = delete;
+
+        WatchedSearch& operator=(const WatchedSearch& s) = delete;
+
+        ~WatchedSearch()
+        {
+            Stop();
+        }
+
+        // Runs the first search, displays its results, then watches the location
+        bool Start()
+        {
+            if (0 != pipe2(_pipe, O_CLOEXEC))
+            {
+                return false;
+            }
+
+            _readThread = thread([this]
+                                 {
+                                     char buffer[65536];
+
+                                     while (true)
+                                     {
+                                         if (_isPaused)
+                                         {
+                                             this_thread::sleep_for( chrono::milliseconds(10) );
+                                             continue;
+                                         }
+
+                                         const ssize_t size = read( _pipe[0], buffer, sizeof(buffer) );
+
+                                         if (size <= 0)
+                                         {
+                                             break;
+                                         }
+
+                                         lock_guard<mutex> lock(_mutex);
+
+                                         _output.append( buffer, static_cast<size_t>(size) );
+                                     }
+                                 });
+
+            _search->SetOutput(_pipe[1], false);
+            _engine.Run(*_search);
+            _search->DisplayData();
+
+            _watchThread = thread([this] { _engine.Watch(*_search); });
+
+            return true;
+        }
+
+        // Cancels the watch and waits for the threads
+        void Stop()
+        {
+            _isPaused = false;
+            _search->Cancel();
+
+            if ( _watchThread.joinable() )
+            {
+                _watchThread.join();
+            }
+
+            // the reader sees the end of the pipe
+            if (_pipe[1] >= 0)
+            {
+                close(_pipe[1]);
+                _pipe[1] = -1;
+            }
+
+            if ( _readThread.joinable() )
+            {
+                _readThread.join();
+            }
+
+            if (_pipe[0] >= 0)
+            {
+                close(_pipe[0]);
+                _pipe[0] = -1;
+            }
+        }
+
+        // Records written since the last call, once there are at least Count of them (or after
+        // WATCH_TIMEOUT), and after WATCH_SETTLE_TIME more, so unexpected ones are returned too
+        vector<Record> Take(size_t Count)
+        {
+            const auto deadline = chrono::steady_clock::now() + chrono::milliseconds(WATCH_TIMEOUT);
+
+            while ( (Records().size() < _taken + Count) && (chrono::steady_clock::now() < deadline) )
+            {
+                this_thread::sleep_for( chrono::milliseconds(10) );
+            }
+
+            this_thread::sleep_for( chrono::milliseconds(WATCH_SETTLE_TIME) );
+
+            vector<Record> records = Records();
+
+            records.erase( records.begin(), records.begin() + static_cast<ptrdiff_t>( min(_taken, records.size()) ) );
+            _taken += records.size();
+
+            return records;
+        }
+
+        void Pause()
+        {
+            _isPaused = true;
+        }
+
+        void Resume()
+        {
+            _isPaused = false;
+        }
+
+        // Waits (up to WATCH_TIMEOUT) until the pipe is full: the watcher is then blocked writing
+        // its results; returns false if it never fills up
+        bool WaitUntilBlocked() const
+        {
+            const int  capacity = fcntl(_pipe[0], F_GETPIPE_SZ);
+            const auto deadline = chrono::steady_clock::now() + chrono::milliseconds(WATCH_TIMEOUT);
+            int        pending = 0;
+
+            while (chrono::steady_clock::now() < deadline)
+            {
+                if ( (0 == ioctl(_pipe[0], FIONREAD, &pending)) && (pending >= capacity) )
+                {
+                    return true;
+                }
+
+                this_thread::sleep_for( chrono::milliseconds(10) );
+            }
+
+            return false;
+        }
+
+    private:
+        // Every complete line written so far
+        vector<Record> Records()
+        {
+            string output{};
+
+            {
+                lock_guard<mutex> lock(_mutex);
+
+                output = _output;
+            }
+
+            vector<Record> records{};
+            size_t         start = 0;
+
+            // {"path":"...","matches":[{"position":N,...},...]}: paths and affixes of the tests hold no quote
+            for (size_t end = output.find('\n'); string::npos != end; start = end + 1, end = output.find('\n', start))
+            {
+                const string line = output.substr(start, end - start);
+                const size_t pathStart = line.find("\"path\":\"") + 8;
+                const size_t pathEnd = line.find('"', pathStart);
+                Record       record{ fs::path( line.substr(pathStart, pathEnd - pathStart) ).filename().string(), {} };
+
+                for (size_t position = line.find("\"position\":"); string::npos != position;
+                     position = line.find("\"position\":", position + 1))
+                {
+                    record.positions.push_back( stoull( line.substr(position + 11) ) );
+                }
+
+                records.push_back( std::move(record) );
+            }
+
+            return records;
+        }
+
+        SearchEngine              _engine;
+        unique_ptr<DataExtractor> _search;
+        int                       _pipe[2];
+        thread                    _watchThread;
+        thread                    _readThread;
+        mutex                     _mutex;
+        string                    _output;
+        size_t                    _taken;
+        atomic<bool>              _isPaused;
+    };
+
+    void Append(const fs::path& File, const string& Text)
+    {
+        ofstream stream(File, ios::binary | ios::app);
+
+        stream << Text;
+    }
+
+    // Single record of File whose matches are at Positions
+    bool IsOnly(const vector<Record>& Records, const string& File, const vector<uint64_t>& Positions)
+    {
+        return (1 == Records.size()) && (Records[0].name == File) && (Records[0].positions == Positions);
+    }
+
+    // Appends, a match split across two writes and a truncated file, each reported once
+    void TestAppends(TestContext& Context, const fs::path& Root)
+    {
+        WatchedSearch search(Root, { "needle" }, false);
+
+        Append(Root / "log", "xx needle\n");
+
+        if ( !Context.Check(search.Start(), "watch started") )
+        {
+            return;
+        }
+
+        Context.Check( IsOnly(search.Take(1), "log", { 3 }), "first search" );
+
+        Append(Root / "log", "aa needle\n");
+        Context.Check( IsOnly(search.Take(1), "log", { 13 }), "appended match" );
+
+        // the first half alone matches nothing; the marker tells it was searched
+        Append(Root / "log", "bb nee");
+        Append(Root / "marker", "needle\n");
+        Context.Check( IsOnly(search.Take(1), "marker", { 0 }), "first half of a split match" );
+
+        Append(Root / "log", "dle\n");
+        Context.Check( IsOnly(search.Take(1), "log", { 23 }), "second half of a split match" );
+
+        // smaller than before: everything is new
+        ofstream(Root / "log", ios::binary | ios::trunc) << "needle";
+        Context.Check( IsOnly(search.Take(1), "log", { 0 }), "truncated file" );
+
+        Append(Root / "log", " needle");
+        Context.Check( IsOnly(search.Take(1), "log", { 7 }), "appended after truncation" );
+    }
+
+    // Regular expressions: a match extended by appended bytes is not reported again
+    void TestRegexAppends(TestContext& Context, const fs::path& Root)
+    {
+        WatchedSearch search(Root, { "a+" }, true);
+
+        Append(Root / "regex", "xx aaa");
+
+        if ( !Context.Check(search.Start(), "regex watch started") )
+        {
+            return;
+        }
+
+        Context.Check( IsOnly(search.Take(1), "regex", { 3 }), "regex first search" );
+
+        Append(Root / "regex", "aa yy");
+        Context.Check( IsOnly(search.Take(1), "regex", { 6 }), "regex match extended" );
+
+        Append(Root / "regex", " a");
+        Context.Check( IsOnly(search.Take(1), "regex", { 12 }), "regex appended match" );
+    }
+
+    // Lost changes (inotify queue overflow) make the watcher look at every file again: only the
+    // files that grew are searched, and only their new bytes
+    void TestOverflow(TestContext& Context, const fs::path& Root)
+    {
+        WatchedSearch search(Root, { "needle" }, false);
+        ifstream      limitStream("/proc/sys/fs/inotify/max_queued_events");
+        size_t        maxQueuedEvents = 16384;
+        string        burst{};
+
+        limitStream >> maxQueuedEvents;
+        Append(Root / "log", "xx needle\n");
+        Append(Root / "quiet", "needle\n");
+        Append(Root / "noise-a", "x");
+        Append(Root / "noise-b", "x");
+
+        if ( !Context.Check(search.Start(), "overflow watch started") )
+        {
+            return;
+        }
+
+        Context.Check(search.Take(2).size() == 2, "overflow first search");
+
+        // the watcher blocks writing the results of the burst, while changes pile up
+        for (size_t i = 0; i < BURST_MATCHES; ++i)
+        {
+            burst += "needle ";
+        }
+
+        search.Pause();
+        Append(Root / "burst", burst);
+
+        if ( !Context.Check(search.WaitUntilBlocked(), "watcher blocked") )
+        {
+            search.Resume();
+            return;
+        }
+
+        {
+            ofstream noiseA(Root / "noise-a", ios::binary | ios::app);
+            ofstream noiseB(Root / "noise-b", ios::binary | ios::app);
+
+            // alternate files: identical successive events would be merged into one
+            for (size_t i = 0; i < maxQueuedEvents; ++i)
+            {
+                noiseA << 'x' << flush;
+                noiseB << 'x' << flush;
+            }
+        }
+
+        // its change is lost
+        Append(Root / "log", "aa needle\n");
+
+        stringstream    console{};
+        streambuf* const previousBuffer = cout.rdbuf( console.rdbuf() );
+
+        search.Resume();
+
+        const vector<Record> records = search.Take(2);
+
+        cout.rdbuf(previousBuffer);
+
+        Context.Check( console.str().find("Too many changes at once") != string::npos, "overflow reported" );
+        Context.Check( (2 == records.size()) && (records[0].name == "burst") && (records[0].positions.size() == BURST_MATCHES),
+                       "burst reported once" );
+        Context.Check( (2 == records.size()) && (records[1].name == "log") && (records[1].positions == vector<uint64_t>{ 13 }),
+                       "only the new match reported after the rescan" );
+    }
+}
+#endif
+
+void TestWatchMode(TestContext& Context)
+{
+#ifdef __linux__
+    const fs::path root = fs::temp_directory_path() / ( "stringfinder-watch-" + to_string( random_device()() ) );
+    error_code     error;
+
+    for (auto&& test : { TestAppends, TestRegexAppends, TestOverflow })
+    {
+        fs::remove_all(root, error);
+        fs::create_directories(root, error);
+        test(Context, root);
+    }
+
+    fs::remove_all(root, error);
+#else
+    // FileWatcher is only supported on Linux
+    (void)Context;
+#endif
+}
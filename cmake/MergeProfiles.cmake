@@ -0,0 +1,23 @@
+# Last step of the profile recording (pgo-train): Clang writes one raw profile per process, which
+# must be merged into the single profile read with STRINGFINDER_PGO=USE; GCC profiles are used as is
+if (NOT COMPILER_ID MATCHES "Clang")
+    return()
+endif()
+
+find_program(LLVM_PROFDATA NAMES llvm-profdata)
+file(GLOB rawProfiles "${PROFILE_DIR}/*.profraw")
+
+if (NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "llvm-profdata is required to merge the Clang profiles")
+endif()
+
+if (NOT rawProfiles)
+    message(FATAL_ERROR "No profile found in ${PROFILE_DIR}")
+endif()
+
+execute_process(COMMAND ${LLVM_PROFDATA} merge -output=${PROFILE_DIR}/stringfinder.profdata ${rawProfiles}
+                RESULT_VARIABLE result)
+
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Profiles cannot be merged")
+endif()